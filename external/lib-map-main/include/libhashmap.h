@@ -0,0 +1,84 @@
+#pragma once
+
+#ifndef __LIBHASHMAP__
+#define __LIBHASHMAP__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Open addressing hash map with Robin Hood probing.
+// -> Lookups are O(1) on average: the key's hash picks a slot & probing stops
+//    as soon as a slot holds an entry closer to its own home than the key
+//    would be.
+// -> Deleting shifts the following entries of the cluster back one slot, so
+//    there are no tombstones & lookups never slow down over time.
+// -> Hashing & equality are pluggable, pointer, 64-bit integer & C string
+//    keys come built in.
+// -> Keys & values belong to the caller, nothing here frees them.
+typedef uint64_t (*HashMapHash)(const void *key);
+typedef bool (*HashMapEquals)(const void *a, const void *b);
+
+typedef struct HashMapEntry {
+  void *key;
+  void *value;
+  uint32_t hash;      // low bits of the key's hash, compared before 'equals'
+  uint32_t distance;  // 1 + slots away from its home slot, 0 when empty
+} HashMapEntry;
+
+typedef struct HashMap {
+  HashMapEntry *entries;
+  size_t capacity;  // power of two
+  size_t size;
+
+  HashMapHash hash;
+  HashMapEquals equals;
+} HashMap;
+
+// -> Create a new empty map, NULL 'hash' & 'equals' compare the pointers
+HashMap *NewHashMap(HashMapHash hash, HashMapEquals equals);
+// -> Keys compared by address
+HashMap *NewPointerHashMap(void);
+// -> Keys are integers cast to (void *)(uintptr_t), 64-bit on 64-bit builds
+HashMap *NewIntHashMap(void);
+// -> Keys are NUL terminated strings compared by content, not copied
+HashMap *NewStringHashMap(void);
+
+// -> Free the table, keys & values stay the caller's
+void HashMapFreeMemory(HashMap *map);
+
+// -> Grow so 'count' entries fit without another rehash. False when out of
+//    memory, the map is left as it was
+bool HashMapReserve(HashMap *map, size_t count);
+
+// -> Insert or replace the value of an equal key. False when out of memory
+bool HashMapPut(HashMap *map, void *key, void *value);
+// -> The value of 'key', NULL when it isn't there
+void *HashMapGet(HashMap *map, const void *key);
+bool HashMapContains(HashMap *map, const void *key);
+// -> Remove 'key' & return its value, NULL when it wasn't there
+void *HashMapDelete(HashMap *map, const void *key);
+
+// -> Remove every entry, the capacity stays
+void HashMapClear(HashMap *map);
+size_t HashMapSize(HashMap *map);
+bool isHashMapEmpty(HashMap *map);
+
+// -> Iterate from '*iterator' = 0 until it returns false, in no particular
+//    order. 'key' & 'value' may be NULL. The map must not change meanwhile
+bool HashMapNext(HashMap *map, size_t *iterator, void **key, void **value);
+
+// -> 64-bit FNV-1a of a NUL terminated string, stable across runs & builds so
+//    it can name files. Its low bits are weak, HashMapHashString() mixes them
+uint64_t HashString64(const char *string);
+
+uint64_t HashMapHashPointer(const void *key);
+uint64_t HashMapHashInt(const void *key);
+uint64_t HashMapHashString(const void *key);
+bool HashMapEqualsPointer(const void *a, const void *b);
+bool HashMapEqualsString(const void *a, const void *b);
+
+#endif  //__LIBHASHMAP__
@@ -0,0 +1,254 @@
+#include "libhashmap.h"
+
+#define HASHMAP_MIN_CAPACITY 16
+
+// Final mix of splitmix64, every bit of the key reaches the low bits the
+// slot is picked with
+static uint64_t MixHash(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ull;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBull;
+  x ^= x >> 31;
+
+  return x;
+}
+
+uint64_t HashMapHashPointer(const void *key) {
+  return MixHash((uint64_t)(uintptr_t)key);
+}
+
+uint64_t HashMapHashInt(const void *key) {
+  return MixHash((uint64_t)(uintptr_t)key);
+}
+
+uint64_t HashString64(const char *string) {
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ull;
+
+  for (const unsigned char *c = (const unsigned char *)string; *c != '\0';
+       c++) {
+    hash ^= *c;
+    hash *= 1099511628211ull;
+  }
+
+  return hash;
+}
+
+uint64_t HashMapHashString(const void *key) {
+  return MixHash(HashString64((const char *)key));
+}
+
+bool HashMapEqualsPointer(const void *a, const void *b) { return a == b; }
+
+bool HashMapEqualsString(const void *a, const void *b) {
+  return strcmp((const char *)a, (const char *)b) == 0;
+}
+
+HashMap *NewHashMap(HashMapHash hash, HashMapEquals equals) {
+  HashMap *map = (HashMap *)malloc(sizeof(HashMap));
+
+  if (map == NULL) {
+    printf("HASHMAP INIT Exception -> Failed to allocate memory!\n");
+    return NULL;
+  }
+
+  map->entries =
+      (HashMapEntry *)calloc(HASHMAP_MIN_CAPACITY, sizeof(HashMapEntry));
+
+  if (map->entries == NULL) {
+    printf("HASHMAP INIT Exception -> Failed to allocate memory!\n");
+    free(map);
+    return NULL;
+  }
+
+  map->capacity = HASHMAP_MIN_CAPACITY;
+  map->size = 0;
+  map->hash = (hash != NULL) ? hash : HashMapHashPointer;
+  map->equals = (equals != NULL) ? equals : HashMapEqualsPointer;
+
+  return map;
+}
+
+HashMap *NewPointerHashMap(void) {
+  return NewHashMap(HashMapHashPointer, HashMapEqualsPointer);
+}
+
+HashMap *NewIntHashMap(void) {
+  return NewHashMap(HashMapHashInt, HashMapEqualsPointer);
+}
+
+HashMap *NewStringHashMap(void) {
+  return NewHashMap(HashMapHashString, HashMapEqualsString);
+}
+
+void HashMapFreeMemory(HashMap *map) {
+  if (map == NULL) return;
+
+  free(map->entries);
+  free(map);
+}
+
+// Kept at most 7/8 full, Robin Hood probing stays short even that full
+static bool Fits(size_t count, size_t capacity) {
+  return count * 8 <= capacity * 7;
+}
+
+// Places an entry whose key isn't in the table yet. Whenever it's further
+// from home than the entry in the slot, it takes the slot & that entry moves
+// on instead
+static void InsertEntry(HashMapEntry *entries, size_t mask,
+                        HashMapEntry entry) {
+  size_t index = entry.hash & mask;
+  entry.distance = 1;
+
+  for (;;) {
+    HashMapEntry *slot = &entries[index];
+
+    if (slot->distance == 0) {
+      *slot = entry;
+      return;
+    }
+
+    if (slot->distance < entry.distance) {
+      HashMapEntry displaced = *slot;
+      *slot = entry;
+      entry = displaced;
+    }
+
+    index = (index + 1) & mask;
+    entry.distance++;
+  }
+}
+
+static bool Rehash(HashMap *map, size_t capacity) {
+  HashMapEntry *entries =
+      (HashMapEntry *)calloc(capacity, sizeof(HashMapEntry));
+
+  if (entries == NULL) {
+    fprintf(stderr,
+            "Failed to allocate memory for HashMap's Entries. ERROR "
+            "ALLOCATING MEMORY\n");
+    return false;
+  }
+
+  // The stored hash bits pick the new home, no key is hashed again
+  for (size_t i = 0; i < map->capacity; i++) {
+    if (map->entries[i].distance != 0) {
+      InsertEntry(entries, capacity - 1, map->entries[i]);
+    }
+  }
+
+  free(map->entries);
+  map->entries = entries;
+  map->capacity = capacity;
+
+  return true;
+}
+
+bool HashMapReserve(HashMap *map, size_t count) {
+  size_t capacity = map->capacity;
+
+  while (!Fits(count, capacity)) capacity *= 2;
+
+  if (capacity == map->capacity) return true;
+  return Rehash(map, capacity);
+}
+
+// Slot of 'key', 'capacity' when it isn't there. The probe stops at the
+// first slot closer to its home than the key would be by then
+static size_t FindIndex(HashMap *map, const void *key, uint32_t hash) {
+  size_t mask = map->capacity - 1;
+  size_t index = hash & mask;
+
+  for (uint32_t distance = 1;; distance++) {
+    HashMapEntry *slot = &map->entries[index];
+
+    if (slot->distance < distance) return map->capacity;
+    if (slot->hash == hash && map->equals(slot->key, key)) return index;
+
+    index = (index + 1) & mask;
+  }
+}
+
+bool HashMapPut(HashMap *map, void *key, void *value) {
+  uint32_t hash = (uint32_t)map->hash(key);
+  size_t index = FindIndex(map, key, hash);
+
+  if (index < map->capacity) {
+    map->entries[index].value = value;
+    return true;
+  }
+
+  if (!Fits(map->size + 1, map->capacity) &&
+      !Rehash(map, map->capacity * 2)) {
+    return false;
+  }
+
+  InsertEntry(map->entries, map->capacity - 1,
+              (HashMapEntry){.key = key, .value = value, .hash = hash});
+  map->size++;
+
+  return true;
+}
+
+void *HashMapGet(HashMap *map, const void *key) {
+  if (isHashMapEmpty(map)) return NULL;
+
+  size_t index = FindIndex(map, key, (uint32_t)map->hash(key));
+  return (index < map->capacity) ? map->entries[index].value : NULL;
+}
+
+bool HashMapContains(HashMap *map, const void *key) {
+  if (isHashMapEmpty(map)) return false;
+  return FindIndex(map, key, (uint32_t)map->hash(key)) < map->capacity;
+}
+
+void *HashMapDelete(HashMap *map, const void *key) {
+  if (isHashMapEmpty(map)) return NULL;
+
+  size_t index = FindIndex(map, key, (uint32_t)map->hash(key));
+  if (index >= map->capacity) return NULL;
+
+  void *value = map->entries[index].value;
+  size_t mask = map->capacity - 1;
+  size_t next = (index + 1) & mask;
+
+  // Backward shift: the rest of the cluster moves one slot closer to home,
+  // up to an empty slot or an entry that's home already
+  while (map->entries[next].distance > 1) {
+    map->entries[index] = map->entries[next];
+    map->entries[index].distance--;
+
+    index = next;
+    next = (next + 1) & mask;
+  }
+
+  map->entries[index] = (HashMapEntry){0};
+  map->size--;
+
+  return value;
+}
+
+void HashMapClear(HashMap *map) {
+  memset(map->entries, 0, map->capacity * sizeof(HashMapEntry));
+  map->size = 0;
+}
+
+size_t HashMapSize(HashMap *map) { return map->size; }
+
+bool isHashMapEmpty(HashMap *map) { return map->size == 0; }
+
+bool HashMapNext(HashMap *map, size_t *iterator, void **key, void **value) {
+  while (*iterator < map->capacity) {
+    HashMapEntry *slot = &map->entries[(*iterator)++];
+    if (slot->distance == 0) continue;
+
+    if (key != NULL) *key = slot->key;
+    if (value != NULL) *value = slot->value;
+
+    return true;
+  }
+
+  return false;
+}
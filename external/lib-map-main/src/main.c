@@ -1,7 +1,8 @@
+#include <stdint.h>
 #include <stdio.h>
-#include <sys/time.h>
 #include <time.h>
 
+#include "libhashmap.h"
 #include "libmap.h"
 
 // -> Create a new Empty Map                                    = Map
@@ -25,54 +26,128 @@
 // -> Copy one map to another map                               = void
 // MapCopy(Map *source, Map *dest);
 
-long long currentTimeInMillis() {
-  struct timeval tv;
-  gettimeofday(&tv, NULL);
-  return (long long)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+// Map vs HashMap on integer keys, 1k & 1M entries.
+// -> Map's get & delete scan every key, at 1M a full pass of either would take
+//    hours, so they run on a sample of MAP_SAMPLE keys & report per operation.
+// -> Keys are looked up & deleted in a shuffled order, not the insert order.
+#define MAP_SAMPLE 1000
+
+static volatile uintptr_t sink;
+
+double currentTimeInNanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
 }
 
-int main() {
-  long long startTimeMillis = currentTimeInMillis();
+// Keys 1..count in a shuffled order, 0 is never a key
+static uintptr_t *ShuffledKeys(size_t count) {
+  uintptr_t *keys = (uintptr_t *)malloc(count * sizeof(uintptr_t));
+  if (keys == NULL) return NULL;
 
-  Map *map = NewMap(NULL);
-  for (int i = 0; i < 2048; i++) {
-    // Using intptr_t to avoid integer overflow when casting to void *
-    // This is a common workaround for C's lack of support for arbitrary-size
-    // integers
-
-    // Insert key-value pair into the map
-    // Note: The key and value are stored as void * pointers,
-    // but they are actually integers (the cast is needed to avoid integer
-    // overflow)
-
-    // In a real-world scenario, you would want to use more complex data types
-    // or allocate memory dynamically for the keys and values.
-    // For this example, we're using integers as keys and values.
-    MapPut(map, (void *)(intptr_t)i, (void *)(intptr_t)i + 1);
-
-    printf("Key: %d, Value: %d\n", i, MapGet(map, (void *)(intptr_t)i));
+  for (size_t i = 0; i < count; i++) keys[i] = i + 1;
+
+  uint64_t state = 0x9E3779B97F4A7C15ull;
+  for (size_t i = count - 1; i > 0; i--) {
+    // xorshift64
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+
+    size_t j = state % (i + 1);
+    uintptr_t swap = keys[i];
+    keys[i] = keys[j];
+    keys[j] = swap;
   }
 
-  printf("Size of map: %d\n", MapSize(map));
-  printf("Size of map in Bytes: %zu\n", sizeof(map->entrySize));
+  return keys;
+}
+
+static void PrintRow(const char *name, const char *operation, size_t count,
+                     double nanos) {
+  printf("  %-8s %-7s %8zu ops %12.2f ms %10.1f ns/op\n", name, operation,
+         count, nanos / 1e6, nanos / (double)count);
+}
+
+static void BenchmarkMap(uintptr_t *keys, size_t count) {
+  size_t sample = (count < MAP_SAMPLE) ? count : MAP_SAMPLE;
+  Map *map = NewMap(NULL);
 
-  // ----------------------------------------------------------------
-  // Function MapGet returns a pointer to the value at the given key passed in
-  // the MapDelete function call below.
-  void *data = MapDelete(map, (void *)(intptr_t)69);
-  if (data) {
-    printf("Deleted Key: 69, Value: %d\n", data);
+  double start = currentTimeInNanos();
+  for (size_t i = 0; i < count; i++) {
+    MapPut(map, (void *)(i + 1), (void *)(i + 1));
   }
+  PrintRow("Map", "put", count, currentTimeInNanos() - start);
 
-  // Note: The number of elements decreases since we performed a MapDelete()
-  // call
-  printf("Size of map after: %d\n", MapSize(map));
+  start = currentTimeInNanos();
+  for (size_t i = 0; i < sample; i++) {
+    sink += (uintptr_t)MapGet(map, (void *)keys[i]);
+  }
+  PrintRow("Map", "get", sample, currentTimeInNanos() - start);
+
+  start = currentTimeInNanos();
+  for (size_t i = 0; i < sample; i++) {
+    sink += (uintptr_t)MapDelete(map, (void *)keys[i]);
+  }
+  PrintRow("Map", "delete", sample, currentTimeInNanos() - start);
 
-  // ----------------------------------------------------------------
-  // Remember to free the map after you are done with it!
+  // The keys & values aren't allocations, don't let MapFreeMemory() free them
+  MapClear(map);
   MapFreeMemory(map);
+}
+
+static void BenchmarkHashMap(uintptr_t *keys, size_t count) {
+  HashMap *map = NewIntHashMap();
+
+  double start = currentTimeInNanos();
+  for (size_t i = 0; i < count; i++) {
+    HashMapPut(map, (void *)(i + 1), (void *)(i + 1));
+  }
+  PrintRow("HashMap", "put", count, currentTimeInNanos() - start);
+
+  start = currentTimeInNanos();
+  for (size_t i = 0; i < count; i++) {
+    sink += (uintptr_t)HashMapGet(map, (void *)keys[i]);
+  }
+  PrintRow("HashMap", "get", count, currentTimeInNanos() - start);
+
+  start = currentTimeInNanos();
+  for (size_t i = 0; i < count; i++) {
+    sink += (uintptr_t)HashMapGet(map, (void *)(keys[i] + count));
+  }
+  PrintRow("HashMap", "miss", count, currentTimeInNanos() - start);
+
+  start = currentTimeInNanos();
+  for (size_t i = 0; i < count; i++) {
+    sink += (uintptr_t)HashMapDelete(map, (void *)keys[i]);
+  }
+  PrintRow("HashMap", "delete", count, currentTimeInNanos() - start);
+
+  if (!isHashMapEmpty(map)) {
+    printf("HashMap still holds %zu entries!\n", HashMapSize(map));
+  }
+
+  HashMapFreeMemory(map);
+}
+
+int main() {
+  size_t counts[] = {1000, 1000000};
+
+  for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+    uintptr_t *keys = ShuffledKeys(counts[i]);
+
+    if (keys == NULL) {
+      fprintf(stderr, "Failed to allocate the benchmark keys\n");
+      return 1;
+    }
+
+    printf("%zu entries:\n", counts[i]);
+    BenchmarkMap(keys, counts[i]);
+    BenchmarkHashMap(keys, counts[i]);
+    printf("\n");
+
+    free(keys);
+  }
 
-  long long endTimeMillis = currentTimeInMillis();
-  printf("\nTime taken: %lld ms\n", endTimeMillis - startTimeMillis);
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#include "engine.h"
+
+/*
+ -> Linear bump allocator, nothing is freed individually, the whole arena is reset at once.
+ -> 'engine->frameArena' holds everything that only lives for one frame, every frame snapshot has its own (renderthread.h),
+    #GetThreadArena() gives every thread its own arena for scoped scratch (#ArenaMark() / #ArenaRewind()).
+ -> Requests that don't fit fall back to the heap & are counted, in a steady-state frame that counter must stay at 0.
+*/
+typedef struct Arena {
+    unsigned char *base;
+    size_t capacity, offset;
+    struct ArenaFallback *fallbacks;  // heap blocks for requests that didn't fit, freed on reset
+
+    size_t lastUsed;   // bytes in use when the arena was last reset
+    size_t highWater;  // most bytes ever in use at once
+    int frameFallbacks, lastFallbacks, totalFallbacks;
+} Arena;
+
+Arena *NewArena(size_t capacity);
+void FreeArena(Arena *arena);
+
+void *ArenaAlloc(Arena *arena, size_t size, size_t alignment);
+
+/* Drop every allocation, records the usage statistics & frees heap fallbacks */
+void ResetArena(Arena *arena);
+
+static inline size_t ArenaMark(Arena *arena) {
+    return arena->offset;
+}
+
+/* Drop everything allocated since 'mark', heap fallbacks live until the next #ResetArena() */
+static inline void ArenaRewind(Arena *arena, size_t mark) {
+    if (arena->offset > arena->highWater) arena->highWater = arena->offset;
+    if (mark <= arena->offset) arena->offset = mark;
+}
+
+#define ArenaPush(arena, type, count) ((type *)ArenaAlloc((arena), sizeof(type) * (size_t)(count), _Alignof(type)))
+
+/* Calling thread's arena, created on first use with ENGINE_THREAD_ARENA_SIZE bytes, NULL when that failed */
+Arena *GetThreadArena(void);
+void FreeThreadArena(void);
+
+/* #ResetArena() of the calling thread's arena if it has one, where no scratch of it is live (frame end, between jobs) */
+void ResetThreadArena(void);
+
+#endif  // ARENA_H
@@ -0,0 +1,77 @@
+#pragma once
+
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <stdint.h>
+
+#include "engine.h"
+
+/*
+ -> Engine wide registry of loaded assets, keyed by the asset type, the normalized path & whatever changes what loading
+    it produces (import flags, texture type). A HashMap (libhashmap.h) on a 64-bit hash of them, a match compares all.
+ -> Loading something already registered hands out the existing asset with one more reference instead of a copy, so
+    memory & VRAM scale with unique assets. Models share their meshes' buffers, textures & BVHs this way.
+ -> The last #ReleaseAsset() unregisters it & calls its 'free', which deletes GL objects through
+    #RunOnRenderThread(). Whoever releases it makes sure no snapshot in flight still draws it.
+ -> Any thread, the table is guarded by a mutex.
+*/
+typedef enum AssetType {
+    ASSET_MODEL,
+    ASSET_TEXTURE,
+    ASSET_SHADER,
+    ASSET_TYPE_COUNT
+} AssetType;
+
+/* What an asset is looked up & registered by, from #NewAssetKey() & freed with #FreeAssetKey() */
+typedef struct AssetKey {
+    uint64_t hash;
+    AssetType type;
+    char *path;  // normalized, NULL when normalizing it failed: nothing matches it & it can't be registered
+    uint64_t options;
+} AssetKey;
+
+typedef struct Asset {
+    AssetKey key;    // its own copy of the path
+    int references;  // guarded by the registry lock
+
+    void *data;  // Model asset, Texture or Shader
+    void (*free)(struct Asset *asset);
+} Asset;
+
+typedef struct AssetStats {
+    int counts[ASSET_TYPE_COUNT];  // unique assets of each type
+    long references;               // held across all of them
+    long hits, misses;             // #AcquireAsset() found it or not, since startup
+} AssetStats;
+
+void InitAssetRegistry(void);
+/* Frees every asset still registered whatever its references, once nothing can draw them anymore */
+void ShutdownAssetRegistry(void);
+
+/* Heap copy with '\' turned into '/', '.' segments & duplicate slashes dropped & "dir/.." folded */
+char *NormalizeAssetPath(const char *path);
+
+AssetKey NewAssetKey(AssetType type, const char *path, uint64_t options);
+
+/* Key of an asset loaded from two files, each normalized on its own & joined by a newline no path holds */
+AssetKey NewAssetKeyPair(AssetType type, const char *first, const char *second, uint64_t options);
+void FreeAssetKey(AssetKey *key);
+
+/* The registered asset with one more reference, NULL when there's none */
+Asset *AcquireAsset(const AssetKey *key);
+
+/*
+ -> Registers 'data' under 'key' with one reference. When another thread registered the key first, that asset comes
+    back with a reference instead & '*inserted' is false: the caller frees its own 'data'.
+ -> NULL & '*inserted' false when it couldn't be registered at all (no memory), the caller frees its 'data' too.
+*/
+Asset *RegisterAsset(const AssetKey *key, void *data, void (*release)(Asset *asset), bool *inserted);
+
+/* Another reference to an asset the caller already holds one of */
+Asset *RetainAsset(Asset *asset);
+void ReleaseAsset(Asset *asset);
+
+AssetStats GetAssetStats(void);
+
+#endif  // ASSETS_H
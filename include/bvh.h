@@ -0,0 +1,104 @@
+#pragma once
+
+#ifndef BVH_H
+#define BVH_H
+
+#include "engine.h"
+
+/* Traversal stack, builds stop splitting before a near/far descent could outgrow it */
+#define BVH_STACK_SIZE 64
+
+/*
+ -> Bounding volume hierarchy over 'count' AABB primitives, built top down with a binned SAH
+    (ENGINE_BVH_SAH_BINS buckets per axis) & refit bottom up when primitives move.
+ -> Children of a node are always stored next to each other, the right one is 'first + 1'.
+*/
+typedef struct BVHNode {
+    vec3s min;
+    int first;  // left child for inner nodes, first slot in 'indices' for leaves
+    vec3s max;
+    int count;  // primitives in a leaf, 0 for inner nodes
+} BVHNode;
+
+typedef struct BVH {
+    BVHNode *nodes;
+    int nodeCount;
+
+    int *indices;  // primitive ids in leaf order
+    int *parents;  // parent of every node, -1 for the root
+    int *leaves;   // leaf holding every primitive
+
+    vec3s *mins, *maxs;  // primitive bounds, indexed by primitive id
+    int count, capacity;
+
+    /* Build settings, a leaf's primitives are tested 'leafWidth' at a time (SIMD lanes) when pricing splits */
+    int maxLeafSize, leafWidth;
+} BVH;
+
+typedef struct BVHHit {
+    int primitive;
+    float distance;
+} BVHHit;
+
+/*
+ -> Exact test for a primitive whose box the ray entered, e.g. against the mesh inside it.
+ -> Return true & write 'distance' (< 'maxDistance') on a hit, NULL uses the box itself.
+*/
+typedef bool (*BVHHitTest)(void *data, int primitive, const Ray *ray, float maxDistance, float *distance);
+
+/* Scene style settings, ENGINE_BVH_MAX_LEAF_SIZE primitives per leaf tested one at a time */
+BVH *NewBVH(void);
+void FreeBVH(BVH *bvh);
+
+/* Rebuild from scratch over 'count' primitives, primitive i is [mins[i], maxs[i]] */
+void BuildBVH(BVH *bvh, const vec3s *mins, const vec3s *maxs, int count);
+
+/* Move one primitive & grow/shrink its ancestors, stops as soon as a node's box doesn't change */
+void UpdateBVHPrimitive(BVH *bvh, int primitive, vec3s min, vec3s max);
+
+/* Recompute every node from the primitive bounds, for when most of them moved */
+void RefitBVH(BVH *bvh);
+
+bool BVHRayClosest(const BVH *bvh, const Ray *ray, float maxDistance, BVHHitTest test, void *data, BVHHit *hit);
+
+/* Stops at the first hit, for occlusion style queries where which one doesn't matter */
+bool BVHRayAny(const BVH *bvh, const Ray *ray, float maxDistance, BVHHitTest test, void *data);
+
+/* Slab test, returns the entry distance (0 when the origin is inside) or -1 when the ray misses within 'maxDistance' */
+float RayBoxDistance(const Ray *ray, vec3s inverseDirection, vec3s min, vec3s max, float maxDistance);
+
+/*
+ -> World bounds of every scene object & model in a BVH for picking.
+ -> #UpdateSceneBVH() rebuilds when objects were added/removed & only walks the changed leaves up otherwise,
+    an owner counts as changed when the versions of its transforms moved.
+*/
+typedef struct SceneBVHEntry {
+    SceneObject *object;
+    Model3D *model;
+    unsigned int version;  // sum of the owner's transform versions when its bounds were taken
+} SceneBVHEntry;
+
+typedef struct SceneBVH {
+    BVH *bvh;
+
+    SceneBVHEntry *entries;
+    vec3s *mins, *maxs;
+    int count, capacity;
+
+    int rebuilds, refits;  // since startup
+} SceneBVH;
+
+SceneBVH *NewSceneBVH(void);
+void FreeSceneBVH(SceneBVH *scene);
+
+void UpdateSceneBVH(SceneBVH *scene);
+
+/* Closest object or model the ray hits, one of them is set on success. Models are tested down to their triangles */
+bool PickScene(SceneBVH *scene, const Ray *ray, SceneObject **object, Model3D **model, float *distance);
+
+#ifdef ENGINE_SELF_TESTS
+/* Build, refit & pick timings against a linear scan at 10k, 100k & 1M random boxes, results are printed */
+void BenchmarkBVH(void);
+#endif  // ENGINE_SELF_TESTS
+
+#endif  // BVH_H
@@ -15,4 +15,13 @@ void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 void cursor_position_callback(GLFWwindow *window, double xpos, double ypos);
 void window_close_callback(GLFWwindow *window);
 
+/* Last cursor position in window coordinates */
+vec2s GetCursorPosition(void);
+
+/* Hover the picked owner (at most one of them is set) & un-hover the previous one, shared by both picking backends */
+void SetHoveredOwner(SceneObject *object, Model3D *model);
+
+/* Called before an object or model goes away, the next hover change won't write through it. NULL forgets both */
+void ForgetHoveredOwner(const void *owner);
+
 #endif  // CALLBACKS_H
\ No newline at end of file
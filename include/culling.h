@@ -0,0 +1,52 @@
+#pragma once
+
+#ifndef CULLING_H
+#define CULLING_H
+
+#include "arena.h"
+#include "engine.h"
+#include "renderqueue.h"
+#include "simd.h"
+
+/*
+ -> World space AABBs as centers & half extents, one stream per component so a plane can be tested
+    against 4 (SSE) or 8 (AVX2) boxes at once.
+ -> A box is outside when, for any plane, n.center + |n|.extent + d < 0 (the corner furthest along the
+    normal is still behind it), planes don't need to be normalized for that.
+*/
+typedef struct CullBounds {
+    float *centerX, *centerY, *centerZ;
+    float *extentX, *extentY, *extentZ;
+
+    int count, capacity;
+} CullBounds;
+
+/* Push the streams for 'capacity' boxes from 'arena', they live until the arena is reset */
+bool BeginCullBounds(CullBounds *bounds, Arena *arena, int capacity);
+
+void AddCullBounds(CullBounds *bounds, vec3s min, vec3s max);
+
+/* Smallest world AABB holding the local box [min, max] under 'model' */
+void TransformBounds(const mat4s *model, vec3s min, vec3s max, vec3s *worldMin, vec3s *worldMax);
+
+/* World AABB of an object or model across all of its instances, unbounded when it has no BoundingBox */
+void GetWorldBounds(SceneObject *object, Model3D *model, vec3s *worldMin, vec3s *worldMax);
+
+/* Write the indices of every box touching the frustum into 'visible' (room for 'count'), returns how many */
+int CullFrustum(const Plane frustum[6], const CullBounds *bounds, int *visible);
+
+/* Same with a forced kernel, levels the CPU doesn't support fall back to the best supported one */
+int CullFrustumLevel(SimdLevel level, const Plane frustum[6], const CullBounds *bounds, int *visible);
+
+/* Cull every scene object & model against the camera & push the survivors into 'queue', counts go to engine->cullStats */
+void PushVisibleScene(RenderQueue *queue, Camera *camera);
+
+#ifdef ENGINE_SELF_TESTS
+/* Compare every kernel against the scalar one on random boxes, returns false on mismatch */
+bool CullingSelfTest(int count);
+
+/* Time every kernel over 'count' boxes, results are printed */
+void BenchmarkCulling(int count, int iterations);
+#endif  // ENGINE_SELF_TESTS
+
+#endif  // CULLING_H
@@ -0,0 +1,66 @@
+#pragma once
+
+#ifndef DEBUGDRAW_H
+#define DEBUGDRAW_H
+
+#include "engine.h"
+
+/*
+ -> Immediate mode lines, triangles & boxes for editor overlays, recorded into a DebugDrawList while a frame
+    is built, copied in by #DebugDrawUpload() & drawn by #DebugDrawFlush() in one draw call per primitive type.
+ -> The list is plain memory so it can be filled on the simulation thread while the render thread owns the GL side.
+ -> Vertices go straight into a persistent mapped buffer split into ENGINE_DEBUG_DRAW_FRAMES regions
+    (fenced the same way as the instance ring), lines fill a region from the front & triangles from the back.
+ -> A line is a screen space quad of 6 vertices, the vertex shader pushes each corner half of 'width' pixels
+    away from the segment so widths don't depend on glLineWidth (core profiles only guarantee 1).
+*/
+typedef struct DebugVertex {
+    float position[3];
+    float other[3];  // opposite end of the line, unused by triangles
+    GLuint color;    // RGBA8
+    float width;     // line width in pixels, its sign picks the quad side, 0 for triangles
+} DebugVertex;
+
+/* One frame of primitives, laid out like a region: lines from the front & triangles from the back */
+typedef struct DebugDrawList {
+    DebugVertex *vertices;
+    int capacity;
+    int lineVertices, triangleVertices;
+    int overflows;  // primitives dropped because the list was full
+} DebugDrawList;
+
+typedef struct DebugDraw {
+    GLuint VAO, buffer;
+    DebugVertex *mapped;
+    GLsync fences[ENGINE_DEBUG_DRAW_FRAMES];
+
+    int region;    // region being written this frame
+    int capacity;  // vertices per region
+    int lineVertices, triangleVertices;  // uploaded into the current region
+
+    int lastLineVertices, lastTriangleVertices;  // vertices drawn by the last flush
+    int overflows;                               // primitives dropped because a list was full, since startup
+} DebugDraw;
+
+DebugDraw *NewDebugDraw(int capacity);
+void FreeDebugDraw(DebugDraw *draw);
+
+/* Start recording into 'vertices', 'capacity' of them */
+void DebugDrawListBegin(DebugDrawList *list, DebugVertex *vertices, int capacity);
+
+void DebugDrawLine(DebugDrawList *list, vec3s start, vec3s end, vec3s color, float width);
+void DebugDrawTriangle(DebugDrawList *list, vec3s a, vec3s b, vec3s c, vec3s color);
+
+/* The 12 edges of the box [min, max] transformed by 'model' */
+void DebugDrawBox(DebugDrawList *list, vec3s min, vec3s max, const mat4s *model, vec3s color, float width);
+
+/* Wait for the GPU to release the region we're about to write, call once per frame before #DebugDrawUpload() */
+void DebugDrawBegin(DebugDraw *draw);
+
+/* Copy a recorded list into the current region, whatever doesn't fit is dropped */
+void DebugDrawUpload(DebugDraw *draw, const DebugDrawList *list);
+
+/* Draw what was uploaded since #DebugDrawBegin() into a viewport of 'width' x 'height' with 'shader', fence the region & move on to the next one */
+void DebugDrawFlush(DebugDraw *draw, Shader *shader, float width, float height);
+
+#endif  // DEBUGDRAW_H
@@ -9,17 +9,21 @@
 #include <stdbool.h>
 
 #include "libio.h"
+#include "libhashmap.h"
 #include "liblist.h"
-#include "libmap.h"
 #include "libtasks.h"
 #include "nanovg.h"
 #include "timings.h"
 
+/* DEBUG */
+/* 1 runs the self-checks & microbenchmarks (SIMD kernels, ...) once after #init() */
+#define ENGINE_DEBUG_MODE 0
+/* END DEBUG */
+
 /* WINDOW */
 #define ENGINE_BACKGROUND_COLOR 0.53f, 0.81f, 0.98f, 1.0f
 #define ENGINE_SCREEN_WIDTH 800
 #define ENGINE_SCREEN_HEIGHT 600
-#define ENGINE_UPDATE_INTERVAL 1.0f / 60.0f
 
 /* CAMERA */
 #define ENGINE_CAMERA_DEFAULT_FOV 45.0f
@@ -31,11 +35,118 @@
 
 /* END WINDOW */
 
+/* HEADLESS */
+/* Frames a headless run renders when it was given neither --frames nor --seconds */
+#define ENGINE_HEADLESS_DEFAULT_FRAMES 600
+/* Headless contexts ask for 4.5 core, the most Mesa's llvmpipe offers, shaders are then compiled as #version 450 */
+#define ENGINE_HEADLESS_GL_MINOR 5
+/* END HEADLESS */
+
+/* TIMESTEP */
+/* Simulation steps per second, #update() runs at this rate whatever the display refresh is */
+#define ENGINE_SIMULATION_RATE 60.0
+#define ENGINE_UPDATE_INTERVAL (1.0 / ENGINE_SIMULATION_RATE)
+/* Steps run at most per frame, time past that is dropped so a slow frame can't snowball into slower ones */
+#define ENGINE_MAX_SUBSTEPS 8
+/* END TIMESTEP */
+
 /* MODELING */
-#define ENGINE_BOUNDING_BOX_VERTEX_COUNT 24
 #define ENGINE_MAX_BONE_INFLUENCE 4
 /* END MODELING */
 
+/* JOBS */
+/* Worker threads besides the main one, 0 starts one per remaining core (at least one) */
+#define ENGINE_JOB_WORKERS 0
+/* Jobs a thread can have queued in its own deque (power of two), the rest go through a shared queue */
+#define ENGINE_JOB_DEQUE_SIZE 4096
+/* END JOBS */
+
+/* TIMERS */
+/* Resolution of the timer wheel, a timer fires on the first tick at or after its deadline */
+#define ENGINE_TIMER_WHEEL_TICK_NS 1000000
+/* END TIMERS */
+
+/* RENDER THREAD */
+/* Submit GL from a dedicated thread fed by frame snapshots, false builds & submits every frame on the main thread */
+#define ENGINE_RENDER_THREAD true
+/* Snapshots in rotation, 2 lets the main thread build one frame ahead of the one being submitted */
+#define ENGINE_FRAME_SNAPSHOTS 2
+/* END RENDER THREAD */
+
+/* PROFILER */
+/* Scoped CPU zones & GL timer query ranges (profiler.h), false compiles every PROFILE_* macro out */
+#define ENGINE_PROFILER true
+/* Zones kept per thread (power of two), the oldest get overwritten */
+#define ENGINE_PROFILER_EVENTS 65536
+#define ENGINE_PROFILER_MAX_THREADS 64
+/* A GPU range is read back this many frames after it was recorded, by then the driver is done with it */
+#define ENGINE_PROFILER_GPU_FRAMES 4
+#define ENGINE_PROFILER_GPU_ZONES 32
+/* Time the overlay averages over & how often it refreshes, seconds */
+#define ENGINE_PROFILER_OVERLAY_WINDOW 1.0
+#define ENGINE_PROFILER_OVERLAY_REFRESH 0.5
+/* END PROFILER */
+
+/* STREAMING */
+/* Buffer & texture bytes the render thread uploads per frame (upload.h), the rest waits for the next frame */
+#define ENGINE_UPLOAD_BUDGET_BYTES (4 * 1024 * 1024)
+/* Imported models are cooked once & memory mapped on later loads (meshcache.h), relative to 'mainPath' */
+#define ENGINE_MESH_CACHE true
+#define ENGINE_MESH_CACHE_DIR "build/meshcache"
+/* END STREAMING */
+
+/* MEMORY */
+#define ENGINE_FRAME_ARENA_SIZE (16 * 1024 * 1024)
+#define ENGINE_THREAD_ARENA_SIZE (4 * 1024 * 1024)
+/* END MEMORY */
+
+/* INSTANCING */
+#define ENGINE_INSTANCE_RING_FRAMES 3
+#define ENGINE_MAX_INSTANCES_PER_FRAME 131072
+#define ENGINE_INSTANCE_ATTRIBUTE_LOCATION 3
+/* Fewer dirty transforms than this are recomposed one at a time by #GetTransformMatrix() */
+#define ENGINE_TRANSFORM_BATCH_THRESHOLD 32
+/* Dirty transforms per job when a batch is split across the job system */
+#define ENGINE_TRANSFORM_PARALLEL_BATCH 4096
+/* END INSTANCING */
+
+/* CULLING */
+#define ENGINE_FRUSTUM_CULLING true
+/* Half extent given to objects without a bounding box, they're never culled */
+#define ENGINE_CULL_UNBOUNDED_EXTENT 1e30f
+/* END CULLING */
+
+/* BVH */
+#define ENGINE_BVH_SAH_BINS 12
+#define ENGINE_BVH_MAX_LEAF_SIZE 4
+/* END BVH */
+
+/* MESH BVH */
+/* Triangles per leaf, one AVX2 Möller–Trumbore batch */
+#define ENGINE_MESH_BVH_LEAF_SIZE 8
+/* END MESH BVH */
+
+/* PICKING */
+/* Backend hover & clicks start with, Ctrl + P switches at runtime */
+#define ENGINE_PICKING_MODE PICKING_CPU
+/* ID readbacks in flight, a result arrives one or two frames after its frame */
+#define ENGINE_PICK_FRAMES 3
+/* END PICKING */
+
+/* DEBUG DRAW */
+#define ENGINE_DEBUG_DRAW_FRAMES 3
+/* Line quads take 6 vertices, triangles 3 */
+#define ENGINE_DEBUG_DRAW_MAX_VERTICES 65536
+#define ENGINE_BOUNDING_BOX_LINE_WIDTH 2.0f
+/* END DEBUG DRAW */
+
+/* SHADERS */
+#define ENGINE_MAX_UNIFORM_NAME 64
+#define ENGINE_SKIP_REDUNDANT_UNIFORMS true
+/* NanoVG's GL3 backend owns uniform buffer binding 0 */
+#define ENGINE_FRAME_UNIFORM_BINDING 1
+/* END SHADERS */
+
 /* UI */
 
 /* COLORS */
@@ -68,6 +179,7 @@ typedef struct Texture {
     int width, height, nrChannels;
 
     const char *path;
+    unsigned char *pixels;  // decoded image of a streamed texture until its upload is done, NULL otherwise
 } Texture;
 
 typedef struct Skybox {
@@ -82,8 +194,49 @@ typedef struct Skybox {
     void (*free)(struct Skybox *self);
 } Skybox;
 
+/*
+ -> Per-frame data shared by every shader through the 'FrameData' std140 uniform block.
+ -> Layout must match the block declared in the vertex shaders under 'shaders/'.
+*/
+typedef struct FrameUniforms {
+    mat4s view;
+    mat4s projection;
+    mat4s viewProjection;
+    vec4s cameraPosition;
+    float time;
+    float padding[3];
+} FrameUniforms;
+
+/* Frustum culling results of the last #render() */
+typedef struct CullStats {
+    int tested, visible, culled;
+} CullStats;
+
+typedef enum PickingMode {
+    PICKING_CPU = 0,  // ray against the scene & mesh BVHs on every cursor event
+    PICKING_GPU,      // object/instance IDs rendered next to the color & read back asynchronously
+    PICKING_MODE_COUNT
+} PickingMode;
+
+/*
+ -> Command line options, see #ParseEngineOptions():
+    --headless           no display, offscreen rendering (headless.h)
+    --frames N           exit after N frames
+    --seconds S          exit after S seconds
+    --size WxH           window or offscreen size
+    --trace PATH         write a Chrome trace of the profiler zones on exit (profiler.h)
+*/
+typedef struct EngineOptions {
+    bool headless;
+    int width, height;
+    long frames;     // 0 for no limit
+    double seconds;  // 0 for no limit
+    const char *tracePath;
+} EngineOptions;
+
 typedef struct Engine {
     GLFWwindow *window;
+    EngineOptions options;
     float windowWidth, windowHeight, aspectRatio, fps, deltaTime, lastX, lastY;
 
     NVGcontext *vgContext;
@@ -92,7 +245,51 @@ typedef struct Engine {
     char *mainPath, *settingsFile, *shaderDir, *assetDir, *fontDir;
 
     List *sceneObjects, *models, *cameras, *shaders;
-    Map *textures;
+    HashMap *textures;  // 2D textures by path, owned by the asset registry
+
+    /* Camera snapshot taken once at the top of #render() & the uniform buffer #submit() uploads it to */
+    FrameUniforms frameUniforms;
+    GLuint frameUBO;
+
+    CullStats cullStats;
+
+    /* The final image goes here, 0 (the window) unless the run is headless */
+    GLuint outputFramebuffer;
+    struct HeadlessTarget *headlessTarget;
+
+    int glVersion;  // major * 10 + minor of the context
+
+    long frameCount;   // frames built since #init()
+    double startTime;  // when the first frame was started
+
+    /* Frame deltas on the monotonic clock, 'frameStats' are its percentiles refreshed once a second by #update() */
+    FrameTimer frameTimer;
+    FrameTimeStats frameStats;
+
+    /* Fixed step simulation, 'interpolation' is how far the frame is between the last two steps [0, 1) */
+    double accumulator, simulationTime, droppedTime;
+    float interpolation;
+    int substeps;  // steps run by the last #tick()
+
+    /* Everything that only lives for one frame, the arena of the snapshot being built, see arena.h & renderthread.h */
+    struct Arena *frameArena;
+
+    /* Sorted draw packets between scene traversal & GL submission, the queue of the snapshot being built, see renderqueue.h */
+    struct RenderQueue *renderQueue;
+
+    /* Persistent mapped instance matrices shared by every instanced draw, see instancering.h */
+    struct InstanceRing *instanceRing;
+
+    /* Bounding boxes, gizmos & other overlay lines/triangles batched per frame, see debugdraw.h */
+    struct DebugDraw *debugDraw;
+    struct DebugDrawList *debugList;  // of the snapshot being built, only valid during #render()
+
+    /* World bounds of every object & model for picking, refit once per frame, see bvh.h */
+    struct SceneBVH *sceneBVH;
+
+    /* ID attachment readback for GPU picking, see picking.h */
+    struct PickBuffer *pickBuffer;
+    PickingMode pickingMode;
 
     /*
      -> Skybox struct for handling the Skybox Cubemap
@@ -115,7 +312,7 @@ typedef struct Engine {
     */
     Skybox *skybox;
 
-    bool vSync, antiAliasing, wireframeMode, firstMouse, mouseDragging;
+    bool vSync, antiAliasing, wireframeMode, profilerOverlay, firstMouse, mouseDragging;
 
     vec3s selectedAxis;
 } Engine;
@@ -151,8 +348,8 @@ typedef struct MeshData {
 typedef struct BoundingBox {
     mat4s model;
     vec3s min, max, color;
-
-    GLuint VAO, VBO, EBO;
+    vec3s expansion;                // added to the owner's scale by #ExpandBoundingBox()
+    unsigned int transformVersion;  // owner Transform.version 'model' was built from
 } BoundingBox;
 
 typedef enum AxisType {
@@ -175,14 +372,43 @@ typedef struct Axis {
     float rotationDegrees;
 } Axis;
 
+/*
+ -> 'model' is a cache of translate -> rotate -> scale, read it through #GetTransformMatrix().
+ -> Change position, rotation or scale through the Set*Transform* helpers in render.h, or call
+    #MarkTransformDirty() after writing the fields directly, otherwise the cache goes stale.
+*/
 typedef struct Transform {
     BoundingBox *boundingBox;
 
     mat4s model;
     vec3s position, rotation, scale;
     float rotationDegrees;
+
+    bool dirty;            // 'model' has to be recomposed before its next use
+    unsigned int version;  // bumped every time 'model' is recomposed
 } Transform;
 
+/* Index into Shader.uniforms, -1 when the uniform is not active in the program */
+typedef int UniformHandle;
+
+typedef struct ShaderUniform {
+    char name[ENGINE_MAX_UNIFORM_NAME];
+    unsigned int hash;
+
+    GLint location, size;
+    GLenum type;
+
+    /* Last value uploaded through this uniform, used to skip redundant uploads */
+    bool hasValue;
+    unsigned char value[sizeof(mat4s)];
+} ShaderUniform;
+
+/* Handles for the uniforms the engine sets on every draw, resolved once after linking */
+typedef struct ShaderHandles {
+    UniformHandle model, color,
+        isSprite, isBillboard, useTexture, texture1, instanceCount, pickID;
+} ShaderHandles;
+
 typedef struct Shader {
     GLuint programID;
 
@@ -190,6 +416,19 @@ typedef struct Shader {
     const char *fragmentPath;
     const char *vShaderCode;
     const char *fShaderCode;
+
+    /*
+     -> Active uniforms reflected from the program after linking.
+     -> 'uniformTable' is an open-addressed (linear probing) hash table of indices into 'uniforms'.
+    */
+    ShaderUniform *uniforms;
+    int *uniformTable;
+    int uniformCount, uniformTableSize;
+
+    ShaderHandles handles;
+
+    /* When true, setters skip the GL call if the value matches the last upload */
+    bool skipRedundantUploads;
 } Shader;
 
 typedef enum ObjectType {
@@ -213,19 +452,13 @@ typedef struct Clickable {
 } Clickable;
 
 typedef struct Line {
-    Texture *texture;
     vec3s start, end, color;
-    float width;
-
-    GLuint VAO, VBO;
+    float width;  // pixels
 } Line;
 
 typedef struct Triangle {
-    Texture *texture;
     Transform transform;
     vec3s color;
-
-    GLuint VAO, VBO;
 } Triangle;
 
 typedef struct TransformGizmo {
@@ -234,6 +467,12 @@ typedef struct TransformGizmo {
     Axis axes[3];
 } TransformGizmo;
 
+typedef enum ModelLoadState {
+    MODEL_LOADING = 0,  // importing on a worker or uploading, 'meshes' is empty or only holds the placeholder
+    MODEL_READY,
+    MODEL_FAILED
+} ModelLoadState;
+
 typedef struct Model3D {
     char *tag;
 
@@ -247,7 +486,12 @@ typedef struct Model3D {
     List *meshes;
 
     bool gammaCorrection;
+    bool placeholder;  // draw a unit cube while loading
+    ModelLoadState loadState;
+    struct Asset *asset;  // meshes, textures & cooked mapping shared with every model of the same path, see assets.h
+
     int instanceCount;
+    int baseInstance;  // first matrix in the instance ring this frame, -1 when nothing was written
 
     vec3s hoverColor;
     vec3s color;
@@ -261,8 +505,11 @@ typedef struct Mesh {
     Vertex *vertices;
     GLuint *indices;
     List *textures;  // (List *) <Texture>
+    vec3s min, max;  // local space bounds, worked out by the import job or read from the cooked mesh
 
-    GLuint VAO, VBO, EBO, IVBO;
+    GLuint VAO, VBO, EBO;
+
+    struct MeshBVH *bvh;  // model space triangle BVH, NULL until the background build publishes it
 
     void (*draw)(Model3D *model, struct Mesh *self);
 } Mesh;
@@ -278,11 +525,12 @@ typedef struct SceneObject {
     Shader *shader;
     Texture *texture;
     MeshData *meshData;
-    GLuint VAO, VBO, EBO, IVBO;
+    GLuint VAO, VBO, EBO;
     Vertex *vertices;
     GLuint *indices;
 
     int indexCount, vertexCount, instanceCount;
+    int baseInstance;  // same as Model3D.baseInstance
 
     vec3s hoverColor;
     vec3s color;
@@ -305,6 +553,8 @@ typedef struct Camera {
     mat4s projection, view;
 
     vec3s position, front, up, right, worldUp, velocity;
+    vec3s previousPosition;  // 'position' before the last simulation step
+    vec3s renderPosition;    // blended between the two by 'engine->interpolation', the view is built from it
 
     float yaw, pitch, renderDistance, movementSpeed,
         maxVelocity, mouseSensitivity, fov, maxFov;
@@ -319,6 +569,7 @@ typedef struct FrameBufferObject {
     GLuint depthStencilBufferID;
     GLuint intermediateFBO;
     GLuint screenTexture;
+    GLuint pickTextureID;  // R32UI object/instance IDs on COLOR_ATTACHMENT1, written only while GPU picking
 
     int bufferWidth;
     int bufferHeight;
@@ -337,36 +588,67 @@ typedef struct Entity {
 
 extern Engine *engine;
 extern FrameBufferObject *antiAlias;
-extern Shader *defaultShader, *miscShader, *instanceShader,
+extern Shader *defaultShader, *debugShader, *instanceShader,
     *antiAliasShader, *skyboxShader;
 extern Camera *camera;
 
-Engine *init(void);
+EngineOptions ParseEngineOptions(int argc, char **argv);
+
+Engine *init(EngineOptions options);
 int cleanup(void);
 
+/* Window closed, or the run reached its frame or time limit */
+static inline bool ShouldExit(void) {
+    if (glfwWindowShouldClose(engine->window)) return GLFW_TRUE;
+    if (engine->options.frames > 0 && engine->frameCount >= engine->options.frames) return GLFW_TRUE;
+    if (engine->options.seconds > 0.0 && engine->frameCount > 0 && GetTimeSeconds() - engine->startTime >= engine->options.seconds) return GLFW_TRUE;
+
+    return GLFW_FALSE;
+}
+
 void update(void);
 void render(void);
 
-static void tick(void) {
-    static double nextUpdateTime = 0.0;
+struct FrameSnapshot;
+
+/* Everything GL for one built frame, called on the render thread (see renderthread.h) */
+void submit(struct FrameSnapshot *snapshot);
 
-    if (nextUpdateTime == 0.0) {
-        nextUpdateTime = current_time();
+/* Simulation state that gets blended for rendering, snapshotted before every step */
+static inline void BeginSimulationStep(void) {
+    foreach (Camera *cam, engine->cameras) {
+        if (cam != NULL) cam->previousPosition = cam->position;
     }
+}
 
-    double currentTime = current_time();
+/*
+ -> Fixed timestep: frame time goes into an accumulator & #update() runs once per ENGINE_UPDATE_INTERVAL
+    of it, up to ENGINE_MAX_SUBSTEPS times. 'deltaTime' is always the step during #update().
+ -> The remainder becomes 'interpolation', #render() draws between the previous & current step with it.
+*/
+static void tick(void) {
+    engine->accumulator += FrameTimerTick(&engine->frameTimer);
+    engine->deltaTime = (float)ENGINE_UPDATE_INTERVAL;
+    engine->substeps = 0;
 
-    if (currentTime >= nextUpdateTime) {
+    while (engine->accumulator >= ENGINE_UPDATE_INTERVAL && engine->substeps < ENGINE_MAX_SUBSTEPS) {
+        BeginSimulationStep();
         update();
 
-        nextUpdateTime += ENGINE_UPDATE_INTERVAL;
+        engine->accumulator -= ENGINE_UPDATE_INTERVAL;
+        engine->simulationTime += ENGINE_UPDATE_INTERVAL;
+        engine->substeps++;
+    }
 
-        if (currentTime > nextUpdateTime) {
-            nextUpdateTime = currentTime;
-        }
+    // Still behind after the cap (a stall, a breakpoint), drop whole steps & keep the fraction
+    if (engine->accumulator >= ENGINE_UPDATE_INTERVAL) {
+        double dropped = engine->accumulator - fmod(engine->accumulator, ENGINE_UPDATE_INTERVAL);
 
-        engine->deltaTime = (float)(nextUpdateTime - currentTime);
+        engine->droppedTime += dropped;
+        engine->accumulator -= dropped;
     }
+
+    engine->interpolation = (float)(engine->accumulator / ENGINE_UPDATE_INTERVAL);
 }
 
 #endif  // ENGINE_H
\ No newline at end of file
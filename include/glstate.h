@@ -0,0 +1,89 @@
+#pragma once
+
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include <stdbool.h>
+
+#include "engine.h"
+
+#define ENGINE_MAX_TEXTURE_UNITS 16
+
+/* Texture targets tracked per unit */
+typedef enum StateTextureTarget {
+    STATE_TEXTURE_2D = 0,
+    STATE_TEXTURE_CUBE_MAP,
+    STATE_TEXTURE_2D_MULTISAMPLE,
+    STATE_TEXTURE_TARGET_COUNT
+} StateTextureTarget;
+
+/* Bits in StateCache.known, a cleared bit means the real GL value is unknown & the next call is always issued */
+typedef enum StateKnown {
+    STATE_KNOWN_PROGRAM = 1 << 0,
+    STATE_KNOWN_VERTEX_ARRAY = 1 << 1,
+    STATE_KNOWN_ACTIVE_TEXTURE = 1 << 2,
+    STATE_KNOWN_BLEND = 1 << 3,
+    STATE_KNOWN_BLEND_FUNC = 1 << 4,
+    STATE_KNOWN_DEPTH_TEST = 1 << 5,
+    STATE_KNOWN_DEPTH_FUNC = 1 << 6,
+    STATE_KNOWN_CULL_FACE = 1 << 7,
+    STATE_KNOWN_CULL_MODE = 1 << 8,
+    STATE_KNOWN_POLYGON_MODE = 1 << 9,
+    STATE_KNOWN_LINE_WIDTH = 1 << 10,
+    STATE_KNOWN_LINE_SMOOTH = 1 << 11
+} StateKnown;
+
+typedef struct StateCacheStats {
+    int issued;    // calls that reached the driver
+    int filtered;  // calls dropped because the state already matched
+} StateCacheStats;
+
+/*
+ -> Shadow copy of the GL state the engine touches on every draw.
+ -> Engine code must go through the State* functions below instead of calling GL directly,
+    otherwise the shadow copy goes stale. Anything else that touches GL state (NanoVG) must be
+    followed by #InvalidateStateCache().
+*/
+typedef struct StateCache {
+    unsigned int known;
+    unsigned int textureKnown[ENGINE_MAX_TEXTURE_UNITS];  // bit per StateTextureTarget
+
+    GLuint program, vertexArray, activeTexture;
+    GLuint textures[ENGINE_MAX_TEXTURE_UNITS][STATE_TEXTURE_TARGET_COUNT];
+
+    bool blend, depthTest, cullFace, lineSmooth;
+    GLenum blendSrc, blendDst, depthFunc, cullMode, polygonMode;
+    float lineWidth;
+
+    StateCacheStats frame, lastFrame;
+} StateCache;
+
+extern StateCache *stateCache;
+
+void InitStateCache(void);
+void FreeStateCache(void);
+
+/* Forget everything, call after code outside the cache changed GL state */
+void InvalidateStateCache(void);
+
+/* Move this frame's counters into 'lastFrame' & start counting again */
+void EndStateCacheFrame(void);
+
+void StateUseProgram(GLuint program);
+void StateBindVertexArray(GLuint vertexArray);
+void StateBindTexture(GLuint unit, GLenum target, GLuint texture);
+
+/* GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE & GL_LINE_SMOOTH are cached, other caps pass straight through */
+void StateEnable(GLenum cap);
+void StateDisable(GLenum cap);
+
+/* Cached value when it's known, asks GL otherwise, for code that restores what it changed */
+bool StateIsEnabled(GLenum cap);
+
+void StateBlendFunc(GLenum src, GLenum dst);
+void StateDepthFunc(GLenum func);
+void StateCullFace(GLenum mode);
+void StatePolygonMode(GLenum mode);  // always GL_FRONT_AND_BACK, core profile allows nothing else
+void StateLineWidth(float width);
+
+#endif  // GLSTATE_H
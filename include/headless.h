@@ -0,0 +1,30 @@
+#pragma once
+
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "engine.h"
+
+/*
+ -> Headless runs for benchmarks & CI: GLFW's null platform, so no display server is needed, with a surfaceless
+    EGL context, or OSMesa when EGL can't be loaded. Both work on Mesa's llvmpipe without a GPU.
+ -> A surfaceless context has no default framebuffer, an offscreen target stands in for it & 'engine->outputFramebuffer'
+    names it, everything that used to bind framebuffer 0 for the final image binds that instead.
+*/
+typedef struct HeadlessTarget {
+    GLuint framebuffer, color, depthStencil;
+    int width, height;
+} HeadlessTarget;
+
+/* Pick the null platform, call before glfwInit() */
+void HeadlessInitHints(void);
+
+/* Hidden window & context, NULL when neither context API is available */
+GLFWwindow *CreateHeadlessWindow(int width, int height);
+
+/* RGBA8 color & depth/stencil renderbuffers of the given size */
+HeadlessTarget *NewHeadlessTarget(int width, int height);
+void ResizeHeadlessTarget(HeadlessTarget *target, int width, int height);
+void FreeHeadlessTarget(HeadlessTarget *target);
+
+#endif  // HEADLESS_H
@@ -0,0 +1,47 @@
+#pragma once
+
+#ifndef INSTANCERING_H
+#define INSTANCERING_H
+
+#include "engine.h"
+
+/*
+ -> One buffer created with glBufferStorage & mapped persistently/coherently for its whole lifetime,
+    split into ENGINE_INSTANCE_RING_FRAMES regions of 'capacity' matrices each.
+ -> The CPU writes frame N into region N % ENGINE_INSTANCE_RING_FRAMES while the GPU may still read the
+    other regions, a fence per region stops us from overwriting one the GPU hasn't finished with.
+ -> Draws reference their matrices through the base instance, so every instanced VAO points its
+    instance attributes at the start of the same buffer & nothing is ever re-specified or orphaned.
+*/
+typedef struct InstanceRing {
+    GLuint buffer;
+    mat4s *mapped;
+    GLsync fences[ENGINE_INSTANCE_RING_FRAMES];
+
+    int region;    // region being written this frame
+    int capacity;  // matrices per region
+    int used;      // matrices written into the current region
+
+    int lastUsed;   // matrices written in the last finished frame
+    int overflows;  // writes dropped because a region was full, since startup
+} InstanceRing;
+
+InstanceRing *NewInstanceRing(int capacity);
+void FreeInstanceRing(InstanceRing *ring);
+
+/* Wait for the GPU to release the region we're about to write, call once per frame before any #WriteInstanceMatrices() */
+void InstanceRingBegin(InstanceRing *ring);
+
+/* Fence the region written this frame & move on to the next one, call after the last draw of the frame */
+void InstanceRingEnd(InstanceRing *ring);
+
+/* Copy 'count' cached model matrices straight into mapped memory, returns the base instance or -1 if the region is full */
+int WriteInstanceMatrices(InstanceRing *ring, Transform *transforms, int count);
+
+/* Same for matrices that were already composed, e.g. a frame snapshot's instances, one memcpy */
+int WriteInstanceBlock(InstanceRing *ring, const mat4s *matrices, int count);
+
+/* Point the bound VAO's instance matrix attributes (3..6) at the ring, call during VAO setup */
+void BindInstanceAttributes(InstanceRing *ring);
+
+#endif  // INSTANCERING_H
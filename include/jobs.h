@@ -0,0 +1,61 @@
+#pragma once
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdbool.h>
+
+/*
+ -> Fixed pool of worker threads, one per core with the main thread counted as one of them.
+ -> Every pool thread owns a Chase-Lev deque: it pushes & pops its own jobs at the bottom (LIFO, cache warm)
+    while idle threads steal from the top of the others (FIFO, oldest & usually biggest work first).
+ -> Jobs run from other threads go through a small locked injection queue instead.
+ -> Completion is tracked with counters, #RunJob() increments one & the job's end decrements it,
+    #WaitForCounter() keeps running jobs until it reaches zero so a waiting thread never idles.
+*/
+typedef struct JobCounter {
+    int pending;  // atomic, jobs started against this counter that haven't finished yet
+} JobCounter;
+
+typedef void (*JobFunction)(void *data);
+
+/* [start, end) of a #ParallelFor() range */
+typedef void (*JobRangeFunction)(void *data, int start, int end);
+
+/* 'workers' threads besides the calling one, 0 starts one per remaining core (at least one) */
+void InitJobSystem(int workers);
+
+/* Finishes every queued job, then joins the workers. Jobs that queue themselves again must stop once it began */
+void ShutdownJobSystem(void);
+
+/* True from the start of #ShutdownJobSystem() until the next #InitJobSystem() */
+bool IsJobSystemStopping(void);
+
+/* Threads running jobs, the calling thread of #InitJobSystem() included */
+int GetJobThreadCount(void);
+
+/* 0 for the thread that called #InitJobSystem(), 1.. for workers, -1 for any other thread */
+int GetJobThreadIndex(void);
+
+/* Queue 'function(data)', 'counter' may be NULL. Runs inline when the job system isn't running */
+void RunJob(JobFunction function, void *data, JobCounter *counter);
+
+static inline bool JobCounterDone(JobCounter *counter) {
+    return __atomic_load_n(&counter->pending, __ATOMIC_ACQUIRE) == 0;
+}
+
+/* Run queued jobs (or sleep briefly when there are none) until 'counter' drops to zero */
+void WaitForCounter(JobCounter *counter);
+
+/*
+ -> Split [0, count) into ranges of 'batch', run them across the pool & wait for all of them,
+    the calling thread works through ranges as well.
+*/
+void ParallelFor(int count, int batch, JobRangeFunction function, void *data);
+
+#ifdef ENGINE_SELF_TESTS
+/* Nested jobs waiting on each other & a ParallelFor sum, returns false when a count is off */
+bool JobSystemSelfTest(void);
+#endif  // ENGINE_SELF_TESTS
+
+#endif  // JOBS_H
@@ -10,7 +10,9 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "jobs.h"
 #include "liblist.h"
+#include "timerwheel.h"
 #include "timings.h"
 
 /* 
@@ -28,7 +30,8 @@ typedef enum TaskType {
 } TaskType;
 
 typedef struct Task {
-  pthread_t pid;
+  WheelTimer timer;   // interval & delay tasks
+  JobCounter counter; // default tasks, the pass queued on the job system
   bool isCanceled;
   int ticks;
 
@@ -48,7 +51,6 @@ typedef struct Task {
 
 typedef struct TaskManager {
   List *tasks;    // List<Task *>
-  List *threads;  // List<pthread_t *>
 } TaskManager;
 
 extern TaskManager *taskManager;
@@ -71,7 +73,6 @@ static inline void CleanupTasks(void) {
   }
 
   ListFreeMemory(taskManager->tasks);
-  ListFreeMemory(taskManager->threads);
 
   free(taskManager);
 
@@ -84,8 +85,10 @@ static inline void CleanupTasks(void) {
 
 void InitTaskManager(void);
 
-/* Create a new Task * struct and add it to the TaskManager list of tasks, each
-Task will run on it's own thread.
+/* Create a new Task * struct and add it to the TaskManager list of tasks.
+Default tasks run as repeated jobs on the job system (see jobs.h), interval &
+delay tasks are timers on the timer wheel (see timerwheel.h), both have to be
+running. No Task owns a thread.
 
 @param Task *task: A pointer to the Task structure that will be initialized if
 not already, to add to the task list.
@@ -0,0 +1,66 @@
+#pragma once
+
+#ifndef MESHBVH_H
+#define MESHBVH_H
+
+#include "bvh.h"
+#include "engine.h"
+#include "simd.h"
+
+/*
+ -> Triangle BVH of one mesh in model space, leaves hold up to ENGINE_MESH_BVH_LEAF_SIZE triangles.
+ -> Triangles are copied in leaf order as a structure of arrays (v0, edge1 = v1 - v0, edge2 = v2 - v0),
+    so a leaf is 'count' contiguous lanes for the Möller–Trumbore kernels.
+*/
+typedef struct MeshBVH {
+    BVH *bvh;  // over triangle boxes, a leaf covers triangles [first, first + count) of the arrays below
+
+    float *v0X, *v0Y, *v0Z;
+    float *edge1X, *edge1Y, *edge1Z;
+    float *edge2X, *edge2Y, *edge2Z;
+
+    int triangleCount;
+} MeshBVH;
+
+/* Builds on the calling thread, degenerate triangles are kept & never hit */
+MeshBVH *NewMeshBVH(const Vertex *vertices, int vertexCount, const GLuint *indices, int indexCount);
+void FreeMeshBVH(MeshBVH *meshBVH);
+
+/*
+ -> Build on the job system (see jobs.h), 'mesh->bvh' is published once the build is done,
+    read it through #GetMeshBVH().
+ -> The vertex & index arrays must stay alive until #CancelMeshBVHBuilds().
+*/
+void QueueMeshBVH(Mesh *mesh);
+
+/* Skips builds that haven't started & waits for the running ones */
+void CancelMeshBVHBuilds(void);
+
+static inline MeshBVH *GetMeshBVH(Mesh *mesh) {
+    return __atomic_load_n(&mesh->bvh, __ATOMIC_ACQUIRE);
+}
+
+/*
+ -> Closest triangle along a model space ray, two sided. 'distance' is in units of the ray's direction,
+    which doesn't need to be normalized, so a world ray taken into model space keeps world distances.
+*/
+bool MeshBVHRayClosest(const MeshBVH *meshBVH, const Ray *ray, float maxDistance, float *distance);
+
+/*
+ -> Closest mesh triangle of any instance of 'model' along a world ray, for #BVHHitTest style callers.
+ -> While a mesh of the model is still building, 'distance' is left as it was (the box hit) & true is returned.
+*/
+bool ModelRayClosest(Model3D *model, const Ray *ray, float maxDistance, float *distance);
+
+/* Closest of triangles [first, first + count) with a forced kernel, returns the triangle or -1 */
+int IntersectTrianglesLevel(SimdLevel level, const MeshBVH *meshBVH, int first, int count, const Ray *ray, float maxDistance, float *distance);
+
+#ifdef ENGINE_SELF_TESTS
+/* Every kernel & the BVH against a brute force scalar scan over a random soup, returns false on mismatch */
+bool MeshBVHSelfTest(int triangleCount, int rays);
+
+/* Ray timings of the BVH against a brute force scan over 'triangleCount' triangles, results are printed */
+void BenchmarkMeshBVH(int triangleCount, int rays);
+#endif  // ENGINE_SELF_TESTS
+
+#endif  // MESHBVH_H
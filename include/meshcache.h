@@ -0,0 +1,75 @@
+#pragma once
+
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "engine.h"
+
+/*
+ -> Cooked meshes: what #ProcessRootNode() builds from an assimp import, written once to
+    'mainPath/ENGINE_MESH_CACHE_DIR/<hash of the asset path>-<import flags>.mesh' & memory mapped on later loads.
+ -> A file is only used while its header matches the source's mtime & size, the import flags, MESH_CACHE_VERSION &
+    sizeof(Vertex), anything else counts as a miss & the model is imported & cooked again. So does a corrupt file, one
+    with a table, blob or index outside its bounds.
+ -> Vertex & index blobs are MESH_CACHE_ALIGNMENT aligned in the file, the meshes of a cooked load point straight into
+    the mapping so the upload queue hands them to GL without touching a vertex. The mapping lives as long as the
+    meshes do, it's part of the model asset they belong to (model3d.c).
+ -> Materials are stored as texture paths & types, the images are still decoded on load.
+*/
+#define MESH_CACHE_MAGIC "TAVMESH"
+#define MESH_CACHE_VERSION 1
+#define MESH_CACHE_ALIGNMENT 64
+
+typedef struct CookedMeshHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t importFlags;
+    int64_t sourceTime;   // mtime of the source asset, seconds
+    uint64_t sourceSize;  // bytes
+    uint32_t vertexSize;  // sizeof(Vertex) of the build that cooked it
+    uint32_t meshCount, textureCount, textureRefCount;
+    float min[3], max[3];  // local space bounds of every mesh
+
+    /* File offsets */
+    uint64_t meshes, textures, textureRefs, strings, vertices, indices;
+    uint64_t fileSize;
+} CookedMeshHeader;
+
+/* One #Mesh, offsets are from the start of the file */
+typedef struct CookedSubmesh {
+    uint64_t vertexOffset, indexOffset;
+    uint32_t vertexCount, indexCount;
+    uint32_t firstTextureRef, textureRefCount;  // range of 'textureRefs', indices into the texture table
+    float min[3], max[3];
+} CookedSubmesh;
+
+typedef struct CookedTexture {
+    uint32_t type;  // TextureType
+    uint32_t path;  // offset into the string blob
+} CookedTexture;
+
+struct TextureSet;  // model3d.h
+
+typedef struct CookedMesh {
+    void *base;  // the mapping (a heap copy on Windows)
+    size_t size;
+    const CookedMeshHeader *header;
+} CookedMesh;
+
+/* NULL when there's no cooked file for 'path' or it's stale, 'path' is relative to the asset directory */
+CookedMesh *OpenCookedMesh(const char *path, unsigned int importFlags);
+void CloseCookedMesh(CookedMesh *cooked);
+
+/*
+ -> Meshes pointing into the mapping appended to 'meshes', their textures acquired into 'textures' & the ones nobody
+    registered before decoded. False on a corrupt file
+*/
+bool ReadCookedMesh(CookedMesh *cooked, List *meshes, struct TextureSet *textures);
+
+/* Cooks 'meshes' (built by #ProcessRootNode()) for the next load of 'path', through a temporary file & a rename */
+bool WriteCookedMesh(const char *path, unsigned int importFlags, List *meshes, List *textures);
+
+#endif  // MESHCACHE_H
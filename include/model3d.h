@@ -7,24 +7,55 @@
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 
+#include "assets.h"
+#include "callbacks.h"
 #include "engine.h"
+#include "instancering.h"
+#include "meshbvh.h"
+#include "meshcache.h"
 #include "render.h"
 #include "shader.h"
+#include "stb_image.h"
 #include "utils.h"
 #include "ui.h"
 
+/*
+ -> Returns right away with 'loadState' MODEL_LOADING, the model is already in 'engine->models' but draws nothing
+    (or a unit cube with 'builder.placeholder') until it's done.
+ -> The assimp import & mesh building run on the job system, buffers & textures are created by the render thread
+    through the upload queue (upload.h) within ENGINE_UPLOAD_BUDGET_BYTES per frame. #UpdateModelLoads() swaps the
+    meshes in on the main thread once the last upload is done, 'loadState' turns MODEL_READY or MODEL_FAILED.
+ -> Models are registered as assets by path & import flags: another #NewModel3D() of the same file shares the meshes,
+    their buffers, BVHs & textures instead of importing it again, or waits on the load already in flight.
+*/
 Model3D *NewModel3D(Model3D builder, const char *path);
 
+/* What every import runs, part of the cooked mesh key */
+#define MODEL_IMPORT_FLAGS (aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace)
+
+/* Main thread, once per frame before the scene is traversed */
+void UpdateModelLoads(void);
+
+/* Waits for running imports & frees everything of unfinished loads, after the render thread shut down */
+void CancelModelLoads(void);
+
 static inline bool ModelExists(Model3D *model) {
     return model && ListSize(model->meshes) > 0;
 }
 
+/* After #CancelModelLoads() & #CancelMeshBVHBuilds(), nothing reads the shared meshes anymore */
 static inline void RemoveModels(void) {
     int counter = 0;
     foreach (Model3D *model, engine->models) {
-        if (!ModelExists(model)) continue;
+        ForgetHoveredOwner(model);
+
+        // The last model of an asset frees its buffers, BVHs, mapping & textures
+        ReleaseAsset(model->asset);
+        model->asset = NULL;
+
+        ListClear(model->meshes);
+        ListClear(model->texturesLoaded);
 
-        UnbindBufferObj(NULL, model);
         counter++;
     }
 
@@ -33,54 +64,13 @@ static inline void RemoveModels(void) {
     printf("[TAV ENGINE] %d 3D Models have been freed!\n", counter);
 }
 
-static inline void SetupMesh(Model3D *model, Mesh *mesh) {
+/* VAO over the mesh's already filled VBO & EBO, render thread */
+static inline void SetupMeshAttributes(Mesh *mesh) {
     glGenVertexArrays(1, &mesh->VAO);
-    glGenBuffers(1, &mesh->VBO);
-    glGenBuffers(1, &mesh->EBO);
-    glGenBuffers(1, &mesh->IVBO);
-
-    int vertexCount = mesh->vertexCount;
-    int indexCount = mesh->indexCount;
-
-    // printf("SetupMesh -> Vertices size %zu\n", vertexCount);
-
-    // printf("Vertices Unit Test Begin\n");
-
-    // for (int i = 0; i < vertexCount; i++) {
-    //     Vertex v = mesh->vertices[i];
-    //     printf("Vertex %i: (%f, %f, %f)\n", i, v.position.x, v.position.y, v.position.z);
-    // }
-
-    // printf("Vertices Unit Test End\n");
-
-    glBindVertexArray(mesh->VAO);
+    StateBindVertexArray(mesh->VAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, mesh->VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertexCount, mesh->vertices, GL_STATIC_DRAW);
-
-    // printf("SetupMesh -> Indices size %zu\n", indexCount);
-
-    // printf("Indices Unit Test Begin\n");
-
-    // for (int i = 0; i < indexCount; i++) {
-    //     GLuint index = mesh->indices[i];
-    //     printf("Index %i: (%u)\n", i, index);
-    // }
-
-    // printf("Indices Unit Test End\n");
-
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indexCount, mesh->indices, GL_STATIC_DRAW);
-
-    // printf("Size of Vertex: %zu\n", sizeof(Vertex));
-
-    GLint vboSize, eboSize;
-    glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &vboSize);
-    glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &eboSize);
-    // printf("VBO Size: %d, Expected: %zu\n", vboSize, vertexCount * sizeof(Vertex));
-    // printf("EBO Size: %d, Expected: %zu\n", eboSize, indexCount * sizeof(GLuint));
-
-    // printf("SetupMesh -> Binding attributes now\n");
 
     // Position attribute (layout = 0)
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
@@ -114,32 +104,12 @@ static inline void SetupMesh(Model3D *model, Mesh *mesh) {
     // glEnableVertexAttribArray(6);
     // glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, boneWeights));
 
-    int instanceCount = model->instanceCount;
-    // Instance matrix attribute (layout = 3)
-    if (instanceCount > 1) {
-        glBindBuffer(GL_ARRAY_BUFFER, mesh->IVBO);
-
-        // mat4s matrix_model = model->transforms->model;
-        // printf("Our translation units x=%.2f y=%.2f z=%.2f\n", matrix_model.raw[3][0], matrix_model.raw[3][1], matrix_model.raw[3][2]);
-        glBufferData(GL_ARRAY_BUFFER, instanceCount * sizeof(mat4s), &model->transforms->model.raw[0], GL_DYNAMIC_DRAW);
-
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(mat4s), (void *)0);
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(mat4s), (void *)(sizeof(vec4s)));
-        glEnableVertexAttribArray(5);
-        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(mat4s), (void *)(2 * sizeof(vec4s)));
-        glEnableVertexAttribArray(6);
-        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(mat4s), (void *)(3 * sizeof(vec4s)));
-
-        glVertexAttribDivisor(3, 1);
-        glVertexAttribDivisor(4, 1);
-        glVertexAttribDivisor(5, 1);
-        glVertexAttribDivisor(6, 1);
-    }
+    // Instance matrix attribute (layout = 3), always: the VAO is shared by every model of the asset, instanced or not.
+    // Only the instance shader reads it (see #GetObjectShader())
+    BindInstanceAttributes(engine->instanceRing);
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    StateBindVertexArray(0);
     // printf("SetupMesh -> Internal Set up mesh\n");
 }
 
@@ -196,23 +166,30 @@ static inline void DrawMesh(Model3D *model, Mesh *mesh) {
     // printf("DrawMesh-> MIDDLE\n");
 
     // printf("Before bind -> VAO: %d, indexCount: %d\n", mesh->VAO, mesh->indexCount);
-    glBindVertexArray(mesh->VAO);
+    StateBindVertexArray(mesh->VAO);
     // printf("After bind -> VAO: %d, indexCount: %d\n", mesh->VAO, mesh->indexCount);
     UseTexture(model->texture);
 
     int indexCount = mesh->indexCount;
     int vertexCount = mesh->vertexCount;
     int instanceCount = model->instanceCount;
+    int baseInstance = model->baseInstance;
     // printf("DrawMesh -> Index count: %d\n", indexCount);
 
-    if (mesh->indices != NULL && indexCount > 0) {
+    if (instanceCount > 1 && baseInstance < 0) {
+        // Instance ring is full this frame, nothing valid to draw with
+    } else if (mesh->indices != NULL && indexCount > 0) {
         if (instanceCount > 1) {
-            glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0, instanceCount);
+            glDrawElementsInstancedBaseInstance(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0, instanceCount, baseInstance);
         } else {
             glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
         }
     } else if (mesh->vertices != NULL && vertexCount > 0) {
-        glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+        if (instanceCount > 1) {
+            glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, vertexCount, instanceCount, baseInstance);
+        } else {
+            glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+        }
     }
 
     // reset to default texture unit
@@ -220,10 +197,11 @@ static inline void DrawMesh(Model3D *model, Mesh *mesh) {
     //     glActiveTexture(GL_TEXTURE0);
     // }
 
-    glBindVertexArray(0);
+    StateBindVertexArray(0);
 }
 
-static inline Mesh *NewMesh(Mesh builder, Model3D *model) {
+/* CPU side only, the buffers are created by the mesh's upload */
+static inline Mesh *NewMesh(Mesh builder) {
     Mesh *mesh = (Mesh *)malloc(sizeof(Mesh));
     if (mesh == NULL) {
         fprintf(stderr, "[MEMORY ERROR] Failed creating NewMesh();, ERROR ALLOCATING MEMORY\n");
@@ -233,18 +211,20 @@ static inline Mesh *NewMesh(Mesh builder, Model3D *model) {
 
     memcpy(mesh, &builder, sizeof(Mesh));
 
+    mesh->VAO = mesh->VBO = mesh->EBO = 0;
+    mesh->bvh = NULL;
     mesh->draw = DrawMesh;
 
     // printf("[Mesh] VertexCount = %d | IndexCount = %d\n", mesh->vertexCount, mesh->indexCount);
-
-    SetupMesh(model, mesh);
-    // printf("NEWMESH -> Set up mesh\n");
     return mesh;
 }
 
 static inline void DrawModel(Model3D *model) {
     // printf("[!IMPORTANT] DRAWMODEL -> Top of Draw Model\n");
 
+    // Once per model, not once per mesh
+    StreamInstanceMatrices(NULL, model);
+
     foreach (Mesh *mesh, model->meshes) {
         if (mesh == NULL) continue;
 
@@ -256,65 +236,99 @@ static inline void DrawModel(Model3D *model) {
     DrawTransformGizmo(NULL, model);
 }
 
-/* Checks all material textures of a given type and loads the textures if they're not loaded yet. */
-static inline List *loadMaterialTextures(Model3D *model, C_STRUCT aiMaterial *mat, C_ENUM aiTextureType type, char *typeName) {
-    List *textures = (List *)NewList(NULL);
+/* A streamed texture nothing has been decoded for yet, see #DecodeTextureImage() & #AcquireTextureImage() */
+static inline Texture *NewTextureImage(TextureType type, const char *path) {
+    Texture *texture = (Texture *)malloc(sizeof(Texture));
+    if (texture == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed creating new Texture, ERROR ALLOCATING MEMORY\n");
+        return NULL;
+    }
 
-    for (GLuint i = 0; i < aiGetMaterialTextureCount(mat, type); i++) {
-        C_STRUCT aiString str;
-        aiGetMaterialTexture(mat, type, i, &str, NULL, NULL, NULL, NULL, NULL, NULL);
+    *texture = (Texture){.type = type, .path = strdup(path)};
+    return texture;
+}
 
-        /* Check if texture was loaded before and if so, continue to next iteration: skip loading a new texture */
-        bool skip = false;
+/*
+ -> Any thread. 'pixels' waits for the texture's upload, 'textureID' is 0 until then.
+    NULL 'pixels' when the file couldn't be read.
+*/
+static inline void DecodeTextureImage(Texture *texture) {
+    // Same orientation as #NewTexture(), which is what every 2D texture is loaded with
+    texture->pixels = LoadTextureImage(texture->path, &texture->width, &texture->height, &texture->nrChannels);
 
-        for (GLuint j = 0; j < ListSize(model->texturesLoaded); j++) {
-            Texture *tex = (Texture *)ListGet(model->texturesLoaded, j);
+    if (texture->pixels == NULL) {
+        printf("[TEXTURE ERROR] Failed to load texture at path: %s\n", texture->path);
+    }
+}
 
-            if (tex != NULL) {
-                // printf("Found tex in loadMaterialTexs()\n");
-                if (strcmp(tex->path, str.data) == 0) {
-                    ListAdd(textures, tex);
-                    skip = true; /* A 'Texture' with the same filepath has already been loaded, continue to next one. (optimization) */
+/*
+ -> Textures of one import, each held through one registry reference (assets.h).
+ -> 'owned' are the ones this import registered first, it decodes & uploads them. The others came from another model,
+    their 'textureID' stays 0 until whoever owns them finished its upload.
+*/
+typedef struct TextureSet {
+    List *textures;  // <Texture *>, each one once
+    List *assets;    // <Asset *>, same order
+    List *owned;     // <Texture *>
+} TextureSet;
 
-                    // printf("LOADMATERIALTEXTURES -> ADD TO FUNCTION LIST CHECK\n");
-                    break;
-                }
-            }
-        }
+TextureSet NewTextureSet(void);
 
-        TextureType ourTextureType = TEXTURE_TYPE_NONE;
-
-        /* If texture hasn't been loaded already, load it */
-        if (!skip) {
-            if (strcmp(typeName, "texture_diffuse") == 0) {
-                ourTextureType = TEXTURE_TYPE_DIFFUSE;
-            } else if (strcmp(typeName, "texture_specular") == 0) {
-                ourTextureType = TEXTURE_TYPE_SPECULAR;
-            } else if (strcmp(typeName, "texture_normal") == 0) {
-                ourTextureType = TEXTURE_TYPE_NORMAL;
-            } else if (strcmp(typeName, "texture_height") == 0) {
-                ourTextureType = TEXTURE_TYPE_HEIGHT;
-            }
-        }
+/*
+ -> The registered texture of 'path' & 'type', any thread. One lookup of the path's hash, no string compares.
+ -> Created undecoded & '*created' set when there was none yet, the caller decodes it.
+*/
+Texture *AcquireTextureImage(TextureSet *set, TextureType type, const char *path, bool *created);
 
-        Texture *texture = (Texture *)NewTexture(ourTextureType, str.data);
+/* Drops the set's references, the last one of a texture frees it */
+void ReleaseTextureSet(TextureSet *set);
 
-        if (texture != NULL) {
-            ListAdd(textures, texture);
-            ListAdd(model->texturesLoaded, texture);
-        }
+/* Adds the material's textures of a given type to 'textures', the ones created for it go to 'decode' as well */
+static inline void CollectMaterialTextures(List *textures, TextureSet *set, List *decode, C_STRUCT aiMaterial *mat,
+                                           C_ENUM aiTextureType type, TextureType ourTextureType) {
+    for (GLuint i = 0; i < aiGetMaterialTextureCount(mat, type); i++) {
+        C_STRUCT aiString str;
+        aiGetMaterialTexture(mat, type, i, &str, NULL, NULL, NULL, NULL, NULL, NULL);
 
-        // printf("LOADMATERIALTEXTURES -> Loading new texture for Model3D %s w/ type: (%s)\n", str.data, typeName);
+        bool created = GLFW_FALSE;
+        Texture *texture = (Texture *)AcquireTextureImage(set, ourTextureType, str.data, &created);
+        if (texture == NULL) continue;
+
+        if (created) ListAdd(decode, texture);
+        ListAdd(textures, texture);
     }
+}
 
-    // printf("Returning material textures list with size %zu\n", ListSize(textures));
+/*
+    Each diffuse texture should be named as 'texture_diffuseN',
+    where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER.
+
+     Same applies to other texture as the following list summarizes:
+     diffuse: texture_diffuseN
+     specular: texture_specularN
+     normal: texture_normalN
+*/
+static inline List *ProcessMaterial(TextureSet *set, List *decode, C_STRUCT aiMaterial *material) {
+    List *textures = (List *)NewList(NULL); /* <Texture *> */
+
+    /* 1. diffuse maps */
+    CollectMaterialTextures(textures, set, decode, material, aiTextureType_DIFFUSE, TEXTURE_TYPE_DIFFUSE);
+    /* 2. specular maps */
+    CollectMaterialTextures(textures, set, decode, material, aiTextureType_SPECULAR, TEXTURE_TYPE_SPECULAR);
+    /* 3. normal maps */
+    CollectMaterialTextures(textures, set, decode, material, aiTextureType_HEIGHT, TEXTURE_TYPE_NORMAL);
+    /* 4. height maps */
+    CollectMaterialTextures(textures, set, decode, material, aiTextureType_AMBIENT, TEXTURE_TYPE_HEIGHT);
 
     return textures;
 }
 
-static inline Mesh *ProcessOurMesh(Model3D *model, C_STRUCT aiMesh *mesh, const C_STRUCT aiScene *scene) {
-    Mesh ourMesh;
+/* CPU side of one mesh, any thread. 'materialTextures' comes from #ProcessMaterial() & is only read */
+static inline Mesh *ProcessOurMesh(const C_STRUCT aiMesh *mesh, List *materialTextures) {
+    Mesh ourMesh = (Mesh){0};
     ourMesh.vertexCount = mesh->mNumVertices;
+    ourMesh.min = (vec3s){FLT_MAX, FLT_MAX, FLT_MAX};
+    ourMesh.max = (vec3s){-FLT_MAX, -FLT_MAX, -FLT_MAX};
 
     /* Data to fill */
     List *textures = (List *)NewList(NULL); /* <Texture *> */
@@ -377,6 +391,9 @@ static inline Mesh *ProcessOurMesh(Model3D *model, C_STRUCT aiMesh *mesh, const
         // printf("Adding Vertex to mesh vertices array %i: (%f, %f, %f)\n", i, vertex.position.x, vertex.position.y, vertex.position.z);
         if (i < ourMesh.vertexCount) {
             ourMesh.vertices[i] = vertex;
+
+            ourMesh.min = glms_vec3_minv(ourMesh.min, vertex.position);
+            ourMesh.max = glms_vec3_maxv(ourMesh.max, vertex.position);
         } else {
             printf("[INDEX ARRAY OUT OF BOUNDS ERROR]  Vertex counter out of bounds when Processing our Mesh: %d\n", i);
         }
@@ -411,73 +428,34 @@ static inline Mesh *ProcessOurMesh(Model3D *model, C_STRUCT aiMesh *mesh, const
         }
     }
 
-    /* Process materials */
-    C_STRUCT aiMaterial *material = (C_STRUCT aiMaterial *)scene->mMaterials[mesh->mMaterialIndex];
-
-    /*
-        Each diffuse texture should be named as 'texture_diffuseN',
-        where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER.
-
-         Same applies to other texture as the following list summarizes:
-         diffuse: texture_diffuseN
-         specular: texture_specularN
-         normal: texture_normalN
-    */
-
-    /* 1. diffuse maps */
-    List *diffuseMaps = (List *)loadMaterialTextures(model, material, aiTextureType_DIFFUSE, "texture_diffuse");
-
-    if (!isListEmpty(diffuseMaps)) {
-        ListAddAll(textures, diffuseMaps);
-    }
-
-    /* 2. specular maps */
-    List *specularMaps = (List *)loadMaterialTextures(model, material, aiTextureType_SPECULAR, "texture_specular");
-
-    if (!isListEmpty(specularMaps)) {
-        ListAddAll(textures, specularMaps);
-    }
-
-    /* 3. normal maps */
-    List *normalMaps = (List *)loadMaterialTextures(model, material, aiTextureType_HEIGHT, "texture_normal");
-
-    if (!isListEmpty(normalMaps)) {
-        ListAddAll(textures, normalMaps);
+    /* Materials were resolved before the meshes, every mesh gets its own list of the shared textures */
+    if (materialTextures != NULL) {
+        foreach (Texture *texture, materialTextures) {
+            ListAdd(textures, texture);
+        }
     }
 
-    /* 4. height maps */
-    List *heightMaps = (List *)loadMaterialTextures(model, material, aiTextureType_AMBIENT, "texture_height");
-
-    if (!isListEmpty(heightMaps)) {
-        ListAddAll(textures, heightMaps);
-    }
+    ourMesh.textures = textures;
 
     // printf("PROCESSOURMESH -> ENTIRE FUNCTION\n");
-    return (Mesh *)NewMesh(ourMesh, model);
+    return (Mesh *)NewMesh(ourMesh);
 }
 
 /*
-    Processes a node in a recursive fashion.
-    Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
+ -> Every mesh under 'node', in the order a depth first walk of the node tree meets them, appended to 'meshes'.
+ -> Two phases: the tree is flattened into one task per mesh & materials are resolved through the asset registry,
+    then the images are decoded & the meshes converted in parallel on the job system into pre-sized arrays.
+ -> Textures are acquired into 'textures', the ones created here come back decoded. GL setup happens later, batched
+    through the upload queue (see #NewModel3D()).
 */
-static inline void ProcessRootNode(Model3D *model, C_STRUCT aiNode *node, const C_STRUCT aiScene *scene) {
-    if (scene != NULL) {
-        /* Process each 'Mesh' located at the current node */
-        for (GLuint i = 0; i < node->mNumMeshes; i++) {
-            /* The node object only contains indices to index the actual objects in the scene.
-               the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-            */
-            C_STRUCT aiMesh *mesh = (C_STRUCT aiMesh *)scene->mMeshes[node->mMeshes[i]];
-            ListAdd(model->meshes, (Mesh *)ProcessOurMesh(model, mesh, scene));
-            // printf("PROCESSROOTNODE -> MESHES LOOP & CHECK\n");
-        }
+void ProcessRootNode(List *meshes, TextureSet *textures, const C_STRUCT aiNode *node, const C_STRUCT aiScene *scene);
 
-        /* After we've processed all of the Meshes (if any) we then recursively process each of the children nodes */
-        for (GLuint i = 0; i < node->mNumChildren; i++) {
-            ProcessRootNode(model, node->mChildren[i], scene);
-            // printf("PROCESSROOTNODE -> CHILDREN LOOP & CHECK\n");
-        }
-    }
-}
+/* #DecodeTextureImage() over the list, in parallel on the job system */
+void DecodeTextureImages(List *textures);
+
+#ifdef ENGINE_SELF_TESTS
+/* A synthetic scene of 'meshCount' meshes converted with 1, 4 & 16 jobs */
+void BenchmarkModelImport(int meshCount, int vertexCount);
+#endif  // ENGINE_SELF_TESTS
 
 #endif  // MODEL3D_H
\ No newline at end of file
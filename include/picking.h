@@ -0,0 +1,89 @@
+#pragma once
+
+#ifndef PICKING_H
+#define PICKING_H
+
+#include "engine.h"
+
+/*
+ -> GPU picking: every draw writes 'firstID + instance' into the ID attachment of the anti-alias framebuffer,
+    the sample under the cursor is blitted to a 1x1 target & copied into a pixel buffer, all without waiting.
+ -> Each frame owns one of ENGINE_PICK_FRAMES readback slots & the ID ranges it handed out,
+    a slot is decoded once its fence has signaled, usually one or two frames later.
+ -> The CPU side cost is a blit, a 4 byte read & a fence per frame, whatever the scene size.
+*/
+typedef struct PickOwner {
+    SceneObject *object;
+    Model3D *model;
+    GLuint firstID;
+    int count;  // instances, IDs [firstID, firstID + count)
+} PickOwner;
+
+typedef struct PickRead {
+    GLuint pixelBuffer;
+    GLsync fence;  // NULL when no read is in flight
+    long frame;
+
+    PickOwner *owners;  // in ID order, registered while the frame was drawn
+    int ownerCount, ownerCapacity;
+    GLuint nextID;
+} PickRead;
+
+typedef struct PickStats {
+    double cpuSeconds, gpuSeconds;  // CPU time spent in either backend
+    int cpuPicks, gpuFrames;
+
+    long latencyFrames;  // summed over 'resolved'
+    int resolved, skipped;
+} PickStats;
+
+typedef struct PickBuffer {
+    PickRead reads[ENGINE_PICK_FRAMES];
+    int slot;     // read written this frame
+    bool active;  // false when GPU picking is off or this frame's slot is still in flight
+    long frame;
+
+    GLuint resolveFBO, resolveBuffer;  // 1x1 R32UI, the multisampled ID is resolved into it
+
+    /* Copied from the frame snapshot being submitted, the render thread can't ask GLFW itself */
+    vec2s cursor;                   // window coordinates
+    int windowWidth, windowHeight;  // screen coordinates the cursor is in
+    int framebufferWidth, framebufferHeight;
+
+    /* Latest decoded result, 'resultFrame' is the frame it was drawn in */
+    SceneObject *object;
+    Model3D *model;
+    int instance;
+    long resultFrame;
+
+    PickStats stats;
+} PickBuffer;
+
+PickBuffer *NewPickBuffer(void);
+void FreePickBuffer(PickBuffer *pick);
+
+/*
+ -> GPU picking when it is selected & there is a framebuffer with an ID attachment to render into.
+ -> Called from both threads, the framebuffer is recreated by the render thread on resize so it is never dereferenced here.
+*/
+static inline PickingMode GetPickingMode(void) {
+    if (engine->pickingMode == PICKING_GPU && engine->antiAliasing && antiAlias != NULL) return PICKING_GPU;
+    return PICKING_CPU;
+}
+
+/* Decode every finished read & clear the ID attachment for this frame, call with 'frameBuffer' bound */
+void PickBufferBegin(PickBuffer *pick, FrameBufferObject *frameBuffer);
+
+/* First ID of 'instanceCount' consecutive ones for an owner drawn this frame, 0 (nothing) when inactive */
+GLuint PickBufferRegister(PickBuffer *pick, SceneObject *object, Model3D *model, int instanceCount);
+
+/* Route draws to the ID attachment as well, only shaders declaring location 1 (shader.frag) should draw in between */
+void PickBufferWriteIDs(PickBuffer *pick, FrameBufferObject *frameBuffer, bool enable);
+
+/* Queue the read of the ID under the cursor, 'frameBuffer' is bound again afterwards */
+void PickBufferRead(PickBuffer *pick, FrameBufferObject *frameBuffer);
+
+/* Average cost of both backends & the GPU result latency so far */
+void PrintPickStats(const PickBuffer *pick);
+
+#endif  // PICKING_H
@@ -0,0 +1,94 @@
+#pragma once
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+
+#include "engine.h"
+
+/*
+ -> Scoped zones: 'PROFILE_ZONE("name");' times everything from there to the end of the enclosing block, early returns
+    included (GCC/Clang cleanup attribute). Names must outlive the profiler, string literals are.
+ -> Every thread records into its own ring of ENGINE_PROFILER_EVENTS zones, registered on its first zone. Only the owner
+    writes it, readers (overlay, trace export) never block it & throw away whatever was overwritten while they read.
+ -> 'PROFILE_GPU_ZONE("name");' is a zone that also wraps a GL_TIME_ELAPSED query, render thread only. Those queries
+    can't nest, a GPU zone opened inside another one only records CPU time. Results are read back
+    ENGINE_PROFILER_GPU_FRAMES frames later & show up on a separate "GPU" track.
+ -> #ProfilerExportChromeTrace() writes the rings as Chrome trace JSON (about:tracing, ui.perfetto.dev).
+*/
+typedef struct ProfileEvent {
+    const char *name;
+    uint64_t start, end;  // nanoseconds, #GetTimeNanoseconds()
+    int depth;            // zones open on the thread when this one started
+} ProfileEvent;
+
+typedef struct ProfileZone {
+    const char *name;
+    uint64_t start;
+} ProfileZone;
+
+typedef struct ProfileGpuZone {
+    ProfileZone zone;
+    bool query;  // false when nested in another GPU zone, or out of queries this frame
+} ProfileGpuZone;
+
+/* One zone name over the summary window */
+typedef struct ProfileSummaryRow {
+    const char *name;
+    bool gpu;
+    int calls;
+    double total, max;  // seconds
+} ProfileSummaryRow;
+
+typedef struct ProfileSummary {
+    ProfileSummaryRow rows[ENGINE_PROFILER_GPU_ZONES * 2];
+    int rowCount;
+    double seconds;  // window the rows cover
+} ProfileSummary;
+
+void InitProfiler(void);
+/* Call once every thread that recorded zones has been joined & the GL context is current */
+void ShutdownProfiler(void);
+
+/* Shown on the thread's track, registers the thread if it hasn't recorded anything yet */
+void ProfilerSetThreadName(const char *name);
+
+ProfileZone ProfileZoneBegin(const char *name);
+void ProfileZoneEnd(ProfileZone *zone);
+
+ProfileGpuZone ProfileGpuZoneBegin(const char *name);
+void ProfileGpuZoneEnd(ProfileGpuZone *zone);
+
+/* Render thread, before the frame's first GPU zone: collects the ranges of ENGINE_PROFILER_GPU_FRAMES frames ago */
+void ProfileGpuFrameBegin(void);
+
+/* Zones that ended in the last 'seconds' of every track, by total time */
+ProfileSummary GetProfileSummary(double seconds);
+void PrintProfileSummary(const ProfileSummary *summary);
+
+/* Render thread, NanoVG text over the frame when 'engine->profilerOverlay' is on, sized by the snapshot's 'frame' */
+struct UIFrame;
+void DrawProfilerOverlay(const struct UIFrame *frame);
+
+bool ProfilerExportChromeTrace(const char *path);
+
+#ifdef ENGINE_SELF_TESTS
+/* A thread records zones while this one reads them back through the lock-free path. False when one comes back torn */
+bool ProfilerSelfTest(int zones);
+#endif  // ENGINE_SELF_TESTS
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if ENGINE_PROFILER
+#define PROFILE_ZONE(name) \
+    ProfileZone PROFILE_CONCAT(profileZone, __LINE__) __attribute__((cleanup(ProfileZoneEnd))) = ProfileZoneBegin(name)
+#define PROFILE_GPU_ZONE(name) \
+    ProfileGpuZone PROFILE_CONCAT(profileGpuZone, __LINE__) __attribute__((cleanup(ProfileGpuZoneEnd))) = ProfileGpuZoneBegin(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_GPU_ZONE(name) ((void)0)
+#endif
+
+#endif  // PROFILER_H
@@ -3,7 +3,10 @@
 #ifndef RENDER_H
 #define RENDER_H
 
+#include "assets.h"
+#include "callbacks.h"
 #include "engine.h"
+#include "glstate.h"
 #include "object.h"
 
 FrameBufferObject *BindFrameBuffer(FrameBufferObject frameBuffer);
@@ -19,13 +22,27 @@ void DrawBoundingBox(SceneObject *object, Model3D *ourModel);
 void GenerateTransformGizmo(SceneObject *object, Model3D *model);
 void DrawTransformGizmo(SceneObject *object, Model3D *model);
 
+/* Recorded into 'engine->debugList' of the frame being built, drawn by the debug draw flush once it is submitted */
 void DrawLine(Line line);
 void DrawTriangle(Triangle triangle);
 
 Transform *NewTransforms(int instanceCount, Transform *transforms);
 
+/* Bounding box matrix for the owner's current transform, rebuilt only when the transform version moved */
+mat4s *GetBoundingBoxMatrix(BoundingBox *boundingBox, Transform *transform);
+
+/* 2D textures are shared through the asset registry by path, a path loaded before comes back without touching GL */
 Texture *NewTexture(TextureType type, const char *path);
 
+/*
+ -> Any thread, 'path' under the asset directory decoded bottom row first like GL expects, NULL when it can't be read.
+ -> Flips the rows itself, stb_image's flip flag is process wide & cube faces are loaded unflipped meanwhile.
+*/
+unsigned char *LoadTextureImage(const char *path, int *width, int *height, int *channels);
+
+/* 'free' of a texture asset: its GL name goes on the render thread, with whatever is left of its image & path */
+void FreeTextureAsset(Asset *asset);
+
 /*
 Order of operation:
     +X (right)
@@ -39,8 +56,68 @@ Skybox *NewSkybox(List *textureNames);
 
 void UseTexture(Texture *texture);
 
+/* 'FrameData' uniform block, filled once per frame from a camera snapshot & uploaded when that frame is submitted */
+void InitFrameUniforms(void);
+void FillFrameUniforms(Camera *camera, FrameUniforms *frame);
+void UploadFrameUniforms(const FrameUniforms *frame);
+void FreeFrameUniforms(void);
+
+/* Shader an object or model is drawn with, instanced draws always go through 'instanceShader' */
+Shader *GetObjectShader(SceneObject *object, Model3D *model);
+
+/* Per-object uniforms only, the shader must already be bound */
+void SendObjectUniforms(Shader *shader, SceneObject *object, Model3D *model);
 void SendToShader(SceneObject *object, Model3D *model);
-void UpdateInstancedBufferObj(SceneObject *object, Model3D *model, mat4s *matrices, int newCount);
+
+/* Write an instanced object's matrices into this frame's instance ring once, every mesh draws from the returned base instance */
+int StreamInstanceMatrices(SceneObject *object, Model3D *model);
+
+/* translate -> rotate -> scale, always recomputed, for temporaries that never live past one draw */
+static inline mat4s ComposeTransform(const Transform *transform) {
+    mat4s model = glms_mat4_identity();
+
+    model = glms_translate(model, transform->position);
+    model = glms_rotate(model, glm_rad(transform->rotationDegrees), transform->rotation);
+    model = glms_scale(model, transform->scale);
+
+    return model;
+}
+
+static inline void MarkTransformDirty(Transform *transform) {
+    transform->dirty = GLFW_TRUE;
+}
+
+/* Cached world matrix, only recomposed after the transform was marked dirty */
+static inline mat4s *GetTransformMatrix(Transform *transform) {
+    if (transform->dirty) {
+        transform->model = ComposeTransform(transform);
+        transform->dirty = GLFW_FALSE;
+        transform->version++;
+    }
+
+    return &transform->model;
+}
+
+static inline void SetTransformPosition(Transform *transform, vec3s position) {
+    transform->position = position;
+    transform->dirty = GLFW_TRUE;
+}
+
+static inline void TranslateTransform(Transform *transform, vec3s delta) {
+    transform->position = glms_vec3_add(transform->position, delta);
+    transform->dirty = GLFW_TRUE;
+}
+
+static inline void SetTransformRotation(Transform *transform, vec3s axis, float degrees) {
+    transform->rotation = axis;
+    transform->rotationDegrees = degrees;
+    transform->dirty = GLFW_TRUE;
+}
+
+static inline void SetTransformScale(Transform *transform, vec3s scale) {
+    transform->scale = scale;
+    transform->dirty = GLFW_TRUE;
+}
 
 static inline float CalcDistance(vec3s cameraPos, vec3s objectPos) {
     return sqrtf(powf(cameraPos.x - objectPos.x, 2) +
@@ -111,10 +188,8 @@ static inline bool ObjectExists(SceneObject *object) {
 }
 
 static inline void UnbindBufferObj(SceneObject *object, Model3D *model) {
-    BoundingBox *boundingBox = (object != NULL) ? object->transforms->boundingBox : model->transforms->boundingBox;
-
     // Unbind VAO, VBO, and EBO
-    glBindVertexArray(0);
+    StateBindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
@@ -122,12 +197,10 @@ static inline void UnbindBufferObj(SceneObject *object, Model3D *model) {
     if (object != NULL) {
         glDeleteVertexArrays(1, &object->VAO);
         glDeleteBuffers(1, &object->VBO);
-        glDeleteBuffers(1, &object->IVBO);
         glDeleteBuffers(1, &object->EBO);
 
         object->VAO = 0;
         object->VBO = 0;
-        object->IVBO = 0;
         object->EBO = 0;
     }
 
@@ -136,51 +209,50 @@ static inline void UnbindBufferObj(SceneObject *object, Model3D *model) {
             foreach (Mesh *mesh, model->meshes) {
                 glDeleteVertexArrays(1, &mesh->VAO);
                 glDeleteBuffers(1, &mesh->VBO);
-                glDeleteBuffers(1, &mesh->IVBO);
                 glDeleteBuffers(1, &mesh->EBO);
 
                 mesh->VAO = 0;
                 mesh->VBO = 0;
-                mesh->IVBO = 0;
                 mesh->EBO = 0;
             }
         }
     }
 
-    if (boundingBox != NULL) {
-        glDeleteVertexArrays(1, &boundingBox->VAO);
-        glDeleteBuffers(1, &boundingBox->VBO);
-        glDeleteBuffers(1, &boundingBox->EBO);
-
-        boundingBox->VAO = 0;
-        boundingBox->VBO = 0;
-        boundingBox->EBO = 0;
-    }
 }
 
 static inline void RemoveTextures(void) {
-    size_t size = MapSize(engine->textures);
+    size_t size = HashMapSize(engine->textures);
 
-    if (!isMapEmpty(engine->textures)) {
-        MapClear(engine->textures);
+    if (!isHashMapEmpty(engine->textures)) {
+        HashMapClear(engine->textures);
     }
 
     printf("[TAV ENGINE] %zu Textures have been freed!\n", size);
 }
 
-static inline void FreeupObject(SceneObject *object) {
-    if (ObjectExists(object)) {
-        UnbindBufferObj(object, NULL);
-    }
-}
+/*
+ -> The object stops existing right away, its GL buffers go on the render thread once no snapshot in flight can draw
+    them anymore (#UpdateRetiredObjects()). Without a render thread they're deleted here.
+*/
+void FreeupObject(SceneObject *object);
+
+/* Main thread, once per frame: hands buffers retired ENGINE_FRAME_SNAPSHOTS frames ago to the render thread */
+void UpdateRetiredObjects(void);
+
+/* Deletes every retired buffer, once no frame is in flight anymore (after #ShutdownRenderThread()) */
+void FreeRetiredObjects(void);
 
 static inline void UnbindFrameBufferObj(FrameBufferObject *frameBuffer) {
     if (frameBuffer) {
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
         glDeleteFramebuffers(1, &frameBuffer->frameBufferID);
         glDeleteTextures(1, &frameBuffer->texColorBufferID);
+        glDeleteTextures(1, &frameBuffer->pickTextureID);
         glDeleteRenderbuffers(1, &frameBuffer->depthStencilBufferID);
 
+        // Deleted names get reused, don't let the cache filter a bind to a new texture with an old name
+        InvalidateStateCache();
+
         free(frameBuffer);
 
         printf("[TAV ENGINE] Screen Framebuffer Object has been freed!\n");
@@ -190,6 +262,8 @@ static inline void UnbindFrameBufferObj(FrameBufferObject *frameBuffer) {
 static inline void RemoveSceneObjects(void) {
     int counter = 0;
     foreach (SceneObject *object, engine->sceneObjects) {
+        ForgetHoveredOwner(object);
+
         if (!ObjectExists(object)) continue;
         FreeupObject(object);
         counter++;
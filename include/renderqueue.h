@@ -0,0 +1,113 @@
+#pragma once
+
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <stdint.h>
+
+#include "engine.h"
+
+/*
+ -> Sort key layout (most significant bits first):
+    Opaque:      [pass:4][shader:12][texture:16][VAO:16][depth:16]    (front to back)
+    Transparent: [pass:4][depth:16][shader:12][texture:16][VAO:16]    (back to front)
+ -> GL names are masked into their fields, the backend still compares the real names before changing state.
+*/
+#define RENDER_KEY_PASS_BITS 4
+#define RENDER_KEY_SHADER_BITS 12
+#define RENDER_KEY_TEXTURE_BITS 16
+#define RENDER_KEY_VAO_BITS 16
+#define RENDER_KEY_DEPTH_BITS 16
+
+#define ENGINE_RENDER_QUEUE_DEFAULT_CAPACITY 256
+
+typedef enum RenderPass {
+    RENDER_PASS_OPAQUE = 0,
+    RENDER_PASS_TRANSPARENT,
+    RENDER_PASS_COUNT
+} RenderPass;
+
+/*
+ -> Everything the backend needs to issue one draw, captured when it is pushed so submission never reads
+    the owner again, the render thread may submit it while the simulation already moved the owner on.
+ -> 'object' & 'model' are only compared & handed to picking, never dereferenced by #RenderQueueSubmit().
+*/
+typedef struct RenderCommand {
+    RenderPass pass;
+
+    SceneObject *object;
+    Model3D *model;
+    Mesh *mesh;
+
+    Shader *shader;
+    Texture *texture;
+    GLuint VAO;
+
+    mat4s matrix;  // world matrix of a single instance
+    vec3s color;  // hover color already resolved
+    bool isSprite, isBillboard;
+
+    int indexCount, vertexCount, instanceCount;
+    int firstInstance;  // into RenderQueue.instances, shared by every mesh of an instanced model
+    GLuint pickID;      // first GPU picking ID of the owner, assigned at submit, 0 while GPU picking is off
+} RenderCommand;
+
+/* What actually gets sorted, 'command' indexes into RenderQueue.commands */
+typedef struct RenderPacket {
+    uint64_t key;
+    uint32_t command;
+} RenderPacket;
+
+typedef struct RenderQueueStats {
+    int draws;
+    int passChanges, shaderChanges, textureChanges, vaoChanges;
+} RenderQueueStats;
+
+/* Buffers come from 'arena' & are only valid between #RenderQueueBegin() & the arena's reset */
+typedef struct RenderQueue {
+    struct Arena *arena;
+
+    RenderCommand *commands;
+    RenderPacket *packets, *scratch;
+    int count, capacity;
+
+    /* Matrices of every instanced command, copied into the instance ring in one block at submit */
+    mat4s *instances;
+    int instanceCount, instanceCapacity;
+
+    /* Counters for the last submitted frame */
+    RenderQueueStats stats;
+} RenderQueue;
+
+RenderQueue *NewRenderQueue(struct Arena *arena, int capacity);
+void FreeRenderQueue(RenderQueue *queue);
+
+/* Take this frame's buffers from the arena, sized for the largest frame so far, call once per frame before pushing */
+void RenderQueueBegin(RenderQueue *queue);
+
+void RenderQueuePushObject(RenderQueue *queue, SceneObject *object);
+void RenderQueuePushModel(RenderQueue *queue, Model3D *model);
+
+/* LSD radix sort on the 64-bit keys, stable & linear in the packet count */
+void RenderQueueSort(RenderQueue *queue);
+
+/* Issue every packet in key order, only touching GL state when it differs from the previous packet. GL thread only */
+void RenderQueueSubmit(RenderQueue *queue);
+
+static inline uint64_t MakeSortKey(RenderPass pass, GLuint shader, GLuint texture, GLuint VAO, uint16_t depth) {
+    uint64_t p = (uint64_t)pass & ((1ull << RENDER_KEY_PASS_BITS) - 1);
+    uint64_t s = (uint64_t)shader & ((1ull << RENDER_KEY_SHADER_BITS) - 1);
+    uint64_t t = (uint64_t)texture & ((1ull << RENDER_KEY_TEXTURE_BITS) - 1);
+    uint64_t v = (uint64_t)VAO & ((1ull << RENDER_KEY_VAO_BITS) - 1);
+    uint64_t d = (uint64_t)depth;
+
+    if (pass == RENDER_PASS_TRANSPARENT) {
+        // Farthest first, so invert the depth & let it dominate the state bits
+        d = (~d) & ((1ull << RENDER_KEY_DEPTH_BITS) - 1);
+        return (p << 60) | (d << 44) | (s << 32) | (t << 16) | v;
+    }
+
+    return (p << 60) | (s << 48) | (t << 32) | (v << 16) | d;
+}
+
+#endif  // RENDERQUEUE_H
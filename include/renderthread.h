@@ -0,0 +1,79 @@
+#pragma once
+
+#ifndef RENDERTHREAD_H
+#define RENDERTHREAD_H
+
+#include "debugdraw.h"
+#include "engine.h"
+#include "ui.h"
+
+/*
+ -> The GL context lives on a dedicated render thread, the main thread only simulates & builds frames.
+ -> A frame is built into a FrameSnapshot (visible draws, matrices, camera, debug lines, UI) that the render thread
+    treats as immutable, there are ENGINE_FRAME_SNAPSHOTS of them so frame N+1 is built while frame N is submitted.
+ -> Nothing the render thread reads is shared with the simulation except through a snapshot, the few results
+    going the other way (GPU pick, UI layout) are written into the snapshot & picked up when it is acquired again.
+ -> With ENGINE_RENDER_THREAD off, or if the thread can't start, #PublishFrameSnapshot() submits right away.
+*/
+typedef struct FrameSnapshot {
+    long frame;
+
+    struct Arena *arena;        // everything variable sized below, reset by the builder once it read the results
+    struct RenderQueue *queue;  // sorted draws & their instance matrices, taken from 'arena'
+
+    FrameUniforms uniforms;
+    DebugDrawList debug;
+
+    /* Copies of the UI elements to draw & where they came from, layouts computed while drawing go back to 'sources' */
+    Element *elements;
+    Element **sources;
+    int elementCount;
+
+    Skybox *skybox;
+    UIFrame ui;
+
+    vec2s cursor;
+    int windowWidth, windowHeight;  // screen coordinates
+    int framebufferWidth, framebufferHeight;
+
+    bool vSync, antiAliasing, wireframe, profilerOverlay;
+
+    /* Written by the render thread: the latest decoded GPU pick when the snapshot was submitted */
+    SceneObject *pickedObject;
+    Model3D *pickedModel;
+    bool pickValid;
+} FrameSnapshot;
+
+typedef void (*RenderThreadFunction)(void *data);
+
+/* Time each side spent waiting on the other, since startup */
+typedef struct RenderThreadStats {
+    long frames;
+    double simulationWait;  // main thread waiting for a free snapshot (GPU bound)
+    double renderWait;      // render thread waiting for a published one (CPU bound)
+} RenderThreadStats;
+
+/* Create the snapshots & hand the context to the render thread, call once every init-time GL resource exists */
+void InitRenderThread(void);
+
+/* Submit whatever was published, join the thread & make the context current on the calling thread again */
+void ShutdownRenderThread(void);
+
+/* Next snapshot to build, waits while the render thread still submits it */
+FrameSnapshot *AcquireFrameSnapshot(void);
+
+/* Hand a built snapshot over to be submitted, it must not be touched until it is acquired again */
+void PublishFrameSnapshot(FrameSnapshot *snapshot);
+
+/*
+ -> GL work from outside the render thread (shader reloads, resource creation), runs before the next submitted frame.
+ -> Never dropped: when the queue can't grow, the caller waits for room in a fixed reserve.
+*/
+void RunOnRenderThread(RenderThreadFunction function, void *data);
+
+/* True where GL may be called: the render thread, or any caller while frames are submitted inline */
+bool IsRenderThread(void);
+
+RenderThreadStats GetRenderThreadStats(void);
+
+#endif  // RENDERTHREAD_H
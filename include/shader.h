@@ -4,9 +4,11 @@
 #define SHADER_H
 
 #include "engine.h"
+#include "glstate.h"
 #include <stdbool.h>
 
 void reloadShaders(void);
+/* Shared through the asset registry, the same pair of stages comes back as the program compiled first */
 Shader *NewShader(const char *vertexPath, const char *fragmentPath);
 void UseShader(Shader shader);
 
@@ -23,26 +25,30 @@ void setMat2(Shader shader, const char *name, const mat2s *mat);
 void setMat3(Shader shader, const char *name, const mat3s *mat);
 void setMat4(Shader shader, const char *name, const mat4s *mat);
 
+/*
+ -> Handle based setters, these skip the name lookup entirely.
+ -> Resolve a handle once with #GetUniformHandle() (or use 'shader->handles') and reuse it every draw.
+ -> Invalid handles (-1) are ignored, just like a location of -1 is in OpenGL.
+*/
+void ReflectUniforms(Shader *shader);
+void FreeUniforms(Shader *shader);
+UniformHandle GetUniformHandle(Shader *shader, const char *name);
+
+void setUniformBool(Shader *shader, UniformHandle handle, bool value);
+void setUniformInt(Shader *shader, UniformHandle handle, int value);
+void setUniformUInt(Shader *shader, UniformHandle handle, GLuint value);
+void setUniformFloat(Shader *shader, UniformHandle handle, float value);
+void setUniformVec2(Shader *shader, UniformHandle handle, const vec2s *value);
+void setUniformVec3(Shader *shader, UniformHandle handle, const vec3s *value);
+void setUniformVec4(Shader *shader, UniformHandle handle, const vec4s *value);
+void setUniformMat2(Shader *shader, UniformHandle handle, const mat2s *mat);
+void setUniformMat3(Shader *shader, UniformHandle handle, const mat3s *mat);
+void setUniformMat4(Shader *shader, UniformHandle handle, const mat4s *mat);
+
 static inline char *getShaderPath(const char *path) {
     return (char *)CreatePath(engine->shaderDir, path);
 }
 
-static inline void freeShaders(void) {
-    if (isListEmpty(engine->shaders)) {
-        printf("[TAV ENGINE] No shaders to free.\n");
-        return;
-    }
-
-    int counter = 0;
-    foreach (Shader *shader, engine->shaders) {
-        glDeleteProgram(shader->programID);
-        counter++;
-    }
-
-    ListClear(engine->shaders);
-    printf("[TAV ENGINE] %d Shaders have been freed!\n", counter);
-}
-
 static inline void checkCompileErrors(GLuint shader, char *type) {
     int success;
     char infoLog[1024];
@@ -62,6 +68,19 @@ static inline void checkCompileErrors(GLuint shader, char *type) {
     }
 }
 
+/*
+ -> Shaders are written against "#version 460 core", a 4.x context older than that (llvmpipe exposes 4.5) gets its own
+    version patched in, nothing in them needs more than 4.2
+*/
+static inline void MatchShaderVersion(char *code) {
+    const char *version = "#version 460";
+
+    if (engine->glVersion < 42 || engine->glVersion >= 46) return;
+    if (strncmp(code, version, strlen(version)) != 0) return;
+
+    code[10] = (char)('0' + engine->glVersion % 10);
+}
+
 static inline void ReadContents(Shader *shader) {
     char *fullVertexPath = getShaderPath(shader->vertexPath);
     char *fullFragmentPath = getShaderPath(shader->fragmentPath);
@@ -91,6 +110,9 @@ static inline void ReadContents(Shader *shader) {
         return;
     }
 
+    MatchShaderVersion((char *)vShaderCode);
+    MatchShaderVersion((char *)fShaderCode);
+
     shader->vShaderCode = vShaderCode;
     shader->fShaderCode = fShaderCode;
 
@@ -122,6 +144,9 @@ static inline void CompileShader(Shader *shader) {
     glLinkProgram(shader->programID);
     checkCompileErrors(shader->programID, "PROGRAM");
 
+    // Cache every active uniform location so setters never hit glGetUniformLocation
+    ReflectUniforms(shader);
+
     // Delete the shaders as they're linked into the program now and no longer necessary
     glDeleteShader(vertex);
     glDeleteShader(fragment);
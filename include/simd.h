@@ -0,0 +1,24 @@
+#pragma once
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ENGINE_SIMD_X86 1
+#else
+#define ENGINE_SIMD_X86 0
+#endif
+
+typedef enum SimdLevel {
+    SIMD_SCALAR = 0,
+    SIMD_SSE,   // 4 lanes
+    SIMD_AVX2,  // 8 lanes
+    SIMD_LEVEL_COUNT
+} SimdLevel;
+
+/* Widest level the CPU & OS support, asked from CPUID once & cached */
+SimdLevel GetSimdLevel(void);
+
+const char *SimdLevelName(SimdLevel level);
+
+#endif  // SIMD_H
@@ -0,0 +1,66 @@
+#pragma once
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "jobs.h"
+
+/*
+ -> Hierarchical timing wheel, 4 levels of 256 slots over ticks of ENGINE_TIMER_WHEEL_TICK_NS.
+    A timer sits in the level of the highest byte where its deadline differs from the current tick
+    & falls down a level each time the wheel reaches its slot, so inserting & canceling are O(1).
+ -> One scheduler thread sleeps until the next slot that holds anything, expired callbacks run on the job system.
+*/
+struct WheelTimer;
+
+typedef void (*WheelTimerFunction)(struct WheelTimer *timer);
+
+/*
+ -> Owned by the caller, it must stay alive until #WaitForWheelTimer() returned after a cancel or its last expiry.
+ -> Zeroed before its first #StartWheelTimer(), which only moves it when it's started again while still linked.
+*/
+typedef struct WheelTimer {
+    WheelTimerFunction callback;
+    void *data;
+
+    uint64_t deadline;  // tick of the next expiry
+    uint64_t interval;  // ticks between repeats, 0 for a one-shot
+
+    int fired;      // callbacks dispatched so far
+    int overruns;   // repeats skipped because the previous callback was still running
+    bool canceled;  // atomic
+
+    JobCounter counter;  // callback queued or running
+
+    struct WheelTimer *next, *prev;  // slot list
+    int level, slot;                 // where it's linked
+    bool linked;                     // in a slot list, guarded by the wheel lock
+} WheelTimer;
+
+/* Starts the scheduler thread, the job system must be running first */
+void InitTimerWheel(void);
+
+/* Stops the scheduler, pending timers are dropped without firing */
+void ShutdownTimerWheel(void);
+
+/*
+ -> Fire 'callback' after 'delay' seconds, then every 'interval' seconds (0 for once), never before it's due.
+ -> Restarting an armed timer replaces its deadline, wait for a dispatched callback first when changing 'callback'.
+*/
+void StartWheelTimer(WheelTimer *timer, double delay, double interval, WheelTimerFunction callback, void *data);
+
+/* O(1), a callback that was already dispatched may still be running, see #WaitForWheelTimer() */
+void CancelWheelTimer(WheelTimer *timer);
+
+/* Runs other jobs until the timer's dispatched callback is done, don't call it from that callback */
+void WaitForWheelTimer(WheelTimer *timer);
+
+#ifdef ENGINE_SELF_TESTS
+/* Thousands of timers fired, repeated & canceled, lateness & scheduler CPU time are printed. False when one is off */
+bool TimerWheelSelfTest(int timers);
+#endif  // ENGINE_SELF_TESTS
+
+#endif  // TIMERWHEEL_H
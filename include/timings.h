@@ -7,20 +7,45 @@
 #include <time.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
-#include <glfw3.h>
+
+/*
+  Read the TSC instead of calling clock_gettime once it's calibrated against the
+  monotonic clock, x86 with an invariant TSC only. Saves the call on hot timing paths.
+*/
+#define TIMINGS_USE_TSC false
+
+#define TIMINGS_FRAME_WINDOW 240       // frames kept for the percentiles
+#define TIMINGS_FRAME_SMOOTHING 0.1    // weight of the newest frame in the smoothed frame time
 
 typedef struct Timer
 {                     // Represents a timer that can be used to schedule
                       // tasks. Useful for anything.
     double startTime; // Start Time (seconds)
     double lifeTime;  // Lifetime (seconds)
+    unsigned int index; // Slot in timerManager->timers
 } Timer;
 
+typedef struct FrameTimeStats
+{
+    double p50, p95, p99; // seconds, over the last TIMINGS_FRAME_WINDOW frames
+} FrameTimeStats;
+
+typedef struct FrameTimer
+{
+    uint64_t lastFrame; // nanoseconds, 0 before the first #FrameTimerTick()
+    double delta;       // seconds since the previous frame
+    double smoothed;    // exponential average of 'delta'
+
+    double window[TIMINGS_FRAME_WINDOW]; // ring of the latest deltas
+    int head, count;
+} FrameTimer;
+
 typedef struct TimerManager
 {
     Timer **timers; // Create a new Timer with NewTimer()
-    double seconds;
+    double seconds; // time #InitTimerManager() was called
 
     unsigned int totalTimers;        // total number of timers in memory
     unsigned int totalTimerCapacity; // space allocated to Timers** array
@@ -28,13 +53,28 @@ typedef struct TimerManager
 
 extern TimerManager *timerManager;
 
+/* Calibrate the TSC over 'seconds' of the monotonic clock, false (& the clock is kept) without an invariant TSC */
+bool CalibrateTSC(double seconds);
+
+/* Nanoseconds on CLOCK_MONOTONIC_RAW, never jumps & needs no GLFW context, safe on any thread */
+uint64_t GetTimeNanoseconds(void);
+
+static inline double GetTimeSeconds(void)
+{
+    return (double)GetTimeNanoseconds() * 1e-9;
+}
+
 static inline void InitTimerManager(void)
 {
+#if TIMINGS_USE_TSC == true
+    CalibrateTSC(0.01);
+#endif // TIMINGS_USE_TSC
+
     timerManager = (TimerManager*) malloc(sizeof(TimerManager));
     timerManager->totalTimerCapacity = 2;
 
     timerManager->timers = (Timer**) malloc(timerManager->totalTimerCapacity * sizeof(Timer *));
-    timerManager->seconds = (double) glfwGetTime();
+    timerManager->seconds = GetTimeSeconds();
     timerManager->totalTimers = 0;
 
     if (timerManager->timers == NULL)
@@ -46,11 +86,18 @@ static inline void InitTimerManager(void)
 }
 
 Timer *NewTimer(double lifeTime); // Create a new Timer
+void FreeTimer(Timer *timer);     // Remove a Timer from the manager & free it, O(1)
 void StartTimer(Timer *timer);    // Starts this Timer
 bool TimerDone(
     Timer timer); // Check if this Timer has reached its 'lifetime' value
 
 double GetElasped(Timer timer); // Returns the elapsed time in seconds since
-double current_time(void);
+double current_time(void);      // Seconds on the monotonic clock, see #GetTimeNanoseconds()
+
+/* Call once per frame, returns the seconds since the previous call (0 on the first one) */
+double FrameTimerTick(FrameTimer *frameTimer);
+
+/* Percentiles of the frame window, sorted on a copy so call it at most a few times per second */
+FrameTimeStats GetFrameTimeStats(const FrameTimer *frameTimer);
 
 #endif // TIMINGS_H
\ No newline at end of file
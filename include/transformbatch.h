@@ -0,0 +1,48 @@
+#pragma once
+
+#ifndef TRANSFORMBATCH_H
+#define TRANSFORMBATCH_H
+
+#include "engine.h"
+#include "simd.h"
+
+/*
+ -> Structure of arrays view of 'count' transforms, every pointer holds 'count' floats.
+ -> Rotations are axis + degrees exactly like Transform, a zero length axis gives a pure scale
+    the same way glm_rotate_make does.
+*/
+typedef struct TransformSoA {
+    float *positionX, *positionY, *positionZ;
+    float *axisX, *axisY, *axisZ, *degrees;
+    float *scaleX, *scaleY, *scaleZ;
+
+    int count, capacity;
+} TransformSoA;
+
+void ReserveTransformSoA(TransformSoA *soa, int capacity);
+void FreeTransformSoA(TransformSoA *soa);
+
+/* Copy transforms[indices[i]] (or transforms[i] when 'indices' is NULL) into lane i */
+void GatherTransforms(TransformSoA *soa, const Transform *transforms, const int *indices, int count);
+
+/* translate -> rotate -> scale for every lane into 'matrices', using the widest kernel #GetSimdLevel() allows */
+void ComposeTransformsBatch(const TransformSoA *soa, mat4s *matrices);
+
+/* Same with a forced kernel, levels the CPU doesn't support fall back to the best supported one */
+void ComposeTransformsBatchLevel(SimdLevel level, const TransformSoA *soa, mat4s *matrices);
+
+/*
+ -> Recompose every dirty transform in one batch & clear its flag, a no-op below ENGINE_TRANSFORM_BATCH_THRESHOLD
+    where #GetTransformMatrix() does the job lazily.
+*/
+void UpdateDirtyTransforms(Transform *transforms, int count);
+
+#ifdef ENGINE_SELF_TESTS
+/* Compare every kernel against cglm's translate/rotate/scale chain, returns false on mismatch */
+bool TransformBatchSelfTest(int count);
+
+/* Time every kernel & the cglm reference over 'count' instances, results are printed */
+void BenchmarkTransformBatch(int count, int iterations);
+#endif  // ENGINE_SELF_TESTS
+
+#endif  // TRANSFORMBATCH_H
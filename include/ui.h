@@ -36,6 +36,15 @@ typedef struct Menu {
 
 extern Menu *menu;
 
+/* What drawing reads besides the elements, copied into the frame snapshot: the render thread can't read 'menu' or 'engine' */
+typedef struct UIFrame {
+    bool shown;
+    float windowWidth, windowHeight, pixelRatio;
+} UIFrame;
+
+/* The UI state of the frame being built, main thread */
+UIFrame GetUIFrame(void);
+
 void initUI(void);
 void destroyUI(void);
 void toggleMenu(void);
@@ -55,7 +64,7 @@ static inline void FreeupElement(Element *element) {
 
 void RemoveElement(Element *element);
 
-void DrawElement(Element *element, void (*update)(void));
+void DrawElement(Element *element, const UIFrame *frame, void (*update)(void));
 
 static inline char *elementTypetoString(ElementType type) {
     switch (type) {
@@ -0,0 +1,68 @@
+#pragma once
+
+#ifndef UPLOAD_H
+#define UPLOAD_H
+
+#include <stddef.h>
+
+#include "engine.h"
+
+/*
+ -> GL resource creation for streamed assets, queued from any thread & run by the render thread at the top of
+    #submit() with at most ENGINE_UPLOAD_BUDGET_BYTES moved per frame, so an asset of any size never costs one frame
+    more than the budget.
+ -> An upload is a step function called frame after frame until it reports done, each call moves at most what's left
+    of the budget (buffers & textures are filled in slices, see #UploadBufferSlices() & #UploadTextureSlices()).
+ -> Uploads run in the order they were queued, 'done' is called on the render thread once the last step finished.
+    The queue doesn't own them, whoever queued one keeps it alive until then or until #DiscardGpuUploads().
+*/
+typedef struct GpuUpload GpuUpload;
+
+/* True once the upload is complete, 'budget' is lowered by the bytes it moved */
+typedef bool (*GpuUploadStep)(GpuUpload *upload, size_t *budget);
+
+struct GpuUpload {
+    GpuUploadStep step;
+    void (*done)(GpuUpload *upload);  // may be NULL
+
+    GpuUpload *next;  // queue link
+};
+
+typedef struct GpuUploadStats {
+    long queued, completed;
+    size_t bytes;          // moved since startup
+    size_t maxFrameBytes;  // most moved in a single frame
+    long frames;           // frames that moved anything
+} GpuUploadStats;
+
+/* A buffer filled 'data' slice by slice, 'buffer' is a name from glGenBuffers() */
+typedef struct BufferSlices {
+    GLuint buffer;
+    const void *data;
+    size_t size, offset;
+    bool allocated;
+} BufferSlices;
+
+/* A 2D texture filled a band of rows at a time, mipmaps are generated after the last band */
+typedef struct TextureSlices {
+    GLuint texture;
+    const unsigned char *pixels;
+    int width, height, channels;
+    int row;  // first row not uploaded yet
+    bool allocated;
+} TextureSlices;
+
+void QueueGpuUpload(GpuUpload *upload);
+
+/* Render thread, once per frame */
+void ProcessGpuUploads(size_t budget);
+
+/* Forget every queued upload without running it, for shutdown once the render thread is gone */
+void DiscardGpuUploads(void);
+
+GpuUploadStats GetGpuUploadStats(void);
+
+bool UploadBufferSlices(BufferSlices *slices, size_t *budget);
+bool UploadTextureSlices(TextureSlices *slices, size_t *budget);
+
+#endif  // UPLOAD_H
@@ -10,7 +10,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+
+#ifdef _WIN32
 #include <windows.h>
+#else
+#include <unistd.h>
+#endif
 
 #include "engine.h"
 #include "ui.h"
@@ -25,6 +30,12 @@
     mat.raw[3][1] = 0.0f;             \
     mat.raw[3][2] = 0.0f;
 
+/* Small LCG for self-tests & benchmarks, reproducible without touching rand()'s global state */
+static inline float RandomRange(unsigned int *state, float min, float max) {
+    *state = *state * 1664525u + 1013904223u;
+    return min + (max - min) * (float)(*state >> 8) / (float)(1u << 24);
+}
+
 static inline char *textureTypetoString(TextureType type) {
     switch (type) {
         case TEXTURE_TYPE_CUBEMAP:
@@ -206,6 +217,7 @@ static inline bool IsAxisSelectionActive(void) {
 bool isPointInsideElement(Element *element, vec2s cursor);
 bool isPointInside3DObj(SceneObject *object, Model3D *model, vec2s worldCursor);
 
-void TransformGizmoUpdateObject(SceneObject *object, Model3D *model, vec3s delta, vec2s cursor);
+/* 'ray' is the cursor's picking ray, generated once per cursor event by the caller */
+void TransformGizmoUpdateObject(SceneObject *object, Model3D *model, vec3s delta, Ray ray);
 
 #endif  // UTILS_H
\ No newline at end of file
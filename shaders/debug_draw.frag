@@ -0,0 +1,21 @@
+#version 460 core
+
+in vec4 Color;
+in float Edge;
+in float LineWidth;
+
+out vec4 FragColor;
+
+void main()
+{
+    vec4 color = Color;
+
+    // Distance to the line's center in pixels, the last pixel fades out in place of GL_LINE_SMOOTH
+    if (LineWidth > 0.0) {
+        float halfWidth = LineWidth * 0.5 + 1.0;
+        float distance = abs(Edge) * halfWidth;
+        color.a *= clamp(halfWidth - distance, 0.0, 1.0);
+    }
+
+    FragColor = color;
+}
@@ -0,0 +1,51 @@
+#version 460 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aOther;   // opposite end of the line
+layout (location = 2) in vec4 aColor;
+layout (location = 3) in float aWidth;  // pixels, the sign picks the quad side, 0 for triangles
+
+out vec4 Color;
+out float Edge;        // -1 / +1 across a line quad, 0 for triangles
+out float LineWidth;
+
+// Per-frame data, see 'FrameUniforms' in engine.h
+layout (std140, binding = 1) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    float time;
+};
+
+uniform vec2 viewportSize;
+
+void main()
+{
+    vec4 clip = viewProjection * vec4(aPos, 1.0);
+
+    Color = aColor;
+    Edge = sign(aWidth);
+    LineWidth = abs(aWidth);
+
+    if (aWidth != 0.0) {
+        vec4 otherClip = viewProjection * vec4(aOther, 1.0);
+
+        // Screen space direction, w is clamped so a segment crossing the near plane still gets a direction
+        vec2 screen = clip.xy / max(clip.w, 1e-4) * viewportSize;
+        vec2 otherScreen = otherClip.xy / max(otherClip.w, 1e-4) * viewportSize;
+
+        // Both ends of a segment have to agree on its normal, so it's always measured from the lexicographically smaller end
+        vec3 delta = aOther - aPos;
+        float orientation = (delta.x != 0.0) ? sign(delta.x) : ((delta.y != 0.0) ? sign(delta.y) : sign(delta.z));
+
+        vec2 direction = (otherScreen - screen) * orientation;
+        direction = (dot(direction, direction) > 1e-8) ? normalize(direction) : vec2(1.0, 0.0);
+
+        // One extra pixel on each side is faded out by the fragment shader, NDC spans 2 units per viewport
+        vec2 normal = vec2(-direction.y, direction.x);
+        clip.xy += normal * (aWidth + 2.0 * sign(aWidth)) / viewportSize * clip.w;
+    }
+
+    gl_Position = clip;
+}
@@ -7,10 +7,18 @@ layout (location = 3) in mat4 aInstancePos;
 out vec3 FragPos;       // Position of the fragment (for lighting calculations)
 out vec3 Normal;        // Normal of the fragment
 out vec2 TexCoords;     // Texture coordinates passed to the fragment shader
+flat out uint InstanceIndex;
+
+// Per-frame data, see 'FrameUniforms' in engine.h
+layout (std140, binding = 1) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    float time;
+};
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 uniform int instanceCount;
 uniform bool isSprite;
 uniform bool isBillboard;
@@ -36,12 +44,11 @@ void main()
         vec3 worldPos = spritePos + rightOffset + upOffset;
 
     // Transform the vertex position to clip space
-        gl_Position = projection * view * aInstancePos * vec4(worldPos, 1.0);
+        gl_Position = viewProjection * aInstancePos * vec4(worldPos, 1.0);
     } else {
-        mat4 camMatrix = projection * view;
-        gl_Position = camMatrix * aInstancePos * vec4(aPos, 1.0);
+        gl_Position = viewProjection * aInstancePos * vec4(aPos, 1.0);
     }
 
     TexCoords = aTexCoord;
-
+    InstanceIndex = uint(gl_InstanceID);
 }
\ No newline at end of file
@@ -4,13 +4,16 @@
 in vec3 FragPos;      // Fragment position
 in vec3 Normal;       // Fragment normal
 in vec2 TexCoords;    // Texture coordinates
+flat in uint InstanceIndex;  // gl_InstanceID, 0 for single draws
 
-out vec4 FragColor;
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out uint PickID;  // only bound while GPU picking, see picking.h
 
 uniform sampler2D texture1;  // Texture sampler
 
 uniform bool useTexture;     // Whether to use texture or not
 uniform vec3 color;          // Uniform color passed from the application
+uniform uint pickID;         // First ID of this object's instances, 0 when it isn't pickable
 
 // model & mesh
 uniform sampler2D texture_diffuse1;
@@ -32,4 +35,5 @@ void main()
         discard;
 
     FragColor = objectColor;
+    PickID = (pickID != 0u) ? pickID + InstanceIndex : 0u;
 }
\ No newline at end of file
@@ -6,10 +6,18 @@ layout (location = 2) in vec3 aNormal;
 out vec3 FragPos;       // Position of the fragment (for lighting calculations)
 out vec3 Normal;        // Normal of the fragment
 out vec2 TexCoords;     // Texture coordinates passed to the fragment shader
+flat out uint InstanceIndex;
+
+// Per-frame data, see 'FrameUniforms' in engine.h
+layout (std140, binding = 1) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    float time;
+};
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 uniform bool isSprite;
 uniform bool isBillboard;
 
@@ -34,13 +42,12 @@ void main()
         vec3 worldPos = spritePos + rightOffset + upOffset;
 
     // Transform the vertex position to clip space
-        gl_Position = projection * view * vec4(worldPos, 1.0);
+        gl_Position = viewProjection * vec4(worldPos, 1.0);
     } else {
-
-        mat4 camMatrix = projection * view;
-        gl_Position = camMatrix * model * vec4(aPos, 1.0);
+        gl_Position = viewProjection * model * vec4(aPos, 1.0);
     }
 
     // Pass the texture coordinates to the fragment shader
     TexCoords = aTexCoord;
+    InstanceIndex = 0u;
 }
\ No newline at end of file
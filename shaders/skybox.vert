@@ -3,12 +3,20 @@ layout (location = 0) in vec3 aPos;
 
 out vec3 TexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
+// Per-frame data, see 'FrameUniforms' in engine.h
+layout (std140, binding = 1) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    float time;
+};
 
 void main()
 {
     TexCoords = aPos;
-    vec4 pos = projection * view * vec4(aPos, 1.0);
+    // Drop the translation so the skybox stays centered on the camera
+    mat4 skyView = mat4(mat3(view));
+    vec4 pos = projection * skyView * vec4(aPos, 1.0);
     gl_Position = pos.xyww; 
 }
\ No newline at end of file
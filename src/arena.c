@@ -0,0 +1,109 @@
+#include "arena.h"
+
+#include <stdint.h>
+
+typedef struct ArenaFallback {
+    struct ArenaFallback *next;
+} ArenaFallback;
+
+static _Thread_local Arena *threadArena;
+
+Arena *NewArena(size_t capacity) {
+    Arena *arena = (Arena *)malloc(sizeof(Arena));
+    if (arena == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed creating new Arena, ERROR ALLOCATING MEMORY\n");
+        return NULL;
+    }
+
+    *arena = (Arena){0};
+    arena->base = (unsigned char *)malloc(capacity);
+
+    if (arena->base == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed reserving %zu bytes for Arena\n", capacity);
+        free(arena);
+        return NULL;
+    }
+
+    arena->capacity = capacity;
+    return arena;
+}
+
+static void FreeFallbacks(Arena *arena) {
+    ArenaFallback *fallback = arena->fallbacks;
+
+    while (fallback != NULL) {
+        ArenaFallback *next = fallback->next;
+        free(fallback);
+        fallback = next;
+    }
+
+    arena->fallbacks = NULL;
+}
+
+void FreeArena(Arena *arena) {
+    if (arena == NULL) return;
+
+    FreeFallbacks(arena);
+    free(arena->base);
+    free(arena);
+}
+
+static inline uintptr_t AlignUp(uintptr_t value, size_t alignment) {
+    return (value + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+}
+
+void *ArenaAlloc(Arena *arena, size_t size, size_t alignment) {
+    if (alignment < sizeof(void *)) alignment = sizeof(void *);
+
+    uintptr_t start = (uintptr_t)arena->base;
+    uintptr_t aligned = AlignUp(start + arena->offset, alignment);
+
+    if (aligned + size <= start + arena->capacity) {
+        arena->offset = (size_t)(aligned + size - start);
+        if (arena->offset > arena->highWater) arena->highWater = arena->offset;
+
+        return (void *)aligned;
+    }
+
+    // Out of space, hand out a heap block that lives until the next reset
+    ArenaFallback *fallback = (ArenaFallback *)malloc(sizeof(ArenaFallback) + alignment + size);
+    if (fallback == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Arena fallback of %zu bytes failed\n", size);
+        return NULL;
+    }
+
+    fallback->next = arena->fallbacks;
+    arena->fallbacks = fallback;
+    arena->frameFallbacks++;
+    arena->totalFallbacks++;
+
+    return (void *)AlignUp((uintptr_t)(fallback + 1), alignment);
+}
+
+void ResetArena(Arena *arena) {
+    if (arena->offset > arena->highWater) arena->highWater = arena->offset;
+
+    arena->lastUsed = arena->offset;
+    arena->lastFallbacks = arena->frameFallbacks;
+    arena->frameFallbacks = 0;
+    arena->offset = 0;
+
+    FreeFallbacks(arena);
+}
+
+Arena *GetThreadArena(void) {
+    if (threadArena == NULL) {
+        threadArena = NewArena(ENGINE_THREAD_ARENA_SIZE);
+    }
+
+    return threadArena;
+}
+
+void ResetThreadArena(void) {
+    if (threadArena != NULL) ResetArena(threadArena);
+}
+
+void FreeThreadArena(void) {
+    FreeArena(threadArena);
+    threadArena = NULL;
+}
@@ -0,0 +1,327 @@
+#include "assets.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ASSET_TABLE_MIN_CAPACITY 64
+
+static pthread_mutex_t assetLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* HashMap <AssetKey *, Asset *>, the key is the asset's own, guarded by 'assetLock' */
+static HashMap *assets;
+static AssetStats stats;
+
+static uint64_t HashAssetKey(const void *key);
+static bool AssetKeysEqual(const void *a, const void *b);
+
+static const char *assetTypeNames[ASSET_TYPE_COUNT] = {"model", "texture", "shader"};
+
+void InitAssetRegistry(void) {
+    pthread_mutex_lock(&assetLock);
+
+    if (assets == NULL) {
+        assets = NewHashMap(HashAssetKey, AssetKeysEqual);
+
+        if (assets != NULL && !HashMapReserve(assets, ASSET_TABLE_MIN_CAPACITY)) {
+            HashMapFreeMemory(assets);
+            assets = NULL;
+        }
+    }
+
+    pthread_mutex_unlock(&assetLock);
+
+    if (assets == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed creating the asset registry, ERROR ALLOCATING MEMORY\n");
+    }
+}
+
+char *NormalizeAssetPath(const char *path) {
+    size_t length = strlen(path);
+    char *normalized = (char *)malloc(length + 1);
+
+    if (normalized == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed normalizing asset path '%s', ERROR ALLOCATING MEMORY\n", path);
+        return NULL;
+    }
+
+    size_t out = 0;
+    bool absolute = path[0] == '/' || path[0] == '\\';
+    if (absolute) normalized[out++] = '/';
+
+    size_t root = out;  // ".." never folds past this
+    const char *segment = path;
+
+    while (*segment != '\0') {
+        while (*segment == '/' || *segment == '\\') segment++;
+        if (*segment == '\0') break;
+
+        const char *end = segment;
+        while (*end != '\0' && *end != '/' && *end != '\\') end++;
+
+        size_t size = (size_t)(end - segment);
+
+        bool parent = size == 2 && segment[0] == '.' && segment[1] == '.';
+
+        // A leading ".." of a relative path has nothing to fold into & stays
+        bool previousIsParent = out - root >= 2 && normalized[out - 1] == '.' && normalized[out - 2] == '.' &&
+                                (out - root == 2 || normalized[out - 3] == '/');
+
+        if (size == 1 && segment[0] == '.') {
+            // Current directory, nothing to add
+        } else if (parent && out > root && !previousIsParent) {
+            // Drop the previous segment & its separator
+            while (out > root && normalized[out - 1] != '/') out--;
+            if (out > root) out--;
+        } else if (parent && absolute && out == root) {
+            // Above the root is the root
+        } else {
+            if (out > root) normalized[out++] = '/';
+
+            memcpy(normalized + out, segment, size);
+            out += size;
+        }
+
+        segment = end;
+    }
+
+    normalized[out] = '\0';
+    return normalized;
+}
+
+/* Final mix of splitmix64, spreads FNV's weak low bits over the whole key */
+static uint64_t MixKey(uint64_t key) {
+    key ^= key >> 30;
+    key *= 0xBF58476D1CE4E5B9ull;
+    key ^= key >> 27;
+    key *= 0x94D049BB133111EBull;
+    key ^= key >> 31;
+
+    return key;
+}
+
+/* Takes 'normalized', NULL when normalizing failed */
+static AssetKey KeyOf(AssetType type, char *normalized, uint64_t options) {
+    uint64_t hash = (normalized != NULL) ? HashString64(normalized) : 0;
+
+    return (AssetKey){
+        .hash = MixKey(hash ^ MixKey(options + (uint64_t)type * 0x9E3779B97F4A7C15ull)),
+        .type = type,
+        .path = normalized,
+        .options = options};
+}
+
+AssetKey NewAssetKey(AssetType type, const char *path, uint64_t options) {
+    return KeyOf(type, NormalizeAssetPath(path), options);
+}
+
+AssetKey NewAssetKeyPair(AssetType type, const char *first, const char *second, uint64_t options) {
+    char *a = NormalizeAssetPath(first);
+    char *b = NormalizeAssetPath(second);
+    char *joined = NULL;
+
+    if (a != NULL && b != NULL) {
+        size_t size = strlen(a) + strlen(b) + 2;
+        joined = (char *)malloc(size);
+
+        if (joined != NULL) {
+            snprintf(joined, size, "%s\n%s", a, b);
+        } else {
+            fprintf(stderr, "[MEMORY ERROR] Failed creating asset key '%s' & '%s', ERROR ALLOCATING MEMORY\n", first, second);
+        }
+    }
+
+    free(a);
+    free(b);
+
+    return KeyOf(type, joined, options);
+}
+
+void FreeAssetKey(AssetKey *key) {
+    free(key->path);
+    key->path = NULL;
+}
+
+/* The hash is mixed already, the map only keeps its low bits */
+static uint64_t HashAssetKey(const void *key) {
+    return ((const AssetKey *)key)->hash;
+}
+
+/* Equal hashes only say where to look, two different assets may share one */
+static bool AssetKeysEqual(const void *a, const void *b) {
+    const AssetKey *x = (const AssetKey *)a, *y = (const AssetKey *)b;
+
+    return x->hash == y->hash && x->type == y->type && x->options == y->options && strcmp(x->path, y->path) == 0;
+}
+
+/* Unregisters 'asset' if it's the one under its key, 'assetLock' held */
+static void RemoveAsset(Asset *asset) {
+    if (assets == NULL || HashMapGet(assets, &asset->key) != asset) return;
+
+    HashMapDelete(assets, &asset->key);
+    stats.counts[asset->key.type]--;
+}
+
+static void DestroyAsset(Asset *asset) {
+    if (asset->free != NULL) asset->free(asset);
+
+    FreeAssetKey(&asset->key);
+    free(asset);
+}
+
+void ShutdownAssetRegistry(void) {
+    int freed = 0, referenced = 0;
+
+    // Models first, freeing them releases what they hold on textures
+    for (int type = 0; type < ASSET_TYPE_COUNT; type++) {
+        bool found = GLFW_TRUE;
+
+        // A 'free' releasing other assets shifts entries around, passes repeat until one finds nothing
+        while (found) {
+            found = GLFW_FALSE;
+
+            for (size_t iterator = 0;;) {
+                Asset *asset = NULL;
+
+                pthread_mutex_lock(&assetLock);
+
+                while (assets != NULL && HashMapNext(assets, &iterator, NULL, (void **)&asset)) {
+                    if (asset->key.type == (AssetType)type) break;
+                    asset = NULL;
+                }
+
+                if (asset == NULL) {
+                    pthread_mutex_unlock(&assetLock);
+                    break;
+                }
+
+                // Back to its slot, deleting shifts the next entry of the cluster into it
+                RemoveAsset(asset);
+                iterator--;
+
+                pthread_mutex_unlock(&assetLock);
+
+                if (asset->references > 0) referenced++;
+                DestroyAsset(asset);
+
+                freed++;
+                found = GLFW_TRUE;
+            }
+        }
+    }
+
+    pthread_mutex_lock(&assetLock);
+
+    HashMapFreeMemory(assets);
+    assets = NULL;
+
+    pthread_mutex_unlock(&assetLock);
+
+    printf("[TAV ENGINE] %d Assets have been freed! (%d still referenced)\n", freed, referenced);
+}
+
+Asset *AcquireAsset(const AssetKey *key) {
+    pthread_mutex_lock(&assetLock);
+
+    Asset *asset = (assets != NULL && key->path != NULL) ? (Asset *)HashMapGet(assets, key) : NULL;
+
+    if (asset != NULL) {
+        asset->references++;
+        stats.references++;
+        stats.hits++;
+    } else {
+        stats.misses++;
+    }
+
+    pthread_mutex_unlock(&assetLock);
+    return asset;
+}
+
+Asset *RegisterAsset(const AssetKey *key, void *data, void (*release)(Asset *asset), bool *inserted) {
+    *inserted = GLFW_FALSE;
+
+    Asset *asset = (Asset *)malloc(sizeof(Asset));
+    char *path = (key->path != NULL) ? strdup(key->path) : NULL;
+
+    if (asset == NULL || path == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed creating new Asset, ERROR ALLOCATING MEMORY\n");
+        free(asset);
+        free(path);
+        return NULL;
+    }
+
+    *asset = (Asset){
+        .key = *key,
+        .references = 1,
+        .data = data,
+        .free = release};
+
+    asset->key.path = path;
+
+    pthread_mutex_lock(&assetLock);
+
+    Asset *existing = (assets != NULL) ? (Asset *)HashMapGet(assets, key) : NULL;
+
+    if (existing == NULL && (assets == NULL || !HashMapPut(assets, &asset->key, asset))) {
+        pthread_mutex_unlock(&assetLock);
+
+        fprintf(stderr, "[ASSETS ERROR] No room to register %s '%s'\n", assetTypeNames[key->type], key->path);
+        FreeAssetKey(&asset->key);
+        free(asset);
+        return NULL;
+    }
+
+    if (existing != NULL) {
+        existing->references++;
+    } else {
+        stats.counts[key->type]++;
+    }
+
+    stats.references++;
+    pthread_mutex_unlock(&assetLock);
+
+    *inserted = existing == NULL;
+
+    if (existing != NULL) {
+        FreeAssetKey(&asset->key);
+        free(asset);
+        return existing;
+    }
+
+    return asset;
+}
+
+Asset *RetainAsset(Asset *asset) {
+    pthread_mutex_lock(&assetLock);
+
+    asset->references++;
+    stats.references++;
+
+    pthread_mutex_unlock(&assetLock);
+    return asset;
+}
+
+void ReleaseAsset(Asset *asset) {
+    if (asset == NULL) return;
+
+    pthread_mutex_lock(&assetLock);
+
+    // Under the lock, an #AcquireAsset() can't find it between the last release & its removal
+    bool last = --asset->references == 0;
+    stats.references--;
+
+    if (last) RemoveAsset(asset);
+
+    pthread_mutex_unlock(&assetLock);
+
+    if (last) DestroyAsset(asset);
+}
+
+AssetStats GetAssetStats(void) {
+    pthread_mutex_lock(&assetLock);
+    AssetStats copy = stats;
+    pthread_mutex_unlock(&assetLock);
+
+    return copy;
+}
@@ -0,0 +1,623 @@
+#include "bvh.h"
+
+#include <float.h>
+#include <string.h>
+
+#include "culling.h"
+#include "meshbvh.h"
+#include "model3d.h"
+#include "render.h"
+#include "utils.h"
+
+/* Keeps traversal within BVH_STACK_SIZE, a near/far descent never holds more than depth + 1 nodes */
+#define BVH_MAX_DEPTH (BVH_STACK_SIZE - 2)
+
+BVH *NewBVH(void) {
+    BVH *bvh = (BVH *)malloc(sizeof(BVH));
+    if (bvh == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed creating new BVH, ERROR ALLOCATING MEMORY\n");
+        return NULL;
+    }
+
+    *bvh = (BVH){0};
+    bvh->maxLeafSize = ENGINE_BVH_MAX_LEAF_SIZE;
+    bvh->leafWidth = 1;
+    return bvh;
+}
+
+void FreeBVH(BVH *bvh) {
+    if (bvh == NULL) return;
+
+    free(bvh->nodes);
+    free(bvh->indices);
+    free(bvh->parents);
+    free(bvh->leaves);
+    free(bvh->mins);
+    free(bvh->maxs);
+    free(bvh);
+}
+
+static bool ReserveBVH(BVH *bvh, int count) {
+    if (count <= bvh->capacity) return GLFW_TRUE;
+
+    // A binary tree with at most one primitive per leaf never needs more than 2n - 1 nodes
+    BVHNode *nodes = (BVHNode *)realloc(bvh->nodes, (size_t)count * 2 * sizeof(BVHNode));
+    if (nodes != NULL) bvh->nodes = nodes;
+    int *parents = (int *)realloc(bvh->parents, (size_t)count * 2 * sizeof(int));
+    if (parents != NULL) bvh->parents = parents;
+    int *indices = (int *)realloc(bvh->indices, (size_t)count * sizeof(int));
+    if (indices != NULL) bvh->indices = indices;
+    int *leaves = (int *)realloc(bvh->leaves, (size_t)count * sizeof(int));
+    if (leaves != NULL) bvh->leaves = leaves;
+    vec3s *mins = (vec3s *)realloc(bvh->mins, (size_t)count * sizeof(vec3s));
+    if (mins != NULL) bvh->mins = mins;
+    vec3s *maxs = (vec3s *)realloc(bvh->maxs, (size_t)count * sizeof(vec3s));
+    if (maxs != NULL) bvh->maxs = maxs;
+
+    if (nodes == NULL || parents == NULL || indices == NULL || leaves == NULL || mins == NULL || maxs == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed growing BVH to %d primitives\n", count);
+        return GLFW_FALSE;
+    }
+
+    bvh->capacity = count;
+    return GLFW_TRUE;
+}
+
+static inline float SurfaceArea(vec3s min, vec3s max) {
+    vec3s size = glms_vec3_sub(max, min);
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+static void ComputeLeafBounds(BVH *bvh, BVHNode *node) {
+    vec3s min = (vec3s){FLT_MAX, FLT_MAX, FLT_MAX};
+    vec3s max = (vec3s){-FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+    for (int i = 0; i < node->count; i++) {
+        int primitive = bvh->indices[node->first + i];
+
+        min = glms_vec3_minv(min, bvh->mins[primitive]);
+        max = glms_vec3_maxv(max, bvh->maxs[primitive]);
+    }
+
+    node->min = min;
+    node->max = max;
+}
+
+/* Primitives cost the same whether they fill a SIMD batch or not */
+static inline float LeafBatches(const BVH *bvh, int count) {
+    return (float)((count + bvh->leafWidth - 1) / bvh->leafWidth);
+}
+
+typedef struct SAHBin {
+    vec3s min, max;
+    int count;
+} SAHBin;
+
+/* Best binned SAH split of the node, returns false when keeping it as a leaf is cheaper */
+static bool FindSplit(BVH *bvh, const BVHNode *node, const vec3s *centroids, int *splitAxis, float *splitPosition) {
+    vec3s centroidMin = (vec3s){FLT_MAX, FLT_MAX, FLT_MAX};
+    vec3s centroidMax = (vec3s){-FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+    for (int i = 0; i < node->count; i++) {
+        vec3s centroid = centroids[bvh->indices[node->first + i]];
+
+        centroidMin = glms_vec3_minv(centroidMin, centroid);
+        centroidMax = glms_vec3_maxv(centroidMax, centroid);
+    }
+
+    float bestCost = FLT_MAX;
+
+    for (int axis = 0; axis < 3; axis++) {
+        float extent = centroidMax.raw[axis] - centroidMin.raw[axis];
+        if (extent <= 0.0f) continue;
+
+        SAHBin bins[ENGINE_BVH_SAH_BINS];
+        for (int b = 0; b < ENGINE_BVH_SAH_BINS; b++) {
+            bins[b] = (SAHBin){.min = {{FLT_MAX, FLT_MAX, FLT_MAX}}, .max = {{-FLT_MAX, -FLT_MAX, -FLT_MAX}}};
+        }
+
+        float scale = ENGINE_BVH_SAH_BINS / extent;
+
+        for (int i = 0; i < node->count; i++) {
+            int primitive = bvh->indices[node->first + i];
+            int b = (int)((centroids[primitive].raw[axis] - centroidMin.raw[axis]) * scale);
+            if (b >= ENGINE_BVH_SAH_BINS) b = ENGINE_BVH_SAH_BINS - 1;
+
+            bins[b].count++;
+            bins[b].min = glms_vec3_minv(bins[b].min, bvh->mins[primitive]);
+            bins[b].max = glms_vec3_maxv(bins[b].max, bvh->maxs[primitive]);
+        }
+
+        // Sweep from the right to get the area & count on that side of every plane, then from the left
+        float rightArea[ENGINE_BVH_SAH_BINS - 1];
+        int rightCount[ENGINE_BVH_SAH_BINS - 1];
+
+        SAHBin side = bins[ENGINE_BVH_SAH_BINS - 1];
+        for (int plane = ENGINE_BVH_SAH_BINS - 2; plane >= 0; plane--) {
+            rightArea[plane] = (side.count > 0) ? SurfaceArea(side.min, side.max) : 0.0f;
+            rightCount[plane] = side.count;
+
+            side.count += bins[plane].count;
+            side.min = glms_vec3_minv(side.min, bins[plane].min);
+            side.max = glms_vec3_maxv(side.max, bins[plane].max);
+        }
+
+        side = (SAHBin){.min = {{FLT_MAX, FLT_MAX, FLT_MAX}}, .max = {{-FLT_MAX, -FLT_MAX, -FLT_MAX}}};
+        for (int plane = 0; plane < ENGINE_BVH_SAH_BINS - 1; plane++) {
+            side.count += bins[plane].count;
+            side.min = glms_vec3_minv(side.min, bins[plane].min);
+            side.max = glms_vec3_maxv(side.max, bins[plane].max);
+
+            if (side.count == 0 || rightCount[plane] == 0) continue;
+
+            float cost = LeafBatches(bvh, side.count) * SurfaceArea(side.min, side.max) + LeafBatches(bvh, rightCount[plane]) * rightArea[plane];
+            if (cost < bestCost) {
+                bestCost = cost;
+                *splitAxis = axis;
+                *splitPosition = centroidMin.raw[axis] + (plane + 1) / scale;
+            }
+        }
+    }
+
+    // Leaf cost is every primitive batch tested against the same ray, a split adds one traversal step (~1 box test)
+    float leafCost = LeafBatches(bvh, node->count) * SurfaceArea(node->min, node->max);
+    float splitCost = SurfaceArea(node->min, node->max) + bestCost;
+
+    if (bestCost == FLT_MAX) return GLFW_FALSE;
+    return node->count > bvh->maxLeafSize || splitCost < leafCost;
+}
+
+static void Subdivide(BVH *bvh, int nodeIndex, const vec3s *centroids, int depth) {
+    BVHNode *node = &bvh->nodes[nodeIndex];
+    ComputeLeafBounds(bvh, node);
+
+    if (node->count <= 1) return;
+
+    int axis = 0;
+    float position = 0.0f;
+    int leftCount = 0;
+
+    if (FindSplit(bvh, node, centroids, &axis, &position)) {
+        // Partition the node's slots in place, everything left of the plane goes first
+        int i = node->first, j = node->first + node->count - 1;
+
+        while (i <= j) {
+            if (centroids[bvh->indices[i]].raw[axis] < position) {
+                i++;
+            } else {
+                int swap = bvh->indices[i];
+                bvh->indices[i] = bvh->indices[j];
+                bvh->indices[j--] = swap;
+            }
+        }
+
+        leftCount = i - node->first;
+    }
+
+    if (leftCount == 0 || leftCount == node->count) {
+        // Cheaper as a leaf, or no useful plane (all centroids equal) & an object median keeps oversized leaves splitting
+        if (node->count <= bvh->maxLeafSize || depth >= BVH_MAX_DEPTH) return;
+
+        leftCount = node->count / 2;
+    } else if (depth >= BVH_MAX_DEPTH) {
+        return;
+    }
+
+    int left = bvh->nodeCount;
+    bvh->nodeCount += 2;
+
+    bvh->nodes[left] = (BVHNode){.first = node->first, .count = leftCount};
+    bvh->nodes[left + 1] = (BVHNode){.first = node->first + leftCount, .count = node->count - leftCount};
+    bvh->parents[left] = nodeIndex;
+    bvh->parents[left + 1] = nodeIndex;
+
+    node->first = left;
+    node->count = 0;
+
+    Subdivide(bvh, left, centroids, depth + 1);
+    Subdivide(bvh, left + 1, centroids, depth + 1);
+}
+
+void BuildBVH(BVH *bvh, const vec3s *mins, const vec3s *maxs, int count) {
+    bvh->count = 0;
+    bvh->nodeCount = 0;
+
+    if (count < 1 || !ReserveBVH(bvh, count)) return;
+
+    vec3s *centroids = (vec3s *)malloc((size_t)count * sizeof(vec3s));
+    if (centroids == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed allocating BVH build centroids\n");
+        return;
+    }
+
+    memcpy(bvh->mins, mins, (size_t)count * sizeof(vec3s));
+    memcpy(bvh->maxs, maxs, (size_t)count * sizeof(vec3s));
+
+    for (int i = 0; i < count; i++) {
+        bvh->indices[i] = i;
+        centroids[i] = glms_vec3_scale(glms_vec3_add(mins[i], maxs[i]), 0.5f);
+    }
+
+    bvh->count = count;
+    bvh->nodeCount = 1;
+    bvh->nodes[0] = (BVHNode){.first = 0, .count = count};
+    bvh->parents[0] = -1;
+
+    Subdivide(bvh, 0, centroids, 0);
+    free(centroids);
+
+    for (int n = 0; n < bvh->nodeCount; n++) {
+        BVHNode *node = &bvh->nodes[n];
+
+        for (int i = 0; i < node->count; i++) {
+            bvh->leaves[bvh->indices[node->first + i]] = n;
+        }
+    }
+}
+
+/* Returns true when the node's box changed */
+static bool RefitNode(BVH *bvh, int nodeIndex) {
+    BVHNode *node = &bvh->nodes[nodeIndex];
+    vec3s oldMin = node->min, oldMax = node->max;
+
+    if (node->count > 0) {
+        ComputeLeafBounds(bvh, node);
+    } else {
+        BVHNode *left = &bvh->nodes[node->first], *right = &bvh->nodes[node->first + 1];
+
+        node->min = glms_vec3_minv(left->min, right->min);
+        node->max = glms_vec3_maxv(left->max, right->max);
+    }
+
+    return !glms_vec3_eqv(oldMin, node->min) || !glms_vec3_eqv(oldMax, node->max);
+}
+
+void UpdateBVHPrimitive(BVH *bvh, int primitive, vec3s min, vec3s max) {
+    if (primitive < 0 || primitive >= bvh->count) return;
+
+    bvh->mins[primitive] = min;
+    bvh->maxs[primitive] = max;
+
+    for (int node = bvh->leaves[primitive]; node >= 0; node = bvh->parents[node]) {
+        if (!RefitNode(bvh, node)) break;
+    }
+}
+
+void RefitBVH(BVH *bvh) {
+    // Children are always created after their parent, so a reverse sweep sees them first
+    for (int n = bvh->nodeCount - 1; n >= 0; n--) {
+        RefitNode(bvh, n);
+    }
+}
+
+float RayBoxDistance(const Ray *ray, vec3s inverseDirection, vec3s min, vec3s max, float maxDistance) {
+    float near = 0.0f, far = maxDistance;
+
+    for (int axis = 0; axis < 3; axis++) {
+        float t0 = (min.raw[axis] - ray->origin.raw[axis]) * inverseDirection.raw[axis];
+        float t1 = (max.raw[axis] - ray->origin.raw[axis]) * inverseDirection.raw[axis];
+
+        near = fmaxf(near, fminf(t0, t1));
+        far = fminf(far, fmaxf(t0, t1));
+    }
+
+    return (near <= far) ? near : -1.0f;
+}
+
+/* Shared traversal, 'closest' off returns on the first accepted hit */
+static bool TraverseBVH(const BVH *bvh, const Ray *ray, float maxDistance, BVHHitTest test, void *data, BVHHit *hit, bool closest) {
+    if (bvh->nodeCount == 0) return GLFW_FALSE;
+
+    // IEEE division gives +-inf for axis aligned rays, which the slab test handles
+    vec3s inverseDirection = (vec3s){1.0f / ray->direction.x, 1.0f / ray->direction.y, 1.0f / ray->direction.z};
+
+    int stack[BVH_STACK_SIZE];
+    int top = 0;
+
+    bool found = GLFW_FALSE;
+    float best = maxDistance;
+
+    if (RayBoxDistance(ray, inverseDirection, bvh->nodes[0].min, bvh->nodes[0].max, best) < 0.0f) return GLFW_FALSE;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const BVHNode *node = &bvh->nodes[stack[--top]];
+
+        if (node->count > 0) {
+            for (int i = 0; i < node->count; i++) {
+                int primitive = bvh->indices[node->first + i];
+                float distance = RayBoxDistance(ray, inverseDirection, bvh->mins[primitive], bvh->maxs[primitive], best);
+
+                if (distance < 0.0f) continue;
+                if (test != NULL && !test(data, primitive, ray, best, &distance)) continue;
+                if (distance > best) continue;
+
+                best = distance;
+                found = GLFW_TRUE;
+                if (hit != NULL) *hit = (BVHHit){.primitive = primitive, .distance = distance};
+
+                if (!closest) return GLFW_TRUE;
+            }
+            continue;
+        }
+
+        int left = node->first, right = node->first + 1;
+        float leftDistance = RayBoxDistance(ray, inverseDirection, bvh->nodes[left].min, bvh->nodes[left].max, best);
+        float rightDistance = RayBoxDistance(ray, inverseDirection, bvh->nodes[right].min, bvh->nodes[right].max, best);
+
+        // Nearer child popped first, so 'best' shrinks early & prunes the far one
+        if (leftDistance >= 0.0f && rightDistance >= 0.0f) {
+            if (top + 2 > BVH_STACK_SIZE) continue;
+
+            bool leftFirst = leftDistance <= rightDistance;
+            stack[top++] = leftFirst ? right : left;
+            stack[top++] = leftFirst ? left : right;
+        } else if (leftDistance >= 0.0f || rightDistance >= 0.0f) {
+            if (top + 1 > BVH_STACK_SIZE) continue;
+
+            stack[top++] = (leftDistance >= 0.0f) ? left : right;
+        }
+    }
+
+    return found;
+}
+
+bool BVHRayClosest(const BVH *bvh, const Ray *ray, float maxDistance, BVHHitTest test, void *data, BVHHit *hit) {
+    return TraverseBVH(bvh, ray, maxDistance, test, data, hit, GLFW_TRUE);
+}
+
+bool BVHRayAny(const BVH *bvh, const Ray *ray, float maxDistance, BVHHitTest test, void *data) {
+    return TraverseBVH(bvh, ray, maxDistance, test, data, NULL, GLFW_FALSE);
+}
+
+SceneBVH *NewSceneBVH(void) {
+    SceneBVH *scene = (SceneBVH *)malloc(sizeof(SceneBVH));
+    if (scene == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed creating new Scene BVH, ERROR ALLOCATING MEMORY\n");
+        return NULL;
+    }
+
+    *scene = (SceneBVH){0};
+    scene->bvh = NewBVH();
+
+    if (scene->bvh == NULL) {
+        free(scene);
+        return NULL;
+    }
+
+    return scene;
+}
+
+void FreeSceneBVH(SceneBVH *scene) {
+    if (scene == NULL) return;
+
+    FreeBVH(scene->bvh);
+    free(scene->entries);
+    free(scene->mins);
+    free(scene->maxs);
+    free(scene);
+}
+
+static unsigned int OwnerVersion(SceneObject *object, Model3D *model) {
+    Transform *transforms = (object != NULL) ? object->transforms : model->transforms;
+    int instanceCount = (object != NULL) ? object->instanceCount : model->instanceCount;
+    if (instanceCount < 1) instanceCount = 1;
+
+    // Dirty transforms haven't bumped their version yet, make them count as a change too
+    unsigned int version = 0;
+    for (int i = 0; i < instanceCount; i++) {
+        version += transforms[i].version * 2u + transforms[i].dirty;
+    }
+
+    return version;
+}
+
+static bool ReserveSceneBVH(SceneBVH *scene, int count) {
+    if (count <= scene->capacity) return GLFW_TRUE;
+
+    SceneBVHEntry *entries = (SceneBVHEntry *)realloc(scene->entries, (size_t)count * sizeof(SceneBVHEntry));
+    if (entries != NULL) scene->entries = entries;
+    vec3s *mins = (vec3s *)realloc(scene->mins, (size_t)count * sizeof(vec3s));
+    if (mins != NULL) scene->mins = mins;
+    vec3s *maxs = (vec3s *)realloc(scene->maxs, (size_t)count * sizeof(vec3s));
+    if (maxs != NULL) scene->maxs = maxs;
+
+    if (entries == NULL || mins == NULL || maxs == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed growing Scene BVH to %d entries\n", count);
+        return GLFW_FALSE;
+    }
+
+    scene->capacity = count;
+    return GLFW_TRUE;
+}
+
+static void RecordEntry(SceneBVH *scene, int index, SceneObject *object, Model3D *model) {
+    scene->entries[index] = (SceneBVHEntry){.object = object, .model = model, .version = OwnerVersion(object, model)};
+    GetWorldBounds(object, model, &scene->mins[index], &scene->maxs[index]);
+}
+
+void UpdateSceneBVH(SceneBVH *scene) {
+    int count = 0;
+
+    foreach (SceneObject *object, engine->sceneObjects) {
+        if (ObjectExists(object) && object->type != OBJECT_FRAMEBUFFER_QUAD) count++;
+    }
+    foreach (Model3D *model, engine->models) {
+        if (ModelExists(model)) count++;
+    }
+
+    bool rebuild = count != scene->count;
+    if (!ReserveSceneBVH(scene, count)) return;
+
+    int index = 0;
+
+    foreach (SceneObject *object, engine->sceneObjects) {
+        if (!ObjectExists(object) || object->type == OBJECT_FRAMEBUFFER_QUAD) continue;
+
+        SceneBVHEntry *entry = &scene->entries[index];
+
+        if (rebuild || entry->object != object) {
+            rebuild = GLFW_TRUE;
+            RecordEntry(scene, index, object, NULL);
+        } else if (entry->version != OwnerVersion(object, NULL)) {
+            RecordEntry(scene, index, object, NULL);
+            UpdateBVHPrimitive(scene->bvh, index, scene->mins[index], scene->maxs[index]);
+            scene->refits++;
+        }
+
+        index++;
+    }
+
+    foreach (Model3D *model, engine->models) {
+        if (!ModelExists(model)) continue;
+
+        SceneBVHEntry *entry = &scene->entries[index];
+
+        if (rebuild || entry->model != model) {
+            rebuild = GLFW_TRUE;
+            RecordEntry(scene, index, NULL, model);
+        } else if (entry->version != OwnerVersion(NULL, model)) {
+            RecordEntry(scene, index, NULL, model);
+            UpdateBVHPrimitive(scene->bvh, index, scene->mins[index], scene->maxs[index]);
+            scene->refits++;
+        }
+
+        index++;
+    }
+
+    if (rebuild) {
+        // Entries before the first mismatch were kept as they were, their bounds are still current
+        BuildBVH(scene->bvh, scene->mins, scene->maxs, count);
+        scene->count = count;
+        scene->rebuilds++;
+    }
+}
+
+/* Models are picked by their triangles, scene objects by their box */
+static bool SceneHitTest(void *data, int primitive, const Ray *ray, float maxDistance, float *distance) {
+    SceneBVHEntry *entry = &((SceneBVH *)data)->entries[primitive];
+    if (entry->model == NULL) return GLFW_TRUE;
+
+    return ModelRayClosest(entry->model, ray, maxDistance, distance);
+}
+
+bool PickScene(SceneBVH *scene, const Ray *ray, SceneObject **object, Model3D **model, float *distance) {
+    BVHHit hit;
+
+    if (object != NULL) *object = NULL;
+    if (model != NULL) *model = NULL;
+
+    if (!BVHRayClosest(scene->bvh, ray, FLT_MAX, SceneHitTest, scene, &hit)) return GLFW_FALSE;
+
+    SceneBVHEntry *entry = &scene->entries[hit.primitive];
+    if (object != NULL) *object = entry->object;
+    if (model != NULL) *model = entry->model;
+    if (distance != NULL) *distance = hit.distance;
+
+    return GLFW_TRUE;
+}
+
+#ifdef ENGINE_SELF_TESTS
+
+/* What picking used to cost, every box against the ray, returns the closest distance or -1 */
+static float LinearRayClosest(const vec3s *mins, const vec3s *maxs, int count, const Ray *ray) {
+    vec3s inverseDirection = (vec3s){1.0f / ray->direction.x, 1.0f / ray->direction.y, 1.0f / ray->direction.z};
+    float best = FLT_MAX, closest = -1.0f;
+
+    for (int i = 0; i < count; i++) {
+        float distance = RayBoxDistance(ray, inverseDirection, mins[i], maxs[i], best);
+
+        if (distance >= 0.0f && distance <= best) {
+            best = distance;
+            closest = distance;
+        }
+    }
+
+    return closest;
+}
+
+void BenchmarkBVH(void) {
+    const int counts[] = {10000, 100000, 1000000};
+    const int rays = 1000;
+
+    for (int c = 0; c < 3; c++) {
+        int count = counts[c];
+
+        vec3s *mins = (vec3s *)malloc((size_t)count * sizeof(vec3s));
+        vec3s *maxs = (vec3s *)malloc((size_t)count * sizeof(vec3s));
+        Ray *queries = (Ray *)malloc((size_t)rays * sizeof(Ray));
+        BVH *bvh = NewBVH();
+
+        if (mins == NULL || maxs == NULL || queries == NULL || bvh == NULL) {
+            free(mins);
+            free(maxs);
+            free(queries);
+            FreeBVH(bvh);
+            return;
+        }
+
+        // Same density at every size, the world grows with the cube root of the object count
+        unsigned int state = 0xB1Au;
+        float world = 10.0f * cbrtf((float)count);
+
+        for (int i = 0; i < count; i++) {
+            vec3s center = (vec3s){RandomRange(&state, -world, world), RandomRange(&state, -world, world), RandomRange(&state, -world, world)};
+            vec3s extent = (vec3s){RandomRange(&state, 0.25f, 2.0f), RandomRange(&state, 0.25f, 2.0f), RandomRange(&state, 0.25f, 2.0f)};
+
+            mins[i] = glms_vec3_sub(center, extent);
+            maxs[i] = glms_vec3_add(center, extent);
+        }
+
+        // Picking rays from outside the world towards a random point inside it, like a camera would cast
+        for (int i = 0; i < rays; i++) {
+            vec3s origin = (vec3s){RandomRange(&state, -world, world), world * 1.5f, RandomRange(&state, -world, world)};
+            vec3s target = (vec3s){RandomRange(&state, -world, world), RandomRange(&state, -world, world), RandomRange(&state, -world, world)};
+
+            queries[i] = (Ray){.origin = origin, .direction = glms_vec3_normalize(glms_vec3_sub(target, origin))};
+        }
+
+        double start = GetTimeSeconds();
+        BuildBVH(bvh, mins, maxs, count);
+        double build = GetTimeSeconds() - start;
+
+        // 1% of the objects move a little, like a frame of gameplay
+        int moved = count / 100;
+        start = GetTimeSeconds();
+        for (int i = 0; i < moved; i++) {
+            int primitive = (int)RandomRange(&state, 0.0f, (float)count - 1.0f);
+            vec3s offset = (vec3s){RandomRange(&state, -1.0f, 1.0f), RandomRange(&state, -1.0f, 1.0f), RandomRange(&state, -1.0f, 1.0f)};
+
+            UpdateBVHPrimitive(bvh, primitive, glms_vec3_add(bvh->mins[primitive], offset), glms_vec3_add(bvh->maxs[primitive], offset));
+        }
+        double refit = GetTimeSeconds() - start;
+
+        int mismatches = 0;
+        BVHHit hit;
+
+        start = GetTimeSeconds();
+        for (int i = 0; i < rays; i++) {
+            BVHRayClosest(bvh, &queries[i], FLT_MAX, NULL, NULL, &hit);
+        }
+        double picked = (GetTimeSeconds() - start) / rays;
+
+        start = GetTimeSeconds();
+        for (int i = 0; i < rays; i++) {
+            float expected = LinearRayClosest(bvh->mins, bvh->maxs, count, &queries[i]);
+            bool found = BVHRayClosest(bvh, &queries[i], FLT_MAX, NULL, NULL, &hit);
+
+            // Ties at the same distance may pick either box, the distance itself has to match
+            if ((expected >= 0.0f) != found || (found && expected != hit.distance)) mismatches++;
+        }
+        double linear = (GetTimeSeconds() - start) / rays - picked;
+
+        printf("[BVH BENCH] %7d objects: build %.2f ms, refit %d moved %.3f ms, pick %.2f us (linear %.2f us, %.0fx), %d nodes, %d mismatches\n",
+               count, build * 1e3, moved, refit * 1e3, picked * 1e6, linear * 1e6, linear / picked, bvh->nodeCount, mismatches);
+
+        free(mins);
+        free(maxs);
+        free(queries);
+        FreeBVH(bvh);
+    }
+}
+
+#endif  // ENGINE_SELF_TESTS
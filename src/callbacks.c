@@ -2,15 +2,24 @@
 
 #include <stdio.h>
 
+#include "bvh.h"
 #include "camera.h"
 #include "model3d.h"
+#include "physics.h"
+#include "picking.h"
+#include "profiler.h"
 #include "render.h"
+#include "renderthread.h"
 #include "shader.h"
 #include "ui.h"
 #include "utils.h"
 
 static vec2s cursor, previousCursor;
 
+/* Closest object or model under the cursor, at most one of them is set */
+static SceneObject *hoveredObject;
+static Model3D *hoveredModel;
+
 void init_callbacks(Engine *engine) {
     glfwSetKeyCallback(engine->window, key_callback);
     glfwSetMouseButtonCallback(engine->window, mouse_button_callback);
@@ -24,6 +33,16 @@ void init_callbacks(Engine *engine) {
     printf("[TAV ENGINE] Initalized GLFW events...\n");
 }
 
+/* Shader programs are GL objects, so the reload waits for the render thread */
+static void ReloadShadersTask(void *data) {
+    (void)data;
+    reloadShaders();
+}
+
+vec2s GetCursorPosition(void) {
+    return cursor;
+}
+
 void APIENTRY debugCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar *message, const void *userParam) {
     fprintf(stderr, "[DEBUG CALLBACK] => OpenGL Debug: %s\n", message);
 }
@@ -31,18 +50,30 @@ void APIENTRY debugCallback(GLenum source, GLenum type, GLuint id, GLenum severi
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
     // printf("Key pressed\n");
 
-    processKeyboard(camera);
-
     if (key == GLFW_KEY_ESCAPE && action == GLFW_RELEASE) {
         glfwSetWindowShouldClose(window, GLFW_TRUE);
     } else if (key == GLFW_KEY_R && action == GLFW_RELEASE) {
-        reloadShaders();
+        RunOnRenderThread(ReloadShadersTask, NULL);
     } else if (key == GLFW_KEY_GRAVE_ACCENT && action == GLFW_RELEASE) {
         int mode = glfwGetInputMode(engine->window, GLFW_CURSOR);
 
         glfwSetInputMode(engine->window, GLFW_CURSOR, (mode == GLFW_CURSOR_DISABLED) ? GLFW_CURSOR_NORMAL : GLFW_CURSOR_DISABLED);
     } else if (key == GLFW_KEY_W && action == GLFW_RELEASE && (mods & GLFW_MOD_CONTROL)) {
         engine->wireframeMode = !engine->wireframeMode;
+    } else if (key == GLFW_KEY_P && action == GLFW_RELEASE && (mods & GLFW_MOD_CONTROL)) {
+        PrintPickStats(engine->pickBuffer);
+
+        engine->pickingMode = (engine->pickingMode + 1) % PICKING_MODE_COUNT;
+        printf("[TAV ENGINE] Picking => %s\n", (GetPickingMode() == PICKING_GPU) ? "GPU" : "CPU");
+    } else if (key == GLFW_KEY_O && action == GLFW_RELEASE && (mods & GLFW_MOD_CONTROL)) {
+        engine->profilerOverlay = !engine->profilerOverlay;
+    } else if (key == GLFW_KEY_T && action == GLFW_RELEASE && (mods & GLFW_MOD_CONTROL)) {
+        char *path = CreatePath(engine->mainPath, "trace.json");
+
+        if (path != NULL) {
+            ProfilerExportChromeTrace(path);
+            free(path);
+        }
     }
 }
 
@@ -68,26 +99,31 @@ void cursor_position_callback(GLFWwindow *window, double xpos, double ypos) {
         element->clickable.isHovered = isPointInsideElement(element, cursor);
     }
 
-    foreach (Model3D *model, engine->models) {
-        if (!ModelExists(model)) continue;
+    // One ray per event, shared by the gizmo & the BVH query
+    Ray ray = GenerateRay(camera, cursor);
 
-        if (isDragging && IsAxisSelectionActive()) {
-            TransformGizmoUpdateObject(NULL, model, delta, cursor);
+    if (isDragging && IsAxisSelectionActive()) {
+        foreach (Model3D *model, engine->models) {
+            if (ModelExists(model)) TransformGizmoUpdateObject(NULL, model, delta, ray);
         }
 
-        model->hoverColor = (vec3s)SmoothHoverColor(model->color, model->clickable.isHovered);
-        model->clickable.isHovered = isPointInside3DObj(NULL, model, cursor);
+        foreach (SceneObject *object, engine->sceneObjects) {
+            if (ObjectExists(object)) TransformGizmoUpdateObject(object, NULL, delta, ray);
+        }
     }
 
-    foreach (SceneObject *object, engine->sceneObjects) {
-        if (!ObjectExists(object)) continue;
+    // GPU picking reads the pixel under this cursor once the next frame snapshot is submitted & sets the hover from #render()
+    if (GetPickingMode() == PICKING_CPU) {
+        SceneObject *object;
+        Model3D *model;
 
-        if (isDragging && IsAxisSelectionActive()) {
-            TransformGizmoUpdateObject(object, NULL, delta, cursor);
-        }
+        double start = GetTimeSeconds();
+        PickScene(engine->sceneBVH, &ray, &object, &model, NULL);
 
-        object->hoverColor = (vec3s)SmoothHoverColor(object->color, object->clickable.isHovered);
-        object->clickable.isHovered = isPointInside3DObj(object, NULL, cursor);
+        engine->pickBuffer->stats.cpuSeconds += GetTimeSeconds() - start;
+        engine->pickBuffer->stats.cpuPicks++;
+
+        SetHoveredOwner(object, model);
     }
 
     if (engine->mouseDragging) {
@@ -95,6 +131,28 @@ void cursor_position_callback(GLFWwindow *window, double xpos, double ypos) {
     }
 }
 
+void SetHoveredOwner(SceneObject *object, Model3D *model) {
+    // Only the previous & the new hovered owner change, everything else stays untouched
+    if (hoveredObject != NULL) hoveredObject->clickable.isHovered = GLFW_FALSE;
+    if (hoveredModel != NULL) hoveredModel->clickable.isHovered = GLFW_FALSE;
+
+    hoveredObject = object;
+    hoveredModel = (object == NULL) ? model : NULL;
+
+    if (hoveredObject != NULL) {
+        hoveredObject->clickable.isHovered = GLFW_TRUE;
+        hoveredObject->hoverColor = (vec3s)SmoothHoverColor(hoveredObject->color, GLFW_TRUE);
+    } else if (hoveredModel != NULL) {
+        hoveredModel->clickable.isHovered = GLFW_TRUE;
+        hoveredModel->hoverColor = (vec3s)SmoothHoverColor(hoveredModel->color, GLFW_TRUE);
+    }
+}
+
+void ForgetHoveredOwner(const void *owner) {
+    if (owner == NULL || owner == hoveredObject) hoveredObject = NULL;
+    if (owner == NULL || owner == hoveredModel) hoveredModel = NULL;
+}
+
 void mouse_button_callback(GLFWwindow *window, int button, int action, int mods) {
     if (button == GLFW_MOUSE_BUTTON_LEFT) {
         if (action == GLFW_PRESS) {
@@ -116,20 +174,12 @@ void mouse_button_callback(GLFWwindow *window, int button, int action, int mods)
             }
         }
 
-        foreach (Model3D *model, engine->models) {
-            if (!ModelExists(model)) continue;
-
-            if (model->clickable.isHovered && model->clickable.onClick) {
-                model->clickable.onClick(model);
-            }
+        if (hoveredModel != NULL && hoveredModel->clickable.onClick) {
+            hoveredModel->clickable.onClick(hoveredModel);
         }
 
-        foreach (SceneObject *object, engine->sceneObjects) {
-            if (!ObjectExists(object)) continue;
-
-            if (object->clickable.isHovered && object->clickable.onClick) {
-                object->clickable.onClick(object);
-            }
+        if (hoveredObject != NULL && hoveredObject->clickable.onClick) {
+            hoveredObject->clickable.onClick(hoveredObject);
         }
     }
 }
@@ -151,19 +201,12 @@ void scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
     printf("Framebuffer callback => Resized to %dx%d\n", width, height);
-    glViewport(0, 0, width, height);
 
     engine->windowWidth = (float)width;
     engine->windowHeight = (float)height;
     engine->aspectRatio = (float)width / (float)height;
 
-    if (engine->antiAliasing) {
-        UnbindFrameBufferObj(antiAlias);  // Clean up the old framebuffer
-
-        antiAlias = BindFrameBuffer((FrameBufferObject){
-            .bufferWidth = width,
-            .bufferHeight = height});  // Recreate framebuffer with new dimensions
-    }
+    // The viewport & the anti-alias framebuffer follow in #submit() once a snapshot with the new size reaches it
 }
 
 void window_close_callback(GLFWwindow *window) {
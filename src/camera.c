@@ -3,7 +3,8 @@
 
 static inline void UpdateCameraVectors(Camera *camera) {
     camera->projection = glms_perspective(glm_rad(camera->fov), engine->aspectRatio, ENGINE_CAMERA_DEFAULT_NEAR_PLANE, camera->renderDistance);
-    camera->view = glms_lookat(camera->position, glms_vec3_add(camera->position, camera->front), camera->up);
+    camera->renderPosition = glms_vec3_lerp(camera->previousPosition, camera->position, engine->interpolation);
+    camera->view = glms_lookat(camera->renderPosition, glms_vec3_add(camera->renderPosition, camera->front), camera->up);
 
     vec3s front;
     front.x = cos(glm_rad(camera->yaw)) * cos(glm_rad(camera->pitch));
@@ -22,6 +23,7 @@ static inline void UpdateCameraVectors(Camera *camera) {
 Camera *NewCamera(vec3s position, float fov) {
     Camera *camera = (Camera *)malloc(sizeof(Camera));
     camera->position = position;
+    camera->previousPosition = position;
     camera->fov = fov;
     camera->maxFov = ENGINE_CAMERA_DEFAULT_MAX_FOV;
     camera->movementSpeed = ENGINE_CAMERA_DEFAULT_MOVE_SPEED;
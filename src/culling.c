@@ -0,0 +1,410 @@
+#include "culling.h"
+
+#include <float.h>
+#include <string.h>
+
+#include "model3d.h"
+#include "profiler.h"
+#include "render.h"
+#include "utils.h"
+
+#if ENGINE_SIMD_X86
+#include <immintrin.h>
+#endif
+
+bool BeginCullBounds(CullBounds *bounds, Arena *arena, int capacity) {
+    *bounds = (CullBounds){0};
+    if (capacity < 1) return GLFW_TRUE;
+
+    float *block = ArenaPush(arena, float, (size_t)capacity * 6);
+    if (block == NULL) return GLFW_FALSE;
+
+    float **streams[] = {&bounds->centerX, &bounds->centerY, &bounds->centerZ,
+                         &bounds->extentX, &bounds->extentY, &bounds->extentZ};
+
+    for (int i = 0; i < 6; i++) {
+        *streams[i] = block + (size_t)i * capacity;
+    }
+
+    bounds->capacity = capacity;
+    return GLFW_TRUE;
+}
+
+void AddCullBounds(CullBounds *bounds, vec3s min, vec3s max) {
+    if (bounds->count >= bounds->capacity) return;
+
+    int i = bounds->count++;
+
+    bounds->centerX[i] = (min.x + max.x) * 0.5f;
+    bounds->centerY[i] = (min.y + max.y) * 0.5f;
+    bounds->centerZ[i] = (min.z + max.z) * 0.5f;
+    bounds->extentX[i] = (max.x - min.x) * 0.5f;
+    bounds->extentY[i] = (max.y - min.y) * 0.5f;
+    bounds->extentZ[i] = (max.z - min.z) * 0.5f;
+}
+
+/* Arvo's method, the new extents are the old ones through the absolute value of the upper 3x3 */
+void TransformBounds(const mat4s *model, vec3s min, vec3s max, vec3s *worldMin, vec3s *worldMax) {
+    vec3s center = glms_vec3_scale(glms_vec3_add(min, max), 0.5f);
+    vec3s extent = glms_vec3_scale(glms_vec3_sub(max, min), 0.5f);
+
+    vec3s worldCenter = glms_mat4_mulv3(*model, center, 1.0f);
+    vec3s worldExtent;
+
+    for (int row = 0; row < 3; row++) {
+        worldExtent.raw[row] = fabsf(model->raw[0][row]) * extent.x +
+                               fabsf(model->raw[1][row]) * extent.y +
+                               fabsf(model->raw[2][row]) * extent.z;
+    }
+
+    *worldMin = glms_vec3_sub(worldCenter, worldExtent);
+    *worldMax = glms_vec3_add(worldCenter, worldExtent);
+}
+
+void GetWorldBounds(SceneObject *object, Model3D *model, vec3s *worldMin, vec3s *worldMax) {
+    Transform *transforms = (object != NULL) ? object->transforms : model->transforms;
+    BoundingBox *boundingBox = transforms->boundingBox;
+    int instanceCount = (object != NULL) ? object->instanceCount : model->instanceCount;
+
+    if (boundingBox == NULL) {
+        *worldMin = (vec3s){-ENGINE_CULL_UNBOUNDED_EXTENT, -ENGINE_CULL_UNBOUNDED_EXTENT, -ENGINE_CULL_UNBOUNDED_EXTENT};
+        *worldMax = (vec3s){ENGINE_CULL_UNBOUNDED_EXTENT, ENGINE_CULL_UNBOUNDED_EXTENT, ENGINE_CULL_UNBOUNDED_EXTENT};
+        return;
+    }
+
+    if (instanceCount < 1) instanceCount = 1;
+
+    // Billboards are rotated towards the camera in the shader, any orientation has to fit
+    bool billboard = object != NULL && (object->type & OBJECT_SPRITE_BILLBOARD);
+
+    vec3s min = (vec3s){FLT_MAX, FLT_MAX, FLT_MAX};
+    vec3s max = (vec3s){-FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+    for (int i = 0; i < instanceCount; i++) {
+        // Only the first transform owns the box (& its expansion), the other instances share its local extents
+        mat4s *matrix = (i == 0) ? GetBoundingBoxMatrix(boundingBox, transforms) : GetTransformMatrix(&transforms[i]);
+
+        vec3s instanceMin, instanceMax;
+        TransformBounds(matrix, boundingBox->min, boundingBox->max, &instanceMin, &instanceMax);
+
+        if (billboard) {
+            vec3s center = glms_vec3_scale(glms_vec3_add(instanceMin, instanceMax), 0.5f);
+            float radius = glms_vec3_norm(glms_vec3_scale(glms_vec3_sub(instanceMax, instanceMin), 0.5f));
+
+            instanceMin = glms_vec3_subs(center, radius);
+            instanceMax = glms_vec3_adds(center, radius);
+        }
+
+        min = glms_vec3_minv(min, instanceMin);
+        max = glms_vec3_maxv(max, instanceMax);
+    }
+
+    *worldMin = min;
+    *worldMax = max;
+}
+
+static inline bool BoxInFrustum(const Plane frustum[6], const CullBounds *bounds, int i) {
+    for (int p = 0; p < 6; p++) {
+        const Plane *plane = &frustum[p];
+
+        float distance = plane->a * bounds->centerX[i] + plane->b * bounds->centerY[i] + plane->c * bounds->centerZ[i] + plane->d +
+                         fabsf(plane->a) * bounds->extentX[i] + fabsf(plane->b) * bounds->extentY[i] + fabsf(plane->c) * bounds->extentZ[i];
+
+        if (distance < 0.0f) return GLFW_FALSE;
+    }
+
+    return GLFW_TRUE;
+}
+
+static int CullScalar(const Plane frustum[6], const CullBounds *bounds, int begin, int *visible) {
+    int count = 0;
+
+    for (int i = begin; i < bounds->count; i++) {
+        if (BoxInFrustum(frustum, bounds, i)) visible[count++] = i;
+    }
+
+    return count;
+}
+
+#if ENGINE_SIMD_X86
+
+/* 'outside' has one bit per lane, every clear bit is a visible box */
+static inline int WriteVisible(int outside, int lanes, int base, int *visible) {
+    int count = 0;
+
+    for (int lane = 0; lane < lanes; lane++) {
+        visible[count] = base + lane;
+        count += !((outside >> lane) & 1);
+    }
+
+    return count;
+}
+
+__attribute__((target("sse2"))) static int CullSSE(const Plane frustum[6], const CullBounds *bounds, int *visible, int *done) {
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    int count = 0, i = 0;
+
+    for (; i + 4 <= bounds->count; i += 4) {
+        __m128 cx = _mm_loadu_ps(&bounds->centerX[i]);
+        __m128 cy = _mm_loadu_ps(&bounds->centerY[i]);
+        __m128 cz = _mm_loadu_ps(&bounds->centerZ[i]);
+        __m128 ex = _mm_loadu_ps(&bounds->extentX[i]);
+        __m128 ey = _mm_loadu_ps(&bounds->extentY[i]);
+        __m128 ez = _mm_loadu_ps(&bounds->extentZ[i]);
+
+        __m128 outside = _mm_setzero_ps();
+
+        for (int p = 0; p < 6; p++) {
+            __m128 a = _mm_set1_ps(frustum[p].a), b = _mm_set1_ps(frustum[p].b), c = _mm_set1_ps(frustum[p].c);
+
+            // Same order of operations as #BoxInFrustum() so every kernel agrees on boxes touching a plane
+            __m128 distance = _mm_add_ps(_mm_mul_ps(a, cx), _mm_mul_ps(b, cy));
+            distance = _mm_add_ps(distance, _mm_mul_ps(c, cz));
+            distance = _mm_add_ps(distance, _mm_set1_ps(frustum[p].d));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_andnot_ps(signMask, a), ex));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_andnot_ps(signMask, b), ey));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_andnot_ps(signMask, c), ez));
+
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_setzero_ps()));
+        }
+
+        count += WriteVisible(_mm_movemask_ps(outside), 4, i, &visible[count]);
+    }
+
+    *done = i;
+    return count;
+}
+
+__attribute__((target("avx2"))) static int CullAVX2(const Plane frustum[6], const CullBounds *bounds, int *visible, int *done) {
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    int count = 0, i = 0;
+
+    for (; i + 8 <= bounds->count; i += 8) {
+        __m256 cx = _mm256_loadu_ps(&bounds->centerX[i]);
+        __m256 cy = _mm256_loadu_ps(&bounds->centerY[i]);
+        __m256 cz = _mm256_loadu_ps(&bounds->centerZ[i]);
+        __m256 ex = _mm256_loadu_ps(&bounds->extentX[i]);
+        __m256 ey = _mm256_loadu_ps(&bounds->extentY[i]);
+        __m256 ez = _mm256_loadu_ps(&bounds->extentZ[i]);
+
+        __m256 outside = _mm256_setzero_ps();
+
+        for (int p = 0; p < 6; p++) {
+            __m256 a = _mm256_set1_ps(frustum[p].a), b = _mm256_set1_ps(frustum[p].b), c = _mm256_set1_ps(frustum[p].c);
+
+            // No FMA, fused rounding would disagree with the scalar kernel on boxes touching a plane
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(a, cx), _mm256_mul_ps(b, cy));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(c, cz));
+            distance = _mm256_add_ps(distance, _mm256_set1_ps(frustum[p].d));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_andnot_ps(signMask, a), ex));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_andnot_ps(signMask, b), ey));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_andnot_ps(signMask, c), ez));
+
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_LT_OQ));
+        }
+
+        // Most frames most boxes are either all in or all out, skip the lane loop for the latter
+        int mask = _mm256_movemask_ps(outside);
+        if (mask != 0xFF) count += WriteVisible(mask, 8, i, &visible[count]);
+    }
+
+    *done = i;
+    return count;
+}
+
+#endif
+
+int CullFrustumLevel(SimdLevel level, const Plane frustum[6], const CullBounds *bounds, int *visible) {
+    SimdLevel supported = GetSimdLevel();
+    if (level > supported) level = supported;
+
+    int count = 0, done = 0;
+
+#if ENGINE_SIMD_X86
+    if (level == SIMD_AVX2) {
+        count = CullAVX2(frustum, bounds, visible, &done);
+    } else if (level == SIMD_SSE) {
+        count = CullSSE(frustum, bounds, visible, &done);
+    }
+#endif
+
+    // Whatever doesn't fill a whole vector
+    return count + CullScalar(frustum, bounds, done, &visible[count]);
+}
+
+int CullFrustum(const Plane frustum[6], const CullBounds *bounds, int *visible) {
+    return CullFrustumLevel(GetSimdLevel(), frustum, bounds, visible);
+}
+
+void PushVisibleScene(RenderQueue *queue, Camera *camera) {
+    PROFILE_ZONE("PushVisibleScene");
+
+    Arena *arena = engine->frameArena;
+    size_t mark = ArenaMark(arena);
+
+    int objectCount = (int)ListSize(engine->sceneObjects);
+    int total = objectCount + (int)ListSize(engine->models);
+
+    // Index i below 'objectCount' is a scene object, the rest are models
+    void **owners = ArenaPush(arena, void *, total);
+    int *visible = ArenaPush(arena, int, total);
+    CullBounds bounds;
+
+    if (owners == NULL || visible == NULL || !BeginCullBounds(&bounds, arena, total)) {
+        ArenaRewind(arena, mark);
+        return;
+    }
+
+    int index = 0;
+    vec3s min, max;
+
+    foreach (SceneObject *object, engine->sceneObjects) {
+        if (!ObjectExists(object) || object->type == OBJECT_FRAMEBUFFER_QUAD) {
+            // Keeps the object/model split at 'objectCount', skipped after the test
+            min = max = (vec3s){0.0f, 0.0f, 0.0f};
+            owners[index++] = NULL;
+        } else {
+            GetWorldBounds(object, NULL, &min, &max);
+            owners[index++] = object;
+        }
+
+        AddCullBounds(&bounds, min, max);
+    }
+
+    foreach (Model3D *model, engine->models) {
+        if (!ModelExists(model)) {
+            min = max = (vec3s){0.0f, 0.0f, 0.0f};
+            owners[index++] = NULL;
+        } else {
+            GetWorldBounds(NULL, model, &min, &max);
+            owners[index++] = model;
+        }
+
+        AddCullBounds(&bounds, min, max);
+    }
+
+    int visibleCount = total;
+    if (ENGINE_FRUSTUM_CULLING) {
+        visibleCount = CullFrustum(camera->frustum, &bounds, visible);
+    } else {
+        for (int i = 0; i < total; i++) visible[i] = i;
+    }
+
+    CullStats stats = (CullStats){0};
+
+    for (int i = 0; i < visibleCount; i++) {
+        int owner = visible[i];
+        if (owners[owner] == NULL) continue;
+
+        if (owner < objectCount) {
+            RenderQueuePushObject(queue, (SceneObject *)owners[owner]);
+        } else {
+            RenderQueuePushModel(queue, (Model3D *)owners[owner]);
+        }
+
+        stats.visible++;
+    }
+
+    for (int i = 0; i < total; i++) {
+        stats.tested += owners[i] != NULL;
+    }
+
+    stats.culled = stats.tested - stats.visible;
+    engine->cullStats = stats;
+
+    ArenaRewind(arena, mark);
+}
+
+#ifdef ENGINE_SELF_TESTS
+
+/* Random boxes around a camera at the origin looking down -Z, roughly half of them end up visible */
+static bool NewRandomBounds(CullBounds *bounds, Arena *arena, int count, Plane frustum[6]) {
+    if (!BeginCullBounds(bounds, arena, count)) return GLFW_FALSE;
+
+    unsigned int state = 0xC011u;
+
+    for (int i = 0; i < count; i++) {
+        vec3s center = (vec3s){RandomRange(&state, -200.0f, 200.0f), RandomRange(&state, -50.0f, 50.0f), RandomRange(&state, -400.0f, 50.0f)};
+        vec3s extent = (vec3s){RandomRange(&state, 0.1f, 5.0f), RandomRange(&state, 0.1f, 5.0f), RandomRange(&state, 0.1f, 5.0f)};
+
+        AddCullBounds(bounds, glms_vec3_sub(center, extent), glms_vec3_add(center, extent));
+    }
+
+    Camera test = (Camera){0};
+    mat4s projection = glms_perspective(glm_rad(ENGINE_CAMERA_DEFAULT_FOV), 4.0f / 3.0f, ENGINE_CAMERA_DEFAULT_NEAR_PLANE, ENGINE_CAMERA_DEFAULT_FAR_PLANE);
+    mat4s view = glms_lookat((vec3s){0.0f, 0.0f, 0.0f}, (vec3s){0.0f, 0.0f, -1.0f}, (vec3s){0.0f, 1.0f, 0.0f});
+    mat4s projectionXview = glms_mat4_mul(projection, view);
+
+    UpdateFrustum(&test, (float *)projectionXview.raw);
+    memcpy(frustum, test.frustum, sizeof(test.frustum));
+
+    return GLFW_TRUE;
+}
+
+bool CullingSelfTest(int count) {
+    Arena *arena = GetThreadArena();
+    if (arena == NULL) return GLFW_FALSE;
+
+    size_t mark = ArenaMark(arena);
+
+    CullBounds bounds;
+    Plane frustum[6];
+    int *expected = ArenaPush(arena, int, count);
+    int *result = ArenaPush(arena, int, count);
+
+    if (expected == NULL || result == NULL || !NewRandomBounds(&bounds, arena, count, frustum)) {
+        ArenaRewind(arena, mark);
+        return GLFW_FALSE;
+    }
+
+    int expectedCount = CullFrustumLevel(SIMD_SCALAR, frustum, &bounds, expected);
+    bool passed = GLFW_TRUE;
+
+    for (SimdLevel level = SIMD_SSE; level <= GetSimdLevel(); level++) {
+        int resultCount = CullFrustumLevel(level, frustum, &bounds, result);
+        bool match = resultCount == expectedCount && memcmp(expected, result, (size_t)resultCount * sizeof(int)) == 0;
+
+        printf("[CULLING TEST] %-6s %d boxes: %d visible, %s\n", SimdLevelName(level), count, resultCount, match ? "OK" : "MISMATCH");
+        passed = passed && match;
+    }
+
+    ArenaRewind(arena, mark);
+    return passed;
+}
+
+void BenchmarkCulling(int count, int iterations) {
+    Arena *arena = GetThreadArena();
+    if (arena == NULL) return;
+
+    size_t mark = ArenaMark(arena);
+
+    CullBounds bounds;
+    Plane frustum[6];
+    int *visible = ArenaPush(arena, int, count);
+
+    if (visible == NULL || iterations < 1 || !NewRandomBounds(&bounds, arena, count, frustum)) {
+        ArenaRewind(arena, mark);
+        return;
+    }
+
+    double reference = 0.0;
+
+    for (SimdLevel level = SIMD_SCALAR; level <= GetSimdLevel(); level++) {
+        int visibleCount = 0;
+
+        double start = GetTimeSeconds();
+        for (int n = 0; n < iterations; n++) {
+            visibleCount = CullFrustumLevel(level, frustum, &bounds, visible);
+        }
+        double elapsed = (GetTimeSeconds() - start) / iterations;
+
+        if (level == SIMD_SCALAR) reference = elapsed;
+
+        printf("[CULLING BENCH] %-6s %d boxes: %.3f ms (%.2f ns/box, %.2fx), %d visible\n",
+               SimdLevelName(level), count, elapsed * 1e3, elapsed * 1e9 / count, reference / elapsed, visibleCount);
+    }
+
+    ArenaRewind(arena, mark);
+}
+
+#endif  // ENGINE_SELF_TESTS
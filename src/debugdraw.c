@@ -0,0 +1,234 @@
+#include "debugdraw.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "glstate.h"
+#include "shader.h"
+
+DebugDraw *NewDebugDraw(int capacity) {
+    DebugDraw *draw = (DebugDraw *)malloc(sizeof(DebugDraw));
+    if (draw == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed creating new Debug Draw, ERROR ALLOCATING MEMORY\n");
+        return NULL;
+    }
+
+    if (capacity < 6) capacity = ENGINE_DEBUG_DRAW_MAX_VERTICES;
+
+    *draw = (DebugDraw){0};
+    draw->capacity = capacity;
+
+    GLsizeiptr size = (GLsizeiptr)capacity * ENGINE_DEBUG_DRAW_FRAMES * sizeof(DebugVertex);
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glGenVertexArrays(1, &draw->VAO);
+    glGenBuffers(1, &draw->buffer);
+
+    StateBindVertexArray(draw->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, draw->buffer);
+    glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+    draw->mapped = (DebugVertex *)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(DebugVertex), (void *)offsetof(DebugVertex, position));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(DebugVertex), (void *)offsetof(DebugVertex, other));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(DebugVertex), (void *)offsetof(DebugVertex, color));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(DebugVertex), (void *)offsetof(DebugVertex, width));
+    glEnableVertexAttribArray(3);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    StateBindVertexArray(0);
+
+    if (draw->mapped == NULL) {
+        fprintf(stderr, "[DEBUG DRAW ERROR] Failed mapping %lld bytes of vertex storage\n", (long long)size);
+        FreeDebugDraw(draw);
+        return NULL;
+    }
+
+    return draw;
+}
+
+void FreeDebugDraw(DebugDraw *draw) {
+    if (draw == NULL) return;
+
+    for (int i = 0; i < ENGINE_DEBUG_DRAW_FRAMES; i++) {
+        if (draw->fences[i] != NULL) glDeleteSync(draw->fences[i]);
+    }
+
+    if (draw->buffer != 0) {
+        if (draw->mapped != NULL) {
+            glBindBuffer(GL_ARRAY_BUFFER, draw->buffer);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+
+        glDeleteBuffers(1, &draw->buffer);
+    }
+
+    if (draw->VAO != 0) glDeleteVertexArrays(1, &draw->VAO);
+    free(draw);
+}
+
+void DebugDrawBegin(DebugDraw *draw) {
+    GLsync fence = draw->fences[draw->region];
+
+    if (fence != NULL) {
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        for (;;) {
+            GLenum result = glClientWaitSync(fence, flags, 1000000);
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) break;
+            if (result == GL_WAIT_FAILED) {
+                fprintf(stderr, "[DEBUG DRAW ERROR] Waiting on region %d failed\n", draw->region);
+                break;
+            }
+            flags = 0;
+        }
+
+        glDeleteSync(fence);
+        draw->fences[draw->region] = NULL;
+    }
+
+    draw->lineVertices = 0;
+    draw->triangleVertices = 0;
+}
+
+void DebugDrawUpload(DebugDraw *draw, const DebugDrawList *list) {
+    int lines = (list->lineVertices < draw->capacity) ? list->lineVertices : draw->capacity;
+    int triangles = (list->triangleVertices < draw->capacity - lines) ? list->triangleVertices : draw->capacity - lines;
+
+    DebugVertex *region = draw->mapped + (size_t)draw->region * draw->capacity;
+
+    // Same layout as the list, so the flush can still draw both types from one contiguous range each
+    memcpy(region, list->vertices, (size_t)lines * sizeof(DebugVertex));
+    memcpy(region + draw->capacity - triangles, list->vertices + list->capacity - list->triangleVertices,
+           (size_t)triangles * sizeof(DebugVertex));
+
+    draw->lineVertices = lines;
+    draw->triangleVertices = triangles;
+    draw->overflows += list->overflows + (list->lineVertices - lines) / 6 + (list->triangleVertices - triangles) / 3;
+}
+
+void DebugDrawListBegin(DebugDrawList *list, DebugVertex *vertices, int capacity) {
+    *list = (DebugDrawList){.vertices = vertices, .capacity = (vertices != NULL) ? capacity : 0};
+}
+
+static inline GLuint PackColor(vec3s color) {
+    GLuint r = (GLuint)(glm_clamp_zo(color.x) * 255.0f + 0.5f);
+    GLuint g = (GLuint)(glm_clamp_zo(color.y) * 255.0f + 0.5f);
+    GLuint b = (GLuint)(glm_clamp_zo(color.z) * 255.0f + 0.5f);
+
+    // Memory order R, G, B, A on little endian, which is what GL_UNSIGNED_BYTE x4 reads
+    return r | (g << 8) | (b << 16) | (255u << 24);
+}
+
+static inline bool Reserve(DebugDrawList *list, int vertices) {
+    if (list->lineVertices + list->triangleVertices + vertices <= list->capacity) return GLFW_TRUE;
+
+    if (list->overflows++ == 0) {
+        fprintf(stderr, "[DEBUG DRAW ERROR] More than %d debug vertices this frame, raise ENGINE_DEBUG_DRAW_MAX_VERTICES\n", list->capacity);
+    }
+    return GLFW_FALSE;
+}
+
+static inline void WriteVertex(DebugVertex *vertex, vec3s position, vec3s other, GLuint color, float width) {
+    vertex->position[0] = position.x;
+    vertex->position[1] = position.y;
+    vertex->position[2] = position.z;
+    vertex->other[0] = other.x;
+    vertex->other[1] = other.y;
+    vertex->other[2] = other.z;
+    vertex->color = color;
+    vertex->width = width;
+}
+
+void DebugDrawLine(DebugDrawList *list, vec3s start, vec3s end, vec3s color, float width) {
+    if (!Reserve(list, 6)) return;
+    if (width <= 0.0f) width = 1.0f;
+
+    DebugVertex *vertices = list->vertices + list->lineVertices;
+    GLuint packed = PackColor(color);
+
+    // The sign of the width is the side of the segment, the shader pushes the corner that way
+    WriteVertex(&vertices[0], start, end, packed, width);
+    WriteVertex(&vertices[1], start, end, packed, -width);
+    WriteVertex(&vertices[2], end, start, packed, width);
+
+    WriteVertex(&vertices[3], end, start, packed, width);
+    WriteVertex(&vertices[4], start, end, packed, -width);
+    WriteVertex(&vertices[5], end, start, packed, -width);
+
+    list->lineVertices += 6;
+}
+
+void DebugDrawTriangle(DebugDrawList *list, vec3s a, vec3s b, vec3s c, vec3s color) {
+    if (!Reserve(list, 3)) return;
+
+    list->triangleVertices += 3;
+
+    // Triangles grow down from the end of the list, so both types stay contiguous
+    DebugVertex *vertices = list->vertices + list->capacity - list->triangleVertices;
+    GLuint packed = PackColor(color);
+
+    WriteVertex(&vertices[0], a, a, packed, 0.0f);
+    WriteVertex(&vertices[1], b, b, packed, 0.0f);
+    WriteVertex(&vertices[2], c, c, packed, 0.0f);
+}
+
+void DebugDrawBox(DebugDrawList *list, vec3s min, vec3s max, const mat4s *model, vec3s color, float width) {
+    vec3s corners[8];
+
+    for (int i = 0; i < 8; i++) {
+        vec4s corner = (vec4s){{(i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z, 1.0f}};
+        corners[i] = glms_vec3(glms_mat4_mulv(*model, corner));
+    }
+
+    // Corner index bits are (x, y, z), every edge joins two corners one bit apart
+    static const int edges[12][2] = {
+        {0, 1}, {2, 3}, {4, 5}, {6, 7},
+        {0, 2}, {1, 3}, {4, 6}, {5, 7},
+        {0, 4}, {1, 5}, {2, 6}, {3, 7}};
+
+    for (int i = 0; i < 12; i++) {
+        DebugDrawLine(list, corners[edges[i][0]], corners[edges[i][1]], color, width);
+    }
+}
+
+void DebugDrawFlush(DebugDraw *draw, Shader *shader, float width, float height) {
+    if (draw->lineVertices + draw->triangleVertices > 0) {
+        GLint first = draw->region * draw->capacity;
+
+        UseShader(*shader);
+        setVec2F(*shader, "viewportSize", width, height);
+
+        bool blend = StateIsEnabled(GL_BLEND), cullFace = StateIsEnabled(GL_CULL_FACE);
+
+        // Arrow heads must show from both sides & line quads have no fixed winding
+        StateDisable(GL_CULL_FACE);
+
+        // The expanded quads fade out over their last pixel, that's the only anti-aliasing lines get
+        StateEnable(GL_BLEND);
+        StateBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        StateBindVertexArray(draw->VAO);
+
+        if (draw->lineVertices > 0) {
+            glDrawArrays(GL_TRIANGLES, first, draw->lineVertices);
+        }
+
+        if (draw->triangleVertices > 0) {
+            glDrawArrays(GL_TRIANGLES, first + draw->capacity - draw->triangleVertices, draw->triangleVertices);
+        }
+
+        StateBindVertexArray(0);
+
+        (blend) ? StateEnable(GL_BLEND) : StateDisable(GL_BLEND);
+        (cullFace) ? StateEnable(GL_CULL_FACE) : StateDisable(GL_CULL_FACE);
+    }
+
+    draw->fences[draw->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    draw->lastLineVertices = draw->lineVertices;
+    draw->lastTriangleVertices = draw->triangleVertices;
+
+    draw->region = (draw->region + 1) % ENGINE_DEBUG_DRAW_FRAMES;
+}
@@ -2,21 +2,38 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define NANOVG_GL3_IMPLEMENTATION
+#include "arena.h"
+#include "assets.h"
 #include "callbacks.h"
+#include "bvh.h"
 #include "camera.h"
+#include "culling.h"
+#include "debugdraw.h"
+#include "glstate.h"
+#include "headless.h"
+#include "instancering.h"
+#include "jobs.h"
+#include "meshbvh.h"
 #include "model3d.h"
 #include "nanovg_gl.h"
 #include "object.h"
+#include "picking.h"
+#include "profiler.h"
 #include "render.h"
+#include "renderqueue.h"
+#include "renderthread.h"
 #include "shader.h"
+#include "timerwheel.h"
 #include "ui.h"
 #include "uievents.h"
+#include "upload.h"
 #include "utils.h"
 
 Engine *engine = NULL;
-Shader *defaultShader, *miscShader, *instanceShader,
+Shader *defaultShader, *debugShader, *instanceShader,
     *antiAliasShader, *skyboxShader;
 Camera *camera;
 FrameBufferObject *antiAlias;
@@ -28,7 +45,48 @@ static Model3D *testModel;
 static Camera *cam2;
 // static Timer *timer;
 
-Engine *init(void) {
+EngineOptions ParseEngineOptions(int argc, char **argv) {
+    EngineOptions options = (EngineOptions){.width = ENGINE_SCREEN_WIDTH, .height = ENGINE_SCREEN_HEIGHT};
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--headless") == 0) {
+            options.headless = GLFW_TRUE;
+        } else if (strcmp(arg, "--frames") == 0 && value != NULL) {
+            options.frames = strtol(value, NULL, 10);
+            i++;
+        } else if (strcmp(arg, "--seconds") == 0 && value != NULL) {
+            options.seconds = strtod(value, NULL);
+            i++;
+        } else if (strcmp(arg, "--trace") == 0 && value != NULL) {
+            options.tracePath = value;
+            i++;
+        } else if (strcmp(arg, "--size") == 0 && value != NULL) {
+            int width, height;
+
+            if (sscanf(value, "%dx%d", &width, &height) == 2 && width > 0 && height > 0) {
+                options.width = width;
+                options.height = height;
+            } else {
+                fprintf(stderr, "[TAV ENGINE] => Ignoring --size '%s', expected WxH\n", value);
+            }
+            i++;
+        } else {
+            fprintf(stderr, "[TAV ENGINE] => Unknown option '%s'\n", arg);
+        }
+    }
+
+    // A headless run always ends on its own
+    if (options.headless && options.frames <= 0 && options.seconds <= 0.0) {
+        options.frames = ENGINE_HEADLESS_DEFAULT_FRAMES;
+    }
+
+    return options;
+}
+
+Engine *init(EngineOptions options) {
     engine = malloc(sizeof(Engine));
     if (!engine) {
         printf("[TAV ENGINE] => Failed to allocate memory for Engine\n");
@@ -37,32 +95,45 @@ Engine *init(void) {
 
     printf("[TAV ENGINE] => Loading engine...\n");
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // First, so everything from here on can open zones
+    InitProfiler();
 
     GLFWwindow *window;
 
+    if (options.headless) {
+        HeadlessInitHints();
+    }
+
     if (!glfwInit()) {
         printf("[TAV ENGINE] => Failed to initialize GLFW\n");
         return NULL;
     }
 
-    window = glfwCreateWindow(ENGINE_SCREEN_WIDTH, ENGINE_SCREEN_HEIGHT, "Prototype Engine", NULL, NULL);
+    if (options.headless) {
+        window = CreateHeadlessWindow(options.width, options.height);
+    } else {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+        window = glfwCreateWindow(options.width, options.height, "Prototype Engine", NULL, NULL);
+    }
+
     if (!window) {
         printf("[TAV ENGINE] => Failed to create GLFW window\n");
         glfwTerminate();
         return NULL;
     }
 
-    engine->windowWidth = (float)ENGINE_SCREEN_WIDTH;
-    engine->windowHeight = (float)ENGINE_SCREEN_HEIGHT;
-    engine->aspectRatio = (float)ENGINE_SCREEN_WIDTH / (float)ENGINE_SCREEN_HEIGHT;
+    engine->options = options;
+    engine->windowWidth = (float)options.width;
+    engine->windowHeight = (float)options.height;
+    engine->aspectRatio = (float)options.width / (float)options.height;
 
     engine->firstMouse = GLFW_TRUE;
     engine->mouseDragging = GLFW_FALSE;
-    engine->lastX = ENGINE_SCREEN_WIDTH / 2.0f;
-    engine->lastY = ENGINE_SCREEN_HEIGHT / 2.0f;
+    engine->lastX = options.width / 2.0f;
+    engine->lastY = options.height / 2.0f;
 
     glfwMakeContextCurrent(window);
 
@@ -71,6 +142,23 @@ Engine *init(void) {
         return NULL;
     }
 
+    engine->glVersion = GLVersion.major * 10 + GLVersion.minor;
+    printf("[TAV ENGINE] => OpenGL %d.%d, %s\n", GLVersion.major, GLVersion.minor, (const char *)glGetString(GL_RENDERER));
+
+    // No default framebuffer without a surface, the whole frame ends up in an offscreen target instead
+    engine->outputFramebuffer = 0;
+    engine->headlessTarget = NULL;
+
+    if (options.headless) {
+        engine->headlessTarget = (HeadlessTarget *)NewHeadlessTarget(options.width, options.height);
+        if (engine->headlessTarget == NULL) return NULL;
+
+        engine->outputFramebuffer = engine->headlessTarget->framebuffer;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, engine->outputFramebuffer);
+    glViewport(0, 0, options.width, options.height);
+
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
     char *mainPath = getSourceCodePath();
@@ -103,44 +191,92 @@ Engine *init(void) {
     engine->fontDir = (char *)fontsDir;
     engine->fps = (float)0.0f;
     engine->deltaTime = (float)0.0f;
+    engine->frameCount = 0;
+    engine->startTime = 0.0;
+    engine->frameTimer = (FrameTimer){0};
+    engine->frameStats = (FrameTimeStats){0};
+    engine->accumulator = engine->simulationTime = engine->droppedTime = 0.0;
+    engine->interpolation = 0.0f;
+    engine->substeps = 0;
     engine->shaders = (List *)NewList(NULL);
     engine->sceneObjects = (List *)NewList(NULL);
     engine->models = (List *)NewList(NULL);
     engine->cameras = (List *)NewList(NULL);
-    engine->textures = (Map *)NewMap(NULL);
+    engine->textures = (HashMap *)NewStringHashMap();
     engine->antiAliasing = GLFW_TRUE;
-    engine->vSync = GLFW_TRUE;
+    engine->vSync = !options.headless;  // a benchmark shouldn't be paced by a display it doesn't have
     engine->wireframeMode = GLFW_FALSE;
+    engine->profilerOverlay = GLFW_FALSE;
     engine->skybox = (Skybox *)NULL;
+    engine->frameUBO = 0;
+    engine->frameArena = NULL;
+    engine->renderQueue = NULL;
+    engine->instanceRing = NULL;
+    engine->debugDraw = NULL;
+    engine->debugList = NULL;
+    engine->sceneBVH = NULL;
+    engine->pickBuffer = NULL;
+    engine->pickingMode = ENGINE_PICKING_MODE;
 
-    glEnable(GL_DEBUG_OUTPUT);
+    // NanoVG already touched GL state while creating its context & font atlas, the cache starts out knowing nothing
+    InitStateCache();
+
+    StateEnable(GL_DEBUG_OUTPUT);
 
     initUI();
     init_callbacks(engine);
     InitTimerManager();
+    InitJobSystem(ENGINE_JOB_WORKERS);
+    InitTimerWheel();
+    InitAssetRegistry();
 
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
+    StateEnable(GL_DEPTH_TEST);
+    StateDepthFunc(GL_LESS);
 
-    glEnable(GL_BLEND);
+    StateEnable(GL_BLEND);
 
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
+    StateEnable(GL_CULL_FACE);
+    StateCullFace(GL_BACK);
     glFrontFace(GL_CCW);
 
     defaultShader = (Shader *)NewShader("shader.vert", "shader.frag");
-    miscShader = (Shader *)NewShader("misc_shader.vert", "shader.frag");
+    debugShader = (Shader *)NewShader("debug_draw.vert", "debug_draw.frag");
     instanceShader = (Shader *)NewShader("instance_shader.vert", "shader.frag");
     skyboxShader = (Shader *)NewShader("skybox.vert", "skybox.frag");
 
+    InitFrameUniforms();
+    engine->instanceRing = (InstanceRing *)NewInstanceRing(ENGINE_MAX_INSTANCES_PER_FRAME);
+    if (engine->instanceRing == NULL) {
+        printf("[TAV ENGINE] => Failed to create the instance ring, GL 4.4 buffer storage is required\n");
+        return NULL;
+    }
+
+    engine->debugDraw = (DebugDraw *)NewDebugDraw(ENGINE_DEBUG_DRAW_MAX_VERTICES);
+    if (engine->debugDraw == NULL) {
+        printf("[TAV ENGINE] => Failed to create the debug draw buffer\n");
+        return NULL;
+    }
+
+    engine->sceneBVH = (SceneBVH *)NewSceneBVH();
+    if (engine->sceneBVH == NULL) {
+        printf("[TAV ENGINE] => Failed to create the scene BVH\n");
+        return NULL;
+    }
+
+    engine->pickBuffer = (PickBuffer *)NewPickBuffer();
+    if (engine->pickBuffer == NULL) {
+        printf("[TAV ENGINE] => Failed to create the pick buffer\n");
+        return NULL;
+    }
+
     camera = (Camera *)NewCamera((vec3s){10.0f, 1.0f, 10.0f}, ENGINE_CAMERA_DEFAULT_FOV);
     cam2 = (Camera *)NewCamera((vec3s){15.0f, -10.0f, 10.0f}, ENGINE_CAMERA_DEFAULT_FOV);
 
     if (engine->antiAliasing) {
         antiAliasShader = (Shader *)NewShader("aa_post.vert", "aa_post.frag");
         antiAlias = (FrameBufferObject *)BindFrameBuffer((FrameBufferObject){
-            .bufferWidth = ENGINE_SCREEN_WIDTH,
-            .bufferHeight = ENGINE_SCREEN_HEIGHT});
+            .bufferWidth = options.width,
+            .bufferHeight = options.height});
     }
 
     button = (Element *)NewUIElement((Element){
@@ -171,24 +307,85 @@ Engine *init(void) {
                                           .transforms = NewTransforms(1, (Transform[]){{.position = (vec3s){0.0, 0.01f, -10.0f},
                                           .rotation = (vec3s){0.0f, 0.45f, 1.0f},
                                           .rotationDegrees = 45.0f}}),
-                                          .gammaCorrection = GLFW_FALSE},
+                                          .gammaCorrection = GLFW_FALSE,
+                                          .placeholder = GLFW_TRUE},
                                       "models/cube.obj");
+
+    // Last, from here on the GL context belongs to the render thread
+    InitRenderThread();
+
     return engine;
 }
 
+/* What a benchmark run is judged by, printed once the render thread has submitted everything */
+static void PrintRunSummary(void) {
+    double seconds = GetTimeSeconds() - engine->startTime;
+    FrameTimeStats stats = GetFrameTimeStats(&engine->frameTimer);
+    RenderThreadStats thread = GetRenderThreadStats();
+
+    printf("[TAV ENGINE] Run summary (%s, %.0fx%.0f, OpenGL %d.%d)\n", engine->options.headless ? "headless" : "windowed",
+           engine->windowWidth, engine->windowHeight, engine->glVersion / 10, engine->glVersion % 10);
+    printf("    frames: %ld in %.3f s, %.1f fps average\n", engine->frameCount, seconds,
+           (seconds > 0.0) ? (double)engine->frameCount / seconds : 0.0);
+    printf("    frame time (last %d frames): p50 %.3f ms, p95 %.3f ms, p99 %.3f ms\n",
+           engine->frameTimer.count, stats.p50 * 1e3, stats.p95 * 1e3, stats.p99 * 1e3);
+    printf("    simulation: %.0f steps, %.3f s dropped\n", engine->simulationTime / ENGINE_UPDATE_INTERVAL, engine->droppedTime);
+    printf("    waits: main thread %.3f s, render thread %.3f s\n", thread.simulationWait, thread.renderWait);
+
+    GpuUploadStats uploads = GetGpuUploadStats();
+    printf("    uploads: %ld of %ld done, %.1f MB over %ld frames, at most %.1f MB in one\n", uploads.completed, uploads.queued,
+           (double)uploads.bytes / (1024.0 * 1024.0), uploads.frames, (double)uploads.maxFrameBytes / (1024.0 * 1024.0));
+
+    AssetStats assets = GetAssetStats();
+    printf("    assets: %d models, %d textures, %d shaders, %ld references, %ld of %ld loads shared\n", assets.counts[ASSET_MODEL],
+           assets.counts[ASSET_TEXTURE], assets.counts[ASSET_SHADER], assets.references, assets.hits, assets.hits + assets.misses);
+
+    // Zones older than a ring's worth of events are gone, busy threads cover less than the whole run
+    ProfileSummary zones = GetProfileSummary(seconds);
+    PrintProfileSummary(&zones);
+}
+
 int cleanup(void) {
     printf("\n");
+
+    // Submits what's still in flight & brings the context back to this thread for the GL cleanup below
+    ShutdownRenderThread();
+
     nvgDeleteGL3(engine->vgContext);
 
     destroyUI();
-    freeShaders();
+    if (engine->options.headless || engine->options.frames > 0 || engine->options.seconds > 0.0) {
+        PrintRunSummary();
+    }
+
+    if (engine->options.tracePath != NULL) {
+        ProfilerExportChromeTrace(engine->options.tracePath);
+    }
+
+    FreeHeadlessTarget(engine->headlessTarget);
+    FreeFrameUniforms();
+    FreeInstanceRing(engine->instanceRing);
+    FreeDebugDraw(engine->debugDraw);
+    FreeSceneBVH(engine->sceneBVH);
+    ShutdownTimerWheel();
+    CancelModelLoads();
+    CancelMeshBVHBuilds();
+    ShutdownJobSystem();
+    FreePickBuffer(engine->pickBuffer);
+    FreeThreadArena();
+    ShutdownProfiler();
 
     RemoveTextures();
     RemoveCameras();
     RemoveModels();
     RemoveSceneObjects();
+    FreeRetiredObjects();
 
-    MapFreeMemory(engine->textures);
+    // Shaders, textures & whatever models are left, their GL objects go while the context is still there
+    ShutdownAssetRegistry();
+    FreeStateCache();
+
+    HashMapFreeMemory(engine->textures);
     ListFreeMemory(engine->cameras);
     ListFreeMemory(engine->models);
     ListFreeMemory(engine->sceneObjects);
@@ -219,82 +416,286 @@ int cleanup(void) {
 }
 
 void update(void) {
-    static int frameCount = 0;
+    PROFILE_ZONE("update");
+
     static double lastTime = 0.0;
     double currentTime = current_time();
 
+    // Held keys are polled once per step, movement speed doesn't depend on key repeat or frame rate
+    processKeyboard(camera);
+
     if (lastTime == 0.0) {
         lastTime = currentTime;
     }
 
-    frameCount++;
     double difference = currentTime - lastTime;
 
+    // Refreshed once a second so the overlay stays readable, the frame timer itself sees every frame
     if (difference >= 1.0f) {
-        engine->fps = frameCount;
+        engine->fps = (engine->frameTimer.smoothed > 0.0) ? (float)(1.0 / engine->frameTimer.smoothed) : 0.0f;
+        engine->frameStats = GetFrameTimeStats(&engine->frameTimer);
 
-        frameCount = 0;
         lastTime = currentTime;
     }
 }
 
+/* What the render thread left in a snapshot it submitted, read before the snapshot gets rebuilt */
+static void ReadSnapshotResults(FrameSnapshot *snapshot) {
+    if (snapshot->pickValid && GetPickingMode() == PICKING_GPU) {
+        SetHoveredOwner(snapshot->pickedObject, snapshot->pickedModel);
+    }
+
+    // Buttons are laid out while they're drawn, their hit tests use that position
+    for (int i = 0; i < snapshot->elementCount; i++) {
+        Element *source = snapshot->sources[i];
+        Element *copy = &snapshot->elements[i];
+
+        if (copy->type == ELEMENT_TEXTBOX || !ListContains(menu->elements, source)) continue;
+        source->transform.position = copy->transform.position;
+    }
+}
+
+/* Removed elements are freed, only ones still in the menu get copied */
+static void SnapshotElement(FrameSnapshot *snapshot, Element *element) {
+    if (snapshot->elements == NULL || snapshot->sources == NULL) return;
+    if (!ListContains(menu->elements, element) || !ElementExists(element)) return;
+
+    snapshot->elements[snapshot->elementCount] = *element;
+    snapshot->sources[snapshot->elementCount] = element;
+    snapshot->elementCount++;
+}
+
 void render(void) {
-    if (!engine->vSync) {
-        glfwSwapInterval(0);
+    PROFILE_ZONE("render");
+
+    FrameSnapshot *snapshot = AcquireFrameSnapshot();
+
+    if (engine->frameCount++ == 0) {
+        engine->startTime = GetTimeSeconds();
+    }
+
+    ReadSnapshotResults(snapshot);
+    ResetArena(snapshot->arena);
+
+    engine->frameArena = snapshot->arena;
+    engine->renderQueue = snapshot->queue;
+    engine->debugList = &snapshot->debug;
+
+    // Snapshot the camera once, every draw reads view & projection from the 'FrameData' block
+    FillFrameUniforms(camera, &engine->frameUniforms);
+    snapshot->uniforms = engine->frameUniforms;
+
+    RenderQueue *queue = snapshot->queue;
+    RenderQueueBegin(queue);
+
+    // Streamed models that finished uploading swap their meshes in before anything reads them
+    UpdateModelLoads();
+    UpdateRetiredObjects();
+
+    PushVisibleScene(queue, camera);
+    UpdateSceneBVH(engine->sceneBVH);
+
+    RenderQueueSort(queue);
+
+    // Bounding boxes & gizmos go on top of the sorted scene, recorded here & drawn by the flush in #submit()
+    {
+        PROFILE_ZONE("Object debug draws");
+
+        foreach (SceneObject *object, engine->sceneObjects) {
+            if (!ObjectExists(object)) continue;
+            if (object->type == OBJECT_FRAMEBUFFER_QUAD) continue;
+
+            DrawBoundingBox(object, NULL);
+            DrawTransformGizmo(object, NULL);
+        }
+    }
+
+    {
+        PROFILE_ZONE("Model debug draws");
+
+        foreach (Model3D *model, engine->models) {
+            if (!ModelExists(model)) continue;
+
+            DrawBoundingBox(NULL, model);
+            DrawTransformGizmo(NULL, model);
+        }
+    }
+
+    snapshot->elementCount = 0;
+    snapshot->elements = NULL;
+    snapshot->sources = NULL;
+
+    snapshot->ui = GetUIFrame();
+
+    if (snapshot->ui.shown) {
+        sprintf(fpstextBox->text, "%.1f (p99 %.1f ms, %d visible, %d culled)", engine->fps, engine->frameStats.p99 * 1e3, engine->cullStats.visible, engine->cullStats.culled);
+        sprintf(coordinatestextBox->text, "X: %.2f, Y: %.2f, Z: %.2f", camera->position.x, camera->position.y, camera->position.z);
+
+        snapshot->elements = ArenaPush(snapshot->arena, Element, 3);
+        snapshot->sources = ArenaPush(snapshot->arena, Element *, 3);
+
+        SnapshotElement(snapshot, button);
+        SnapshotElement(snapshot, fpstextBox);
+        SnapshotElement(snapshot, coordinatestextBox);
+    }
+
+    // The render thread can't ask GLFW for any of this itself
+    glfwGetWindowSize(engine->window, &snapshot->windowWidth, &snapshot->windowHeight);
+    glfwGetFramebufferSize(engine->window, &snapshot->framebufferWidth, &snapshot->framebufferHeight);
+
+    snapshot->skybox = engine->skybox;
+    snapshot->cursor = GetCursorPosition();
+    snapshot->vSync = engine->vSync;
+    snapshot->antiAliasing = engine->antiAliasing;
+    snapshot->wireframe = engine->wireframeMode;
+    snapshot->profilerOverlay = engine->profilerOverlay;
+    snapshot->pickValid = GLFW_FALSE;
+
+#if ENGINE_DEBUG_MODE
+    if (snapshot->arena->frameFallbacks > 0) {
+        fprintf(stderr, "[MEMORY ERROR] Frame arena spilled %d allocations to the heap, raise ENGINE_FRAME_ARENA_SIZE\n",
+                snapshot->arena->frameFallbacks);
     }
+#endif
+
+    engine->debugList = NULL;
+    PublishFrameSnapshot(snapshot);
 
+    // This thread's scratch, the render thread resets its own after every submit
+    ResetThreadArena();
+
+    glfwPollEvents();
+}
+
+void submit(FrameSnapshot *snapshot) {
+    PROFILE_ZONE("submit");
+
+    static int appliedVSync = -1;
+    static int framebufferWidth = ENGINE_SCREEN_WIDTH, framebufferHeight = ENGINE_SCREEN_HEIGHT;
+
+    // No surface to swap without a window, so no swap interval either
+    if ((int)snapshot->vSync != appliedVSync && engine->headlessTarget == NULL) {
+        glfwSwapInterval(snapshot->vSync ? 1 : 0);
+        appliedVSync = (int)snapshot->vSync;
+    }
+
+    // Resizes are picked up here rather than in the callback, which runs on the main thread without the context
+    bool resized = snapshot->framebufferWidth != framebufferWidth || snapshot->framebufferHeight != framebufferHeight;
+
+    if (resized && snapshot->framebufferWidth > 0 && snapshot->framebufferHeight > 0) {
+        framebufferWidth = snapshot->framebufferWidth;
+        framebufferHeight = snapshot->framebufferHeight;
+
+        glViewport(0, 0, framebufferWidth, framebufferHeight);
+        ResizeHeadlessTarget(engine->headlessTarget, framebufferWidth, framebufferHeight);
+
+        if (snapshot->antiAliasing && antiAlias != NULL) {
+            UnbindFrameBufferObj(antiAlias);  // Clean up the old framebuffer
+
+            antiAlias = BindFrameBuffer((FrameBufferObject){
+                .bufferWidth = framebufferWidth,
+                .bufferHeight = framebufferHeight});  // Recreate framebuffer with new dimensions
+        }
+    }
+
+    ProfileGpuFrameBegin();
+
+    // Streamed assets, a slice at a time so a big one spreads over frames instead of stalling one
+    ProcessGpuUploads(ENGINE_UPLOAD_BUDGET_BYTES);
+
+    UploadFrameUniforms(&snapshot->uniforms);
+    InstanceRingBegin(engine->instanceRing);
+    DebugDrawBegin(engine->debugDraw);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, engine->outputFramebuffer);
     glClearColor(ENGINE_BACKGROUND_COLOR);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-    glEnable(GL_DEPTH_TEST);
+    StateEnable(GL_DEPTH_TEST);
 
-    if (engine->antiAliasing) {
+    if (snapshot->antiAliasing) {
         glBindFramebuffer(GL_FRAMEBUFFER, antiAlias->frameBufferID);
         glClearColor(ENGINE_BACKGROUND_COLOR);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-        glEnable(GL_DEPTH_TEST);
+        StateEnable(GL_DEPTH_TEST);
     }
 
-    if (engine->wireframeMode) {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+    PickBuffer *pick = engine->pickBuffer;
+    pick->cursor = snapshot->cursor;
+    pick->windowWidth = snapshot->windowWidth;
+    pick->windowHeight = snapshot->windowHeight;
+    pick->framebufferWidth = framebufferWidth;
+    pick->framebufferHeight = framebufferHeight;
+
+    PickBufferBegin(pick, antiAlias);
+
+    if (snapshot->wireframe) {
+        StatePolygonMode(GL_LINE);
     } else {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        StatePolygonMode(GL_FILL);
     }
 
-    if (engine->skybox != NULL) {
-        engine->skybox->draw(engine->skybox);
+    if (snapshot->skybox != NULL) {
+        PROFILE_GPU_ZONE("Skybox");
+        snapshot->skybox->draw(snapshot->skybox);
     }
 
-    foreach (SceneObject *object, engine->sceneObjects) {
-        if (!ObjectExists(object)) continue;
-        if (object->type == OBJECT_FRAMEBUFFER_QUAD) continue;
-        // if (!ObjectInFrustum(camera, object->transforms->position, object->transforms->scale.x)) continue;
+    // Only the sorted scene carries IDs, the skybox & overlays never become pickable
+    {
+        PROFILE_GPU_ZONE("Scene");
 
-        object->draw(object);
+        PickBufferWriteIDs(pick, antiAlias, GLFW_TRUE);
+        RenderQueueSubmit(snapshot->queue);
+        PickBufferWriteIDs(pick, antiAlias, GLFW_FALSE);
     }
 
-    foreach (Model3D *model, engine->models) {
-        if (!ModelExists(model)) continue;
-        // if (!ObjectInFrustum(camera, model->transforms->position, model->transforms->scale.x)) continue;
+    {
+        PROFILE_GPU_ZONE("Pick readback");
+        PickBufferRead(pick, antiAlias);
+    }
+
+    snapshot->pickedObject = pick->object;
+    snapshot->pickedModel = pick->model;
+    snapshot->pickValid = GetPickingMode() == PICKING_GPU;
 
-        model->draw(model);
+    {
+        PROFILE_GPU_ZONE("Debug draw");
+
+        DebugDrawUpload(engine->debugDraw, &snapshot->debug);
+        DebugDrawFlush(engine->debugDraw, debugShader, (float)framebufferWidth, (float)framebufferHeight);
     }
 
-    if (menu != NULL) {
-        DrawElement(button, NULL);
+    {
+        PROFILE_GPU_ZONE("UI");
 
-        DrawElement(fpstextBox, lambda(void, (void), {
-                        sprintf(fpstextBox->text, "%.1f", engine->fps);
-                    }));
+        for (int i = 0; i < snapshot->elementCount; i++) {
+            DrawElement(&snapshot->elements[i], &snapshot->ui, NULL);
+        }
 
-        DrawElement(coordinatestextBox, lambda(void, (void), {
-                        sprintf(coordinatestextBox->text, "X: %.2f, Y: %.2f, Z: %.2f", camera->position.x, camera->position.y, camera->position.z);
-                    }));
+        if (snapshot->profilerOverlay) {
+            DrawProfilerOverlay(&snapshot->ui);
+        }
     }
 
-    if (engine->antiAliasing) {
+    if (snapshot->antiAliasing) {
+        PROFILE_GPU_ZONE("AA resolve");
         antiAlias->drawBuffer(antiAlias);
     }
 
-    glfwSwapBuffers(engine->window);
-    glfwPollEvents();
-}
\ No newline at end of file
+    InstanceRingEnd(engine->instanceRing);
+    EndStateCacheFrame();
+
+    GLenum error;
+    while ((error = glGetError()) != GL_NO_ERROR) {
+        fprintf(stderr, "[FATAL ERROR] => OpenGL error: %d\n", error);
+    }
+
+    if (engine->headlessTarget == NULL) {
+        glfwSwapBuffers(engine->window);
+    } else {
+        // Nothing waits on a swap, keep the CPU from queueing frames faster than the GPU finishes them
+        glFinish();
+    }
+
+    // Nothing the render thread allocated for this frame survives past here
+    ResetThreadArena();
+}
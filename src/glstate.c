@@ -0,0 +1,197 @@
+#include "glstate.h"
+
+StateCache *stateCache;
+
+void InitStateCache(void) {
+    if (stateCache == NULL) {
+        stateCache = (StateCache *)malloc(sizeof(StateCache));
+    }
+
+    if (stateCache == NULL) {
+        fprintf(stderr, "[INIT MEMORY ERROR] Failed to allocate memory for State Cache\n");
+        exit(EXIT_FAILURE);
+    }
+
+    *stateCache = (StateCache){0};
+    InvalidateStateCache();
+}
+
+void FreeStateCache(void) {
+    free(stateCache);
+    stateCache = NULL;
+}
+
+void InvalidateStateCache(void) {
+    stateCache->known = 0;
+
+    for (int i = 0; i < ENGINE_MAX_TEXTURE_UNITS; i++) {
+        stateCache->textureKnown[i] = 0;
+    }
+}
+
+void EndStateCacheFrame(void) {
+    stateCache->lastFrame = stateCache->frame;
+    stateCache->frame = (StateCacheStats){0};
+}
+
+/* True when the call has to reach the driver, updates the counters either way */
+static inline bool StateChanged(unsigned int bit, bool matches) {
+    if ((stateCache->known & bit) && matches) {
+        stateCache->frame.filtered++;
+        return GLFW_FALSE;
+    }
+
+    stateCache->known |= bit;
+    stateCache->frame.issued++;
+    return GLFW_TRUE;
+}
+
+void StateUseProgram(GLuint program) {
+    if (StateChanged(STATE_KNOWN_PROGRAM, stateCache->program == program)) {
+        stateCache->program = program;
+        glUseProgram(program);
+    }
+}
+
+void StateBindVertexArray(GLuint vertexArray) {
+    if (StateChanged(STATE_KNOWN_VERTEX_ARRAY, stateCache->vertexArray == vertexArray)) {
+        stateCache->vertexArray = vertexArray;
+        glBindVertexArray(vertexArray);
+    }
+}
+
+static inline int TextureTargetIndex(GLenum target) {
+    switch (target) {
+        case GL_TEXTURE_2D:
+            return STATE_TEXTURE_2D;
+        case GL_TEXTURE_CUBE_MAP:
+            return STATE_TEXTURE_CUBE_MAP;
+        case GL_TEXTURE_2D_MULTISAMPLE:
+            return STATE_TEXTURE_2D_MULTISAMPLE;
+        default:
+            return -1;
+    }
+}
+
+void StateBindTexture(GLuint unit, GLenum target, GLuint texture) {
+    if (StateChanged(STATE_KNOWN_ACTIVE_TEXTURE, stateCache->activeTexture == unit)) {
+        stateCache->activeTexture = unit;
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+
+    int index = TextureTargetIndex(target);
+    if (index < 0 || unit >= ENGINE_MAX_TEXTURE_UNITS) {
+        stateCache->frame.issued++;
+        glBindTexture(target, texture);
+        return;
+    }
+
+    unsigned int bit = 1u << index;
+    if ((stateCache->textureKnown[unit] & bit) && stateCache->textures[unit][index] == texture) {
+        stateCache->frame.filtered++;
+        return;
+    }
+
+    stateCache->textureKnown[unit] |= bit;
+    stateCache->textures[unit][index] = texture;
+    stateCache->frame.issued++;
+    glBindTexture(target, texture);
+}
+
+static void SetCapability(GLenum cap, bool enabled) {
+    unsigned int bit;
+    bool *current;
+
+    switch (cap) {
+        case GL_BLEND:
+            bit = STATE_KNOWN_BLEND;
+            current = &stateCache->blend;
+            break;
+        case GL_DEPTH_TEST:
+            bit = STATE_KNOWN_DEPTH_TEST;
+            current = &stateCache->depthTest;
+            break;
+        case GL_CULL_FACE:
+            bit = STATE_KNOWN_CULL_FACE;
+            current = &stateCache->cullFace;
+            break;
+        case GL_LINE_SMOOTH:
+            bit = STATE_KNOWN_LINE_SMOOTH;
+            current = &stateCache->lineSmooth;
+            break;
+        default:
+            stateCache->frame.issued++;
+            (enabled) ? glEnable(cap) : glDisable(cap);
+            return;
+    }
+
+    if (StateChanged(bit, *current == enabled)) {
+        *current = enabled;
+        (enabled) ? glEnable(cap) : glDisable(cap);
+    }
+}
+
+void StateEnable(GLenum cap) {
+    SetCapability(cap, GLFW_TRUE);
+}
+
+void StateDisable(GLenum cap) {
+    SetCapability(cap, GLFW_FALSE);
+}
+
+bool StateIsEnabled(GLenum cap) {
+    switch (cap) {
+        case GL_BLEND:
+            if (stateCache->known & STATE_KNOWN_BLEND) return stateCache->blend;
+            break;
+        case GL_DEPTH_TEST:
+            if (stateCache->known & STATE_KNOWN_DEPTH_TEST) return stateCache->depthTest;
+            break;
+        case GL_CULL_FACE:
+            if (stateCache->known & STATE_KNOWN_CULL_FACE) return stateCache->cullFace;
+            break;
+        case GL_LINE_SMOOTH:
+            if (stateCache->known & STATE_KNOWN_LINE_SMOOTH) return stateCache->lineSmooth;
+            break;
+        default:
+            break;
+    }
+
+    return glIsEnabled(cap) == GL_TRUE;
+}
+
+void StateBlendFunc(GLenum src, GLenum dst) {
+    if (StateChanged(STATE_KNOWN_BLEND_FUNC, stateCache->blendSrc == src && stateCache->blendDst == dst)) {
+        stateCache->blendSrc = src;
+        stateCache->blendDst = dst;
+        glBlendFunc(src, dst);
+    }
+}
+
+void StateDepthFunc(GLenum func) {
+    if (StateChanged(STATE_KNOWN_DEPTH_FUNC, stateCache->depthFunc == func)) {
+        stateCache->depthFunc = func;
+        glDepthFunc(func);
+    }
+}
+
+void StateCullFace(GLenum mode) {
+    if (StateChanged(STATE_KNOWN_CULL_MODE, stateCache->cullMode == mode)) {
+        stateCache->cullMode = mode;
+        glCullFace(mode);
+    }
+}
+
+void StatePolygonMode(GLenum mode) {
+    if (StateChanged(STATE_KNOWN_POLYGON_MODE, stateCache->polygonMode == mode)) {
+        stateCache->polygonMode = mode;
+        glPolygonMode(GL_FRONT_AND_BACK, mode);
+    }
+}
+
+void StateLineWidth(float width) {
+    if (StateChanged(STATE_KNOWN_LINE_WIDTH, stateCache->lineWidth == width)) {
+        stateCache->lineWidth = width;
+        glLineWidth(width);
+    }
+}
@@ -0,0 +1,89 @@
+#include "headless.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+void HeadlessInitHints(void) {
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+}
+
+static GLFWwindow *TryContext(int width, int height, int api, const char *name) {
+    glfwDefaultWindowHints();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, ENGINE_HEADLESS_GL_MINOR);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, api);
+
+    GLFWwindow *window = glfwCreateWindow(width, height, "Prototype Engine (headless)", NULL, NULL);
+
+    if (window != NULL) {
+        printf("[TAV ENGINE] => Headless %dx%d, %s context\n", width, height, name);
+    } else {
+        fprintf(stderr, "[HEADLESS ERROR] No %s context\n", name);
+    }
+
+    return window;
+}
+
+GLFWwindow *CreateHeadlessWindow(int width, int height) {
+    GLFWwindow *window = TryContext(width, height, GLFW_EGL_CONTEXT_API, "surfaceless EGL");
+
+    if (window == NULL) {
+        window = TryContext(width, height, GLFW_OSMESA_CONTEXT_API, "OSMesa");
+    }
+
+    return window;
+}
+
+static void AllocHeadlessStorage(HeadlessTarget *target, int width, int height) {
+    target->width = width;
+    target->height = height;
+
+    glBindRenderbuffer(GL_RENDERBUFFER, target->color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, target->depthStencil);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+}
+
+HeadlessTarget *NewHeadlessTarget(int width, int height) {
+    HeadlessTarget *target = (HeadlessTarget *)malloc(sizeof(HeadlessTarget));
+    if (target == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed creating new Headless Target, ERROR ALLOCATING MEMORY\n");
+        return NULL;
+    }
+
+    *target = (HeadlessTarget){0};
+
+    glGenRenderbuffers(1, &target->color);
+    glGenRenderbuffers(1, &target->depthStencil);
+    AllocHeadlessStorage(target, width, height);
+
+    glGenFramebuffers(1, &target->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target->color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, target->depthStencil);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "[HEADLESS ERROR] Offscreen framebuffer is not complete\n");
+    }
+
+    return target;
+}
+
+void ResizeHeadlessTarget(HeadlessTarget *target, int width, int height) {
+    if (target == NULL || (target->width == width && target->height == height)) return;
+
+    // Same names, so the framebuffer keeps its attachments
+    AllocHeadlessStorage(target, width, height);
+}
+
+void FreeHeadlessTarget(HeadlessTarget *target) {
+    if (target == NULL) return;
+
+    glDeleteFramebuffers(1, &target->framebuffer);
+    glDeleteRenderbuffers(1, &target->color);
+    glDeleteRenderbuffers(1, &target->depthStencil);
+    free(target);
+}
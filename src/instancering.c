@@ -0,0 +1,141 @@
+#include "instancering.h"
+
+#include <string.h>
+
+#include "render.h"
+#include "transformbatch.h"
+
+InstanceRing *NewInstanceRing(int capacity) {
+    InstanceRing *ring = (InstanceRing *)malloc(sizeof(InstanceRing));
+    if (ring == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed creating new Instance Ring, ERROR ALLOCATING MEMORY\n");
+        return NULL;
+    }
+
+    if (capacity < 1) capacity = ENGINE_MAX_INSTANCES_PER_FRAME;
+
+    *ring = (InstanceRing){0};
+    ring->capacity = capacity;
+
+    GLsizeiptr size = (GLsizeiptr)capacity * ENGINE_INSTANCE_RING_FRAMES * sizeof(mat4s);
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glGenBuffers(1, &ring->buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, ring->buffer);
+    glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+    ring->mapped = (mat4s *)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (ring->mapped == NULL) {
+        fprintf(stderr, "[INSTANCE RING ERROR] Failed mapping %lld bytes of instance storage\n", (long long)size);
+        FreeInstanceRing(ring);
+        return NULL;
+    }
+
+    return ring;
+}
+
+void FreeInstanceRing(InstanceRing *ring) {
+    if (ring == NULL) return;
+
+    for (int i = 0; i < ENGINE_INSTANCE_RING_FRAMES; i++) {
+        if (ring->fences[i] != NULL) glDeleteSync(ring->fences[i]);
+    }
+
+    if (ring->buffer != 0) {
+        if (ring->mapped != NULL) {
+            glBindBuffer(GL_ARRAY_BUFFER, ring->buffer);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+
+        glDeleteBuffers(1, &ring->buffer);
+    }
+
+    free(ring);
+}
+
+void InstanceRingBegin(InstanceRing *ring) {
+    GLsync fence = ring->fences[ring->region];
+
+    if (fence != NULL) {
+        // Only blocks when the CPU is ENGINE_INSTANCE_RING_FRAMES frames ahead of the GPU
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        for (;;) {
+            GLenum result = glClientWaitSync(fence, flags, 1000000);
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) break;
+            if (result == GL_WAIT_FAILED) {
+                fprintf(stderr, "[INSTANCE RING ERROR] Waiting on region %d failed\n", ring->region);
+                break;
+            }
+            flags = 0;
+        }
+
+        glDeleteSync(fence);
+        ring->fences[ring->region] = NULL;
+    }
+
+    ring->used = 0;
+}
+
+void InstanceRingEnd(InstanceRing *ring) {
+    ring->fences[ring->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ring->lastUsed = ring->used;
+
+    ring->region = (ring->region + 1) % ENGINE_INSTANCE_RING_FRAMES;
+}
+
+/* Base instance of 'count' free matrices in the current region, -1 when it is full */
+static int ReserveInstances(InstanceRing *ring, int count) {
+    if (ring->used + count > ring->capacity) {
+        if (ring->overflows++ == 0) {
+            fprintf(stderr, "[INSTANCE RING ERROR] More than %d instances this frame, raise ENGINE_MAX_INSTANCES_PER_FRAME\n", ring->capacity);
+        }
+        return -1;
+    }
+
+    int baseInstance = ring->region * ring->capacity + ring->used;
+    ring->used += count;
+
+    return baseInstance;
+}
+
+int WriteInstanceMatrices(InstanceRing *ring, Transform *transforms, int count) {
+    int baseInstance = ReserveInstances(ring, count);
+    if (baseInstance < 0) return -1;
+
+    mat4s *matrices = ring->mapped + baseInstance;
+
+    // Only dirty transforms get recomposed, in one SIMD batch when there are enough of them,
+    // everything else is a straight copy of the cached matrix
+    UpdateDirtyTransforms(transforms, count);
+
+    for (int i = 0; i < count; i++) {
+        matrices[i] = *GetTransformMatrix(&transforms[i]);
+    }
+
+    return baseInstance;
+}
+
+int WriteInstanceBlock(InstanceRing *ring, const mat4s *matrices, int count) {
+    if (count <= 0) return -1;
+
+    int baseInstance = ReserveInstances(ring, count);
+    if (baseInstance < 0) return -1;
+
+    memcpy(ring->mapped + baseInstance, matrices, (size_t)count * sizeof(mat4s));
+    return baseInstance;
+}
+
+void BindInstanceAttributes(InstanceRing *ring) {
+    glBindBuffer(GL_ARRAY_BUFFER, ring->buffer);
+
+    // A mat4 attribute takes four consecutive locations, one column each
+    for (int i = 0; i < 4; i++) {
+        GLuint location = ENGINE_INSTANCE_ATTRIBUTE_LOCATION + i;
+
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(mat4s), (void *)(i * sizeof(vec4s)));
+        glVertexAttribDivisor(location, 1);
+    }
+}
@@ -0,0 +1,621 @@
+#include "jobs.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "arena.h"
+#include "engine.h"
+#include "profiler.h"
+
+/* Idle rounds of looking for work before a worker goes to sleep */
+#define JOB_IDLE_SPINS 64
+#define JOB_CHUNK_SIZE 256
+
+typedef struct Job {
+    JobFunction function;
+    void *data;
+    JobCounter *counter;
+
+    struct Job *next;   // free list & injection queue link
+    struct Job *batch;  // next batch of the shared pool, on a batch's first node
+} Job;
+
+/*
+ -> Chase-Lev deque over a fixed ring (Lê et al., "Correct and Efficient Work-Stealing for Weak Memory Models").
+ -> Only the owner touches 'bottom', thieves race on 'top' with a CAS. A full deque sends jobs to the injection queue.
+*/
+typedef struct JobDeque {
+    long long top;
+    char padding[64 - sizeof(long long)];  // thieves hammer 'top', keep it off the owner's line
+    long long bottom;
+
+    Job *buffer[ENGINE_JOB_DEQUE_SIZE];
+} JobDeque;
+
+typedef struct JobChunk {
+    struct JobChunk *next;
+    Job jobs[JOB_CHUNK_SIZE];
+} JobChunk;
+
+static pthread_t *workers;
+static JobDeque *deques;  // one per pool thread, index 0 belongs to the thread that called #InitJobSystem()
+static int threadCount;
+static bool running, stopping;
+
+static _Thread_local int threadIndex = -1;
+static _Thread_local unsigned int stealSeed;
+
+/* Jobs pushed but not taken yet, workers only sleep while this is 0 */
+static int pendingJobs;
+static int sleepers;
+static pthread_mutex_t sleepLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sleepWake = PTHREAD_COND_INITIALIZER;
+
+static pthread_mutex_t injectionLock = PTHREAD_MUTEX_INITIALIZER;
+static Job *injectionHead, *injectionTail;
+
+/*
+ -> Job nodes come from shared chunks & are recycled through a free list per thread, no locking after warm up.
+ -> The thread that finishes a job keeps its node, so lists only fill up on threads that run jobs. Past two chunks'
+    worth a thread hands a batch of JOB_CHUNK_SIZE to the shared pool, & a thread that runs out takes a batch back
+    before allocating a new chunk. A thread that only submits (scheduler, render thread) lives off returned batches.
+*/
+static pthread_mutex_t chunkLock = PTHREAD_MUTEX_INITIALIZER;
+static JobChunk *chunks;
+static int chunkCount;
+static int chunkGeneration;
+static Job *freeBatches;  // guarded by 'chunkLock'
+
+static _Thread_local Job *freeJobs;
+static _Thread_local int freeCount;
+static _Thread_local int freeGeneration;
+
+static int CountCores(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return (cores > 0) ? (int)cores : 1;
+#endif
+}
+
+/* Lists from before the last shutdown point into freed chunks */
+static void DropStaleJobs(void) {
+    if (freeGeneration != __atomic_load_n(&chunkGeneration, __ATOMIC_ACQUIRE)) {
+        freeJobs = NULL;
+        freeCount = 0;
+        freeGeneration = __atomic_load_n(&chunkGeneration, __ATOMIC_ACQUIRE);
+    }
+}
+
+static Job *AllocJob(void) {
+    DropStaleJobs();
+
+    if (freeJobs == NULL) {
+        pthread_mutex_lock(&chunkLock);
+
+        if (freeBatches != NULL) {
+            freeJobs = freeBatches;
+            freeBatches = freeBatches->batch;
+            freeCount = JOB_CHUNK_SIZE;
+        }
+
+        pthread_mutex_unlock(&chunkLock);
+    }
+
+    if (freeJobs == NULL) {
+        JobChunk *chunk = (JobChunk *)malloc(sizeof(JobChunk));
+        if (chunk == NULL) {
+            fprintf(stderr, "[MEMORY ERROR] Failed allocating %d jobs, ERROR ALLOCATING MEMORY\n", JOB_CHUNK_SIZE);
+            return NULL;
+        }
+
+        pthread_mutex_lock(&chunkLock);
+        chunk->next = chunks;
+        chunks = chunk;
+        chunkCount++;
+        pthread_mutex_unlock(&chunkLock);
+
+        for (int i = 0; i < JOB_CHUNK_SIZE; i++) {
+            chunk->jobs[i].next = (i + 1 < JOB_CHUNK_SIZE) ? &chunk->jobs[i + 1] : NULL;
+        }
+
+        freeJobs = &chunk->jobs[0];
+        freeCount = JOB_CHUNK_SIZE;
+    }
+
+    Job *job = freeJobs;
+    freeJobs = job->next;
+    freeCount--;
+    return job;
+}
+
+/* Into the finishing thread's list, a full batch goes back to the shared pool once that list holds two */
+static void ReleaseJob(Job *job) {
+    DropStaleJobs();
+
+    job->next = freeJobs;
+    freeJobs = job;
+
+    if (++freeCount < 2 * JOB_CHUNK_SIZE) return;
+
+    Job *batch = freeJobs;
+    Job *last = batch;
+    for (int i = 1; i < JOB_CHUNK_SIZE; i++) last = last->next;
+
+    freeJobs = last->next;
+    freeCount -= JOB_CHUNK_SIZE;
+    last->next = NULL;
+
+    pthread_mutex_lock(&chunkLock);
+    batch->batch = freeBatches;
+    freeBatches = batch;
+    pthread_mutex_unlock(&chunkLock);
+}
+
+static bool PushDeque(JobDeque *deque, Job *job) {
+    long long bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+    long long top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+
+    if (bottom - top >= ENGINE_JOB_DEQUE_SIZE) return false;
+
+    __atomic_store_n(&deque->buffer[bottom & (ENGINE_JOB_DEQUE_SIZE - 1)], job, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+
+    return true;
+}
+
+static Job *TakeDeque(JobDeque *deque) {
+    long long bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long long top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+
+    if (top > bottom) {
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    Job *job = __atomic_load_n(&deque->buffer[bottom & (ENGINE_JOB_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+
+    // Last job, a thief may be after the same one
+    if (top == bottom) {
+        if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            job = NULL;
+        }
+
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    }
+
+    return job;
+}
+
+static Job *StealDeque(JobDeque *deque) {
+    long long top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long long bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+
+    if (top >= bottom) return NULL;
+
+    Job *job = __atomic_load_n(&deque->buffer[top & (ENGINE_JOB_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+
+    // Lost the race to the owner or another thief, the caller just moves on
+    if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        return NULL;
+    }
+
+    return job;
+}
+
+static void PushInjection(Job *job) {
+    job->next = NULL;
+
+    pthread_mutex_lock(&injectionLock);
+
+    if (injectionTail != NULL) {
+        injectionTail->next = job;
+    } else {
+        __atomic_store_n(&injectionHead, job, __ATOMIC_RELEASE);
+    }
+    injectionTail = job;
+
+    pthread_mutex_unlock(&injectionLock);
+}
+
+static Job *PopInjection(void) {
+    // Unlocked peek, the queue is empty nearly all the time
+    if (__atomic_load_n(&injectionHead, __ATOMIC_ACQUIRE) == NULL) return NULL;
+
+    pthread_mutex_lock(&injectionLock);
+
+    Job *job = injectionHead;
+    if (job != NULL) {
+        __atomic_store_n(&injectionHead, job->next, __ATOMIC_RELEASE);
+        if (injectionHead == NULL) injectionTail = NULL;
+    }
+
+    pthread_mutex_unlock(&injectionLock);
+    return job;
+}
+
+static Job *FindJob(void) {
+    Job *job = NULL;
+
+    if (threadIndex >= 0) job = TakeDeque(&deques[threadIndex]);
+    if (job == NULL) job = PopInjection();
+
+    // Start at a random victim so thieves spread out instead of all hitting deque 0
+    if (job == NULL && threadCount > 1) {
+        stealSeed = stealSeed * 1664525u + 1013904223u;
+        int first = (int)((stealSeed >> 8) % (unsigned int)threadCount);
+
+        for (int n = 0; n < threadCount && job == NULL; n++) {
+            int victim = (first + n) % threadCount;
+            if (victim != threadIndex) job = StealDeque(&deques[victim]);
+        }
+    }
+
+    if (job != NULL) __atomic_sub_fetch(&pendingJobs, 1, __ATOMIC_RELAXED);
+    return job;
+}
+
+static void ExecuteJob(Job *job) {
+    PROFILE_ZONE("Job");
+
+    JobCounter *counter = job->counter;
+
+    job->function(job->data);
+    ReleaseJob(job);
+
+    if (counter != NULL) __atomic_sub_fetch(&counter->pending, 1, __ATOMIC_RELEASE);
+}
+
+static void *JobWorker(void *argument) {
+    threadIndex = (int)(size_t)argument;
+    stealSeed = 0x9E3779B9u * (unsigned int)(threadIndex + 1);
+
+    char name[32];
+    snprintf(name, sizeof(name), "Job worker %d", threadIndex);
+    ProfilerSetThreadName(name);
+
+    int idle = 0;
+
+    for (;;) {
+        Job *job = FindJob();
+
+        if (job != NULL) {
+            ExecuteJob(job);
+            idle = 0;
+
+            // Out of every job, nothing holds scratch: heap fallbacks of rewound scopes go instead of piling up
+            ResetThreadArena();
+            continue;
+        }
+
+        if (__atomic_load_n(&stopping, __ATOMIC_ACQUIRE) && __atomic_load_n(&pendingJobs, __ATOMIC_SEQ_CST) == 0) break;
+
+        if (++idle < JOB_IDLE_SPINS) {
+            sched_yield();
+            continue;
+        }
+
+        // Pairs with #RunJob(): it bumps 'pendingJobs' then checks 'sleepers', this bumps 'sleepers' then checks 'pendingJobs'
+        pthread_mutex_lock(&sleepLock);
+        __atomic_add_fetch(&sleepers, 1, __ATOMIC_SEQ_CST);
+
+        while (__atomic_load_n(&pendingJobs, __ATOMIC_SEQ_CST) == 0 && !__atomic_load_n(&stopping, __ATOMIC_ACQUIRE)) {
+            pthread_cond_wait(&sleepWake, &sleepLock);
+        }
+
+        __atomic_sub_fetch(&sleepers, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&sleepLock);
+
+        idle = 0;
+    }
+
+    FreeThreadArena();
+    return NULL;
+}
+
+void InitJobSystem(int workerCount) {
+    if (running) return;
+
+    // At least one worker even on a single core, background jobs (timers, builds) must progress while nobody waits
+    if (workerCount <= 0) workerCount = CountCores() - 1;
+    if (workerCount < 1) workerCount = 1;
+
+    threadCount = workerCount + 1;
+    deques = (JobDeque *)calloc((size_t)threadCount, sizeof(JobDeque));
+    workers = (pthread_t *)malloc((size_t)(workerCount > 0 ? workerCount : 1) * sizeof(pthread_t));
+
+    if (deques == NULL || workers == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed creating the job system, ERROR ALLOCATING MEMORY\n");
+        free(deques);
+        free(workers);
+        deques = NULL;
+        workers = NULL;
+        threadCount = 0;
+        return;
+    }
+
+    threadIndex = 0;
+    stealSeed = 0x9E3779B9u;
+    stopping = false;
+    running = true;
+
+    for (int i = 0; i < workerCount; i++) {
+        if (pthread_create(&workers[i], NULL, JobWorker, (void *)(size_t)(i + 1)) != 0) {
+            fprintf(stderr, "[JOBS ERROR] Failed starting worker %d, running with %d threads\n", i + 1, i + 1);
+
+            // Deques past the started workers stay empty, nobody pushes to them
+            threadCount = i + 1;
+            break;
+        }
+    }
+
+    printf("[TAV ENGINE] Job system running on %d threads\n", threadCount);
+}
+
+void ShutdownJobSystem(void) {
+    if (!running) return;
+
+    pthread_mutex_lock(&sleepLock);
+    __atomic_store_n(&stopping, true, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&sleepWake);
+    pthread_mutex_unlock(&sleepLock);
+
+    // Help drain whatever is left, the workers leave once nothing is pending
+    Job *job;
+    while ((job = FindJob()) != NULL) {
+        ExecuteJob(job);
+    }
+
+    for (int i = 0; i < threadCount - 1; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    running = false;
+    threadIndex = -1;
+
+    pthread_mutex_lock(&chunkLock);
+    while (chunks != NULL) {
+        JobChunk *next = chunks->next;
+        free(chunks);
+        chunks = next;
+    }
+    chunkCount = 0;
+    freeBatches = NULL;
+    __atomic_add_fetch(&chunkGeneration, 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&chunkLock);
+
+    free(deques);
+    free(workers);
+    deques = NULL;
+    workers = NULL;
+    threadCount = 0;
+}
+
+bool IsJobSystemStopping(void) {
+    return __atomic_load_n(&stopping, __ATOMIC_ACQUIRE);
+}
+
+int GetJobThreadCount(void) {
+    return running ? threadCount : 1;
+}
+
+int GetJobThreadIndex(void) {
+    return threadIndex;
+}
+
+void RunJob(JobFunction function, void *data, JobCounter *counter) {
+    if (!running) {
+        function(data);
+        return;
+    }
+
+    Job *job = AllocJob();
+    if (job == NULL) {
+        function(data);
+        return;
+    }
+
+    *job = (Job){.function = function, .data = data, .counter = counter};
+
+    // Counted before it becomes visible, so neither a waiter nor a taker ever sees it missing from the totals
+    if (counter != NULL) __atomic_add_fetch(&counter->pending, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&pendingJobs, 1, __ATOMIC_SEQ_CST);
+
+    if (threadIndex < 0 || !PushDeque(&deques[threadIndex], job)) {
+        PushInjection(job);
+    }
+
+    if (__atomic_load_n(&sleepers, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&sleepLock);
+        pthread_cond_signal(&sleepWake);
+        pthread_mutex_unlock(&sleepLock);
+    }
+}
+
+void WaitForCounter(JobCounter *counter) {
+    int idle = 0;
+
+    while (!JobCounterDone(counter)) {
+        // Jobs that were queued before a shutdown never run, don't wait on them forever
+        if (!running) return;
+
+        Job *job = FindJob();
+
+        if (job != NULL) {
+            ExecuteJob(job);
+            idle = 0;
+        } else if (++idle >= JOB_IDLE_SPINS) {
+            sched_yield();
+        }
+    }
+}
+
+typedef struct ParallelForState {
+    JobRangeFunction function;
+    void *data;
+    int count, batch;
+    int next;  // atomic, start of the next unclaimed range
+} ParallelForState;
+
+/* Every helper claims ranges until none are left, so a slow thread never holds up a fixed share */
+static void RunParallelRanges(void *argument) {
+    ParallelForState *state = (ParallelForState *)argument;
+
+    for (;;) {
+        int start = __atomic_fetch_add(&state->next, state->batch, __ATOMIC_RELAXED);
+        if (start >= state->count) break;
+
+        int end = (start + state->batch < state->count) ? start + state->batch : state->count;
+        state->function(state->data, start, end);
+    }
+}
+
+void ParallelFor(int count, int batch, JobRangeFunction function, void *data) {
+    if (count <= 0) return;
+    if (batch < 1) batch = 1;
+
+    int ranges = (count + batch - 1) / batch;
+
+    if (!running || ranges == 1) {
+        function(data, 0, count);
+        return;
+    }
+
+    ParallelForState state = (ParallelForState){.function = function, .data = data, .count = count, .batch = batch};
+    JobCounter counter = (JobCounter){0};
+
+    int helpers = (ranges - 1 < threadCount - 1) ? ranges - 1 : threadCount - 1;
+    for (int i = 0; i < helpers; i++) {
+        RunJob(RunParallelRanges, &state, &counter);
+    }
+
+    RunParallelRanges(&state);
+    WaitForCounter(&counter);
+}
+
+#ifdef ENGINE_SELF_TESTS
+
+typedef struct JobTestState {
+    JobCounter *counter;
+    int *sum;  // atomic
+    int depth;
+} JobTestState;
+
+/* Fans out into two children until 'depth' runs out, every job adds one */
+static void RunTestJob(void *argument) {
+    JobTestState *state = (JobTestState *)argument;
+    __atomic_add_fetch(state->sum, 1, __ATOMIC_RELAXED);
+
+    if (state->depth == 0) return;
+
+    JobTestState *children = (JobTestState *)malloc(2 * sizeof(JobTestState));
+    if (children == NULL) return;
+
+    JobCounter counter = (JobCounter){0};
+
+    for (int i = 0; i < 2; i++) {
+        children[i] = (JobTestState){.counter = &counter, .sum = state->sum, .depth = state->depth - 1};
+        RunJob(RunTestJob, &children[i], &counter);
+    }
+
+    // Waiting inside a job, the thread keeps running others (its children or stolen ones) meanwhile
+    WaitForCounter(&counter);
+    free(children);
+}
+
+static void SumRange(void *data, int start, int end) {
+    long long local = 0;
+    for (int i = start; i < end; i++) local += i;
+
+    __atomic_add_fetch((long long *)data, local, __ATOMIC_RELAXED);
+}
+
+typedef struct SubmitterTestState {
+    int rounds, jobs;
+    int sum;  // atomic
+} SubmitterTestState;
+
+static void CountTestJob(void *argument) {
+    __atomic_add_fetch((int *)argument, 1, __ATOMIC_RELAXED);
+}
+
+/* Outside the pool & never runs a job itself, like the timer scheduler: every node it gets back is finished elsewhere */
+static void *SubmitTestJobs(void *argument) {
+    SubmitterTestState *state = (SubmitterTestState *)argument;
+
+    for (int round = 0; round < state->rounds; round++) {
+        JobCounter counter = (JobCounter){0};
+
+        for (int i = 0; i < state->jobs; i++) {
+            RunJob(CountTestJob, &state->sum, &counter);
+        }
+
+        while (!JobCounterDone(&counter)) sched_yield();
+    }
+
+    return NULL;
+}
+
+bool JobSystemSelfTest(void) {
+    const int depth = 16;  // 2^17 - 1 jobs
+    int sum = 0;
+
+    JobCounter counter = (JobCounter){0};
+    JobTestState root = (JobTestState){.counter = &counter, .sum = &sum, .depth = depth};
+
+    double start = GetTimeSeconds();
+    RunJob(RunTestJob, &root, &counter);
+    WaitForCounter(&counter);
+    double elapsed = GetTimeSeconds() - start;
+
+    int expected = (1 << (depth + 1)) - 1;
+
+    long long total = 0;
+    const int count = 10000000;
+    ParallelFor(count, 65536, SumRange, &total);
+
+    // Nodes recycled to a submit-only thread, the chunk count can't grow with the number of jobs it runs
+    SubmitterTestState submitter = (SubmitterTestState){.rounds = 256, .jobs = 1024};
+
+    pthread_mutex_lock(&chunkLock);
+    int chunksBefore = chunkCount;
+    pthread_mutex_unlock(&chunkLock);
+
+    pthread_t thread;
+    bool submitted = pthread_create(&thread, NULL, SubmitTestJobs, &submitter) == 0;
+    if (submitted) pthread_join(thread, NULL);
+
+    pthread_mutex_lock(&chunkLock);
+    int chunksGrown = chunkCount - chunksBefore;
+    pthread_mutex_unlock(&chunkLock);
+
+    bool bounded = submitted && submitter.sum == submitter.rounds * submitter.jobs &&
+                   chunksGrown <= 2 * threadCount + submitter.jobs / JOB_CHUNK_SIZE + 2;
+
+    bool ok = sum == expected && total == (long long)count * (count - 1) / 2 && bounded;
+
+    printf("[JOBS TEST] %d threads, %d nested jobs in %.2f ms (%.0f ns/job), parallel sum %s: %s\n",
+           GetJobThreadCount(), sum, elapsed * 1000.0, elapsed * 1e9 / expected,
+           (total == (long long)count * (count - 1) / 2) ? "matches" : "differs", ok ? "OK" : "FAILED");
+    printf("[JOBS TEST] %d jobs from a thread outside the pool grew the job chunks by %d: %s\n",
+           submitter.rounds * submitter.jobs, chunksGrown, bounded ? "OK" : "FAILED");
+
+    return ok;
+}
+
+#endif  // ENGINE_SELF_TESTS
@@ -1,13 +1,14 @@
 #include "libtasks.h"
 #include <stdlib.h>
 
+#include "profiler.h"
+
 TaskManager *taskManager;
 
 void InitTaskManager(void) {
   taskManager = (TaskManager *)malloc(sizeof(TaskManager));
 
   taskManager->tasks = (List *)NewList(NULL);
-  taskManager->threads = (List *)NewList(NULL);
 
 #if AT_EXIT_CLEANUP == TRUE
   if (atexit(CleanupTasks) != 0) {
@@ -19,6 +20,35 @@ void InitTaskManager(void) {
 #endif  // AT_EXIT_CLEANUP
 }
 
+/* Interval & delay tasks, called on the job system each time their wheel timer expires */
+static void timed_task_expired(WheelTimer *timer) {
+  PROFILE_ZONE("Timed task");
+  Task *task = (Task *)timer->data;
+
+  task->ticks += 1;
+  task->data.retVal = task->callback(task);
+
+#if DEBUG_MODE == true
+  printf("Task of type: %d ran, ticks: %d\n", task->type, task->ticks);
+#endif  // DEBUG_MODE
+}
+
+/* One pass of a default task, queued again after every run so the pool interleaves it with other work.
+   Not once the pool shuts down: its drain would never run out of jobs */
+static void default_task_job(void *argument) {
+  PROFILE_ZONE("Task");
+  Task *task = (Task *)argument;
+  if (__atomic_load_n(&task->isCanceled, __ATOMIC_ACQUIRE)) return;
+
+  task->ticks += 1;
+  task->data.retVal = task->callback(task);
+
+  if (!__atomic_load_n(&task->isCanceled, __ATOMIC_ACQUIRE) &&
+      !IsJobSystemStopping()) {
+    RunJob(default_task_job, task, &task->counter);
+  }
+}
+
 static void task_runner(Task *task) {
   if (task == NULL) {
     printf(
@@ -28,78 +58,36 @@ static void task_runner(Task *task) {
     return;
   }
 
-  if (pthread_create(&task->pid, NULL, NULL, NULL) != 0) {
-    fprintf(stderr,
-            "Thread Creation Exception: Unable to create thread for struct "
-            "'Task *' in library 'libtasks'.\n");
-    free(task);
-  } else {
-    ListAdd(taskManager->threads, &task->pid);
-
-#if DEBUG_MODE == true
-    printf("Created a new thread\n");
-#endif  // DEBUG_MODE
+  // Default tasks are jobs on the shared pool (see jobs.h), no thread of their own
+  if (task->type == TASK_TYPE_DEFAULT) {
+    RunJob(default_task_job, task, &task->counter);
+    return;
   }
 
-  void *retVal = NULL;
-
-  switch (task->type) {
-    case TASK_TYPE_INTERVAL:
-      Timer *intervalTimer = NewTimer(task->timings.interval);
-      StartTimer(intervalTimer);
-
-      while (!task->isCanceled) {
-        if (TimerDone(*intervalTimer)) {
-          StartTimer(intervalTimer);
-
-          task->ticks += 1;
-          retVal = task->callback(task);
-        }
-      }
-
-      break;
-    case TASK_TYPE_DELAY:
-      Timer *delayTimer = NewTimer(task->timings.delay);
-      StartTimer(delayTimer);
-
-      while (!task->isCanceled) {
-        if (TimerDone(*delayTimer)) {
-          task->ticks += 1;
-
-          retVal = task->callback(task);
-          break;
-        }
-      }
-      break;
-    case TASK_TYPE_DEFAULT:
-    default:
-      while (!task->isCanceled) {
-        task->ticks += 1;
-        retVal = task->callback(task);
-      }
-      break;
+  if (task->type == TASK_TYPE_INTERVAL) {
+    StartWheelTimer(&task->timer, (double)task->timings.interval,
+                    (double)task->timings.interval, timed_task_expired, task);
+  } else {
+    StartWheelTimer(&task->timer, (double)task->timings.delay, 0.0,
+                    timed_task_expired, task);
   }
-
-#if DEBUG_MODE == true
-  printf("Task Runner exiting for task with ID: %lu\n", task->pid);
-#endif  // DEBUG_MODE
-
-  task->data.retVal = retVal;
 }
 
 static void cancel(Task *task) {
-  task->isCanceled = true;
+  __atomic_store_n(&task->isCanceled, true, __ATOMIC_RELEASE);
 
 #if DEBUG_MODE == true
-  printf("\n * Cancelling task with id= %lu\n", (unsigned long)task->pid);
+  printf("\n * Cancelling task of type: %d\n", task->type);
 #endif  // DEBUG_MODE
 
-  pthread_cancel(task->pid);
-
-  void *retVal;
-  pthread_join(task->pid, (void **)&retVal);
+  if (task->type == TASK_TYPE_DEFAULT) {
+    // The pass running right now finishes, the one after it sees the flag
+    WaitForCounter(&task->counter);
+    return;
+  }
 
-  if (retVal != NULL) task->data.retVal = retVal;
+  CancelWheelTimer(&task->timer);
+  WaitForWheelTimer(&task->timer);
 }
 
 // Debugging Utility Function
@@ -138,6 +126,8 @@ static Task *create_task(Task *task, TaskType type,
   task->callback = callback;
   task->cancel = cancel;
   task->isCanceled = false;
+  task->timer = (WheelTimer){0};
+  task->counter = (JobCounter){0};
   task->ticks = 0;
 
   if (task->type == TASK_TYPE_INTERVAL) {
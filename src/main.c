@@ -1,26 +1,18 @@
 #include <stdio.h>
 #include "engine.h"
 
-static void debug(void) {
-    GLenum err;
-    while ((err = glGetError()) != GL_NO_ERROR) {
-        fprintf(stderr, "[FATAL ERROR] => OpenGL error: %d\n", err);
-    }
-}
-
 static void loop(void) {
-    debug();
-    
     tick();
     render();
 }
 
-int main(void) {
-    engine = init();
+int main(int argc, char **argv) {
+    engine = init(ParseEngineOptions(argc, argv));
+    if (engine == NULL) return EXIT_FAILURE;
 
-    while (!glfwWindowShouldClose(engine->window)) {
+    while (!ShouldExit()) {
         loop();
     }
 
     return cleanup();
-}
\ No newline at end of file
+}
@@ -0,0 +1,528 @@
+#include "meshbvh.h"
+
+#include <float.h>
+#include "jobs.h"
+#include "render.h"
+#include "utils.h"
+
+#if ENGINE_SIMD_X86
+#include <immintrin.h>
+#endif
+
+/* Below this |det| the ray runs parallel to the triangle's plane (or the triangle is degenerate) */
+#define MESH_BVH_PARALLEL_EPSILON 1e-12f
+/* Every stream is padded so the last leaf can be loaded a whole vector at a time */
+#define MESH_BVH_LANE_PADDING 8
+
+/* Builds in flight, #CancelMeshBVHBuilds() sets 'buildsCanceled' so the queued ones return right away */
+static JobCounter meshBVHBuilds;
+static bool buildsCanceled;
+
+MeshBVH *NewMeshBVH(const Vertex *vertices, int vertexCount, const GLuint *indices, int indexCount) {
+    int triangleCount = indexCount / 3;
+    if (vertices == NULL || indices == NULL || triangleCount < 1) return NULL;
+
+    MeshBVH *meshBVH = (MeshBVH *)malloc(sizeof(MeshBVH));
+    if (meshBVH == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed creating new Mesh BVH, ERROR ALLOCATING MEMORY\n");
+        return NULL;
+    }
+
+    *meshBVH = (MeshBVH){0};
+
+    // One block for all nine streams, zeroed padding is a degenerate triangle no ray hits
+    size_t stride = (size_t)triangleCount + MESH_BVH_LANE_PADDING;
+    float *block = (float *)calloc(stride * 9, sizeof(float));
+    vec3s *mins = (vec3s *)malloc((size_t)triangleCount * sizeof(vec3s));
+    vec3s *maxs = (vec3s *)malloc((size_t)triangleCount * sizeof(vec3s));
+    meshBVH->bvh = NewBVH();
+
+    if (block == NULL || mins == NULL || maxs == NULL || meshBVH->bvh == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed reserving %d triangles for Mesh BVH\n", triangleCount);
+        free(block);
+        free(mins);
+        free(maxs);
+        FreeBVH(meshBVH->bvh);
+        free(meshBVH);
+        return NULL;
+    }
+
+    float **streams[] = {&meshBVH->v0X, &meshBVH->v0Y, &meshBVH->v0Z,
+                         &meshBVH->edge1X, &meshBVH->edge1Y, &meshBVH->edge1Z,
+                         &meshBVH->edge2X, &meshBVH->edge2Y, &meshBVH->edge2Z};
+
+    for (int s = 0; s < 9; s++) {
+        *streams[s] = block + (size_t)s * stride;
+    }
+
+    for (int i = 0; i < triangleCount; i++) {
+        GLuint a = indices[i * 3], b = indices[i * 3 + 1], c = indices[i * 3 + 2];
+
+        // Broken indices become a point at the first vertex, which keeps the triangle numbering intact
+        if (a >= (GLuint)vertexCount || b >= (GLuint)vertexCount || c >= (GLuint)vertexCount) a = b = c = 0;
+
+        vec3s p0 = vertices[a].position, p1 = vertices[b].position, p2 = vertices[c].position;
+
+        mins[i] = glms_vec3_minv(p0, glms_vec3_minv(p1, p2));
+        maxs[i] = glms_vec3_maxv(p0, glms_vec3_maxv(p1, p2));
+    }
+
+    // Leaves are priced in whole kernel batches, so a leaf of 3 costs the same as a leaf of 8 on AVX2
+    SimdLevel level = GetSimdLevel();
+    meshBVH->bvh->maxLeafSize = ENGINE_MESH_BVH_LEAF_SIZE;
+    meshBVH->bvh->leafWidth = (level == SIMD_AVX2) ? 8 : (level == SIMD_SSE) ? 4 : 1;
+
+    BuildBVH(meshBVH->bvh, mins, maxs, triangleCount);
+
+    free(mins);
+    free(maxs);
+
+    // Copy the triangles in leaf order, a leaf's [first, first + count) is then a contiguous run of lanes
+    for (int slot = 0; slot < triangleCount; slot++) {
+        int i = meshBVH->bvh->indices[slot];
+        GLuint a = indices[i * 3], b = indices[i * 3 + 1], c = indices[i * 3 + 2];
+
+        if (a >= (GLuint)vertexCount || b >= (GLuint)vertexCount || c >= (GLuint)vertexCount) a = b = c = 0;
+
+        vec3s p0 = vertices[a].position;
+        vec3s edge1 = glms_vec3_sub(vertices[b].position, p0);
+        vec3s edge2 = glms_vec3_sub(vertices[c].position, p0);
+
+        meshBVH->v0X[slot] = p0.x;
+        meshBVH->v0Y[slot] = p0.y;
+        meshBVH->v0Z[slot] = p0.z;
+        meshBVH->edge1X[slot] = edge1.x;
+        meshBVH->edge1Y[slot] = edge1.y;
+        meshBVH->edge1Z[slot] = edge1.z;
+        meshBVH->edge2X[slot] = edge2.x;
+        meshBVH->edge2Y[slot] = edge2.y;
+        meshBVH->edge2Z[slot] = edge2.z;
+    }
+
+    meshBVH->triangleCount = triangleCount;
+    return meshBVH;
+}
+
+void FreeMeshBVH(MeshBVH *meshBVH) {
+    if (meshBVH == NULL) return;
+
+    FreeBVH(meshBVH->bvh);
+    free(meshBVH->v0X);  // start of the shared block
+    free(meshBVH);
+}
+
+static void BuildMeshBVHJob(void *data) {
+    Mesh *mesh = (Mesh *)data;
+    if (__atomic_load_n(&buildsCanceled, __ATOMIC_RELAXED)) return;
+
+    MeshBVH *built = NewMeshBVH(mesh->vertices, mesh->vertexCount, mesh->indices, mesh->indexCount);
+
+    // Release pairs with #GetMeshBVH()'s acquire, a reader never sees the pointer before the arrays
+    __atomic_store_n(&mesh->bvh, built, __ATOMIC_RELEASE);
+}
+
+void QueueMeshBVH(Mesh *mesh) {
+    if (mesh == NULL || mesh->indexCount < 3) return;
+
+    RunJob(BuildMeshBVHJob, mesh, &meshBVHBuilds);
+}
+
+void CancelMeshBVHBuilds(void) {
+    __atomic_store_n(&buildsCanceled, GLFW_TRUE, __ATOMIC_RELAXED);
+    WaitForCounter(&meshBVHBuilds);
+    __atomic_store_n(&buildsCanceled, GLFW_FALSE, __ATOMIC_RELAXED);
+}
+
+/*
+ -> Möller–Trumbore, u & v are the barycentrics of v1 & v2, a hit needs both in [0, 1] with u + v <= 1.
+ -> The SIMD kernels below do the exact same multiplies & adds in the same order (no FMA),
+    so every level agrees on the distances bit for bit.
+*/
+static int IntersectScalar(const MeshBVH *meshBVH, int first, int count, const Ray *ray, float *best) {
+    float ox = ray->origin.x, oy = ray->origin.y, oz = ray->origin.z;
+    float dx = ray->direction.x, dy = ray->direction.y, dz = ray->direction.z;
+    int closest = -1;
+
+    for (int i = first; i < first + count; i++) {
+        float e1x = meshBVH->edge1X[i], e1y = meshBVH->edge1Y[i], e1z = meshBVH->edge1Z[i];
+        float e2x = meshBVH->edge2X[i], e2y = meshBVH->edge2Y[i], e2z = meshBVH->edge2Z[i];
+
+        float px = dy * e2z - dz * e2y;
+        float py = dz * e2x - dx * e2z;
+        float pz = dx * e2y - dy * e2x;
+
+        float det = e1x * px + e1y * py + e1z * pz;
+        if (!(fabsf(det) > MESH_BVH_PARALLEL_EPSILON)) continue;
+
+        float inverseDet = 1.0f / det;
+        float tx = ox - meshBVH->v0X[i], ty = oy - meshBVH->v0Y[i], tz = oz - meshBVH->v0Z[i];
+
+        float u = (tx * px + ty * py + tz * pz) * inverseDet;
+        if (!(u >= 0.0f && u <= 1.0f)) continue;
+
+        float qx = ty * e1z - tz * e1y;
+        float qy = tz * e1x - tx * e1z;
+        float qz = tx * e1y - ty * e1x;
+
+        float v = (dx * qx + dy * qy + dz * qz) * inverseDet;
+        if (!(v >= 0.0f && u + v <= 1.0f)) continue;
+
+        float t = (e2x * qx + e2y * qy + e2z * qz) * inverseDet;
+        if (!(t >= 0.0f && t < *best)) continue;
+
+        *best = t;
+        closest = i;
+    }
+
+    return closest;
+}
+
+#if ENGINE_SIMD_X86
+
+/* Lanes of 'hits' in order, so ties go to the lowest triangle exactly like the scalar loop */
+static inline int ClosestLane(int hits, const float *t, int base, float *best, int closest) {
+    while (hits != 0) {
+        int lane = __builtin_ctz((unsigned int)hits);
+        hits &= hits - 1;
+
+        if (t[lane] < *best) {
+            *best = t[lane];
+            closest = base + lane;
+        }
+    }
+
+    return closest;
+}
+
+__attribute__((target("sse2"))) static int IntersectSSE(const MeshBVH *meshBVH, int first, int count, const Ray *ray, float *best) {
+    const __m128 signMask = _mm_set1_ps(-0.0f), zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    const __m128 epsilon = _mm_set1_ps(MESH_BVH_PARALLEL_EPSILON);
+    const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+
+    __m128 ox = _mm_set1_ps(ray->origin.x), oy = _mm_set1_ps(ray->origin.y), oz = _mm_set1_ps(ray->origin.z);
+    __m128 dx = _mm_set1_ps(ray->direction.x), dy = _mm_set1_ps(ray->direction.y), dz = _mm_set1_ps(ray->direction.z);
+
+    int closest = -1;
+    float t[4];
+
+    for (int i = 0; i < count; i += 4) {
+        int base = first + i;
+
+        __m128 e1x = _mm_loadu_ps(&meshBVH->edge1X[base]), e1y = _mm_loadu_ps(&meshBVH->edge1Y[base]), e1z = _mm_loadu_ps(&meshBVH->edge1Z[base]);
+        __m128 e2x = _mm_loadu_ps(&meshBVH->edge2X[base]), e2y = _mm_loadu_ps(&meshBVH->edge2Y[base]), e2z = _mm_loadu_ps(&meshBVH->edge2Z[base]);
+
+        __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+
+        __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+        __m128 inverseDet = _mm_div_ps(one, det);
+
+        __m128 tx = _mm_sub_ps(ox, _mm_loadu_ps(&meshBVH->v0X[base]));
+        __m128 ty = _mm_sub_ps(oy, _mm_loadu_ps(&meshBVH->v0Y[base]));
+        __m128 tz = _mm_sub_ps(oz, _mm_loadu_ps(&meshBVH->v0Z[base]));
+
+        __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), inverseDet);
+
+        __m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+        __m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+        __m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+
+        __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inverseDet);
+        __m128 distance = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverseDet);
+
+        // Lanes past 'count' belong to the next leaf
+        __m128 hit = _mm_castsi128_ps(_mm_cmplt_epi32(lanes, _mm_set1_epi32(count - i)));
+        hit = _mm_and_ps(hit, _mm_cmpgt_ps(_mm_andnot_ps(signMask, det), epsilon));
+        hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmple_ps(u, one)));
+        hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(v, zero), _mm_cmple_ps(_mm_add_ps(u, v), one)));
+        hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(distance, zero), _mm_cmplt_ps(distance, _mm_set1_ps(*best))));
+
+        int hits = _mm_movemask_ps(hit);
+        if (hits == 0) continue;
+
+        _mm_storeu_ps(t, distance);
+        closest = ClosestLane(hits, t, base, best, closest);
+    }
+
+    return closest;
+}
+
+__attribute__((target("avx2"))) static int IntersectAVX2(const MeshBVH *meshBVH, int first, int count, const Ray *ray, float *best) {
+    const __m256 signMask = _mm256_set1_ps(-0.0f), zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+    const __m256 epsilon = _mm256_set1_ps(MESH_BVH_PARALLEL_EPSILON);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    __m256 ox = _mm256_set1_ps(ray->origin.x), oy = _mm256_set1_ps(ray->origin.y), oz = _mm256_set1_ps(ray->origin.z);
+    __m256 dx = _mm256_set1_ps(ray->direction.x), dy = _mm256_set1_ps(ray->direction.y), dz = _mm256_set1_ps(ray->direction.z);
+
+    int closest = -1;
+    float t[8];
+
+    for (int i = 0; i < count; i += 8) {
+        int base = first + i;
+
+        __m256 e1x = _mm256_loadu_ps(&meshBVH->edge1X[base]), e1y = _mm256_loadu_ps(&meshBVH->edge1Y[base]), e1z = _mm256_loadu_ps(&meshBVH->edge1Z[base]);
+        __m256 e2x = _mm256_loadu_ps(&meshBVH->edge2X[base]), e2y = _mm256_loadu_ps(&meshBVH->edge2Y[base]), e2z = _mm256_loadu_ps(&meshBVH->edge2Z[base]);
+
+        __m256 px = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+        __m256 py = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+        __m256 pz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+
+        __m256 det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, px), _mm256_mul_ps(e1y, py)), _mm256_mul_ps(e1z, pz));
+        __m256 inverseDet = _mm256_div_ps(one, det);
+
+        __m256 tx = _mm256_sub_ps(ox, _mm256_loadu_ps(&meshBVH->v0X[base]));
+        __m256 ty = _mm256_sub_ps(oy, _mm256_loadu_ps(&meshBVH->v0Y[base]));
+        __m256 tz = _mm256_sub_ps(oz, _mm256_loadu_ps(&meshBVH->v0Z[base]));
+
+        __m256 u = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tx, px), _mm256_mul_ps(ty, py)), _mm256_mul_ps(tz, pz)), inverseDet);
+
+        __m256 qx = _mm256_sub_ps(_mm256_mul_ps(ty, e1z), _mm256_mul_ps(tz, e1y));
+        __m256 qy = _mm256_sub_ps(_mm256_mul_ps(tz, e1x), _mm256_mul_ps(tx, e1z));
+        __m256 qz = _mm256_sub_ps(_mm256_mul_ps(tx, e1y), _mm256_mul_ps(ty, e1x));
+
+        __m256 v = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz)), inverseDet);
+        __m256 distance = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)), inverseDet);
+
+        __m256 hit = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(count - i), lanes));
+        hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_andnot_ps(signMask, det), epsilon, _CMP_GT_OQ));
+        hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(u, zero, _CMP_GE_OQ), _mm256_cmp_ps(u, one, _CMP_LE_OQ)));
+        hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(v, zero, _CMP_GE_OQ), _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ)));
+        hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(distance, zero, _CMP_GE_OQ), _mm256_cmp_ps(distance, _mm256_set1_ps(*best), _CMP_LT_OQ)));
+
+        int hits = _mm256_movemask_ps(hit);
+        if (hits == 0) continue;
+
+        _mm256_storeu_ps(t, distance);
+        closest = ClosestLane(hits, t, base, best, closest);
+    }
+
+    return closest;
+}
+
+#endif
+
+int IntersectTrianglesLevel(SimdLevel level, const MeshBVH *meshBVH, int first, int count, const Ray *ray, float maxDistance, float *distance) {
+    SimdLevel supported = GetSimdLevel();
+    if (level > supported) level = supported;
+
+    float best = maxDistance;
+    int closest = -1;
+
+#if ENGINE_SIMD_X86
+    if (level == SIMD_AVX2) {
+        closest = IntersectAVX2(meshBVH, first, count, ray, &best);
+    } else if (level == SIMD_SSE) {
+        closest = IntersectSSE(meshBVH, first, count, ray, &best);
+    } else
+#endif
+    {
+        closest = IntersectScalar(meshBVH, first, count, ray, &best);
+    }
+
+    if (closest >= 0 && distance != NULL) *distance = best;
+    return closest;
+}
+
+/* Same near-first descent as the scene BVH, leaves go to one kernel call instead of a callback per primitive */
+static bool TraverseMeshBVH(SimdLevel level, const MeshBVH *meshBVH, const Ray *ray, float maxDistance, float *distance) {
+    const BVH *bvh = meshBVH->bvh;
+    if (bvh->nodeCount == 0) return GLFW_FALSE;
+
+    vec3s inverseDirection = (vec3s){{1.0f / ray->direction.x, 1.0f / ray->direction.y, 1.0f / ray->direction.z}};
+
+    int stack[BVH_STACK_SIZE];
+    int top = 0;
+
+    bool found = GLFW_FALSE;
+    float best = maxDistance;
+
+    if (RayBoxDistance(ray, inverseDirection, bvh->nodes[0].min, bvh->nodes[0].max, best) < 0.0f) return GLFW_FALSE;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const BVHNode *node = &bvh->nodes[stack[--top]];
+
+        if (node->count > 0) {
+            if (IntersectTrianglesLevel(level, meshBVH, node->first, node->count, ray, best, &best) >= 0) found = GLFW_TRUE;
+            continue;
+        }
+
+        int left = node->first, right = node->first + 1;
+        float leftDistance = RayBoxDistance(ray, inverseDirection, bvh->nodes[left].min, bvh->nodes[left].max, best);
+        float rightDistance = RayBoxDistance(ray, inverseDirection, bvh->nodes[right].min, bvh->nodes[right].max, best);
+
+        if (leftDistance >= 0.0f && rightDistance >= 0.0f) {
+            if (top + 2 > BVH_STACK_SIZE) continue;
+
+            bool leftFirst = leftDistance <= rightDistance;
+            stack[top++] = leftFirst ? right : left;
+            stack[top++] = leftFirst ? left : right;
+        } else if (leftDistance >= 0.0f || rightDistance >= 0.0f) {
+            if (top + 1 > BVH_STACK_SIZE) continue;
+
+            stack[top++] = (leftDistance >= 0.0f) ? left : right;
+        }
+    }
+
+    if (found && distance != NULL) *distance = best;
+    return found;
+}
+
+bool MeshBVHRayClosest(const MeshBVH *meshBVH, const Ray *ray, float maxDistance, float *distance) {
+    return TraverseMeshBVH(GetSimdLevel(), meshBVH, ray, maxDistance, distance);
+}
+
+bool ModelRayClosest(Model3D *model, const Ray *ray, float maxDistance, float *distance) {
+    // All or nothing, a half built model would let the ray pass through its missing meshes
+    foreach (Mesh *mesh, model->meshes) {
+        if (mesh->indexCount >= 3 && GetMeshBVH(mesh) == NULL) return GLFW_TRUE;
+    }
+
+    int instanceCount = (model->instanceCount < 1) ? 1 : model->instanceCount;
+    float best = maxDistance;
+    bool found = GLFW_FALSE;
+
+    for (int i = 0; i < instanceCount; i++) {
+        mat4s inverse = glms_mat4_inv(*GetTransformMatrix(&model->transforms[i]));
+
+        // The direction keeps the instance's scale, so model space distances stay world distances
+        Ray local = (Ray){
+            .origin = glms_mat4_mulv3(inverse, ray->origin, 1.0f),
+            .direction = glms_mat4_mulv3(inverse, ray->direction, 0.0f),
+        };
+
+        foreach (Mesh *mesh, model->meshes) {
+            MeshBVH *meshBVH = GetMeshBVH(mesh);
+            if (meshBVH == NULL) continue;
+
+            if (MeshBVHRayClosest(meshBVH, &local, best, &best)) found = GLFW_TRUE;
+        }
+    }
+
+    if (found) *distance = best;
+    return found;
+}
+
+#ifdef ENGINE_SELF_TESTS
+
+/* Triangle soup in a 100 unit cube, small triangles so most rays hit a handful of them */
+static MeshBVH *NewRandomMeshBVH(int triangleCount, unsigned int *state) {
+    Vertex *vertices = (Vertex *)calloc((size_t)triangleCount * 3, sizeof(Vertex));
+    GLuint *indices = (GLuint *)malloc((size_t)triangleCount * 3 * sizeof(GLuint));
+
+    if (vertices == NULL || indices == NULL) {
+        free(vertices);
+        free(indices);
+        return NULL;
+    }
+
+    for (int i = 0; i < triangleCount; i++) {
+        vec3s center = (vec3s){{RandomRange(state, -50.0f, 50.0f), RandomRange(state, -50.0f, 50.0f), RandomRange(state, -50.0f, 50.0f)}};
+
+        for (int corner = 0; corner < 3; corner++) {
+            vec3s offset = (vec3s){{RandomRange(state, -2.0f, 2.0f), RandomRange(state, -2.0f, 2.0f), RandomRange(state, -2.0f, 2.0f)}};
+
+            vertices[i * 3 + corner].position = glms_vec3_add(center, offset);
+            indices[i * 3 + corner] = (GLuint)(i * 3 + corner);
+        }
+    }
+
+    MeshBVH *meshBVH = NewMeshBVH(vertices, triangleCount * 3, indices, triangleCount * 3);
+
+    free(vertices);
+    free(indices);
+    return meshBVH;
+}
+
+static Ray RandomRay(unsigned int *state) {
+    vec3s origin = (vec3s){{RandomRange(state, -80.0f, 80.0f), RandomRange(state, -80.0f, 80.0f), RandomRange(state, -80.0f, 80.0f)}};
+    vec3s target = (vec3s){{RandomRange(state, -40.0f, 40.0f), RandomRange(state, -40.0f, 40.0f), RandomRange(state, -40.0f, 40.0f)}};
+
+    return (Ray){.origin = origin, .direction = glms_vec3_normalize(glms_vec3_sub(target, origin))};
+}
+
+bool MeshBVHSelfTest(int triangleCount, int rays) {
+    unsigned int state = 0x7E1Au;
+    MeshBVH *meshBVH = NewRandomMeshBVH(triangleCount, &state);
+    if (meshBVH == NULL) return GLFW_FALSE;
+
+    int mismatches = 0, hits = 0;
+
+    for (int r = 0; r < rays; r++) {
+        Ray ray = RandomRay(&state);
+
+        float expected = -1.0f;
+        bool expectedHit = IntersectTrianglesLevel(SIMD_SCALAR, meshBVH, 0, triangleCount, &ray, FLT_MAX, &expected) >= 0;
+        hits += expectedHit;
+
+        for (int level = 0; level < SIMD_LEVEL_COUNT; level++) {
+            float scan = -1.0f, traversed = -1.0f;
+            bool scanHit = IntersectTrianglesLevel((SimdLevel)level, meshBVH, 0, triangleCount, &ray, FLT_MAX, &scan) >= 0;
+            bool traversedHit = TraverseMeshBVH((SimdLevel)level, meshBVH, &ray, FLT_MAX, &traversed);
+
+            if (scanHit != expectedHit || traversedHit != expectedHit) {
+                mismatches++;
+            } else if (expectedHit && (scan != expected || traversed != expected)) {
+                mismatches++;
+            }
+        }
+    }
+
+    printf("[MESH BVH TEST] %d triangles, %d rays (%d hits): %s (%d mismatches)\n",
+           triangleCount, rays, hits, (mismatches == 0) ? "OK" : "FAILED", mismatches);
+
+    FreeMeshBVH(meshBVH);
+    return mismatches == 0;
+}
+
+void BenchmarkMeshBVH(int triangleCount, int rays) {
+    unsigned int state = 0xBE7Cu;
+
+    double start = GetTimeSeconds();
+    MeshBVH *meshBVH = NewRandomMeshBVH(triangleCount, &state);
+    double build = GetTimeSeconds() - start;
+
+    Ray *queries = (Ray *)malloc((size_t)rays * sizeof(Ray));
+
+    if (meshBVH == NULL || queries == NULL) {
+        FreeMeshBVH(meshBVH);
+        free(queries);
+        return;
+    }
+
+    for (int r = 0; r < rays; r++) {
+        queries[r] = RandomRay(&state);
+    }
+
+    printf("[MESH BVH BENCH] %d triangles: build %.2f ms, %d nodes\n", triangleCount, build * 1000.0, meshBVH->bvh->nodeCount);
+
+    float distance;
+    volatile int sink = 0;
+
+    start = GetTimeSeconds();
+    for (int r = 0; r < rays; r++) {
+        sink += IntersectTrianglesLevel(GetSimdLevel(), meshBVH, 0, triangleCount, &queries[r], FLT_MAX, &distance) >= 0;
+    }
+    double scan = (GetTimeSeconds() - start) / rays;
+
+    printf("[MESH BVH BENCH] %-6s brute force scan: %.2f us/ray\n", SimdLevelName(GetSimdLevel()), scan * 1e6);
+
+    for (int level = 0; level <= (int)GetSimdLevel(); level++) {
+        start = GetTimeSeconds();
+        for (int r = 0; r < rays; r++) {
+            sink += TraverseMeshBVH((SimdLevel)level, meshBVH, &queries[r], FLT_MAX, &distance);
+        }
+        double traversed = (GetTimeSeconds() - start) / rays;
+
+        printf("[MESH BVH BENCH] %-6s BVH: %.3f us/ray (%.0fx vs scan)\n",
+               SimdLevelName((SimdLevel)level), traversed * 1e6, scan / traversed);
+    }
+
+    (void)sink;
+    FreeMeshBVH(meshBVH);
+    free(queries);
+}
+
+#endif  // ENGINE_SELF_TESTS
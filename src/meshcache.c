@@ -0,0 +1,453 @@
+#include "meshcache.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "model3d.h"
+#include "profiler.h"
+
+/* Makes temporary file names unique when two loads of one asset cook at once */
+static int cookCounter;
+
+static char *CookedMeshDirectory(void) {
+    return CreatePath(engine->mainPath, ENGINE_MESH_CACHE_DIR);
+}
+
+/* One file per path & import flags, imports of one source with different flags don't overwrite each other */
+static char *CookedMeshPath(const char *path, unsigned int importFlags) {
+    char name[48];
+    snprintf(name, sizeof(name), "%016llx-%08x.mesh", (unsigned long long)HashString64(path), importFlags);
+
+    char *directory = CookedMeshDirectory();
+    char *file = CreatePath(directory, name);
+    free(directory);
+
+    return file;
+}
+
+static bool StatSource(const char *path, int64_t *time, uint64_t *size) {
+    char *fullPath = getAssetPath(path);
+    struct stat info;
+
+    bool found = stat(fullPath, &info) == 0;
+    free(fullPath);
+
+    if (!found) return GLFW_FALSE;
+
+    *time = (int64_t)info.st_mtime;
+    *size = (uint64_t)info.st_size;
+    return GLFW_TRUE;
+}
+
+static uint64_t Align(uint64_t offset, uint64_t alignment) {
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+static void *MapFile(const char *file, size_t *size) {
+#ifdef _WIN32
+    FILE *stream = fopen(file, "rb");
+    if (stream == NULL) return NULL;
+
+    fseek(stream, 0, SEEK_END);
+    long length = ftell(stream);
+    fseek(stream, 0, SEEK_SET);
+
+    void *base = (length > 0) ? malloc((size_t)length) : NULL;
+
+    if (base != NULL && fread(base, 1, (size_t)length, stream) != (size_t)length) {
+        free(base);
+        base = NULL;
+    }
+
+    fclose(stream);
+
+    *size = (base != NULL) ? (size_t)length : 0;
+    return base;
+#else
+    int descriptor = open(file, O_RDONLY);
+    if (descriptor < 0) return NULL;
+
+    struct stat info;
+    if (fstat(descriptor, &info) != 0 || info.st_size <= 0) {
+        close(descriptor);
+        return NULL;
+    }
+
+    void *base = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+
+    if (base == MAP_FAILED) return NULL;
+
+    // Uploads read the blobs front to back right after this, start paging them in now
+    madvise(base, (size_t)info.st_size, MADV_WILLNEED);
+
+    *size = (size_t)info.st_size;
+    return base;
+#endif
+}
+
+static void UnmapFile(void *base, size_t size) {
+#ifdef _WIN32
+    (void)size;
+    free(base);
+#else
+    munmap(base, size);
+#endif
+}
+
+/* 'count' elements at 'offset' fit in 'size' bytes, without adding untrusted values that could wrap around */
+static bool InBounds(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t size) {
+    return offset <= size && count <= (size - offset) / elementSize;
+}
+
+/* Every table & blob inside the file, anything else is a truncated or foreign file */
+static bool ValidLayout(const CookedMeshHeader *header, size_t size) {
+    if (header->fileSize != size) return GLFW_FALSE;
+
+    return InBounds(header->meshes, header->meshCount, sizeof(CookedSubmesh), size) &&
+           InBounds(header->textures, header->textureCount, sizeof(CookedTexture), size) &&
+           InBounds(header->textureRefs, header->textureRefCount, sizeof(uint32_t), size) && header->strings <= header->vertices &&
+           header->vertices <= size && header->indices <= size && header->meshes % 8 == 0 && header->textures % 4 == 0 &&
+           header->textureRefs % 4 == 0;
+}
+
+CookedMesh *OpenCookedMesh(const char *path, unsigned int importFlags) {
+    PROFILE_ZONE("Open cooked mesh");
+
+    int64_t sourceTime;
+    uint64_t sourceSize;
+    if (!StatSource(path, &sourceTime, &sourceSize)) return NULL;
+
+    char *file = CookedMeshPath(path, importFlags);
+    size_t size = 0;
+    void *base = MapFile(file, &size);
+    free(file);
+
+    if (base == NULL) return NULL;
+
+    const CookedMeshHeader *header = (const CookedMeshHeader *)base;
+
+    bool current = size >= sizeof(CookedMeshHeader) && memcmp(header->magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) == 0 &&
+                   header->version == MESH_CACHE_VERSION && header->importFlags == importFlags &&
+                   header->vertexSize == sizeof(Vertex) && header->sourceTime == sourceTime && header->sourceSize == sourceSize;
+
+    if (!current || !ValidLayout(header, size)) {
+        if (current) fprintf(stderr, "[MESH CACHE ERROR] Cooked mesh of '%s' is corrupt, importing it again\n", path);
+
+        UnmapFile(base, size);
+        return NULL;
+    }
+
+    CookedMesh *cooked = (CookedMesh *)malloc(sizeof(CookedMesh));
+    if (cooked == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed creating new Cooked Mesh, ERROR ALLOCATING MEMORY\n");
+        UnmapFile(base, size);
+        return NULL;
+    }
+
+    *cooked = (CookedMesh){.base = base, .size = size, .header = header};
+    return cooked;
+}
+
+void CloseCookedMesh(CookedMesh *cooked) {
+    if (cooked == NULL) return;
+
+    UnmapFile(cooked->base, cooked->size);
+    free(cooked);
+}
+
+bool ReadCookedMesh(CookedMesh *cooked, List *meshes, TextureSet *textures) {
+    PROFILE_ZONE("Read cooked mesh");
+
+    const CookedMeshHeader *header = cooked->header;
+    const char *base = (const char *)cooked->base;
+
+    const CookedSubmesh *submeshes = (const CookedSubmesh *)(base + header->meshes);
+    const CookedTexture *cookedTextures = (const CookedTexture *)(base + header->textures);
+    const uint32_t *textureRefs = (const uint32_t *)(base + header->textureRefs);
+
+    const char *strings = base + header->strings;
+    size_t stringsSize = (size_t)(header->vertices - header->strings);
+
+    // Everything is checked before anything is built, a bad file leaves the lists as they were
+    for (uint32_t i = 0; i < header->meshCount; i++) {
+        const CookedSubmesh *submesh = &submeshes[i];
+
+        bool valid = submesh->vertexOffset % MESH_CACHE_ALIGNMENT == 0 && submesh->indexOffset % MESH_CACHE_ALIGNMENT == 0 &&
+                     InBounds(submesh->vertexOffset, submesh->vertexCount, sizeof(Vertex), cooked->size) &&
+                     InBounds(submesh->indexOffset, submesh->indexCount, sizeof(GLuint), cooked->size) &&
+                     submesh->vertexCount <= INT_MAX && submesh->indexCount <= INT_MAX &&
+                     (uint64_t)submesh->firstTextureRef + submesh->textureRefCount <= header->textureRefCount;
+
+        for (uint32_t j = 0; valid && j < submesh->textureRefCount; j++) {
+            valid = textureRefs[submesh->firstTextureRef + j] < header->textureCount;
+        }
+
+        if (!valid) {
+            fprintf(stderr, "[MESH CACHE ERROR] Cooked submesh %u is out of the file's bounds\n", i);
+            return GLFW_FALSE;
+        }
+
+        // The indices go to glDrawElements as they are, one past the vertices would have the GPU read out of bounds
+        const GLuint *indices = (const GLuint *)(base + submesh->indexOffset);
+        GLuint highest = 0;
+
+        for (uint32_t j = 0; j < submesh->indexCount; j++) {
+            if (indices[j] > highest) highest = indices[j];
+        }
+
+        if (submesh->indexCount > 0 && highest >= submesh->vertexCount) {
+            fprintf(stderr, "[MESH CACHE ERROR] Cooked submesh %u indexes vertex %u of %u\n", i, highest, submesh->vertexCount);
+            return GLFW_FALSE;
+        }
+    }
+
+    for (uint32_t i = 0; i < header->textureCount; i++) {
+        uint32_t offset = cookedTextures[i].path;
+
+        if (offset >= stringsSize || memchr(strings + offset, '\0', stringsSize - offset) == NULL) {
+            fprintf(stderr, "[MESH CACHE ERROR] Cooked texture %u has no path\n", i);
+            return GLFW_FALSE;
+        }
+    }
+
+    Texture **loaded = (Texture **)calloc((size_t)header->textureCount + 1, sizeof(Texture *));
+    if (loaded == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed reading cooked textures, ERROR ALLOCATING MEMORY\n");
+        return GLFW_FALSE;
+    }
+
+    List *decode = (List *)NewList(NULL);
+
+    // Textures another model registered already are shared, only the new ones are decoded
+    for (uint32_t i = 0; i < header->textureCount; i++) {
+        bool created = GLFW_FALSE;
+        loaded[i] = (Texture *)AcquireTextureImage(textures, (TextureType)cookedTextures[i].type, strings + cookedTextures[i].path, &created);
+
+        if (created) ListAdd(decode, loaded[i]);
+    }
+
+    DecodeTextureImages(decode);
+
+    ListClear(decode);
+    ListFreeMemory(decode);
+
+    for (uint32_t i = 0; i < header->meshCount; i++) {
+        const CookedSubmesh *submesh = &submeshes[i];
+        List *meshTextures = (List *)NewList(NULL);
+
+        for (uint32_t j = 0; j < submesh->textureRefCount; j++) {
+            Texture *texture = loaded[textureRefs[submesh->firstTextureRef + j]];
+            if (texture != NULL) ListAdd(meshTextures, texture);
+        }
+
+        // Nothing is copied, the mapping stays alive as long as the meshes do
+        Mesh *mesh = (Mesh *)NewMesh((Mesh){
+            .vertexCount = (int)submesh->vertexCount,
+            .indexCount = (int)submesh->indexCount,
+            .vertices = (Vertex *)(base + submesh->vertexOffset),
+            .indices = (GLuint *)(base + submesh->indexOffset),
+            .textures = meshTextures,
+            .min = (vec3s){submesh->min[0], submesh->min[1], submesh->min[2]},
+            .max = (vec3s){submesh->max[0], submesh->max[1], submesh->max[2]}});
+
+        if (mesh != NULL) ListAdd(meshes, mesh);
+    }
+
+    free(loaded);
+    return GLFW_TRUE;
+}
+
+/* Zeroes up to 'offset', then 'data' */
+static bool WriteAt(FILE *stream, uint64_t *cursor, uint64_t offset, const void *data, size_t size) {
+    static const char zeros[MESH_CACHE_ALIGNMENT];
+
+    while (*cursor < offset) {
+        size_t padding = (offset - *cursor < sizeof(zeros)) ? (size_t)(offset - *cursor) : sizeof(zeros);
+        if (fwrite(zeros, 1, padding, stream) != padding) return GLFW_FALSE;
+        *cursor += padding;
+    }
+
+    if (size > 0 && fwrite(data, 1, size, stream) != size) return GLFW_FALSE;
+
+    *cursor += size;
+    return GLFW_TRUE;
+}
+
+static int TextureIndex(List *textures, Texture *texture) {
+    for (unsigned int i = 0; i < ListSize(textures); i++) {
+        if (ListGet(textures, i) == texture) return (int)i;
+    }
+
+    return -1;
+}
+
+bool WriteCookedMesh(const char *path, unsigned int importFlags, List *meshes, List *textures) {
+    PROFILE_ZONE("Cook mesh");
+
+    CookedMeshHeader header = (CookedMeshHeader){
+        .version = MESH_CACHE_VERSION,
+        .importFlags = importFlags,
+        .vertexSize = sizeof(Vertex),
+        .meshCount = (uint32_t)ListSize(meshes),
+        .textureCount = (uint32_t)ListSize(textures)};
+
+    memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+
+    if (!StatSource(path, &header.sourceTime, &header.sourceSize)) return GLFW_FALSE;
+
+    CookedSubmesh *submeshes = (CookedSubmesh *)calloc((size_t)header.meshCount + 1, sizeof(CookedSubmesh));
+    CookedTexture *cookedTextures = (CookedTexture *)calloc((size_t)header.textureCount + 1, sizeof(CookedTexture));
+
+    uint32_t refCapacity = 0;
+    foreach (Mesh *mesh, meshes) {
+        if (mesh->textures != NULL) refCapacity += (uint32_t)ListSize(mesh->textures);
+    }
+
+    uint32_t *textureRefs = (uint32_t *)calloc((size_t)refCapacity + 1, sizeof(uint32_t));
+
+    if (submeshes == NULL || cookedTextures == NULL || textureRefs == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed cooking mesh '%s', ERROR ALLOCATING MEMORY\n", path);
+        free(submeshes);
+        free(cookedTextures);
+        free(textureRefs);
+        return GLFW_FALSE;
+    }
+
+    // Tables first, then the strings, then every vertex blob & every index blob
+    uint64_t stringsSize = 0;
+
+    for (uint32_t i = 0; i < header.textureCount; i++) {
+        Texture *texture = (Texture *)ListGet(textures, i);
+
+        cookedTextures[i] = (CookedTexture){.type = (uint32_t)texture->type, .path = (uint32_t)stringsSize};
+        stringsSize += strlen(texture->path) + 1;
+    }
+
+    header.meshes = Align(sizeof(CookedMeshHeader), 8);
+    header.textures = header.meshes + (uint64_t)header.meshCount * sizeof(CookedSubmesh);
+    header.textureRefs = header.textures + (uint64_t)header.textureCount * sizeof(CookedTexture);
+    header.strings = header.textureRefs + (uint64_t)refCapacity * sizeof(uint32_t);
+    header.vertices = Align(header.strings + stringsSize, MESH_CACHE_ALIGNMENT);
+
+    vec3s min = (vec3s){FLT_MAX, FLT_MAX, FLT_MAX};
+    vec3s max = (vec3s){-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    uint64_t offset = header.vertices;
+
+    for (uint32_t i = 0; i < header.meshCount; i++) {
+        Mesh *mesh = (Mesh *)ListGet(meshes, i);
+
+        submeshes[i] = (CookedSubmesh){
+            .vertexOffset = offset,
+            .vertexCount = (uint32_t)mesh->vertexCount,
+            .indexCount = (uint32_t)mesh->indexCount,
+            .firstTextureRef = header.textureRefCount,
+            .min = {mesh->min.x, mesh->min.y, mesh->min.z},
+            .max = {mesh->max.x, mesh->max.y, mesh->max.z}};
+
+        offset = Align(offset + (uint64_t)mesh->vertexCount * sizeof(Vertex), MESH_CACHE_ALIGNMENT);
+
+        if (mesh->textures != NULL) {
+            foreach (Texture *texture, mesh->textures) {
+                int index = TextureIndex(textures, texture);
+                if (index >= 0) textureRefs[header.textureRefCount++] = (uint32_t)index;
+            }
+        }
+
+        submeshes[i].textureRefCount = header.textureRefCount - submeshes[i].firstTextureRef;
+
+        min = glms_vec3_minv(min, mesh->min);
+        max = glms_vec3_maxv(max, mesh->max);
+    }
+
+    header.indices = offset;
+
+    for (uint32_t i = 0; i < header.meshCount; i++) {
+        Mesh *mesh = (Mesh *)ListGet(meshes, i);
+
+        submeshes[i].indexOffset = offset;
+        offset = Align(offset + (uint64_t)mesh->indexCount * sizeof(GLuint), MESH_CACHE_ALIGNMENT);
+    }
+
+    header.fileSize = offset;
+    memcpy(header.min, min.raw, sizeof(header.min));
+    memcpy(header.max, max.raw, sizeof(header.max));
+
+    char *directory = CookedMeshDirectory();
+#ifdef _WIN32
+    _mkdir(directory);
+#else
+    mkdir(directory, 0755);
+#endif
+    free(directory);
+
+    char *file = CookedMeshPath(path, importFlags);
+    size_t tempLength = strlen(file) + 32;
+    char *temp = (char *)malloc(tempLength);
+
+    bool written = GLFW_FALSE;
+    FILE *stream = NULL;
+
+    if (temp != NULL) {
+        snprintf(temp, tempLength, "%s.%d.tmp", file, __atomic_fetch_add(&cookCounter, 1, __ATOMIC_RELAXED));
+        stream = fopen(temp, "wb");
+    }
+
+    if (stream != NULL) {
+        uint64_t cursor = 0;
+
+        written = WriteAt(stream, &cursor, 0, &header, sizeof(header)) &&
+                  WriteAt(stream, &cursor, header.meshes, submeshes, (size_t)header.meshCount * sizeof(CookedSubmesh)) &&
+                  WriteAt(stream, &cursor, header.textures, cookedTextures, (size_t)header.textureCount * sizeof(CookedTexture)) &&
+                  WriteAt(stream, &cursor, header.textureRefs, textureRefs, (size_t)refCapacity * sizeof(uint32_t));
+
+        for (uint32_t i = 0; written && i < header.textureCount; i++) {
+            Texture *texture = (Texture *)ListGet(textures, i);
+            written = WriteAt(stream, &cursor, header.strings + cookedTextures[i].path, texture->path, strlen(texture->path) + 1);
+        }
+
+        for (uint32_t i = 0; written && i < header.meshCount; i++) {
+            Mesh *mesh = (Mesh *)ListGet(meshes, i);
+            written = WriteAt(stream, &cursor, submeshes[i].vertexOffset, mesh->vertices, (size_t)mesh->vertexCount * sizeof(Vertex));
+        }
+
+        for (uint32_t i = 0; written && i < header.meshCount; i++) {
+            Mesh *mesh = (Mesh *)ListGet(meshes, i);
+            written = WriteAt(stream, &cursor, submeshes[i].indexOffset, mesh->indices, (size_t)mesh->indexCount * sizeof(GLuint));
+        }
+
+        written = WriteAt(stream, &cursor, header.fileSize, NULL, 0) && written;
+        written = fclose(stream) == 0 && written;
+
+#ifdef _WIN32
+        // rename() doesn't replace on Windows
+        if (written) remove(file);
+#endif
+        // Readers only ever see a complete file, or the old one
+        written = written && rename(temp, file) == 0;
+        if (!written) remove(temp);
+    }
+
+    if (!written) {
+        fprintf(stderr, "[MESH CACHE ERROR] Failed writing the cooked mesh of '%s' to '%s'\n", path, file);
+    }
+
+    free(temp);
+    free(file);
+    free(submeshes);
+    free(cookedTextures);
+    free(textureRefs);
+
+    return written;
+}
@@ -1,47 +1,794 @@
 #include "model3d.h"
 
 #include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
 
-void *LoadAsync(void *arg) {
-    const char *path = (const char *)arg;
+#include "jobs.h"
+#include "meshcache.h"
+#include "profiler.h"
+#include "renderthread.h"
+#include "upload.h"
 
-    C_STRUCT aiScene *scene = (C_STRUCT aiScene *)aiImportFile(getAssetPath(path),
-                                                               aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+typedef enum ModelLoadStage {
+    LOAD_IMPORTING = 0,  // import job running
+    LOAD_UPLOADING,      // meshes & textures built, waiting on their uploads
+    LOAD_FAILED          // import failed, nothing but the placeholder was queued
+} ModelLoadStage;
+
+typedef struct MeshUpload {
+    GpuUpload upload;  // first, the queue hands this back
+    struct ModelLoad *load;
+    Mesh *mesh;
+    BufferSlices vertices, indices;
+} MeshUpload;
+
+typedef struct TextureUpload {
+    GpuUpload upload;
+    struct ModelLoad *load;
+    Texture *texture;
+    TextureSlices slices;
+} TextureUpload;
+
+/*
+ -> One model asset in flight, main thread only except for what the import job fills in before it publishes 'stage'
+    & the 'pendingUploads' count the render thread brings down.
+*/
+typedef struct ModelLoad {
+    Asset *asset;  // the models wait on it, its 'load' points back here until the meshes are handed over
+    List *models;  // <Model3D *> waiting, the first one & every #NewModel3D() of the same path meanwhile
+    char *path;
+    double startTime;
+
+    JobCounter counter;  // the import job
+    int stage;           // ModelLoadStage, atomic
+    int pendingUploads;  // atomic
+
+    /* Written by the import job */
+    CookedMesh *cooked;  // 'meshes' point into it, handed to the asset once it's ready
+    List *meshes;
+    TextureSet textures;
+    MeshUpload *meshUploads;
+    TextureUpload *textureUploads;
+    int meshCount, textureCount;
+    size_t bytes;
+
+    Mesh *placeholder;
+    MeshUpload placeholderUpload;
+    bool placeholderReady;  // atomic, its upload is done
+    bool placeholderShown;  // in 'model->meshes'
+
+    bool retiring;  // swapped in or failed, waits until no snapshot in flight draws the placeholder
+    long retireFrame;
+} ModelLoad;
+
+/*
+ -> 'data' of a model asset, main thread only. Every model of it lists the same meshes & textures, the last one to
+    release it frees them (see #FreeModelAsset()).
+*/
+typedef struct ModelAsset {
+    List *meshes;  // <Mesh *>
+    TextureSet textures;
+    CookedMesh *cooked;  // mapping 'meshes' point into, NULL when they were imported
+    ModelLoad *load;     // NULL once the meshes are handed over or the load failed
+    bool failed;
+} ModelAsset;
+
+/* Loads in flight, main thread only */
+static List *modelLoads;
+
+static bool StepMeshUpload(GpuUpload *upload, size_t *budget) {
+    MeshUpload *meshUpload = (MeshUpload *)upload;
+    Mesh *mesh = meshUpload->mesh;
+
+    if (mesh->VBO == 0) {
+        glGenBuffers(1, &mesh->VBO);
+        glGenBuffers(1, &mesh->EBO);
+
+        meshUpload->vertices = (BufferSlices){.buffer = mesh->VBO, .data = mesh->vertices, .size = sizeof(Vertex) * (size_t)mesh->vertexCount};
+        meshUpload->indices = (BufferSlices){.buffer = mesh->EBO, .data = mesh->indices, .size = sizeof(GLuint) * (size_t)mesh->indexCount};
+    }
+
+    if (!UploadBufferSlices(&meshUpload->vertices, budget)) return GLFW_FALSE;
+    if (!UploadBufferSlices(&meshUpload->indices, budget)) return GLFW_FALSE;
+
+    SetupMeshAttributes(mesh);
+    return GLFW_TRUE;
+}
+
+static void MeshUploadDone(GpuUpload *upload) {
+    MeshUpload *meshUpload = (MeshUpload *)upload;
+    __atomic_sub_fetch(&meshUpload->load->pendingUploads, 1, __ATOMIC_RELEASE);
+}
+
+static void PlaceholderUploadDone(GpuUpload *upload) {
+    MeshUpload *meshUpload = (MeshUpload *)upload;
+    __atomic_store_n(&meshUpload->load->placeholderReady, GLFW_TRUE, __ATOMIC_RELEASE);
+}
+
+static bool StepTextureUpload(GpuUpload *upload, size_t *budget) {
+    TextureUpload *textureUpload = (TextureUpload *)upload;
+    Texture *texture = textureUpload->texture;
+
+    if (texture->textureID == 0) {
+        glGenTextures(1, &texture->textureID);
+        StateBindTexture(0, GL_TEXTURE_2D, texture->textureID);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        textureUpload->slices = (TextureSlices){
+            .texture = texture->textureID,
+            .pixels = texture->pixels,
+            .width = texture->width,
+            .height = texture->height,
+            .channels = texture->nrChannels};
+    }
+
+    if (!UploadTextureSlices(&textureUpload->slices, budget)) return GLFW_FALSE;
+
+    stbi_image_free(texture->pixels);
+    texture->pixels = NULL;
+
+    return GLFW_TRUE;
+}
+
+static void TextureUploadDone(GpuUpload *upload) {
+    TextureUpload *textureUpload = (TextureUpload *)upload;
+    __atomic_sub_fetch(&textureUpload->load->pendingUploads, 1, __ATOMIC_RELEASE);
+}
+
+/* Unit cube, drawn through the model's own shader & color */
+static Mesh *NewPlaceholderMesh(void) {
+    static const float corners[8][3] = {
+        {-0.5f, -0.5f, -0.5f}, {0.5f, -0.5f, -0.5f}, {0.5f, 0.5f, -0.5f}, {-0.5f, 0.5f, -0.5f},
+        {-0.5f, -0.5f, 0.5f}, {0.5f, -0.5f, 0.5f}, {0.5f, 0.5f, 0.5f}, {-0.5f, 0.5f, 0.5f}};
+
+    static const GLuint faces[36] = {
+        0, 2, 1, 0, 3, 2,  // back
+        4, 5, 6, 4, 6, 7,  // front
+        0, 4, 7, 0, 7, 3,  // left
+        1, 2, 6, 1, 6, 5,  // right
+        3, 7, 6, 3, 6, 2,  // top
+        0, 1, 5, 0, 5, 4   // bottom
+    };
+
+    Vertex *vertices = (Vertex *)malloc(sizeof(Vertex) * 8);
+    GLuint *indices = (GLuint *)malloc(sizeof(faces));
+
+    if (vertices == NULL || indices == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed creating the placeholder mesh, ERROR ALLOCATING MEMORY\n");
+        free(vertices);
+        free(indices);
+        return NULL;
+    }
+
+    vec3s min = (vec3s){-0.5f, -0.5f, -0.5f};
+    vec3s max = (vec3s){0.5f, 0.5f, 0.5f};
+
+    for (int i = 0; i < 8; i++) {
+        vec3s position = (vec3s){corners[i][0], corners[i][1], corners[i][2]};
+
+        // Smoothed corner normals, none of their components is 0 so the normal attribute gets enabled
+        vertices[i] = (Vertex){.position = position, .normal = glms_vec3_normalize(position), .texCoords = (vec2s){0.0f, 0.0f}};
+    }
+
+    memcpy(indices, faces, sizeof(faces));
+
+    return (Mesh *)NewMesh((Mesh){.vertexCount = 8, .indexCount = 36, .vertices = vertices, .indices = indices, .min = min, .max = max});
+}
+
+/* CPU memory of a mesh, GL names too if its upload got that far. Render thread (or main once it shut down) */
+static void FreeModelMesh(Mesh *mesh, bool mapped) {
+    if (mesh == NULL) return;
+
+    glDeleteVertexArrays(1, &mesh->VAO);
+    glDeleteBuffers(1, &mesh->VBO);
+    glDeleteBuffers(1, &mesh->EBO);
+
+    // The textures are shared with other meshes, only the list goes
+    if (mesh->textures != NULL) {
+        ListClear(mesh->textures);
+        ListFreeMemory(mesh->textures);
+    }
+
+    if (!mapped) {
+        free(mesh->vertices);
+        free(mesh->indices);
+    }
+
+    free(mesh);
+}
+
+TextureSet NewTextureSet(void) {
+    return (TextureSet){
+        .textures = (List *)NewList(NULL),
+        .assets = (List *)NewList(NULL),
+        .owned = (List *)NewList(NULL)};
+}
+
+Texture *AcquireTextureImage(TextureSet *set, TextureType type, const char *path, bool *created) {
+    AssetKey key = NewAssetKey(ASSET_TEXTURE, path, type);
+    Asset *asset = AcquireAsset(&key);
+
+    *created = GLFW_FALSE;
+
+    if (asset == NULL) {
+        Texture *texture = (Texture *)NewTextureImage(type, path);
+        if (texture == NULL) {
+            FreeAssetKey(&key);
+            return NULL;
+        }
+
+        bool inserted = GLFW_FALSE;
+        asset = RegisterAsset(&key, texture, FreeTextureAsset, &inserted);
+
+        // Another import registered it between the lookup & here, its texture wins
+        if (asset == NULL || !inserted) {
+            free((char *)texture->path);
+            free(texture);
+
+            if (asset == NULL) {
+                FreeAssetKey(&key);
+                return NULL;
+            }
+        }
+
+        *created = inserted;
+    }
+
+    FreeAssetKey(&key);
+
+    Texture *texture = (Texture *)asset->data;
+
+    // Materials share textures, the set holds one reference to each
+    if (!*created && !isListEmpty(set->assets) && ListContains(set->assets, asset)) {
+        ReleaseAsset(asset);
+        return texture;
+    }
+
+    ListAdd(set->assets, asset);
+    ListAdd(set->textures, texture);
+    if (*created) ListAdd(set->owned, texture);
+
+    return texture;
+}
+
+void ReleaseTextureSet(TextureSet *set) {
+    if (set->assets != NULL) {
+        foreach (Asset *asset, set->assets) ReleaseAsset(asset);
+    }
+
+    // The textures went with their last reference, only the lists are left
+    List *lists[] = {set->textures, set->assets, set->owned};
+
+    for (int i = 0; i < 3; i++) {
+        if (lists[i] == NULL) continue;
+
+        ListClear(lists[i]);
+        ListFreeMemory(lists[i]);
+    }
+
+    *set = (TextureSet){0};
+}
+
+/* One #ProcessRootNode(), shared by its jobs */
+typedef struct MeshImport {
+    const C_STRUCT aiMesh **tasks;  // the node tree flattened, one per mesh
+    Mesh **meshes;                  // one slot per task, filled in parallel
+    List **materials;               // textures of each scene material, NULL for the ones no task uses
+    unsigned int materialCount;
+    int count, slices;
+} MeshImport;
+
+static int CountNodeMeshes(const C_STRUCT aiNode *node) {
+    int count = (int)node->mNumMeshes;
+
+    for (GLuint i = 0; i < node->mNumChildren; i++) {
+        count += CountNodeMeshes(node->mChildren[i]);
+    }
+
+    return count;
+}
+
+static void FlattenNode(const C_STRUCT aiNode *node, const C_STRUCT aiScene *scene, const C_STRUCT aiMesh **tasks, int *count) {
+    /* The node object only contains indices to index the actual objects in the scene */
+    for (GLuint i = 0; i < node->mNumMeshes; i++) {
+        tasks[(*count)++] = scene->mMeshes[node->mMeshes[i]];
+    }
+
+    for (GLuint i = 0; i < node->mNumChildren; i++) {
+        FlattenNode(node->mChildren[i], scene, tasks, count);
+    }
+}
+
+static void DecodeTextureRange(void *data, int start, int end) {
+    List *textures = (List *)data;
+
+    for (int i = start; i < end; i++) {
+        DecodeTextureImage((Texture *)ListGet(textures, (unsigned int)i));
+    }
+}
+
+/* 1x1 grey PNG whose zlib stream is a single fixed Huffman block */
+static const unsigned char fixedHuffmanPNG[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48, 0x44, 0x52, 0x00,
+    0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x08, 0x00, 0x00, 0x00, 0x00, 0x3a, 0x7e, 0x9b, 0x55, 0x00,
+    0x00, 0x00, 0x0a, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0x63, 0x60, 0x00, 0x00, 0x00, 0x02, 0x00, 0x01,
+    0xe5, 0x27, 0xde, 0xfc, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82};
+
+static pthread_once_t decoderWarmed = PTHREAD_ONCE_INIT;
+
+/* stb_image v2.10 fills its fixed Huffman tables on the first PNG that needs them, unguarded: do it before any worker */
+static void WarmImageDecoder(void) {
+    int width, height, channels;
+    stbi_image_free(stbi_load_from_memory(fixedHuffmanPNG, (int)sizeof(fixedHuffmanPNG), &width, &height, &channels, 0));
+}
+
+void DecodeTextureImages(List *textures) {
+    if (isListEmpty(textures)) return;
+
+    PROFILE_ZONE("Decode textures");
+
+    // Rows are flipped per image (#LoadTextureImage()), the workers share no stb_image state once it's warm
+    pthread_once(&decoderWarmed, WarmImageDecoder);
+
+    // Few & big, one image per job
+    ParallelFor((int)ListSize(textures), 1, DecodeTextureRange, textures);
+}
+
+static void ConvertMeshRange(void *data, int start, int end) {
+    PROFILE_ZONE("Convert meshes");
+
+    MeshImport *import = (MeshImport *)data;
+
+    for (int slice = start; slice < end; slice++) {
+        int first = (int)((long long)import->count * slice / import->slices);
+        int last = (int)((long long)import->count * (slice + 1) / import->slices);
+
+        for (int i = first; i < last; i++) {
+            const C_STRUCT aiMesh *mesh = import->tasks[i];
+            List *materialTextures = (mesh->mMaterialIndex < import->materialCount) ? import->materials[mesh->mMaterialIndex] : NULL;
+
+            import->meshes[i] = (Mesh *)ProcessOurMesh(mesh, materialTextures);
+        }
+    }
+}
+
+/* #ProcessRootNode() with the meshes split over 'slices' jobs, one per mesh when 0 */
+static void ProcessMeshes(List *meshes, TextureSet *textures, const C_STRUCT aiNode *node, const C_STRUCT aiScene *scene, int slices) {
+    int count = CountNodeMeshes(node);
+    if (count == 0) return;
+
+    MeshImport import = (MeshImport){
+        .tasks = (const C_STRUCT aiMesh **)malloc((size_t)count * sizeof(C_STRUCT aiMesh *)),
+        .meshes = (Mesh **)calloc((size_t)count, sizeof(Mesh *)),
+        .materials = (List **)calloc((size_t)scene->mNumMaterials + 1, sizeof(List *)),
+        .materialCount = scene->mNumMaterials,
+        .count = count,
+        .slices = (slices > 0 && slices < count) ? slices : count};
+
+    List *decode = (List *)NewList(NULL);
+
+    if (import.tasks == NULL || import.meshes == NULL || import.materials == NULL || decode == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed processing %d meshes, ERROR ALLOCATING MEMORY\n", count);
+
+        free(import.tasks);
+        free(import.meshes);
+        free(import.materials);
+        if (decode != NULL) ListFreeMemory(decode);
+        return;
+    }
+
+    int flattened = 0;
+    FlattenNode(node, scene, import.tasks, &flattened);
+
+    // Serial, one registry lookup per texture is cheap next to decoding & converting
+    for (int i = 0; i < count; i++) {
+        unsigned int material = import.tasks[i]->mMaterialIndex;
+
+        if (material < import.materialCount && import.materials[material] == NULL) {
+            import.materials[material] = (List *)ProcessMaterial(textures, decode, scene->mMaterials[material]);
+        }
+    }
+
+    DecodeTextureImages(decode);
+    ParallelFor(import.slices, 1, ConvertMeshRange, &import);
+
+    for (int i = 0; i < count; i++) {
+        if (import.meshes[i] != NULL) ListAdd(meshes, import.meshes[i]);
+    }
+
+    // The textures are in the set & the meshes' own lists, only the lists go
+    for (unsigned int i = 0; i < import.materialCount; i++) {
+        if (import.materials[i] == NULL) continue;
+
+        ListClear(import.materials[i]);
+        ListFreeMemory(import.materials[i]);
+    }
+
+    ListClear(decode);
+    ListFreeMemory(decode);
+
+    free(import.tasks);
+    free(import.meshes);
+    free(import.materials);
+}
+
+void ProcessRootNode(List *meshes, TextureSet *textures, const C_STRUCT aiNode *node, const C_STRUCT aiScene *scene) {
+    if (scene == NULL || node == NULL) return;
+
+    ProcessMeshes(meshes, textures, node, scene, 0);
+}
+
+#ifdef ENGINE_SELF_TESTS
+
+void BenchmarkModelImport(int meshCount, int vertexCount) {
+    vertexCount -= vertexCount % 3;
+    if (meshCount < 1 || vertexCount < 3) return;
+
+    int faceCount = vertexCount / 3;
+
+    // One triangle soup per mesh, every mesh shares the same attribute & index arrays
+    C_STRUCT aiVector3D *positions = (C_STRUCT aiVector3D *)malloc((size_t)vertexCount * sizeof(C_STRUCT aiVector3D));
+    C_STRUCT aiVector3D *normals = (C_STRUCT aiVector3D *)malloc((size_t)vertexCount * sizeof(C_STRUCT aiVector3D));
+    C_STRUCT aiVector3D *texCoords = (C_STRUCT aiVector3D *)malloc((size_t)vertexCount * sizeof(C_STRUCT aiVector3D));
+    unsigned int *indices = (unsigned int *)malloc((size_t)vertexCount * sizeof(unsigned int));
+    C_STRUCT aiFace *faces = (C_STRUCT aiFace *)malloc((size_t)faceCount * sizeof(C_STRUCT aiFace));
+
+    C_STRUCT aiMesh *sceneMeshes = (C_STRUCT aiMesh *)calloc((size_t)meshCount, sizeof(C_STRUCT aiMesh));
+    C_STRUCT aiMesh **meshPointers = (C_STRUCT aiMesh **)malloc((size_t)meshCount * sizeof(C_STRUCT aiMesh *));
+    unsigned int *nodeMeshes = (unsigned int *)malloc((size_t)meshCount * sizeof(unsigned int));
+    C_STRUCT aiMaterial *material = (C_STRUCT aiMaterial *)calloc(1, sizeof(C_STRUCT aiMaterial));
+
+    TextureSet textures = NewTextureSet();
+
+    bool allocated = positions != NULL && normals != NULL && texCoords != NULL && indices != NULL && faces != NULL &&
+                     sceneMeshes != NULL && meshPointers != NULL && nodeMeshes != NULL && material != NULL &&
+                     textures.textures != NULL && textures.assets != NULL && textures.owned != NULL;
+
+    if (!allocated) {
+        fprintf(stderr, "[MEMORY ERROR] Failed creating the import benchmark scene, ERROR ALLOCATING MEMORY\n");
+    } else {
+        unsigned int state = 0x1A9Fu;
+
+        for (int i = 0; i < vertexCount; i++) {
+            state = state * 1664525u + 1013904223u;
+            float r = (float)(state >> 8) / 16777216.0f;
+
+            positions[i] = (C_STRUCT aiVector3D){r * 10.0f, (float)(i % 97), (float)(i % 89)};
+            normals[i] = (C_STRUCT aiVector3D){0.577f, 0.577f, 0.577f};
+            texCoords[i] = (C_STRUCT aiVector3D){r, 1.0f - r, 0.0f};
+            indices[i] = (unsigned int)i;
+        }
+
+        for (int f = 0; f < faceCount; f++) {
+            faces[f] = (C_STRUCT aiFace){.mNumIndices = 3, .mIndices = &indices[f * 3]};
+        }
+
+        for (int m = 0; m < meshCount; m++) {
+            sceneMeshes[m].mNumVertices = (unsigned int)vertexCount;
+            sceneMeshes[m].mNumFaces = (unsigned int)faceCount;
+            sceneMeshes[m].mVertices = positions;
+            sceneMeshes[m].mNormals = normals;
+            sceneMeshes[m].mTextureCoords[0] = texCoords;
+            sceneMeshes[m].mFaces = faces;
+
+            meshPointers[m] = &sceneMeshes[m];
+            nodeMeshes[m] = (unsigned int)m;
+        }
+
+        C_STRUCT aiNode root = (C_STRUCT aiNode){.mNumMeshes = (unsigned int)meshCount, .mMeshes = nodeMeshes};
+        C_STRUCT aiScene scene = (C_STRUCT aiScene){
+            .mNumMeshes = (unsigned int)meshCount,
+            .mMeshes = meshPointers,
+            .mNumMaterials = 1,
+            .mMaterials = &material,
+            .mRootNode = &root};
+
+        static const int jobCounts[] = {1, 1, 4, 16};
+        double serial = 0.0;
+
+        // The first pass warms the allocator up & isn't printed
+        for (int run = 0; run < (int)(sizeof(jobCounts) / sizeof(jobCounts[0])); run++) {
+            List *meshes = (List *)NewList(NULL);
+
+            double start = GetTimeSeconds();
+            ProcessMeshes(meshes, &textures, scene.mRootNode, &scene, jobCounts[run]);
+            double elapsed = GetTimeSeconds() - start;
+
+            if (run == 1) serial = elapsed;
+
+            if (run > 0) {
+                printf("[IMPORT BENCH] %d meshes x %d vertices, %2d jobs on %d threads: %.2f ms (%.1fx)\n", meshCount, vertexCount,
+                       jobCounts[run], GetJobThreadCount(), elapsed * 1000.0, serial / elapsed);
+            }
+
+            foreach (Mesh *mesh, meshes) {
+                ListClear(mesh->textures);
+                ListFreeMemory(mesh->textures);
+                free(mesh->vertices);
+                free(mesh->indices);
+            }
+
+            ListFreeMemory(meshes);
+        }
+    }
+
+    free(positions);
+    free(normals);
+    free(texCoords);
+    free(indices);
+    free(faces);
+    free(sceneMeshes);
+    free(meshPointers);
+    free(nodeMeshes);
+    free(material);
+    ReleaseTextureSet(&textures);
+}
+
+#endif  // ENGINE_SELF_TESTS
+
+/* Source asset through assimp & #ProcessRootNode() */
+static bool ImportMeshes(ModelLoad *load) {
+    char *fullPath = getAssetPath(load->path);
+
+    const C_STRUCT aiScene *scene = aiImportFile(fullPath, MODEL_IMPORT_FLAGS);
+    free(fullPath);
 
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
         printf("[Model3D] ERROR from 'ASSIMP' library -> %s\n", (char *)aiGetErrorString());
+
+        if (scene != NULL) aiReleaseImport(scene);
+        return GLFW_FALSE;
     }
 
-    return scene;
+    // process ASSIMP's root node recursively, into lists nobody else sees until 'stage' is published
+    {
+        PROFILE_ZONE("Build meshes");
+        ProcessRootNode(load->meshes, &load->textures, scene->mRootNode, scene);
+    }
+
+    aiReleaseImport(scene);
+    return GLFW_TRUE;
 }
 
-Model3D *NewModel3D(Model3D builder, const char *path) {
-    Model3D *model = (Model3D *)malloc(sizeof(Model3D));
-    if (model == NULL) {
-        printf("[MEMORY ERROR] Failed to allocate memory for Model3D.");
+static void ImportModelJob(void *data) {
+    PROFILE_ZONE("Import model");
+
+    ModelLoad *load = (ModelLoad *)data;
+    bool cook = GLFW_FALSE;
+
+#if ENGINE_MESH_CACHE
+    load->cooked = OpenCookedMesh(load->path, MODEL_IMPORT_FLAGS);
+
+    if (load->cooked != NULL && !ReadCookedMesh(load->cooked, load->meshes, &load->textures)) {
+        CloseCookedMesh(load->cooked);
+        load->cooked = NULL;
+    }
+
+    cook = load->cooked == NULL;
+#endif
+
+    if (load->cooked == NULL && !ImportMeshes(load)) {
+        __atomic_store_n(&load->stage, LOAD_FAILED, __ATOMIC_RELEASE);
+        return;
+    }
+
+    // Only the textures this load registered are uploaded by it, the others belong to another model
+    int ownedCount = (int)ListSize(load->textures.owned);
+
+    load->meshCount = (int)ListSize(load->meshes);
+    load->textureCount = (int)ListSize(load->textures.textures);
+    load->meshUploads = (MeshUpload *)calloc((size_t)load->meshCount + 1, sizeof(MeshUpload));
+    load->textureUploads = (TextureUpload *)calloc((size_t)ownedCount + 1, sizeof(TextureUpload));
+
+    if (load->meshUploads == NULL || load->textureUploads == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed allocating the uploads of '%s'\n", load->path);
+        __atomic_store_n(&load->stage, LOAD_FAILED, __ATOMIC_RELEASE);
+        return;
+    }
+
+    int pending = load->meshCount;
+
+    foreach (Mesh *mesh, load->meshes) {
+        load->bytes += sizeof(Vertex) * (size_t)mesh->vertexCount + sizeof(GLuint) * (size_t)mesh->indexCount;
+    }
+
+    foreach (Texture *texture, load->textures.owned) {
+        if (texture->pixels == NULL) continue;
+
+        load->bytes += (size_t)texture->width * (size_t)texture->height * (size_t)texture->nrChannels;
+        pending++;
+    }
+
+    // Set before anything is queued, an upload may finish before the next one goes in. The load isn't freed before
+    // the counter says the job returned, see #UpdateModelLoads()
+    __atomic_store_n(&load->pendingUploads, pending, __ATOMIC_RELAXED);
+    __atomic_store_n(&load->stage, LOAD_UPLOADING, __ATOMIC_RELEASE);
+
+    for (int i = 0; i < load->meshCount; i++) {
+        Mesh *mesh = (Mesh *)ListGet(load->meshes, i);
+        MeshUpload *upload = &load->meshUploads[i];
+
+        *upload = (MeshUpload){.upload = {.step = StepMeshUpload, .done = MeshUploadDone}, .load = load, .mesh = mesh};
+        QueueGpuUpload(&upload->upload);
+    }
+
+    for (int i = 0; i < ownedCount; i++) {
+        Texture *texture = (Texture *)ListGet(load->textures.owned, i);
+        if (texture->pixels == NULL) continue;
+
+        TextureUpload *upload = &load->textureUploads[i];
+
+        *upload = (TextureUpload){.upload = {.step = StepTextureUpload, .done = TextureUploadDone}, .load = load, .texture = texture};
+        QueueGpuUpload(&upload->upload);
+    }
+    // Once the uploads are out, the render thread only reads the meshes meanwhile & the load waits for this job
+    if (cook) WriteCookedMesh(load->path, MODEL_IMPORT_FLAGS, load->meshes, load->textures.textures);
+}
+
+/* Whatever the load still owns, render thread (or main once it shut down). What it handed over is NULL */
+static void FreeModelLoad(ModelLoad *load) {
+    FreeModelMesh(load->placeholder, GLFW_FALSE);
+
+    if (load->meshes != NULL) {
+        foreach (Mesh *mesh, load->meshes) FreeModelMesh(mesh, load->cooked != NULL);
+
+        // Freed above, #ListFreeMemory() would free the items too
+        ListClear(load->meshes);
+        ListFreeMemory(load->meshes);
+    }
+
+    // The meshes pointed into it
+    CloseCookedMesh(load->cooked);
+    ReleaseTextureSet(&load->textures);
+
+    // The models are in 'engine->models'
+    ListClear(load->models);
+    ListFreeMemory(load->models);
+
+    free(load->meshUploads);
+    free(load->textureUploads);
+    free(load->path);
+    free(load);
+}
+
+static void FreeModelLoadTask(void *data) {
+    FreeModelLoad((ModelLoad *)data);
+
+    // Deleted names get reused, don't let the cache filter a bind to a new VAO with an old name
+    InvalidateStateCache();
+}
+
+/* The last model let go: no snapshot draws the meshes & no BVH build reads them anymore */
+static void FreeModelAssetTask(void *data) {
+    ModelAsset *shared = (ModelAsset *)data;
+
+    if (shared->meshes != NULL) {
+        foreach (Mesh *mesh, shared->meshes) {
+            FreeMeshBVH(__atomic_exchange_n(&mesh->bvh, NULL, __ATOMIC_ACQ_REL));
+            FreeModelMesh(mesh, shared->cooked != NULL);
+        }
+
+        ListClear(shared->meshes);
+        ListFreeMemory(shared->meshes);
+    }
+
+    CloseCookedMesh(shared->cooked);
+    ReleaseTextureSet(&shared->textures);
+
+    free(shared);
+
+    InvalidateStateCache();
+}
+
+static void FreeModelAsset(Asset *asset) {
+    RunOnRenderThread(FreeModelAssetTask, asset->data);
+}
+
+/*
+ -> A load registered as a new model asset, main thread.
+ -> NULL when the allocation failed, or when 'path' turned out to be registered already: '*asset' is that one then.
+*/
+static ModelLoad *NewModelLoad(const AssetKey *key, const char *path, Asset **asset) {
+    ModelAsset *shared = (ModelAsset *)calloc(1, sizeof(ModelAsset));
+    ModelLoad *load = (ModelLoad *)malloc(sizeof(ModelLoad));
+
+    *asset = NULL;
+
+    if (shared == NULL || load == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed creating new Model Load, ERROR ALLOCATING MEMORY\n");
+        free(shared);
+        free(load);
         return NULL;
     }
 
-    memcpy(model, &builder, sizeof(Model3D));
+    *load = (ModelLoad){
+        .models = (List *)NewList(NULL),
+        .path = strdup(path),
+        .startTime = GetTimeSeconds(),
+        .stage = LOAD_IMPORTING,
+        .meshes = (List *)NewList(NULL),
+        .textures = NewTextureSet()};
+
+    shared->load = load;
 
-    pthread_t thread;
-    if (pthread_create(&thread, NULL, LoadAsync, (void *)path) != 0) {
-        printf("[THREAD ERROR] Failed to create thread #NewModel3D.\n");
+    bool inserted = GLFW_FALSE;
+    *asset = RegisterAsset(key, shared, FreeModelAsset, &inserted);
+
+    // Nothing was queued or built yet, freeing it touches no GL object
+    if (*asset == NULL || !inserted) {
+        free(shared);
+        FreeModelLoad(load);
         return NULL;
+    }
+
+    load->asset = *asset;
+    return load;
+}
+
+/* Main thread, the asset's meshes & textures become the model's */
+static void ShareModelAsset(Model3D *model, ModelAsset *shared) {
+    ListClear(model->meshes);
+
+    foreach (Mesh *mesh, shared->meshes) {
+        ListAdd(model->meshes, mesh);
+    }
+
+    foreach (Texture *texture, shared->textures.textures) {
+        ListAdd(model->texturesLoaded, texture);
+    }
+
+    GenerateTransformGizmo(NULL, model);
+    GenerateBoundingBox(NULL, model);
+
+    // Culled & picked as unbounded until now, the scene BVH refits entries whose transforms changed
+    MarkTransformDirty(model->transforms);
+
+    model->loadState = MODEL_READY;
+}
+
+/* Main thread, a model of an asset that's loaded already or still in flight */
+static void JoinModelAsset(Model3D *model, ModelAsset *shared) {
+    ModelLoad *load = shared->load;
+
+    if (load != NULL) {
+        ListAdd(load->models, model);
+
+        if (model->placeholder && load->placeholderShown) ListAdd(model->meshes, load->placeholder);
+    } else if (shared->failed) {
+        model->loadState = MODEL_FAILED;
     } else {
-        printf("[THREAD] 'asset_thread' Creation Success\n");
+        ShareModelAsset(model, shared);
     }
+}
+
+Model3D *NewModel3D(Model3D builder, const char *path) {
+    PROFILE_ZONE("NewModel3D");
 
-    C_STRUCT aiScene *scene = NULL;
-    if (pthread_join(thread, (void **)&scene) != 0) {
-        printf("[THREAD ERROR] Failed to join thread #NewModel3D.\n");
+    Model3D *model = (Model3D *)malloc(sizeof(Model3D));
+    if (model == NULL) {
+        printf("[MEMORY ERROR] Failed to allocate memory for Model3D.");
         return NULL;
-    } else {
-        printf("[THREAD] 'asset_thread' Join Success\n");
     }
 
-    if (!scene) {
-        printf("[Model3D] ERROR: Failed to load the model 'scene' from thread: %s\n", path);
+    memcpy(model, &builder, sizeof(Model3D));
+
+    // Only the first model of a path loads it, the others share what it built
+    AssetKey key = NewAssetKey(ASSET_MODEL, path, MODEL_IMPORT_FLAGS);
+    ModelLoad *load = NULL;
+
+    model->asset = AcquireAsset(&key);
+
+    if (model->asset == NULL) load = (ModelLoad *)NewModelLoad(&key, path, &model->asset);
+
+    FreeAssetKey(&key);
+
+    if (model->asset == NULL) {
+        free(model);
         return NULL;
     }
 
@@ -73,9 +820,12 @@ Model3D *NewModel3D(Model3D builder, const char *path) {
         model->instanceCount = 1;
     }
 
+    model->baseInstance = -1;
+
     if (model->transforms == NULL) {
-        model->transforms = (Transform *)malloc(model->instanceCount * sizeof(Transform));
+        model->transforms = (Transform *)calloc((size_t)model->instanceCount, sizeof(Transform));
         model->transforms[0].model = glms_mat4_identity();
+        model->transforms[0].version = 0;
     }
 
     if (model->draw == NULL) {
@@ -86,13 +836,160 @@ Model3D *NewModel3D(Model3D builder, const char *path) {
         model->transforms->scale = (vec3s)GLMS_VEC3_ONE;
     }
 
-    // process ASSIMP's root node recursively
-    ProcessRootNode(model, scene->mRootNode, scene);
-    printf("[Model3D] '%s' loaded.\n", path);
+    for (int i = 0; i < model->instanceCount; i++) {
+        MarkTransformDirty(&model->transforms[i]);
+    }
 
-    GenerateTransformGizmo(NULL, model);
-    GenerateBoundingBox(NULL, model);
-    
+    model->loadState = MODEL_LOADING;
+
+    // Drawn & picked once it has meshes, see #ModelExists()
     ListAdd(engine->models, model);
+
+    if (load == NULL) {
+        JoinModelAsset(model, (ModelAsset *)model->asset->data);
+        return model;
+    }
+
+    ListAdd(load->models, model);
+
+    if (model->placeholder) {
+        load->placeholder = (Mesh *)NewPlaceholderMesh();
+
+        if (load->placeholder != NULL) {
+            load->placeholderUpload = (MeshUpload){
+                .upload = {.step = StepMeshUpload, .done = PlaceholderUploadDone},
+                .load = load,
+                .mesh = load->placeholder};
+
+            QueueGpuUpload(&load->placeholderUpload.upload);
+        }
+    }
+
+    if (modelLoads == NULL) {
+        modelLoads = (List *)NewList(NULL);
+    }
+
+    ListAdd(modelLoads, load);
+
+    RunJob(ImportModelJob, load, &load->counter);
     return model;
-}
\ No newline at end of file
+}
+
+/* Main thread, every upload is done: the asset takes the meshes & the real ones replace the placeholders */
+static void FinishModelLoad(ModelLoad *load) {
+    ModelAsset *shared = (ModelAsset *)load->asset->data;
+
+    shared->meshes = load->meshes;
+    shared->textures = load->textures;
+    shared->cooked = load->cooked;
+    shared->load = NULL;
+
+    load->meshes = NULL;
+    load->textures = (TextureSet){0};
+    load->cooked = NULL;
+
+    // Picking uses the models' boxes until the triangles are ready, once per mesh whatever shares it
+    foreach (Mesh *mesh, shared->meshes) {
+        QueueMeshBVH(mesh);
+    }
+
+    foreach (Model3D *model, load->models) {
+        ShareModelAsset(model, shared);
+    }
+
+    printf("[Model3D] '%s' loaded (%s): %d meshes, %d textures, %.1f MB uploaded in %.3f s, %d models\n", load->path,
+           (shared->cooked != NULL) ? "cooked" : "imported", load->meshCount, load->textureCount,
+           (double)load->bytes / (1024.0 * 1024.0), GetTimeSeconds() - load->startTime, (int)ListSize(load->models));
+}
+
+/* Main thread, the asset stays registered as failed until its models let go of it */
+static void FailModelLoad(ModelLoad *load) {
+    ModelAsset *shared = (ModelAsset *)load->asset->data;
+
+    shared->failed = GLFW_TRUE;
+    shared->load = NULL;
+
+    foreach (Model3D *model, load->models) {
+        ListClear(model->meshes);
+        model->loadState = MODEL_FAILED;
+    }
+}
+
+void UpdateModelLoads(void) {
+    if (modelLoads == NULL) return;
+
+    PROFILE_ZONE("UpdateModelLoads");
+
+    for (int i = (int)ListSize(modelLoads) - 1; i >= 0; i--) {
+        ModelLoad *load = (ModelLoad *)ListGet(modelLoads, (unsigned int)i);
+        bool placeholderReady = __atomic_load_n(&load->placeholderReady, __ATOMIC_ACQUIRE);
+
+        if (!load->retiring) {
+            int stage = __atomic_load_n(&load->stage, __ATOMIC_ACQUIRE);
+
+            if (!load->placeholderShown && placeholderReady) {
+                // Models joining later pick it up in #JoinModelAsset()
+                foreach (Model3D *model, load->models) {
+                    if (model->placeholder) ListAdd(model->meshes, load->placeholder);
+                }
+
+                load->placeholderShown = GLFW_TRUE;
+            }
+
+            if (stage == LOAD_UPLOADING && __atomic_load_n(&load->pendingUploads, __ATOMIC_ACQUIRE) == 0) {
+                FinishModelLoad(load);
+            } else if (stage == LOAD_FAILED) {
+                printf("[Model3D] ERROR: Failed to load the model '%s'\n", load->path);
+                FailModelLoad(load);
+            } else {
+                continue;
+            }
+
+            load->retiring = GLFW_TRUE;
+            load->retireFrame = engine->frameCount;
+        }
+
+        // Snapshots built before the swap may still draw the placeholder, it goes once they've all been submitted
+        if (load->placeholder != NULL && !placeholderReady) continue;
+        if (!JobCounterDone(&load->counter)) continue;
+        if (engine->frameCount < load->retireFrame + ENGINE_FRAME_SNAPSHOTS) continue;
+
+        ListRemoveIndex(modelLoads, (unsigned int)i);
+        RunOnRenderThread(FreeModelLoadTask, load);
+    }
+}
+
+void CancelModelLoads(void) {
+    if (modelLoads == NULL) return;
+
+    // Imports can't be interrupted, but nothing is queued from them anymore once they returned
+    foreach (ModelLoad *load, modelLoads) {
+        WaitForCounter(&load->counter);
+    }
+
+    DiscardGpuUploads();
+
+    foreach (ModelLoad *load, modelLoads) {
+        // Its models are released right after, the asset they free then holds nothing
+        if (!load->retiring) {
+            ModelAsset *shared = (ModelAsset *)load->asset->data;
+
+            shared->failed = GLFW_TRUE;
+            shared->load = NULL;
+
+            if (load->placeholderShown) {
+                foreach (Model3D *model, load->models) {
+                    if (model->placeholder) ListRemove(model->meshes, load->placeholder);
+                }
+            }
+        }
+
+        FreeModelLoad(load);
+    }
+
+    ListClear(modelLoads);
+    ListFreeMemory(modelLoads);
+    modelLoads = NULL;
+
+    InvalidateStateCache();
+}
@@ -0,0 +1,238 @@
+#include "picking.h"
+
+PickBuffer *NewPickBuffer(void) {
+    PickBuffer *pick = (PickBuffer *)malloc(sizeof(PickBuffer));
+    if (pick == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed creating new Pick Buffer, ERROR ALLOCATING MEMORY\n");
+        return NULL;
+    }
+
+    *pick = (PickBuffer){0};
+    pick->resultFrame = -1;
+
+    for (int i = 0; i < ENGINE_PICK_FRAMES; i++) {
+        glGenBuffers(1, &pick->reads[i].pixelBuffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pick->reads[i].pixelBuffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(GLuint), NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    glGenRenderbuffers(1, &pick->resolveBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, pick->resolveBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_R32UI, 1, 1);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &pick->resolveFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, pick->resolveFBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, pick->resolveBuffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "[PICKING ERROR] Pick resolve framebuffer is not complete\n");
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return pick;
+}
+
+void FreePickBuffer(PickBuffer *pick) {
+    if (pick == NULL) return;
+
+    for (int i = 0; i < ENGINE_PICK_FRAMES; i++) {
+        PickRead *read = &pick->reads[i];
+
+        if (read->fence != NULL) glDeleteSync(read->fence);
+        glDeleteBuffers(1, &read->pixelBuffer);
+        free(read->owners);
+    }
+
+    glDeleteFramebuffers(1, &pick->resolveFBO);
+    glDeleteRenderbuffers(1, &pick->resolveBuffer);
+    free(pick);
+}
+
+/* Binary search over the ID ranges, 0 & IDs past the last owner are the background */
+static const PickOwner *FindOwner(const PickRead *read, GLuint id) {
+    int low = 0, high = read->ownerCount - 1;
+
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        const PickOwner *owner = &read->owners[middle];
+
+        if (id < owner->firstID) {
+            high = middle - 1;
+        } else if (id >= owner->firstID + (GLuint)owner->count) {
+            low = middle + 1;
+        } else {
+            return owner;
+        }
+    }
+
+    return NULL;
+}
+
+static void DecodeRead(PickBuffer *pick, PickRead *read) {
+    GLuint id = 0;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, read->pixelBuffer);
+    glGetBufferSubData(GL_PIXEL_PACK_BUFFER, 0, sizeof(GLuint), &id);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    pick->stats.latencyFrames += pick->frame - read->frame;
+    pick->stats.resolved++;
+
+    // Slots can finish out of order on some drivers, never replace a newer answer
+    if (read->frame < pick->resultFrame) return;
+
+    const PickOwner *owner = FindOwner(read, id);
+
+    pick->object = (owner != NULL) ? owner->object : NULL;
+    pick->model = (owner != NULL) ? owner->model : NULL;
+    pick->instance = (owner != NULL) ? (int)(id - owner->firstID) : -1;
+    pick->resultFrame = read->frame;
+}
+
+/* Oldest first, a fence that hasn't signaled yet is simply checked again next frame */
+static void CollectReads(PickBuffer *pick) {
+    for (int n = 1; n <= ENGINE_PICK_FRAMES; n++) {
+        PickRead *read = &pick->reads[(pick->slot + n) % ENGINE_PICK_FRAMES];
+        if (read->fence == NULL) continue;
+
+        GLenum status = glClientWaitSync(read->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status == GL_TIMEOUT_EXPIRED) continue;
+
+        glDeleteSync(read->fence);
+        read->fence = NULL;
+
+        if (status != GL_WAIT_FAILED) DecodeRead(pick, read);
+    }
+}
+
+void PickBufferBegin(PickBuffer *pick, FrameBufferObject *frameBuffer) {
+    pick->frame++;
+    pick->active = GLFW_FALSE;
+
+    if (GetPickingMode() != PICKING_GPU) return;
+
+    double start = GetTimeSeconds();
+
+    CollectReads(pick);
+
+    pick->slot = (pick->slot + 1) % ENGINE_PICK_FRAMES;
+    PickRead *read = &pick->reads[pick->slot];
+
+    // The GPU is more than ENGINE_PICK_FRAMES behind, skip this frame rather than wait on it
+    if (read->fence != NULL) {
+        pick->stats.skipped++;
+        pick->stats.gpuSeconds += GetTimeSeconds() - start;
+        return;
+    }
+
+    read->ownerCount = 0;
+    read->nextID = 1;
+    read->frame = pick->frame;
+    pick->active = GLFW_TRUE;
+
+    const GLuint background[4] = {0, 0, 0, 0};
+
+    PickBufferWriteIDs(pick, frameBuffer, GLFW_TRUE);
+    glClearBufferuiv(GL_COLOR, 1, background);
+    PickBufferWriteIDs(pick, frameBuffer, GLFW_FALSE);
+
+    pick->stats.gpuSeconds += GetTimeSeconds() - start;
+}
+
+GLuint PickBufferRegister(PickBuffer *pick, SceneObject *object, Model3D *model, int instanceCount) {
+    if (pick == NULL || !pick->active) return 0;
+
+    PickRead *read = &pick->reads[pick->slot];
+    if (instanceCount < 1) instanceCount = 1;
+
+    if (read->ownerCount >= read->ownerCapacity) {
+        int capacity = (read->ownerCapacity > 0) ? read->ownerCapacity * 2 : 64;
+        PickOwner *owners = (PickOwner *)realloc(read->owners, (size_t)capacity * sizeof(PickOwner));
+
+        if (owners == NULL) {
+            fprintf(stderr, "[MEMORY ERROR] Failed growing pick owners to %d\n", capacity);
+            return 0;
+        }
+
+        read->owners = owners;
+        read->ownerCapacity = capacity;
+    }
+
+    GLuint firstID = read->nextID;
+
+    read->owners[read->ownerCount++] = (PickOwner){.object = object, .model = model, .firstID = firstID, .count = instanceCount};
+    read->nextID += (GLuint)instanceCount;
+
+    return firstID;
+}
+
+void PickBufferWriteIDs(PickBuffer *pick, FrameBufferObject *frameBuffer, bool enable) {
+    if (!pick->active) return;
+
+    static const GLenum both[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+
+    glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer->frameBufferID);
+    glDrawBuffers(enable ? 2 : 1, both);
+}
+
+void PickBufferRead(PickBuffer *pick, FrameBufferObject *frameBuffer) {
+    if (!pick->active) return;
+
+    double start = GetTimeSeconds();
+
+    // Cursor to framebuffer pixels, the window can be smaller than its framebuffer on high DPI screens
+    int windowWidth = pick->windowWidth, windowHeight = pick->windowHeight;
+
+    int width = pick->framebufferWidth, height = pick->framebufferHeight;
+    int x = (windowWidth > 0) ? (int)(pick->cursor.x * width / windowWidth) : 0;
+    int y = (windowHeight > 0) ? height - 1 - (int)(pick->cursor.y * height / windowHeight) : 0;
+
+    PickRead *read = &pick->reads[pick->slot];
+
+    if (x < 0 || y < 0 || x >= width || y >= height) {
+        // Nothing under a cursor outside the window, answered right away
+        read->ownerCount = 0;
+        pick->object = NULL;
+        pick->model = NULL;
+        pick->instance = -1;
+        pick->resultFrame = pick->frame;
+    } else {
+        // Multisampled integers can't be read directly, the 1x1 blit picks one sample of the pixel
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, frameBuffer->frameBufferID);
+        glReadBuffer(GL_COLOR_ATTACHMENT1);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, pick->resolveFBO);
+        glBlitFramebuffer(x, y, x + 1, y + 1, 0, 0, 1, 1, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, pick->resolveFBO);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, read->pixelBuffer);
+        glReadPixels(0, 0, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, (void *)0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        read->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        // The resolve blit in #DrawFrameBufferObject() reads the color attachment
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, frameBuffer->frameBufferID);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer->frameBufferID);
+
+    pick->stats.gpuSeconds += GetTimeSeconds() - start;
+    pick->stats.gpuFrames++;
+}
+
+void PrintPickStats(const PickBuffer *pick) {
+    const PickStats *stats = &pick->stats;
+
+    if (stats->cpuPicks > 0) {
+        printf("[PICKING] CPU: %.2f us per cursor event over %d picks\n", stats->cpuSeconds * 1e6 / stats->cpuPicks, stats->cpuPicks);
+    }
+
+    if (stats->gpuFrames > 0) {
+        printf("[PICKING] GPU: %.2f us per frame over %d frames, %.2f frames latency, %d frames skipped\n",
+               stats->gpuSeconds * 1e6 / stats->gpuFrames, stats->gpuFrames,
+               (stats->resolved > 0) ? (double)stats->latencyFrames / stats->resolved : 0.0, stats->skipped);
+    }
+}
@@ -0,0 +1,508 @@
+#include "profiler.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "glstate.h"
+#include "ui.h"
+
+#define PROFILE_EVENT_MASK ((uint64_t)ENGINE_PROFILER_EVENTS - 1)
+
+#if (ENGINE_PROFILER_EVENTS & (ENGINE_PROFILER_EVENTS - 1)) != 0
+#error "ENGINE_PROFILER_EVENTS must be a power of two"
+#endif
+
+/*
+ -> 'reserved' is bumped before a slot is overwritten & 'head' once it's written, a reader that copied event i checks
+    'reserved' afterwards: if the writer got to i + ENGINE_PROFILER_EVENTS in the meantime the copy may be torn.
+*/
+typedef struct ProfileThread {
+    char name[32];
+    uint64_t head, reserved;
+    int depth;  // owner only
+
+    ProfileEvent events[ENGINE_PROFILER_EVENTS];
+} ProfileThread;
+
+typedef struct GpuRange {
+    const char *name;
+    GLuint query;
+    uint64_t cpuStart;  // where the range lands on the GPU track, GL_TIME_ELAPSED only gives a duration
+} GpuRange;
+
+typedef struct GpuFrame {
+    GpuRange ranges[ENGINE_PROFILER_GPU_ZONES];
+    int count;
+} GpuFrame;
+
+static ProfileThread *threads[ENGINE_PROFILER_MAX_THREADS];
+static int threadCount;
+
+static _Thread_local ProfileThread *localThread;
+static _Thread_local bool registrationFailed;
+
+static uint64_t originTime;
+
+/* Render thread only */
+static ProfileThread *gpuTrack;
+static GpuFrame gpuFrames[ENGINE_PROFILER_GPU_FRAMES];
+static GLuint gpuQueries[ENGINE_PROFILER_GPU_FRAMES][ENGINE_PROFILER_GPU_ZONES];
+static int gpuSlot;
+static bool gpuReady, gpuActive;
+static uint64_t gpuCursor;
+static long gpuDropped;
+
+static ProfileThread *RegisterThread(const char *name) {
+    ProfileThread *thread = (ProfileThread *)malloc(sizeof(ProfileThread));
+    if (thread == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed creating new Profile Thread, ERROR ALLOCATING MEMORY\n");
+        return NULL;
+    }
+
+    thread->head = thread->reserved = 0;
+    thread->depth = 0;
+
+    int index = __atomic_fetch_add(&threadCount, 1, __ATOMIC_RELAXED);
+
+    if (index >= ENGINE_PROFILER_MAX_THREADS) {
+        fprintf(stderr, "[PROFILER ERROR] More than %d threads recorded zones, '%s' isn't profiled\n", ENGINE_PROFILER_MAX_THREADS, name);
+        free(thread);
+        return NULL;
+    }
+
+    snprintf(thread->name, sizeof(thread->name), "%s", name);
+
+    // Readers skip the slot until this lands
+    __atomic_store_n(&threads[index], thread, __ATOMIC_RELEASE);
+    return thread;
+}
+
+static ProfileThread *GetLocalThread(void) {
+    if (localThread != NULL || registrationFailed) return localThread;
+
+    char name[32];
+    snprintf(name, sizeof(name), "Thread %d", __atomic_load_n(&threadCount, __ATOMIC_RELAXED));
+
+    localThread = RegisterThread(name);
+    registrationFailed = localThread == NULL;
+
+    return localThread;
+}
+
+static void PushEvent(ProfileThread *thread, ProfileEvent event) {
+    uint64_t index = thread->head;
+
+    __atomic_store_n(&thread->reserved, index + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    thread->events[index & PROFILE_EVENT_MASK] = event;
+
+    __atomic_store_n(&thread->head, index + 1, __ATOMIC_RELEASE);
+}
+
+/* False when the slot was overwritten while it was copied, the copy has to be thrown away */
+static bool ReadEvent(ProfileThread *thread, uint64_t index, ProfileEvent *event) {
+    *event = thread->events[index & PROFILE_EVENT_MASK];
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&thread->reserved, __ATOMIC_RELAXED) <= index + ENGINE_PROFILER_EVENTS;
+}
+
+void InitProfiler(void) {
+    originTime = GetTimeNanoseconds();
+
+    ProfilerSetThreadName("Main");
+    gpuTrack = RegisterThread("GPU");
+}
+
+void ShutdownProfiler(void) {
+    if (gpuReady) {
+        glDeleteQueries(ENGINE_PROFILER_GPU_FRAMES * ENGINE_PROFILER_GPU_ZONES, &gpuQueries[0][0]);
+        gpuReady = GLFW_FALSE;
+    }
+
+    int count = __atomic_load_n(&threadCount, __ATOMIC_ACQUIRE);
+    if (count > ENGINE_PROFILER_MAX_THREADS) count = ENGINE_PROFILER_MAX_THREADS;
+
+    for (int i = 0; i < count; i++) {
+        free(threads[i]);
+        threads[i] = NULL;
+    }
+
+    threadCount = 0;
+    gpuTrack = NULL;
+    localThread = NULL;
+}
+
+void ProfilerSetThreadName(const char *name) {
+    ProfileThread *thread = GetLocalThread();
+    if (thread == NULL) return;
+
+    snprintf(thread->name, sizeof(thread->name), "%s", name);
+}
+
+ProfileZone ProfileZoneBegin(const char *name) {
+    ProfileThread *thread = GetLocalThread();
+    if (thread != NULL) thread->depth++;
+
+    return (ProfileZone){.name = name, .start = GetTimeNanoseconds()};
+}
+
+void ProfileZoneEnd(ProfileZone *zone) {
+    uint64_t end = GetTimeNanoseconds();
+
+    ProfileThread *thread = localThread;
+    if (thread == NULL) return;
+
+    thread->depth--;
+    PushEvent(thread, (ProfileEvent){.name = zone->name, .start = zone->start, .end = end, .depth = thread->depth});
+}
+
+/* Ranges finish in the order they were issued, the last one being available means all of them are */
+static void CollectGpuFrame(GpuFrame *frame) {
+    if (frame->count == 0) return;
+
+    GLint available = 0;
+    glGetQueryObjectiv(frame->ranges[frame->count - 1].query, GL_QUERY_RESULT_AVAILABLE, &available);
+
+    if (!available) {
+        // Waiting would stall the pipeline the profiler is measuring, the frame is left out instead
+        gpuDropped++;
+        frame->count = 0;
+        return;
+    }
+
+    for (int i = 0; i < frame->count; i++) {
+        GpuRange *range = &frame->ranges[i];
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(range->query, GL_QUERY_RESULT, &elapsed);
+
+        // Ranges don't overlap on the GPU, each one starts after the previous one ended at the earliest
+        uint64_t start = (range->cpuStart > gpuCursor) ? range->cpuStart : gpuCursor;
+        gpuCursor = start + elapsed;
+
+        if (gpuTrack != NULL) {
+            PushEvent(gpuTrack, (ProfileEvent){.name = range->name, .start = start, .end = gpuCursor, .depth = 0});
+        }
+    }
+
+    frame->count = 0;
+}
+
+void ProfileGpuFrameBegin(void) {
+    if (!gpuReady) {
+        glGenQueries(ENGINE_PROFILER_GPU_FRAMES * ENGINE_PROFILER_GPU_ZONES, &gpuQueries[0][0]);
+        gpuReady = GLFW_TRUE;
+    }
+
+    gpuSlot = (gpuSlot + 1) % ENGINE_PROFILER_GPU_FRAMES;
+    CollectGpuFrame(&gpuFrames[gpuSlot]);
+}
+
+ProfileGpuZone ProfileGpuZoneBegin(const char *name) {
+    ProfileGpuZone zone = {.zone = ProfileZoneBegin(name), .query = GLFW_FALSE};
+    GpuFrame *frame = &gpuFrames[gpuSlot];
+
+    // GL_TIME_ELAPSED queries can't nest
+    if (!gpuReady || gpuActive || frame->count >= ENGINE_PROFILER_GPU_ZONES) return zone;
+
+    GpuRange *range = &frame->ranges[frame->count];
+    range->name = name;
+    range->query = gpuQueries[gpuSlot][frame->count];
+    range->cpuStart = zone.zone.start;
+    frame->count++;
+
+    glBeginQuery(GL_TIME_ELAPSED, range->query);
+    gpuActive = GLFW_TRUE;
+    zone.query = GLFW_TRUE;
+
+    return zone;
+}
+
+void ProfileGpuZoneEnd(ProfileGpuZone *zone) {
+    if (zone->query) {
+        glEndQuery(GL_TIME_ELAPSED);
+        gpuActive = GLFW_FALSE;
+    }
+
+    ProfileZoneEnd(&zone->zone);
+}
+
+static int GetTrackCount(void) {
+    int count = __atomic_load_n(&threadCount, __ATOMIC_ACQUIRE);
+    return (count < ENGINE_PROFILER_MAX_THREADS) ? count : ENGINE_PROFILER_MAX_THREADS;
+}
+
+static void AddSummaryEvent(ProfileSummary *summary, const ProfileEvent *event, bool gpu) {
+    ProfileSummaryRow *row = NULL;
+
+    for (int i = 0; i < summary->rowCount; i++) {
+        ProfileSummaryRow *candidate = &summary->rows[i];
+
+        if (candidate->gpu == gpu && (candidate->name == event->name || strcmp(candidate->name, event->name) == 0)) {
+            row = candidate;
+            break;
+        }
+    }
+
+    if (row == NULL) {
+        int capacity = (int)(sizeof(summary->rows) / sizeof(summary->rows[0]));
+        if (summary->rowCount >= capacity) return;
+
+        row = &summary->rows[summary->rowCount++];
+        *row = (ProfileSummaryRow){.name = event->name, .gpu = gpu};
+    }
+
+    double seconds = (double)(event->end - event->start) * 1e-9;
+
+    row->calls++;
+    row->total += seconds;
+    if (seconds > row->max) row->max = seconds;
+}
+
+static int CompareSummaryRows(const void *a, const void *b) {
+    double difference = ((const ProfileSummaryRow *)b)->total - ((const ProfileSummaryRow *)a)->total;
+    return (difference > 0.0) - (difference < 0.0);
+}
+
+ProfileSummary GetProfileSummary(double seconds) {
+    ProfileSummary summary = {.rowCount = 0, .seconds = seconds};
+
+    uint64_t now = GetTimeNanoseconds();
+    uint64_t window = (uint64_t)(seconds * 1e9);
+    uint64_t from = (now > window) ? now - window : 0;
+
+    int count = GetTrackCount();
+
+    for (int t = 0; t < count; t++) {
+        ProfileThread *thread = __atomic_load_n(&threads[t], __ATOMIC_ACQUIRE);
+        if (thread == NULL) continue;
+
+        uint64_t head = __atomic_load_n(&thread->head, __ATOMIC_ACQUIRE);
+        uint64_t first = (head > ENGINE_PROFILER_EVENTS) ? head - ENGINE_PROFILER_EVENTS : 0;
+
+        // Events are pushed when they end, so walking back from the newest stops at the first one before the window
+        for (uint64_t i = head; i > first; i--) {
+            ProfileEvent event;
+
+            if (!ReadEvent(thread, i - 1, &event)) break;
+            if (event.end < from) break;
+
+            AddSummaryEvent(&summary, &event, thread == gpuTrack);
+        }
+    }
+
+    qsort(summary.rows, (size_t)summary.rowCount, sizeof(ProfileSummaryRow), CompareSummaryRows);
+    return summary;
+}
+
+void PrintProfileSummary(const ProfileSummary *summary) {
+    printf("[PROFILER] Zones over the last %.2f s:\n", summary->seconds);
+
+    for (int i = 0; i < summary->rowCount; i++) {
+        const ProfileSummaryRow *row = &summary->rows[i];
+
+        printf("    %s%-28s %8d calls %10.3f ms avg %10.3f ms max %6.1f%%\n", row->gpu ? "GPU " : "    ", row->name, row->calls,
+               row->total * 1e3 / row->calls, row->max * 1e3, row->total * 100.0 / summary->seconds);
+    }
+
+    if (gpuDropped > 0) {
+        printf("    %ld GPU frames weren't ready after %d frames & were left out\n", gpuDropped, ENGINE_PROFILER_GPU_FRAMES);
+    }
+}
+
+void DrawProfilerOverlay(const UIFrame *frame) {
+    static ProfileSummary summary;
+    static double lastRefresh = -1.0;
+
+    double now = GetTimeSeconds();
+
+    if (lastRefresh < 0.0 || now - lastRefresh >= ENGINE_PROFILER_OVERLAY_REFRESH) {
+        summary = GetProfileSummary(ENGINE_PROFILER_OVERLAY_WINDOW);
+        lastRefresh = now;
+    }
+
+    NVGcontext *vg = engine->vgContext;
+    const float lineHeight = 16.0f, padding = 10.0f, width = 420.0f;
+    int lines = (summary.rowCount < 24) ? summary.rowCount : 24;
+
+    nvgBeginFrame(vg, frame->windowWidth, frame->windowHeight, frame->pixelRatio);
+
+    float x = frame->windowWidth - width - padding;
+    float y = padding;
+
+    nvgBeginPath(vg);
+    nvgRect(vg, x, y, width, (lines + 1) * lineHeight + padding);
+    nvgFillColor(vg, nvgRGBA(0, 0, 0, 160));
+    nvgFill(vg);
+
+    nvgFontSize(vg, 14.0f);
+    nvgFontFaceId(vg, engine->defaultFont);
+    nvgTextAlign(vg, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+    nvgFillColor(vg, nvgRGBA(255, 255, 255, 255));
+
+    char text[128];
+    snprintf(text, sizeof(text), "Zone (last %.1f s)          calls     avg ms     max ms", summary.seconds);
+    nvgText(vg, x + padding, y + padding * 0.5f, text, NULL);
+
+    for (int i = 0; i < lines; i++) {
+        ProfileSummaryRow *row = &summary.rows[i];
+
+        snprintf(text, sizeof(text), "%s%-24.24s %6d %10.3f %10.3f", row->gpu ? "GPU " : "", row->name, row->calls,
+                 row->total * 1e3 / row->calls, row->max * 1e3);
+
+        nvgFillColor(vg, row->gpu ? nvgRGBA(255, 200, 120, 255) : nvgRGBA(255, 255, 255, 255));
+        nvgText(vg, x + padding, y + padding * 0.5f + (i + 1) * lineHeight, text, NULL);
+    }
+
+    // NanoVG's GL3 backend binds its own program, VAO, textures & blend state on flush
+    nvgEndFrame(vg);
+    InvalidateStateCache();
+}
+
+static void WriteJsonString(FILE *file, const char *string) {
+    fputc('"', file);
+
+    for (const char *c = string; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', file);
+            fputc(*c, file);
+        } else if ((unsigned char)*c >= 0x20) {
+            fputc(*c, file);
+        }
+    }
+
+    fputc('"', file);
+}
+
+bool ProfilerExportChromeTrace(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "[PROFILER ERROR] Failed opening '%s' for the trace\n", path);
+        return GLFW_FALSE;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    int count = GetTrackCount();
+    long written = 0;
+
+    for (int t = 0; t < count; t++) {
+        ProfileThread *thread = __atomic_load_n(&threads[t], __ATOMIC_ACQUIRE);
+        if (thread == NULL) continue;
+
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", (written++ > 0) ? ",\n" : "", t);
+        WriteJsonString(file, thread->name);
+        fprintf(file, "}}");
+
+        uint64_t head = __atomic_load_n(&thread->head, __ATOMIC_ACQUIRE);
+        uint64_t first = (head > ENGINE_PROFILER_EVENTS) ? head - ENGINE_PROFILER_EVENTS : 0;
+
+        for (uint64_t i = first; i < head; i++) {
+            ProfileEvent event;
+            if (!ReadEvent(thread, i, &event)) continue;
+
+            // Complete events, microseconds since #InitProfiler()
+            fprintf(file, ",\n{\"name\":");
+            WriteJsonString(file, event.name);
+            fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", (thread == gpuTrack) ? "gpu" : "cpu", t,
+                    ((double)event.start - (double)originTime) * 1e-3, (double)(event.end - event.start) * 1e-3);
+            written++;
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+
+    bool success = !ferror(file);
+    fclose(file);
+
+    if (success) {
+        printf("[PROFILER] Wrote %ld trace events to '%s'\n", written, path);
+    } else {
+        fprintf(stderr, "[PROFILER ERROR] Failed writing the trace to '%s'\n", path);
+    }
+
+    return success;
+}
+
+#ifdef ENGINE_SELF_TESTS
+
+typedef struct ProfilerTestWriter {
+    int zones;
+    ProfileThread *thread;  // NULL when it couldn't register
+    bool ready;             // 'thread' is set
+} ProfilerTestWriter;
+
+static const char *selfTestZone = "Profiler self test";
+
+static void *ProfilerTestWrite(void *argument) {
+    ProfilerTestWriter *writer = (ProfilerTestWriter *)argument;
+
+    ProfilerSetThreadName(selfTestZone);
+    writer->thread = localThread;
+    __atomic_store_n(&writer->ready, GLFW_TRUE, __ATOMIC_RELEASE);
+
+    for (int i = 0; i < writer->zones; i++) {
+        PROFILE_ZONE(selfTestZone);
+    }
+
+    return NULL;
+}
+
+bool ProfilerSelfTest(int zones) {
+    ProfilerTestWriter writer = {.zones = zones, .thread = NULL, .ready = GLFW_FALSE};
+    pthread_t thread;
+
+    if (pthread_create(&thread, NULL, ProfilerTestWrite, &writer) != 0) {
+        fprintf(stderr, "[PROFILER TEST] Failed starting the writer thread\n");
+        return false;
+    }
+
+    // Reads race the writer the whole time, every event that passes #ReadEvent() has to be one it wrote completely
+    while (!__atomic_load_n(&writer.ready, __ATOMIC_ACQUIRE)) sched_yield();
+    ProfileThread *track = writer.thread;
+
+    long checked = 0, torn = 0, discarded = 0;
+    bool ok = true;
+
+    while (track != NULL) {
+        uint64_t head = __atomic_load_n(&track->head, __ATOMIC_ACQUIRE);
+        uint64_t first = (head > ENGINE_PROFILER_EVENTS) ? head - ENGINE_PROFILER_EVENTS : 0;
+
+        for (uint64_t i = first; i < head; i += 7) {
+            ProfileEvent event;
+
+            if (!ReadEvent(track, i, &event)) {
+                discarded++;
+                continue;
+            }
+
+            checked++;
+            if (event.name != selfTestZone || event.end < event.start || event.depth != 0) torn++;
+        }
+
+        if (head >= (uint64_t)zones) break;
+    }
+
+    pthread_join(thread, NULL);
+
+    if (track == NULL || __atomic_load_n(&track->head, __ATOMIC_ACQUIRE) != (uint64_t)zones) {
+        fprintf(stderr, "[PROFILER TEST] Writer didn't record %d zones\n", zones);
+        ok = false;
+    }
+
+    if (torn > 0) {
+        fprintf(stderr, "[PROFILER TEST] %ld of %ld events read back torn\n", torn, checked);
+        ok = false;
+    }
+
+    printf("[PROFILER TEST] %d zones, %ld events checked while written, %ld overwritten during the read: %s\n", zones, checked, discarded,
+           ok ? "OK" : "FAILED");
+    return ok;
+}
+
+#endif  // ENGINE_SELF_TESTS
@@ -1,11 +1,23 @@
 #include "render.h"
 
+#include "debugdraw.h"
+#include "instancering.h"
+#include "profiler.h"
+#include "renderthread.h"
 #include "shader.h"
 #include "stb_image.h"
 #include "utils.h"
 
 static SceneObject *mainFrameBufferScreenQuad = NULL;
 
+/* GL names of a removed scene object, the snapshots in flight still draw its VAO */
+typedef struct RetiredObject {
+    GLuint VAO, VBO, EBO;
+    long retireFrame;
+} RetiredObject;
+
+static List *retiredObjects;  // List <RetiredObject *>, main thread
+
 void BindBufferObj(SceneObject *object);
 
 static SceneObject *CreateScreenQuad(FrameBufferObject *frameBuffer) {
@@ -51,18 +63,17 @@ static void DrawFrameBufferObject(FrameBufferObject *frameBuffer) {
     glBlitFramebuffer(0, 0, engine->windowWidth, engine->windowHeight, 0, 0, engine->windowWidth, engine->windowHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
 
     // 3. now render quad with scene's visuals as its texture image
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, engine->outputFramebuffer);
     glClearColor(ENGINE_BACKGROUND_COLOR);
     glClear(GL_COLOR_BUFFER_BIT);
-    glDisable(GL_DEPTH_TEST);
+    StateDisable(GL_DEPTH_TEST);
 
     if (mainFrameBufferScreenQuad) {
         // draw Screen quad
         UseShader(*mainFrameBufferScreenQuad->shader);
         setInt(*mainFrameBufferScreenQuad->shader, "screenTexture", 0);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, frameBuffer->screenTexture);  // use the now resolved color attachment as the mainFrameBufferScreenQuad's texture
+        StateBindTexture(0, GL_TEXTURE_2D, frameBuffer->screenTexture);  // use the now resolved color attachment as the mainFrameBufferScreenQuad's texture
 
         mainFrameBufferScreenQuad->draw(mainFrameBufferScreenQuad);
     } else {
@@ -83,11 +94,18 @@ FrameBufferObject *BindFrameBuffer(FrameBufferObject frameBuffer) {
     glBindFramebuffer(GL_FRAMEBUFFER, newFrameBuffer->frameBufferID);
 
     glGenTextures(1, &newFrameBuffer->texColorBufferID);
-    glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, newFrameBuffer->texColorBufferID);
+    StateBindTexture(0, GL_TEXTURE_2D_MULTISAMPLE, newFrameBuffer->texColorBufferID);
     glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, 4, GL_RGB, engine->windowWidth, engine->windowHeight, GL_TRUE);
-    glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
+    StateBindTexture(0, GL_TEXTURE_2D_MULTISAMPLE, 0);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D_MULTISAMPLE, newFrameBuffer->texColorBufferID, 0);
 
+    // Object IDs for GPU picking, same sample count as the color so both can be drawn to at once (see picking.h)
+    glGenTextures(1, &newFrameBuffer->pickTextureID);
+    StateBindTexture(0, GL_TEXTURE_2D_MULTISAMPLE, newFrameBuffer->pickTextureID);
+    glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, 4, GL_R32UI, engine->windowWidth, engine->windowHeight, GL_TRUE);
+    StateBindTexture(0, GL_TEXTURE_2D_MULTISAMPLE, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D_MULTISAMPLE, newFrameBuffer->pickTextureID, 0);
+
     glGenRenderbuffers(1, &newFrameBuffer->depthStencilBufferID);
     glBindRenderbuffer(GL_RENDERBUFFER, newFrameBuffer->depthStencilBufferID);
     glRenderbufferStorageMultisample(GL_RENDERBUFFER, 4, GL_DEPTH24_STENCIL8, engine->windowWidth, engine->windowHeight);
@@ -105,7 +123,7 @@ FrameBufferObject *BindFrameBuffer(FrameBufferObject frameBuffer) {
 
     // create a color attachment texture
     glGenTextures(1, &newFrameBuffer->screenTexture);
-    glBindTexture(GL_TEXTURE_2D, newFrameBuffer->screenTexture);
+    StateBindTexture(0, GL_TEXTURE_2D, newFrameBuffer->screenTexture);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, engine->windowWidth, engine->windowHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -127,104 +145,136 @@ FrameBufferObject *BindFrameBuffer(FrameBufferObject frameBuffer) {
 }
 
 static void HandleShaderTransform(SceneObject *object, Model3D *ourModel, Shader *shader, bool isInstanced) {
-    int instanceCount = (object != NULL) ? object->instanceCount : ourModel->instanceCount;
-    Transform *transforms = (object != NULL) ? object->transforms : ourModel->transforms;
-
-    if (isInstanced) {
-        mat4s instanceMatrices[instanceCount];
+    // Instanced matrices were already streamed into the instance ring by #StreamInstanceMatrices()
+    if (isInstanced) return;
 
-        for (int i = 0; i < instanceCount; i++) {
-            Transform transform = transforms[i];
-            mat4s model = glms_mat4_identity();
+    Transform *transform = (object != NULL) ? &object->transforms[0] : &ourModel->transforms[0];
+    setUniformMat4(shader, shader->handles.model, GetTransformMatrix(transform));
+}
 
-            model = glms_translate(model, transform.position);
-            model = glms_rotate(model, glm_rad(transform.rotationDegrees), transform.rotation);
-            model = glms_scale(model, transform.scale);
+int StreamInstanceMatrices(SceneObject *object, Model3D *model) {
+    int instanceCount = (object != NULL) ? object->instanceCount : model->instanceCount;
+    Transform *transforms = (object != NULL) ? object->transforms : model->transforms;
 
-            instanceMatrices[i] = model;
-        }
+    int baseInstance = (instanceCount > 1) ? WriteInstanceMatrices(engine->instanceRing, transforms, instanceCount) : -1;
 
-        UpdateInstancedBufferObj(object, ourModel, instanceMatrices, instanceCount);
+    if (object != NULL) {
+        object->baseInstance = baseInstance;
     } else {
-        // Non-instanced handling
-        Transform transform = transforms[0];
-        mat4s model = glms_mat4_identity();
+        model->baseInstance = baseInstance;
+    }
 
-        model = glms_translate(model, transform.position);
-        model = glms_rotate(model, glm_rad(transform.rotationDegrees), transform.rotation);
-        model = glms_scale(model, transform.scale);
+    return baseInstance;
+}
 
-        setMat4(*shader, "model", &model);
-    }
+void InitFrameUniforms(void) {
+    glGenBuffers(1, &engine->frameUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, engine->frameUBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, ENGINE_FRAME_UNIFORM_BINDING, engine->frameUBO);
 }
 
-void SendToShader(SceneObject *object, Model3D *model) {
+void FillFrameUniforms(Camera *camera, FrameUniforms *frame) {
+    // The only place the camera matrices & frustum get rebuilt during a frame
     camera->update(camera);
 
+    frame->view = camera->view;
+    frame->projection = camera->projection;
+    frame->viewProjection = glms_mat4_mul(camera->projection, camera->view);
+    frame->cameraPosition = glms_vec4(camera->renderPosition, 1.0f);
+    frame->time = (float)glfwGetTime();
+}
+
+void UploadFrameUniforms(const FrameUniforms *frame) {
+    glBindBuffer(GL_UNIFORM_BUFFER, engine->frameUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), frame);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // Re-bind every frame, other code (NanoVG) is free to use the indexed binding points
+    glBindBufferBase(GL_UNIFORM_BUFFER, ENGINE_FRAME_UNIFORM_BINDING, engine->frameUBO);
+}
+
+void FreeFrameUniforms(void) {
+    if (engine->frameUBO != 0) {
+        glDeleteBuffers(1, &engine->frameUBO);
+        engine->frameUBO = 0;
+    }
+}
+
+Shader *GetObjectShader(SceneObject *object, Model3D *model) {
+    int instanceCount = (object != NULL) ? object->instanceCount : model->instanceCount;
+
+    if (instanceCount > 1) {
+        return instanceShader;
+    }
+
+    return (object != NULL) ? object->shader : model->shader;
+}
+
+void SendObjectUniforms(Shader *shader, SceneObject *object, Model3D *model) {
     int instanceCount = (object != NULL) ? object->instanceCount : model->instanceCount;
 
-    Shader *shader = (object != NULL) ? object->shader : model->shader;
     Texture *texture = (object != NULL) ? object->texture : model->texture;
     vec3s color = (object != NULL) ? object->color : model->color;
     Clickable clickable = (object != NULL) ? object->clickable : model->clickable;
 
-    ObjectType type;
-    if (object != NULL) {
-        type = object->type;
+    ObjectType type = (object != NULL) ? object->type : OBJECT_3D_MODEL;
+    bool isInstanced = instanceCount > 1;
+
+    if (isInstanced) {
+        setUniformVec3(shader, shader->handles.color, &color);
+        setUniformInt(shader, shader->handles.instanceCount, instanceCount);
+    } else {
+        setUniformVec3(shader, shader->handles.color, (!clickable.isHovered) ? &color : &clickable.hoverColor);
     }
 
-    if (instanceCount > 1) {
-        UseShader(*instanceShader);
-        setMat4(*instanceShader, "projection", &camera->projection);
-        setMat4(*instanceShader, "view", &camera->view);
-        setVec3(*instanceShader, "color", &color);
-        setInt(*instanceShader, "instanceCount", instanceCount);
+    bool isSprite = (type & (OBJECT_SPRITE_BILLBOARD | OBJECT_SPRITE_STATIC | OBJECT_CAMERA)) != 0;
+    setUniformBool(shader, shader->handles.isSprite, isSprite);
+    setUniformBool(shader, shader->handles.isBillboard, isSprite && (type & OBJECT_SPRITE_BILLBOARD));
 
-        if (type & (OBJECT_SPRITE_BILLBOARD | OBJECT_SPRITE_STATIC | OBJECT_CAMERA)) {
-            setBool(*shader, "isSprite", GLFW_TRUE);
+    HandleShaderTransform(object, model, shader, isInstanced);
 
-            if (type & OBJECT_SPRITE_BILLBOARD) {
-                setBool(*shader, "isBillboard", GLFW_TRUE);
-            }
-        } else {
-            setBool(*shader, "isSprite", GLFW_FALSE);
-            setBool(*shader, "isBillboard", GLFW_FALSE);
-        }
+    setUniformBool(shader, shader->handles.useTexture, texture != NULL);
+    if (texture != NULL) {
+        setUniformInt(shader, shader->handles.texture1, 0);
+    }
+}
 
-        HandleShaderTransform(object, model, instanceShader, GLFW_TRUE);
+void SendToShader(SceneObject *object, Model3D *model) {
+    PROFILE_ZONE("SendToShader");
 
-        if (texture != NULL) {
-            setBool(*instanceShader, "useTexture", GLFW_TRUE);
-            setInt(*instanceShader, "texture1", 0);
-        } else {
-            setBool(*instanceShader, "useTexture", GLFW_FALSE);
-        }
+    Shader *shader = GetObjectShader(object, model);
+
+    UseShader(*shader);
+    SendObjectUniforms(shader, object, model);
+}
+
+static void RebuildBoundingBoxMatrix(BoundingBox *boundingBox, Transform *transform) {
+    vec3s expansion = boundingBox->expansion;
+
+    if (expansion.x == 0.0f && expansion.y == 0.0f && expansion.z == 0.0f) {
+        boundingBox->model = *GetTransformMatrix(transform);
     } else {
-        UseShader(*shader);
-        setMat4(*shader, "projection", &camera->projection);
-        setMat4(*shader, "view", &camera->view);
-        setVec3(*shader, "color", (!clickable.isHovered) ? &color : &clickable.hoverColor);
+        Transform expanded = *transform;
+        expanded.scale = glms_vec3_add(transform->scale, expansion);
 
-        if (type & (OBJECT_SPRITE_BILLBOARD | OBJECT_SPRITE_STATIC | OBJECT_CAMERA)) {
-            setBool(*shader, "isSprite", GLFW_TRUE);
+        boundingBox->model = ComposeTransform(&expanded);
+        GetTransformMatrix(transform);
+    }
 
-            if (type & (OBJECT_SPRITE_BILLBOARD)) {
-                setBool(*shader, "isBillboard", GLFW_TRUE);
-            }
-        } else {
-            setBool(*shader, "isSprite", GLFW_FALSE);
-            setBool(*shader, "isBillboard", GLFW_FALSE);
-        }
+    boundingBox->transformVersion = transform->version;
+}
 
-        HandleShaderTransform(object, model, shader, GLFW_FALSE);
+mat4s *GetBoundingBoxMatrix(BoundingBox *boundingBox, Transform *transform) {
+    GetTransformMatrix(transform);
 
-        if (texture != NULL) {
-            setBool(*shader, "useTexture", GLFW_TRUE);
-            setInt(*shader, "texture1", 0);
-        } else {
-            setBool(*shader, "useTexture", GLFW_FALSE);
-        }
+    if (boundingBox->transformVersion != transform->version) {
+        RebuildBoundingBoxMatrix(boundingBox, transform);
     }
+
+    return &boundingBox->model;
 }
 
 void ExpandBoundingBox(SceneObject *object, Model3D *model, vec3s offset) {
@@ -234,15 +284,9 @@ void ExpandBoundingBox(SceneObject *object, Model3D *model, vec3s offset) {
     if (boundingBox != NULL) {
         boundingBox->min = glms_vec3_sub(boundingBox->min, offset);
         boundingBox->max = glms_vec3_add(boundingBox->max, offset);
+        boundingBox->expansion = offset;
 
-        mat4s modelMatrix = glms_mat4_identity();
-        modelMatrix = glms_translate(modelMatrix, transforms->position);
-        modelMatrix = glms_rotate(modelMatrix, glm_rad(transforms->rotationDegrees), transforms->rotation);
-
-        vec3s scalar = (vec3s)glms_vec3_add(transforms->scale, offset);
-        modelMatrix = glms_scale(modelMatrix, scalar);
-
-        boundingBox->model = modelMatrix;
+        RebuildBoundingBoxMatrix(boundingBox, transforms);
     }
 }
 
@@ -251,133 +295,24 @@ void DrawBoundingBox(SceneObject *object, Model3D *ourModel) {
     Transform *transforms = (object != NULL) ? object->transforms : ourModel->transforms;
 
     if (boundingBox != NULL) {
-        UseShader(*miscShader);
-        setMat4(*miscShader, "projection", &camera->projection);
-        setMat4(*miscShader, "view", &camera->view);
-        setMat4(*miscShader, "model", &boundingBox->model);
-        setVec3(*miscShader, "color", &boundingBox->color);
-
-        glBindVertexArray(boundingBox->VAO);
-        glDrawElements(GL_LINES, ENGINE_BOUNDING_BOX_VERTEX_COUNT, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        DebugDrawBox(engine->debugList, boundingBox->min, boundingBox->max, GetBoundingBoxMatrix(boundingBox, transforms),
+                     boundingBox->color, ENGINE_BOUNDING_BOX_LINE_WIDTH);
     }
 }
 
 void DrawLine(Line line) {
-    float width = line.width;
-
-    if (width <= 0.0f) {
-        width = 1.0f;
-    }
-
-    mat4s model = glms_mat4_identity();
-
-    UseShader(*defaultShader);
-    setMat4(*defaultShader, "projection", &camera->projection);
-    setMat4(*defaultShader, "view", &camera->view);
-    setMat4(*defaultShader, "model", &model);
-    setVec3(*defaultShader, "color", &line.color);
-    setBool(*defaultShader, "isSprite", GLFW_FALSE);
-    setBool(*defaultShader, "isBillboard", GLFW_FALSE);
-
-    if (line.texture != NULL) {
-        setInt(*defaultShader, "texture1", 0);
-        setBool(*defaultShader, "useTexture", GLFW_TRUE);
-    } else {
-        setBool(*defaultShader, "useTexture", GLFW_FALSE);
-    }
-
-    UseTexture(line.texture);
-
-    vec3s start = line.start;
-    vec3s end = line.end;
-
-    float vertices[] = {
-        start.raw[0], start.raw[1], start.raw[2], 0.0f, 0.0f,
-        end.raw[0], end.raw[1], end.raw[2], 1.0f, 1.0f};
-
-    // GLuint VAO, VBO;
-    glGenVertexArrays(1, &line.VAO);
-    glGenBuffers(1, &line.VBO);
-
-    glBindVertexArray(line.VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, line.VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    // Enable vertex attributes
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)0);  // Position
-    glEnableVertexAttribArray(0);
-
-    if (line.texture != NULL) {
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)(3 * sizeof(float)));  // TexCoords
-        glEnableVertexAttribArray(1);
-    }
-
-    // Draw the line
-    glBindVertexArray(line.VAO);
-    glLineWidth(width);
-    glDrawArrays(GL_LINES, 0, 2);
-    glBindVertexArray(0);
-
-    // Cleanup
-    glDeleteVertexArrays(1, &line.VAO);
-    glDeleteBuffers(1, &line.VBO);
+    DebugDrawLine(engine->debugList, line.start, line.end, line.color, line.width);
 }
 
 void DrawTriangle(Triangle triangle) {
-    Transform transform = triangle.transform;
-    mat4s model = glms_mat4_identity();
-    model = glms_translate(model, transform.position);
-    model = glms_rotate(model, glm_rad(transform.rotationDegrees), transform.rotation);
-    model = glms_scale(model, transform.scale);
-
-    UseShader(*defaultShader);
-    setMat4(*defaultShader, "projection", &camera->projection);
-    setMat4(*defaultShader, "view", &camera->view);
-    setMat4(*defaultShader, "model", &model);
-    setVec3(*defaultShader, "color", &triangle.color);
-    setBool(*defaultShader, "isSprite", GLFW_FALSE);
-    setBool(*defaultShader, "isBillboard", GLFW_FALSE);
-
-    if (triangle.texture != NULL) {
-        setInt(*defaultShader, "texture1", 0);
-        setBool(*defaultShader, "useTexture", GLFW_TRUE);
-    } else {
-        setBool(*defaultShader, "useTexture", GLFW_FALSE);
-    }
-
-    float vertices[] = {
-        // Positions         // Texture Coords
-        0.0f, 0.5f, 0.0f, 0.5f, 1.0f,    // Top vertex
-        -0.5f, -0.5f, 0.0f, 0.0f, 0.0f,  // Bottom-left vertex
-        0.5f, -0.5f, 0.0f, 1.0f, 0.0f    // Bottom-right vertex
-    };
+    mat4s model = ComposeTransform(&triangle.transform);
 
-    // GLuint VAO, VBO;
-    glGenVertexArrays(1, &triangle.VAO);
-    glGenBuffers(1, &triangle.VBO);
+    // Same unit triangle the gizmo arrow heads have always used, moved to world space here
+    vec3s a = glms_mat4_mulv3(model, (vec3s){{0.0f, 0.5f, 0.0f}}, 1.0f);
+    vec3s b = glms_mat4_mulv3(model, (vec3s){{-0.5f, -0.5f, 0.0f}}, 1.0f);
+    vec3s c = glms_mat4_mulv3(model, (vec3s){{0.5f, -0.5f, 0.0f}}, 1.0f);
 
-    glBindVertexArray(triangle.VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, triangle.VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    // Enable vertex attributes
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)0);  // Position
-    glEnableVertexAttribArray(0);
-
-    if (triangle.texture != NULL) {
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)(3 * sizeof(float)));  // Texture
-        glEnableVertexAttribArray(1);
-    }
-
-    // Draw the triangle
-    glBindVertexArray(triangle.VAO);
-    glDrawArrays(GL_TRIANGLES, 0, 3);
-    glBindVertexArray(0);
-
-    // Cleanup
-    glDeleteVertexArrays(1, &triangle.VAO);
-    glDeleteBuffers(1, &triangle.VBO);
+    DebugDrawTriangle(engine->debugList, a, b, c, triangle.color);
 }
 
 void GenerateTransformGizmo(SceneObject *object, Model3D *model) {
@@ -513,45 +448,60 @@ void DrawTransformGizmo(SceneObject *object, Model3D *model) {
 static void DrawSceneObject(SceneObject *object) {
     char *tag = object->tag;
 
-    glLineWidth(1.0f);
+    StateLineWidth(1.0f);
 
     if (object->type == OBJECT_SPRITE_STATIC || object->type == OBJECT_SPRITE_BILLBOARD || object->type == OBJECT_CAMERA) {
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        StateEnable(GL_BLEND);
+        StateBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     }
 
     SendToShader(object, NULL);
 
-    glBindVertexArray(object->VAO);
+    StateBindVertexArray(object->VAO);
     UseTexture(object->texture);
 
     int indexCount = object->indexCount;
+    int instanceCount = object->instanceCount;
+    int baseInstance = StreamInstanceMatrices(object, NULL);
 
-    if (object->indices != NULL && indexCount > 0) {
-        int instanceCount = object->instanceCount;
-
+    if (instanceCount > 1 && baseInstance < 0) {
+        // Instance ring is full this frame, nothing valid to draw with
+    } else if (object->indices != NULL && indexCount > 0) {
         if (instanceCount > 1) {
-            glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0, instanceCount);
+            glDrawElementsInstancedBaseInstance(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0, instanceCount, baseInstance);
         } else {
             glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
         }
     } else if (object->vertices != NULL && object->vertexCount > 0) {
-        glDrawArrays(GL_TRIANGLES, 0, object->vertexCount);
+        if (instanceCount > 1) {
+            glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, object->vertexCount, instanceCount, baseInstance);
+        } else {
+            glDrawArrays(GL_TRIANGLES, 0, object->vertexCount);
+        }
     }
 
-    glBindVertexArray(0);
+    StateBindVertexArray(0);
 
-    glEnable(GL_LINE_SMOOTH);
+    StateEnable(GL_LINE_SMOOTH);
 
     if (object->transforms->boundingBox != NULL) {
-        glLineWidth(2.0f);
+        StateLineWidth(2.0f);
         DrawBoundingBox(object, NULL);
     }
 
     DrawTransformGizmo(object, NULL);
 
-    glDisable(GL_BLEND);
-    glDisable(GL_LINE_SMOOTH);
+    StateDisable(GL_BLEND);
+    StateDisable(GL_LINE_SMOOTH);
+}
+
+static void GrowBounds(const Vertex *vertices, int vertexCount, vec3s *min, vec3s *max) {
+    if (vertices == NULL) return;
+
+    for (int i = 0; i < vertexCount; i++) {
+        *min = glms_vec3_minv(*min, vertices[i].position);
+        *max = glms_vec3_maxv(*max, vertices[i].position);
+    }
 }
 
 void GenerateBoundingBox(SceneObject *object, Model3D *model) {
@@ -560,59 +510,31 @@ void GenerateBoundingBox(SceneObject *object, Model3D *model) {
     vec3s min = (vec3s){FLT_MAX, FLT_MAX, FLT_MAX};
     vec3s max = (vec3s){-FLT_MAX, -FLT_MAX, -FLT_MAX};
 
+    // Local space box over every vertex, world bounds are derived from it each frame (see culling.h)
     if (object != NULL) {
-        mat4s modelMatrix = glms_mat4_identity();
-        modelMatrix = glms_translate(modelMatrix, transforms->position);
-        modelMatrix = glms_rotate(modelMatrix, glm_rad(transforms->rotationDegrees), transforms->rotation);
-        modelMatrix = glms_scale(modelMatrix, transforms->scale);
-
-        Vertex *vertices = (Vertex *)object->meshData->verticesCopy;
-        vec3s boxPosition = (vec3s){vertices->position.x,
-                                    vertices->position.y,
-                                    vertices->position.z};
-
-        min = glms_vec3_minv(min, glms_vec3_negate(boxPosition));
-        max = glms_vec3_maxv(max, boxPosition);
-
-        BoundingBox *boundingBox = (BoundingBox *)CreateBoundingBox((BoundingBox){
-            .min = min,
-            .max = max});
-
-        boundingBox->min = min;
-        boundingBox->max = max;
-        boundingBox->model = modelMatrix;
-
-        object->transforms->boundingBox = boundingBox;
+        GrowBounds(object->vertices, object->vertexCount, &min, &max);
     } else {
-        mat4s modelMatrix = glms_mat4_identity();
-        modelMatrix = glms_translate(modelMatrix, transforms->position);
-        modelMatrix = glms_rotate(modelMatrix, glm_rad(transforms->rotationDegrees), transforms->rotation);
-        modelMatrix = glms_scale(modelMatrix, transforms->scale);
-
-        Mesh *mesh = (Mesh *)ListFirst(model->meshes);
-
-        if (mesh != NULL) {
-            Vertex *vertices = (Vertex *)mesh->vertices;
-            vec3s boxPosition = (vec3s){vertices->position.x,
-                                        vertices->position.y,
-                                        vertices->position.z};
+        // Meshes carry their bounds from the import job or the cooked file, no vertex is read here
+        foreach (Mesh *mesh, model->meshes) {
+            if (mesh == NULL) continue;
 
-            min = glms_vec3_minv(min, glms_vec3_negate(boxPosition));
-            max = glms_vec3_maxv(max, boxPosition);
+            min = glms_vec3_minv(min, mesh->min);
+            max = glms_vec3_maxv(max, mesh->max);
+        }
+    }
 
-            BoundingBox *boundingBox = (BoundingBox *)CreateBoundingBox((BoundingBox){
-                .min = min,
-                .max = max});
+    if (min.x > max.x) {
+        fprintf(stderr, "[BOUNDING BOX ERROR] Failed generating bounding box, no vertices found\n");
+        return;
+    }
 
-            boundingBox->min = min;
-            boundingBox->max = max;
-            boundingBox->model = modelMatrix;
+    BoundingBox *boundingBox = (BoundingBox *)CreateBoundingBox((BoundingBox){
+        .min = min,
+        .max = max});
+    if (boundingBox == NULL) return;
 
-            model->transforms->boundingBox = boundingBox;
-        } else {
-            fprintf(stderr, "[MODEL3D ERROR] Failed generating bounding box for Model 3D, no meshes found\n");
-        }
-    }
+    RebuildBoundingBoxMatrix(boundingBox, transforms);
+    transforms->boundingBox = boundingBox;
 }
 
 SceneObject *NewSceneObject(SceneObject builder) {
@@ -645,9 +567,12 @@ SceneObject *NewSceneObject(SceneObject builder) {
         newSceneObject->instanceCount = 1;
     }
 
+    newSceneObject->baseInstance = -1;
+
     if (newSceneObject->transforms == NULL) {
         newSceneObject->transforms = (Transform *)malloc(newSceneObject->instanceCount * sizeof(Transform));
         newSceneObject->transforms[0].model = glms_mat4_identity();
+        newSceneObject->transforms[0].version = 0;
     }
 
     if (newSceneObject->draw == NULL) {
@@ -662,6 +587,10 @@ SceneObject *NewSceneObject(SceneObject builder) {
         newSceneObject->transforms->scale = (vec3s)GLMS_VEC3_ONE;
     }
 
+    for (int i = 0; i < newSceneObject->instanceCount; i++) {
+        MarkTransformDirty(&newSceneObject->transforms[i]);
+    }
+
     GenerateTransformGizmo(newSceneObject, NULL);
     GenerateBoundingBox(newSceneObject, NULL);
 
@@ -719,40 +648,114 @@ Transform *NewTransforms(int instanceCount, Transform *transforms) {
 
     memcpy(newTransforms, transforms, sizeof(Transform));
     newTransforms[0].model = glms_mat4_identity();
+    newTransforms[0].version = 0;
+
+    for (int i = 0; i < instanceCount; i++) {
+        MarkTransformDirty(&newTransforms[i]);
+    }
 
     return newTransforms;
 }
 
 void UseTexture(Texture *texture) {
     if (texture != NULL) {
-        glActiveTexture(GL_TEXTURE0);
-
         switch (texture->type) {
             case TEXTURE_TYPE_CUBEMAP:
-                glBindTexture(GL_TEXTURE_CUBE_MAP, texture->textureID);
+                StateBindTexture(0, GL_TEXTURE_CUBE_MAP, texture->textureID);
                 break;
             default:
-                glBindTexture(GL_TEXTURE_2D, texture->textureID);
+                StateBindTexture(0, GL_TEXTURE_2D, texture->textureID);
                 break;
         }
     }
 }
 
+static void FreeTextureTask(void *data) {
+    Texture *texture = (Texture *)data;
+
+    // Drop it from the path index first, the key is its own path
+    if (texture->path != NULL && HashMapGet(engine->textures, texture->path) == texture) {
+        HashMapDelete(engine->textures, texture->path);
+    }
+
+    glDeleteTextures(1, &texture->textureID);
+    stbi_image_free(texture->pixels);
+
+    free((char *)texture->path);
+    free(texture);
+
+    // Deleted names get reused, don't let the cache filter a bind to a new texture with an old name
+    InvalidateStateCache();
+}
+
+unsigned char *LoadTextureImage(const char *path, int *width, int *height, int *channels) {
+    char *fullPath = getAssetPath(path);
+    unsigned char *pixels = stbi_load(fullPath, width, height, channels, 0);
+    free(fullPath);
+
+    if (pixels == NULL) return NULL;
+
+    size_t stride = (size_t)*width * (size_t)*channels;
+    unsigned char *row = (unsigned char *)malloc(stride);
+
+    if (row == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed flipping texture '%s', ERROR ALLOCATING MEMORY\n", path);
+        stbi_image_free(pixels);
+        return NULL;
+    }
+
+    for (int y = 0; y < *height / 2; y++) {
+        unsigned char *top = pixels + (size_t)y * stride;
+        unsigned char *bottom = pixels + (size_t)(*height - 1 - y) * stride;
+
+        memcpy(row, top, stride);
+        memcpy(top, bottom, stride);
+        memcpy(bottom, row, stride);
+    }
+
+    free(row);
+    return pixels;
+}
+
+void FreeTextureAsset(Asset *asset) {
+    RunOnRenderThread(FreeTextureTask, asset->data);
+}
+
 Texture *NewTexture(TextureType type, const char *path) {
+    // Cubemaps are filled face by face by their owner, only 2D textures are known by their path
+    bool shared = path != NULL && type == TEXTURE_TYPE_2D;
+    AssetKey key = (shared) ? NewAssetKey(ASSET_TEXTURE, path, type) : (AssetKey){0};
+
+    if (shared) {
+        Asset *asset = AcquireAsset(&key);
+
+        if (asset != NULL) {
+            FreeAssetKey(&key);
+            return (Texture *)asset->data;
+        }
+    }
+
     Texture *texture = (Texture *)malloc(sizeof(Texture));
+    if (texture == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed creating new Texture, ERROR ALLOCATING MEMORY\n");
+        FreeAssetKey(&key);
+        return NULL;
+    }
+
     texture->type = type;
     texture->textureID = 0;
     texture->width = 0;
     texture->height = 0;
     texture->nrChannels = 0;
-    texture->path = path;
+    texture->path = (path != NULL) ? strdup(path) : NULL;
+    texture->pixels = NULL;
 
     // Load texture
     glGenTextures(1, &texture->textureID);
 
     // set the texture wrapping parameters
     if (texture->type == TEXTURE_TYPE_2D) {
-        glBindTexture(GL_TEXTURE_2D, texture->textureID);
+        StateBindTexture(0, GL_TEXTURE_2D, texture->textureID);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -762,9 +765,8 @@ Texture *NewTexture(TextureType type, const char *path) {
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
         // load image, create texture and generate mipmaps
-        stbi_set_flip_vertically_on_load(GLFW_TRUE);
+        unsigned char *data = LoadTextureImage(path, &texture->width, &texture->height, &texture->nrChannels);
 
-        unsigned char *data = stbi_load(getAssetPath(path), &texture->width, &texture->height, &texture->nrChannels, 0);
         if (data) {
             GLenum format;
             if (texture->nrChannels == 1)
@@ -784,23 +786,38 @@ Texture *NewTexture(TextureType type, const char *path) {
 
         printf("[Texture] '%s' loaded.\n", path);
     } else if (texture->type == TEXTURE_TYPE_CUBEMAP) {
-        glBindTexture(GL_TEXTURE_CUBE_MAP, texture->textureID);
+        StateBindTexture(0, GL_TEXTURE_CUBE_MAP, texture->textureID);
 
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-        stbi_set_flip_vertically_on_load(GLFW_FALSE);
     }
 
-    char *temp = malloc(strlen(path) * sizeof(char));
-    strcpy(temp, path);
+    if (shared) {
+        bool inserted = GLFW_FALSE;
+        Asset *asset = RegisterAsset(&key, texture, FreeTextureAsset, &inserted);
+        FreeAssetKey(&key);
 
-    if (!MapContains(engine->textures, temp)) {
-        MapPut(engine->textures, temp, texture);
+        // Another thread registered the same path between the lookup & here, its texture wins
+        if (asset != NULL && !inserted) {
+            Texture *existing = (Texture *)asset->data;
+
+            glDeleteTextures(1, &texture->textureID);
+            free((char *)texture->path);
+            free(texture);
+
+            // It was just bound, the cache would keep a name GL can hand out again
+            InvalidateStateCache();
+
+            return existing;
+        }
+
+        // Index by path, the registry owns the texture. Unregistered it stays the caller's, like a cubemap
+        if (asset != NULL) HashMapPut(engine->textures, (char *)texture->path, texture);
     }
+
     return texture;
 }
 
@@ -820,23 +837,16 @@ static inline void FreeSkybox(Skybox *skybox) {
 }
 
 static inline void DrawSkyBox(Skybox *skybox) {
-    glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
-    UseShader(*skyboxShader);
-
-    mat4s viewNoTranslation;
-    viewNoTranslation = glms_mat4_copy(camera->view);
-    REMOVE_MAT4S_TRANSLATION(viewNoTranslation);
-
-    setMat4(*skyboxShader, "view", &viewNoTranslation);
-    setMat4(*skyboxShader, "projection", &camera->projection);
+    StateDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
+    UseShader(*skyboxShader);  // view & projection come from the 'FrameData' block, translation is stripped in 'skybox.vert'
 
     // skybox cube
-    glBindVertexArray(skybox->VAO);
+    StateBindVertexArray(skybox->VAO);
     UseTexture(skybox->texture);
 
     glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
-    glDepthFunc(GL_LESS);  // default depth FUNC
+    StateBindVertexArray(0);
+    StateDepthFunc(GL_LESS);  // default depth FUNC
 }
 
 Skybox *NewSkybox(List *textureNames) {
@@ -876,7 +886,7 @@ Skybox *NewSkybox(List *textureNames) {
 
         glGenVertexArrays(1, &skybox->VAO);
         glGenBuffers(1, &skybox->VBO);
-        glBindVertexArray(skybox->VAO);
+        StateBindVertexArray(skybox->VAO);
         glBindBuffer(GL_ARRAY_BUFFER, skybox->VBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), &cubeVertices, GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
@@ -887,27 +897,12 @@ Skybox *NewSkybox(List *textureNames) {
     }
 }
 
-void UpdateInstancedBufferObj(SceneObject *object, Model3D *model, mat4s *instanceMatrices, int instanceCount) {
-    if (object != NULL) {
-        glBindBuffer(GL_ARRAY_BUFFER, object->IVBO);
-        glBufferData(GL_ARRAY_BUFFER, instanceCount * sizeof(mat4s), instanceMatrices, GL_DYNAMIC_DRAW);
-    }
-
-    if (model != NULL) {
-        foreach (Mesh *mesh, model->meshes) {
-            glBindBuffer(GL_ARRAY_BUFFER, mesh->IVBO);
-            glBufferData(GL_ARRAY_BUFFER, instanceCount * sizeof(mat4s), instanceMatrices, GL_DYNAMIC_DRAW);
-        }
-    }
-}
-
 void BindBufferObj(SceneObject *object) {
     glGenVertexArrays(1, &object->VAO);
     glGenBuffers(1, &object->VBO);
     glGenBuffers(1, &object->EBO);
-    glGenBuffers(1, &object->IVBO);
 
-    glBindVertexArray(object->VAO);
+    StateBindVertexArray(object->VAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, object->VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * object->vertexCount, object->vertices, GL_STATIC_DRAW);
@@ -933,29 +928,83 @@ void BindBufferObj(SceneObject *object) {
     int instanceCount = object->instanceCount;
     // Instance matrix attribute (layout = 3)
     if (instanceCount > 1) {
-        glBindBuffer(GL_ARRAY_BUFFER, object->IVBO);
-        glBufferData(GL_ARRAY_BUFFER, instanceCount * sizeof(mat4s), &object->transforms->model.raw[0], GL_DYNAMIC_DRAW);
+        BindInstanceAttributes(engine->instanceRing);
+    }
 
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(mat4s), (void *)0);
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(mat4s), (void *)(sizeof(vec4s)));
-        glEnableVertexAttribArray(5);
-        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(mat4s), (void *)(2 * sizeof(vec4s)));
-        glEnableVertexAttribArray(6);
-        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(mat4s), (void *)(3 * sizeof(vec4s)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    StateBindVertexArray(0);
+}
+
+static void DeleteRetiredObjectTask(void *data) {
+    RetiredObject *retired = (RetiredObject *)data;
+
+    glDeleteVertexArrays(1, &retired->VAO);
+    glDeleteBuffers(1, &retired->VBO);
+    glDeleteBuffers(1, &retired->EBO);
+    free(retired);
+
+    // Deleting the bound VAO unbinds it & the names get reused, the cache must not filter the next bind
+    InvalidateStateCache();
+}
+
+void FreeupObject(SceneObject *object) {
+    if (!ObjectExists(object)) return;
 
-        glVertexAttribDivisor(3, 1);
-        glVertexAttribDivisor(4, 1);
-        glVertexAttribDivisor(5, 1);
-        glVertexAttribDivisor(6, 1);
+    RetiredObject *retired = (RetiredObject *)malloc(sizeof(RetiredObject));
+    if (retired == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed retiring the buffers of a Scene Object, ERROR ALLOCATING MEMORY\n");
+        return;
     }
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    *retired = (RetiredObject){
+        .VAO = object->VAO,
+        .VBO = object->VBO,
+        .EBO = object->EBO,
+        .retireFrame = engine->frameCount};
+
+    // Not pushed or picked from here on
+    object->VAO = 0;
+    object->VBO = 0;
+    object->EBO = 0;
+
+    // Inline nothing is in flight, the context is the caller's
+    if (IsRenderThread()) {
+        DeleteRetiredObjectTask(retired);
+        return;
+    }
+
+    if (retiredObjects == NULL) retiredObjects = (List *)NewList(NULL);
+    ListAdd(retiredObjects, retired);
+}
+
+void UpdateRetiredObjects(void) {
+    if (retiredObjects == NULL) return;
+
+    for (int i = (int)ListSize(retiredObjects) - 1; i >= 0; i--) {
+        RetiredObject *retired = (RetiredObject *)ListGet(retiredObjects, (unsigned int)i);
+
+        // Same wait as a retiring model load, every snapshot built before the removal has been submitted by then
+        if (engine->frameCount < retired->retireFrame + ENGINE_FRAME_SNAPSHOTS) continue;
+
+        ListRemoveIndex(retiredObjects, (unsigned int)i);
+        RunOnRenderThread(DeleteRetiredObjectTask, retired);
+    }
+}
+
+void FreeRetiredObjects(void) {
+    if (retiredObjects == NULL) return;
+
+    foreach (RetiredObject *retired, retiredObjects) {
+        RunOnRenderThread(DeleteRetiredObjectTask, retired);
+    }
+
+    ListFreeMemory(retiredObjects);
+    retiredObjects = NULL;
 }
 
 void RemoveSceneObject(SceneObject *object) {
+    ForgetHoveredOwner(object);
+
     if (ObjectExists(object)) {
         if (ListContains(engine->sceneObjects, object)) {
             ListRemove(engine->sceneObjects, object);
@@ -0,0 +1,367 @@
+#include "renderqueue.h"
+
+#include <string.h>
+
+#include "arena.h"
+#include "instancering.h"
+#include "model3d.h"
+#include "picking.h"
+#include "render.h"
+#include "shader.h"
+#include "transformbatch.h"
+
+RenderQueue *NewRenderQueue(Arena *arena, int capacity) {
+    RenderQueue *queue = (RenderQueue *)malloc(sizeof(RenderQueue));
+    if (queue == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed creating new Render Queue, ERROR ALLOCATING MEMORY\n");
+        return NULL;
+    }
+
+    if (capacity < 1) capacity = ENGINE_RENDER_QUEUE_DEFAULT_CAPACITY;
+
+    queue->arena = arena;
+    queue->commands = NULL;
+    queue->packets = NULL;
+    queue->scratch = NULL;
+    queue->count = 0;
+    queue->capacity = capacity;
+    queue->instances = NULL;
+    queue->instanceCount = 0;
+    queue->instanceCapacity = 0;
+    queue->stats = (RenderQueueStats){0};
+
+    return queue;
+}
+
+void FreeRenderQueue(RenderQueue *queue) {
+    if (queue == NULL) return;
+
+    // The buffers belong to the arena
+    free(queue);
+}
+
+static bool AllocRenderQueue(RenderQueue *queue, int capacity) {
+    RenderCommand *commands = ArenaPush(queue->arena, RenderCommand, capacity);
+    RenderPacket *packets = ArenaPush(queue->arena, RenderPacket, capacity);
+    RenderPacket *scratch = ArenaPush(queue->arena, RenderPacket, capacity);
+
+    if (commands == NULL || packets == NULL || scratch == NULL) return GLFW_FALSE;
+
+    // Growing mid-frame, the old arena space is simply left behind until the reset
+    if (queue->count > 0) {
+        memcpy(commands, queue->commands, queue->count * sizeof(RenderCommand));
+        memcpy(packets, queue->packets, queue->count * sizeof(RenderPacket));
+    }
+
+    queue->commands = commands;
+    queue->packets = packets;
+    queue->scratch = scratch;
+    queue->capacity = capacity;
+
+    return GLFW_TRUE;
+}
+
+static bool AllocInstances(RenderQueue *queue, int capacity) {
+    mat4s *instances = ArenaPush(queue->arena, mat4s, capacity);
+    if (instances == NULL) return GLFW_FALSE;
+
+    if (queue->instanceCount > 0) {
+        memcpy(instances, queue->instances, queue->instanceCount * sizeof(mat4s));
+    }
+
+    queue->instances = instances;
+    queue->instanceCapacity = capacity;
+
+    return GLFW_TRUE;
+}
+
+void RenderQueueBegin(RenderQueue *queue) {
+    queue->count = 0;
+    queue->instanceCount = 0;
+
+    if (!AllocRenderQueue(queue, queue->capacity)) {
+        fprintf(stderr, "[RENDER QUEUE ERROR] Failed taking %d packets from the frame arena\n", queue->capacity);
+        queue->capacity = 0;
+    }
+
+    if (queue->instanceCapacity > 0 && !AllocInstances(queue, queue->instanceCapacity)) {
+        fprintf(stderr, "[RENDER QUEUE ERROR] Failed taking %d instances from the frame arena\n", queue->instanceCapacity);
+        queue->instanceCapacity = 0;
+    }
+}
+
+static bool GrowRenderQueue(RenderQueue *queue) {
+    return AllocRenderQueue(queue, (queue->capacity > 0) ? queue->capacity * 2 : ENGINE_RENDER_QUEUE_DEFAULT_CAPACITY);
+}
+
+/* Camera distance quantized to 16 bits over the camera's render distance */
+static uint16_t QuantizeDepth(vec3s position) {
+    vec3s cameraPosition = glms_vec3(engine->frameUniforms.cameraPosition);
+    float distance = glms_vec3_distance(cameraPosition, position) / camera->renderDistance;
+
+    distance = glm_clamp(distance, 0.0f, 1.0f);
+    return (uint16_t)(distance * 65535.0f);
+}
+
+static void PushCommand(RenderQueue *queue, RenderCommand command, vec3s position) {
+    if (queue->count >= queue->capacity && !GrowRenderQueue(queue)) {
+        fprintf(stderr, "[RENDER QUEUE ERROR] Failed growing the render queue, dropping draw\n");
+        return;
+    }
+
+    GLuint textureID = (command.texture != NULL) ? command.texture->textureID : 0;
+
+    queue->commands[queue->count] = command;
+    queue->packets[queue->count] = (RenderPacket){
+        .key = MakeSortKey(command.pass, command.shader->programID, textureID, command.VAO, QuantizeDepth(position)),
+        .command = (uint32_t)queue->count};
+
+    queue->count++;
+}
+
+/* Compose & copy an instanced owner's matrices into the queue, returns the first one or -1 */
+static int PushInstances(RenderQueue *queue, Transform *transforms, int count) {
+    if (queue->instanceCount + count > queue->instanceCapacity) {
+        int capacity = (queue->instanceCapacity > 0) ? queue->instanceCapacity : ENGINE_RENDER_QUEUE_DEFAULT_CAPACITY;
+        while (capacity < queue->instanceCount + count) capacity *= 2;
+
+        if (!AllocInstances(queue, capacity)) {
+            fprintf(stderr, "[RENDER QUEUE ERROR] Failed growing the instances to %d, dropping draw\n", capacity);
+            return -1;
+        }
+    }
+
+    int firstInstance = queue->instanceCount;
+    mat4s *matrices = queue->instances + firstInstance;
+
+    // Same as #WriteInstanceMatrices(), dirty ones recomposed in one batch & the rest copied from the cache
+    UpdateDirtyTransforms(transforms, count);
+
+    for (int i = 0; i < count; i++) {
+        matrices[i] = *GetTransformMatrix(&transforms[i]);
+    }
+
+    queue->instanceCount += count;
+    return firstInstance;
+}
+
+/* Fields every mesh of an owner shares */
+static RenderCommand OwnerCommand(RenderQueue *queue, SceneObject *object, Model3D *model) {
+    int instanceCount = (object != NULL) ? object->instanceCount : model->instanceCount;
+    Transform *transforms = (object != NULL) ? object->transforms : model->transforms;
+    Clickable clickable = (object != NULL) ? object->clickable : model->clickable;
+    vec3s color = (object != NULL) ? object->color : model->color;
+    ObjectType type = (object != NULL) ? object->type : OBJECT_3D_MODEL;
+
+    RenderCommand command = (RenderCommand){
+        .object = object,
+        .model = model,
+        .shader = GetObjectShader(object, model),
+        .texture = (object != NULL) ? object->texture : model->texture,
+        .instanceCount = instanceCount,
+        .firstInstance = -1};
+
+    if (instanceCount > 1) {
+        command.firstInstance = PushInstances(queue, transforms, instanceCount);
+        command.color = color;
+    } else {
+        command.matrix = *GetTransformMatrix(&transforms[0]);
+        command.color = (clickable.isHovered) ? clickable.hoverColor : color;
+    }
+
+    command.isSprite = (type & (OBJECT_SPRITE_BILLBOARD | OBJECT_SPRITE_STATIC | OBJECT_CAMERA)) != 0;
+    command.isBillboard = command.isSprite && (type & OBJECT_SPRITE_BILLBOARD);
+
+    return command;
+}
+
+void RenderQueuePushObject(RenderQueue *queue, SceneObject *object) {
+    RenderCommand command = OwnerCommand(queue, object, NULL);
+    if (object->instanceCount > 1 && command.firstInstance < 0) return;
+
+    bool isBlended = (object->type & (OBJECT_SPRITE_STATIC | OBJECT_SPRITE_BILLBOARD | OBJECT_CAMERA)) != 0;
+
+    command.pass = (isBlended) ? RENDER_PASS_TRANSPARENT : RENDER_PASS_OPAQUE;
+    command.VAO = object->VAO;
+    command.indexCount = (object->indices != NULL) ? object->indexCount : 0;
+    command.vertexCount = (object->vertices != NULL) ? object->vertexCount : 0;
+
+    PushCommand(queue, command, object->transforms->position);
+}
+
+void RenderQueuePushModel(RenderQueue *queue, Model3D *model) {
+    RenderCommand command = OwnerCommand(queue, NULL, model);
+    if (model->instanceCount > 1 && command.firstInstance < 0) return;
+
+    command.pass = RENDER_PASS_OPAQUE;
+
+    foreach (Mesh *mesh, model->meshes) {
+        if (mesh == NULL) continue;
+
+        command.mesh = mesh;
+        command.VAO = mesh->VAO;
+        command.indexCount = (mesh->indices != NULL) ? mesh->indexCount : 0;
+        command.vertexCount = (mesh->vertices != NULL) ? mesh->vertexCount : 0;
+
+        PushCommand(queue, command, model->transforms->position);
+    }
+}
+
+void RenderQueueSort(RenderQueue *queue) {
+    int count = queue->count;
+    if (count < 2) return;
+
+    RenderPacket *source = queue->packets;
+    RenderPacket *dest = queue->scratch;
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t histogram[256] = {0};
+
+        for (int i = 0; i < count; i++) {
+            histogram[(source[i].key >> shift) & 0xFF]++;
+        }
+
+        // Every key shares this byte, nothing to reorder
+        if (histogram[(source[0].key >> shift) & 0xFF] == (size_t)count) continue;
+
+        size_t offset = 0;
+        for (int i = 0; i < 256; i++) {
+            size_t bucket = histogram[i];
+            histogram[i] = offset;
+            offset += bucket;
+        }
+
+        for (int i = 0; i < count; i++) {
+            dest[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+        }
+
+        RenderPacket *temp = source;
+        source = dest;
+        dest = temp;
+    }
+
+    // Keep the sorted packets in 'packets' so the buffers never swap roles between frames
+    if (source != queue->packets) {
+        memcpy(queue->packets, source, count * sizeof(RenderPacket));
+    }
+}
+
+static void SetRenderPass(RenderPass pass) {
+    if (pass == RENDER_PASS_TRANSPARENT) {
+        StateEnable(GL_BLEND);
+        StateBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    } else {
+        StateDisable(GL_BLEND);
+    }
+}
+
+/* IDs in push order, the meshes of a model were pushed back to back & share their owner's range */
+static void RegisterPickOwners(RenderQueue *queue) {
+    const void *previous = NULL;
+    GLuint pickID = 0;
+
+    for (int i = 0; i < queue->count; i++) {
+        RenderCommand *command = &queue->commands[i];
+        const void *owner = (command->object != NULL) ? (const void *)command->object : (const void *)command->model;
+
+        if (owner != previous) {
+            pickID = PickBufferRegister(engine->pickBuffer, command->object, command->model, command->instanceCount);
+            previous = owner;
+        }
+
+        command->pickID = pickID;
+    }
+}
+
+static void SendCommandUniforms(const RenderCommand *command) {
+    Shader *shader = command->shader;
+
+    setUniformVec3(shader, shader->handles.color, &command->color);
+
+    if (command->instanceCount > 1) {
+        setUniformInt(shader, shader->handles.instanceCount, command->instanceCount);
+    } else {
+        setUniformMat4(shader, shader->handles.model, &command->matrix);
+    }
+
+    setUniformBool(shader, shader->handles.isSprite, command->isSprite);
+    setUniformBool(shader, shader->handles.isBillboard, command->isBillboard);
+
+    setUniformBool(shader, shader->handles.useTexture, command->texture != NULL);
+    if (command->texture != NULL) {
+        setUniformInt(shader, shader->handles.texture1, 0);
+    }
+
+    setUniformUInt(shader, shader->handles.pickID, command->pickID);
+}
+
+void RenderQueueSubmit(RenderQueue *queue) {
+    RenderQueueStats stats = (RenderQueueStats){0};
+
+    RegisterPickOwners(queue);
+
+    // Every instanced command of the frame draws out of this one block
+    int baseInstance = WriteInstanceBlock(engine->instanceRing, queue->instances, queue->instanceCount);
+
+    RenderPass currentPass = RENDER_PASS_COUNT;
+    Shader *currentShader = NULL;
+    GLuint currentTexture = 0, currentVAO = 0;
+    bool first = GLFW_TRUE;
+
+    StateLineWidth(1.0f);
+
+    for (int i = 0; i < queue->count; i++) {
+        RenderCommand *command = &queue->commands[queue->packets[i].command];
+        if (command->instanceCount > 1 && baseInstance < 0) continue;
+
+        if (command->pass != currentPass) {
+            SetRenderPass(command->pass);
+            currentPass = command->pass;
+            stats.passChanges++;
+        }
+
+        if (command->shader != currentShader) {
+            UseShader(*command->shader);
+            currentShader = command->shader;
+            stats.shaderChanges++;
+        }
+
+        GLuint textureID = (command->texture != NULL) ? command->texture->textureID : 0;
+        if (command->texture != NULL && (first || textureID != currentTexture)) {
+            UseTexture(command->texture);
+            currentTexture = textureID;
+            stats.textureChanges++;
+        }
+
+        if (first || command->VAO != currentVAO) {
+            StateBindVertexArray(command->VAO);
+            currentVAO = command->VAO;
+            stats.vaoChanges++;
+        }
+
+        first = GLFW_FALSE;
+
+        SendCommandUniforms(command);
+
+        if (command->indexCount > 0) {
+            if (command->instanceCount > 1) {
+                glDrawElementsInstancedBaseInstance(GL_TRIANGLES, command->indexCount, GL_UNSIGNED_INT, 0, command->instanceCount, baseInstance + command->firstInstance);
+            } else {
+                glDrawElements(GL_TRIANGLES, command->indexCount, GL_UNSIGNED_INT, 0);
+            }
+        } else if (command->vertexCount > 0) {
+            if (command->instanceCount > 1) {
+                glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, command->vertexCount, command->instanceCount, baseInstance + command->firstInstance);
+            } else {
+                glDrawArrays(GL_TRIANGLES, 0, command->vertexCount);
+            }
+        }
+
+        stats.draws++;
+    }
+
+    StateBindVertexArray(0);
+    StateDisable(GL_BLEND);
+
+    queue->stats = stats;
+}
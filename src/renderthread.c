@@ -0,0 +1,299 @@
+#include "renderthread.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "arena.h"
+#include "profiler.h"
+#include "renderqueue.h"
+
+#define RENDER_TASK_RESERVE 64
+
+typedef enum SnapshotState {
+    SNAPSHOT_FREE = 0,  // nobody touches it, the next one to be built
+    SNAPSHOT_BUILDING,  // owned by the main thread
+    SNAPSHOT_PUBLISHED  // owned by the render thread until it has been submitted
+} SnapshotState;
+
+typedef struct RenderTask {
+    RenderThreadFunction function;
+    void *data;
+} RenderTask;
+
+static FrameSnapshot snapshots[ENGINE_FRAME_SNAPSHOTS];
+static DebugVertex *debugVertices[ENGINE_FRAME_SNAPSHOTS];
+static SnapshotState states[ENGINE_FRAME_SNAPSHOTS];
+static int buildIndex, submitIndex;
+static long frameCounter;
+
+static pthread_t renderThread;
+static pthread_mutex_t renderLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t snapshotFreed = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t snapshotPublished = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t reserveDrained = PTHREAD_COND_INITIALIZER;
+static bool running, stopping;
+
+/* Queued by #RunOnRenderThread(), guarded by 'renderLock' */
+static RenderTask *tasks;
+static int taskCount, taskCapacity;
+
+/* Where tasks go once growing 'tasks' failed, run after them. Tasks free GL objects & memory, none may be dropped */
+static RenderTask reserve[RENDER_TASK_RESERVE];
+static int reserveCount;
+
+static RenderThreadStats stats;
+static _Thread_local bool isRenderThread;
+
+static void RunRenderTasks(void) {
+    RenderTask reserved[RENDER_TASK_RESERVE];
+
+    pthread_mutex_lock(&renderLock);
+
+    RenderTask *pending = tasks;
+    int count = taskCount, reservedCount = reserveCount;
+
+    for (int i = 0; i < reservedCount; i++) {
+        reserved[i] = reserve[i];
+    }
+
+    tasks = NULL;
+    taskCount = taskCapacity = 0;
+    reserveCount = 0;
+
+    if (reservedCount > 0) pthread_cond_broadcast(&reserveDrained);
+    pthread_mutex_unlock(&renderLock);
+
+    // Run outside the lock, a task may queue another one
+    for (int i = 0; i < count; i++) {
+        pending[i].function(pending[i].data);
+    }
+
+    for (int i = 0; i < reservedCount; i++) {
+        reserved[i].function(reserved[i].data);
+    }
+
+    free(pending);
+}
+
+static void *RenderThreadMain(void *data) {
+    (void)data;
+    isRenderThread = GLFW_TRUE;
+    ProfilerSetThreadName("Render");
+    glfwMakeContextCurrent(engine->window);
+
+    pthread_mutex_lock(&renderLock);
+
+    for (;;) {
+        double start = GetTimeSeconds();
+
+        while (states[submitIndex] != SNAPSHOT_PUBLISHED && taskCount + reserveCount == 0 && !stopping) {
+            pthread_cond_wait(&snapshotPublished, &renderLock);
+        }
+
+        stats.renderWait += GetTimeSeconds() - start;
+
+        if (states[submitIndex] != SNAPSHOT_PUBLISHED) {
+            // Woken for a task, or stopping with every published frame already submitted
+            if (taskCount + reserveCount == 0) break;
+
+            pthread_mutex_unlock(&renderLock);
+            RunRenderTasks();
+            pthread_mutex_lock(&renderLock);
+            continue;
+        }
+
+        FrameSnapshot *snapshot = &snapshots[submitIndex];
+        pthread_mutex_unlock(&renderLock);
+
+        RunRenderTasks();
+        submit(snapshot);
+
+        pthread_mutex_lock(&renderLock);
+
+        states[submitIndex] = SNAPSHOT_FREE;
+        submitIndex = (submitIndex + 1) % ENGINE_FRAME_SNAPSHOTS;
+        stats.frames++;
+
+        pthread_cond_signal(&snapshotFreed);
+    }
+
+    pthread_mutex_unlock(&renderLock);
+
+    RunRenderTasks();
+    FreeThreadArena();
+
+    glfwMakeContextCurrent(NULL);
+    return NULL;
+}
+
+void InitRenderThread(void) {
+    for (int i = 0; i < ENGINE_FRAME_SNAPSHOTS; i++) {
+        FrameSnapshot *snapshot = &snapshots[i];
+        *snapshot = (FrameSnapshot){0};
+
+        snapshot->arena = (Arena *)NewArena(ENGINE_FRAME_ARENA_SIZE);
+        snapshot->queue = (snapshot->arena != NULL) ? (RenderQueue *)NewRenderQueue(snapshot->arena, ENGINE_RENDER_QUEUE_DEFAULT_CAPACITY) : NULL;
+
+        // Debug vertices don't go through the arena, a full list would take a big bite out of it every frame
+        debugVertices[i] = (DebugVertex *)malloc((size_t)ENGINE_DEBUG_DRAW_MAX_VERTICES * sizeof(DebugVertex));
+        if (debugVertices[i] == NULL) {
+            fprintf(stderr, "[MEMORY ERROR] Failed allocating the debug vertices of frame snapshot %d\n", i);
+        }
+
+        states[i] = SNAPSHOT_FREE;
+    }
+
+    buildIndex = submitIndex = 0;
+    stopping = GLFW_FALSE;
+    stats = (RenderThreadStats){0};
+
+    engine->frameArena = snapshots[0].arena;
+    engine->renderQueue = snapshots[0].queue;
+
+    if (!ENGINE_RENDER_THREAD) return;
+
+    // A context is current on one thread at a time, release it before the render thread takes it
+    glfwMakeContextCurrent(NULL);
+
+    if (pthread_create(&renderThread, NULL, RenderThreadMain, NULL) != 0) {
+        fprintf(stderr, "[RENDER THREAD ERROR] Failed starting the render thread, frames are submitted from the main thread\n");
+        glfwMakeContextCurrent(engine->window);
+        return;
+    }
+
+    running = GLFW_TRUE;
+    printf("[TAV ENGINE] Render thread started, %d frame snapshots\n", ENGINE_FRAME_SNAPSHOTS);
+}
+
+void ShutdownRenderThread(void) {
+    if (running) {
+        pthread_mutex_lock(&renderLock);
+        stopping = GLFW_TRUE;
+        pthread_cond_signal(&snapshotPublished);
+        pthread_mutex_unlock(&renderLock);
+
+        pthread_join(renderThread, NULL);
+        running = GLFW_FALSE;
+
+        glfwMakeContextCurrent(engine->window);
+
+        printf("[TAV ENGINE] Render thread: %ld frames, main thread waited %.3f s, render thread waited %.3f s\n",
+               stats.frames, stats.simulationWait, stats.renderWait);
+    }
+
+    RunRenderTasks();
+
+    for (int i = 0; i < ENGINE_FRAME_SNAPSHOTS; i++) {
+        FreeRenderQueue(snapshots[i].queue);
+        FreeArena(snapshots[i].arena);
+        free(debugVertices[i]);
+
+        snapshots[i] = (FrameSnapshot){0};
+        debugVertices[i] = NULL;
+    }
+
+    engine->frameArena = NULL;
+    engine->renderQueue = NULL;
+}
+
+FrameSnapshot *AcquireFrameSnapshot(void) {
+    if (running) {
+        pthread_mutex_lock(&renderLock);
+
+        double start = GetTimeSeconds();
+        while (states[buildIndex] != SNAPSHOT_FREE) {
+            pthread_cond_wait(&snapshotFreed, &renderLock);
+        }
+
+        stats.simulationWait += GetTimeSeconds() - start;
+        states[buildIndex] = SNAPSHOT_BUILDING;
+
+        pthread_mutex_unlock(&renderLock);
+    }
+
+    FrameSnapshot *snapshot = &snapshots[buildIndex];
+    snapshot->frame = ++frameCounter;
+
+    DebugDrawListBegin(&snapshot->debug, debugVertices[buildIndex], ENGINE_DEBUG_DRAW_MAX_VERTICES);
+    return snapshot;
+}
+
+void PublishFrameSnapshot(FrameSnapshot *snapshot) {
+    int index = (int)(snapshot - snapshots);
+
+    if (!running) {
+        submit(snapshot);
+        stats.frames++;
+
+        buildIndex = (index + 1) % ENGINE_FRAME_SNAPSHOTS;
+        return;
+    }
+
+    pthread_mutex_lock(&renderLock);
+
+    states[index] = SNAPSHOT_PUBLISHED;
+    buildIndex = (index + 1) % ENGINE_FRAME_SNAPSHOTS;
+
+    pthread_cond_signal(&snapshotPublished);
+    pthread_mutex_unlock(&renderLock);
+}
+
+void RunOnRenderThread(RenderThreadFunction function, void *data) {
+    // Without a render thread the caller owns the context
+    if (!running || isRenderThread) {
+        function(data);
+        return;
+    }
+
+    RenderTask task = {.function = function, .data = data};
+
+    pthread_mutex_lock(&renderLock);
+
+    // Once the reserve is in use everything after goes there too, tasks keep running in the order they were queued
+    if (reserveCount == 0 && taskCount >= taskCapacity) {
+        int capacity = (taskCapacity > 0) ? taskCapacity * 2 : 16;
+        RenderTask *grown = (RenderTask *)realloc(tasks, (size_t)capacity * sizeof(RenderTask));
+
+        if (grown != NULL) {
+            tasks = grown;
+            taskCapacity = capacity;
+        } else {
+            fprintf(stderr, "[MEMORY ERROR] Failed growing the render thread tasks to %d, using the reserve\n", capacity);
+        }
+    }
+
+    if (reserveCount == 0 && taskCount < taskCapacity) {
+        tasks[taskCount++] = task;
+    } else {
+        // Full too: wait for the render thread (or #ShutdownRenderThread()) to take what's there
+        while (reserveCount == RENDER_TASK_RESERVE) {
+            pthread_cond_signal(&snapshotPublished);
+            pthread_cond_wait(&reserveDrained, &renderLock);
+        }
+
+        // Drained by #ShutdownRenderThread(), nothing would run it anymore
+        if (!running) {
+            pthread_mutex_unlock(&renderLock);
+            function(data);
+            return;
+        }
+
+        reserve[reserveCount++] = task;
+    }
+
+    pthread_cond_signal(&snapshotPublished);
+    pthread_mutex_unlock(&renderLock);
+}
+
+bool IsRenderThread(void) {
+    return isRenderThread || !running;
+}
+
+RenderThreadStats GetRenderThreadStats(void) {
+    pthread_mutex_lock(&renderLock);
+    RenderThreadStats copy = stats;
+    pthread_mutex_unlock(&renderLock);
+
+    return copy;
+}
@@ -2,6 +2,9 @@
 
 #include <string.h>
 
+#include "assets.h"
+#include "renderthread.h"
+
 void reloadShaders(void) {
     if (isListEmpty(engine->shaders)) {
         printf("[TAV ENGINE] => No shaders to reload.\n");
@@ -17,25 +20,61 @@ void reloadShaders(void) {
         counter++;
     }
 
+    // Reloaded programs can come back with the names of the deleted ones
+    InvalidateStateCache();
+
     printf("[TAV ENGINE] => DONE.. Reloaded %d shaders successfully!\n", counter);
 }
 
+static void FreeShaderTask(void *data) {
+    Shader *shader = (Shader *)data;
+
+    glDeleteProgram(shader->programID);
+    FreeUniforms(shader);
+
+    ListRemove(engine->shaders, shader);
+    free(shader);
+
+    // A new program can come back with the deleted one's name
+    InvalidateStateCache();
+}
+
+static void FreeShaderAsset(Asset *asset) {
+    RunOnRenderThread(FreeShaderTask, asset->data);
+}
+
 Shader *NewShader(const char *vertexPath, const char *fragmentPath) {
+    // A program is known by both of its stages
+    AssetKey key = NewAssetKeyPair(ASSET_SHADER, vertexPath, fragmentPath, 0);
+
+    Asset *asset = AcquireAsset(&key);
+    if (asset != NULL) {
+        FreeAssetKey(&key);
+        return (Shader *)asset->data;
+    }
+
     Shader *shader = malloc(sizeof(Shader));
     if (shader == NULL) {
         printf("[Shader] => Memory allocation failed.\n");
+        FreeAssetKey(&key);
         return NULL;
     }
 
     shader->programID = 0;
     shader->vertexPath = vertexPath;
     shader->fragmentPath = fragmentPath;
+    shader->uniforms = NULL;
+    shader->uniformTable = NULL;
+    shader->uniformCount = 0;
+    shader->uniformTableSize = 0;
+    shader->skipRedundantUploads = ENGINE_SKIP_REDUNDANT_UNIFORMS;
 
     // 1. Get the Full File Path's
     char *fullVertexPath = getShaderPath(vertexPath);
     char *fullFragmentPath = getShaderPath(fragmentPath);
     if (!fullVertexPath || !fullFragmentPath) {
         printf("[Shader] => Error constructing shader paths using #getShaderPath(const char* path)\n");
+        FreeAssetKey(&key);
         free(shader);
         return NULL;
     }
@@ -47,7 +86,19 @@ Shader *NewShader(const char *vertexPath, const char *fragmentPath) {
     free(fullVertexPath);
     free(fullFragmentPath);
 
-    // 4. Add the shader to the engine's shader list
+    // 4. Register it & add it to the engine's shader list, the registry frees it with its last reference
+    bool inserted = GLFW_FALSE;
+    asset = RegisterAsset(&key, shader, FreeShaderAsset, &inserted);
+    FreeAssetKey(&key);
+
+    if (asset != NULL && !inserted) {
+        glDeleteProgram(shader->programID);
+        FreeUniforms(shader);
+        free(shader);
+
+        return (Shader *)asset->data;
+    }
+
     ListAdd(engine->shaders, shader);
     printf("[Shader] '%s' & '%s'\n", vertexPath, fragmentPath);
 
@@ -55,42 +106,199 @@ Shader *NewShader(const char *vertexPath, const char *fragmentPath) {
 }
 
 void UseShader(Shader shader) {
-    glUseProgram(shader.programID);
+    StateUseProgram(shader.programID);
 }
 
 void setBool(Shader shader, const char *name, bool value) {
-    glUniform1i(glGetUniformLocation(shader.programID, name), (int)value);
+    setUniformBool(&shader, GetUniformHandle(&shader, name), value);
 }
 void setInt(Shader shader, const char *name, int value) {
-    glUniform1i(glGetUniformLocation(shader.programID, name), value);
+    setUniformInt(&shader, GetUniformHandle(&shader, name), value);
 }
 void setFloat(Shader shader, const char *name, float value) {
-    glUniform1f(glGetUniformLocation(shader.programID, name), value);
+    setUniformFloat(&shader, GetUniformHandle(&shader, name), value);
 }
 void setVec2(Shader shader, const char *name, const vec2s *value) {
-    glUniform2fv(glGetUniformLocation(shader.programID, name), 1, &value->raw[0]);
+    setUniformVec2(&shader, GetUniformHandle(&shader, name), value);
 }
 void setVec2F(Shader shader, const char *name, float x, float y) {
-    glUniform2f(glGetUniformLocation(shader.programID, name), x, y);
+    setUniformVec2(&shader, GetUniformHandle(&shader, name), &(vec2s){{x, y}});
 }
 void setVec3(Shader shader, const char *name, const vec3s *value) {
-    glUniform3fv(glGetUniformLocation(shader.programID, name), 1, &value->raw[0]);
+    setUniformVec3(&shader, GetUniformHandle(&shader, name), value);
 }
 void setVec3F(Shader shader, const char *name, float x, float y, float z) {
-    glUniform3f(glGetUniformLocation(shader.programID, name), x, y, z);
+    setUniformVec3(&shader, GetUniformHandle(&shader, name), &(vec3s){{x, y, z}});
 }
 void setVec4(Shader shader, const char *name, const vec4s *value) {
-    glUniform4fv(glGetUniformLocation(shader.programID, name), 1, &value->raw[0]);
+    setUniformVec4(&shader, GetUniformHandle(&shader, name), value);
 }
 void setVec4F(Shader shader, const char *name, float x, float y, float z, float w) {
-    glUniform4f(glGetUniformLocation(shader.programID, name), x, y, z, w);
+    setUniformVec4(&shader, GetUniformHandle(&shader, name), &(vec4s){{x, y, z, w}});
 }
 void setMat2(Shader shader, const char *name, const mat2s *mat) {
-    glUniformMatrix2fv(glGetUniformLocation(shader.programID, name), 1, GL_FALSE, &mat->raw[0][0]);
+    setUniformMat2(&shader, GetUniformHandle(&shader, name), mat);
 }
 void setMat3(Shader shader, const char *name, const mat3s *mat) {
-    glUniformMatrix3fv(glGetUniformLocation(shader.programID, name), 1, GL_FALSE, &mat->raw[0][0]);
+    setUniformMat3(&shader, GetUniformHandle(&shader, name), mat);
 }
 void setMat4(Shader shader, const char *name, const mat4s *mat) {
-    glUniformMatrix4fv(glGetUniformLocation(shader.programID, name), 1, GL_FALSE, &mat->raw[0][0]);
-}
\ No newline at end of file
+    setUniformMat4(&shader, GetUniformHandle(&shader, name), mat);
+}
+
+/* FNV-1a, good enough for the handful of uniform names a program has */
+static unsigned int HashUniformName(const char *name) {
+    uint64_t hash = HashString64(name);
+
+    // Folded, the high half reaches the low bits the slot is picked with
+    return (unsigned int)(hash ^ (hash >> 32));
+}
+
+void FreeUniforms(Shader *shader) {
+    free(shader->uniforms);
+    free(shader->uniformTable);
+
+    shader->uniforms = NULL;
+    shader->uniformTable = NULL;
+    shader->uniformCount = 0;
+    shader->uniformTableSize = 0;
+}
+
+void ReflectUniforms(Shader *shader) {
+    FreeUniforms(shader);
+
+    GLint activeUniforms = 0;
+    glGetProgramiv(shader->programID, GL_ACTIVE_UNIFORMS, &activeUniforms);
+
+    // Keep the table at most half full so probe chains stay short
+    int tableSize = 16;
+    while (tableSize < activeUniforms * 2) {
+        tableSize *= 2;
+    }
+
+    shader->uniforms = (ShaderUniform *)calloc((activeUniforms > 0) ? activeUniforms : 1, sizeof(ShaderUniform));
+    shader->uniformTable = (int *)malloc(tableSize * sizeof(int));
+    if (shader->uniforms == NULL || shader->uniformTable == NULL) {
+        printf("[Shader] => Memory allocation failed for uniform table.\n");
+        FreeUniforms(shader);
+        return;
+    }
+
+    shader->uniformTableSize = tableSize;
+    for (int i = 0; i < tableSize; i++) {
+        shader->uniformTable[i] = -1;
+    }
+
+    for (GLint i = 0; i < activeUniforms; i++) {
+        ShaderUniform *uniform = &shader->uniforms[shader->uniformCount];
+
+        GLsizei length = 0;
+        glGetActiveUniform(shader->programID, (GLuint)i, ENGINE_MAX_UNIFORM_NAME, &length, &uniform->size, &uniform->type, uniform->name);
+
+        // Uniforms inside blocks have no location and are never set through this table
+        uniform->location = glGetUniformLocation(shader->programID, uniform->name);
+        if (uniform->location == -1) continue;
+
+        // Arrays are reported as "name[0]", we want lookups by plain "name" to work too
+        char *bracket = strchr(uniform->name, '[');
+        if (bracket != NULL) {
+            *bracket = '\0';
+        }
+
+        uniform->hash = HashUniformName(uniform->name);
+        uniform->hasValue = GLFW_FALSE;
+
+        int slot = uniform->hash & (tableSize - 1);
+        while (shader->uniformTable[slot] != -1) {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+
+        shader->uniformTable[slot] = shader->uniformCount++;
+    }
+
+    shader->handles = (ShaderHandles){
+        .model = GetUniformHandle(shader, "model"),
+        .color = GetUniformHandle(shader, "color"),
+        .isSprite = GetUniformHandle(shader, "isSprite"),
+        .isBillboard = GetUniformHandle(shader, "isBillboard"),
+        .useTexture = GetUniformHandle(shader, "useTexture"),
+        .texture1 = GetUniformHandle(shader, "texture1"),
+        .instanceCount = GetUniformHandle(shader, "instanceCount"),
+        .pickID = GetUniformHandle(shader, "pickID")};
+}
+
+UniformHandle GetUniformHandle(Shader *shader, const char *name) {
+    if (shader->uniformTableSize == 0) return -1;
+
+    unsigned int hash = HashUniformName(name);
+    int mask = shader->uniformTableSize - 1;
+
+    for (int slot = hash & mask;; slot = (slot + 1) & mask) {
+        int index = shader->uniformTable[slot];
+
+        if (index == -1) return -1;
+
+        ShaderUniform *uniform = &shader->uniforms[index];
+        if (uniform->hash == hash && strcmp(uniform->name, name) == 0) {
+            return index;
+        }
+    }
+}
+
+/* Returns the uniform to upload to, or NULL when the handle is invalid or the value is already current */
+static ShaderUniform *PrepareUpload(Shader *shader, UniformHandle handle, const void *value, size_t size) {
+    if (handle < 0 || handle >= shader->uniformCount) return NULL;
+
+    ShaderUniform *uniform = &shader->uniforms[handle];
+
+    if (shader->skipRedundantUploads) {
+        if (uniform->hasValue && memcmp(uniform->value, value, size) == 0) {
+            return NULL;
+        }
+
+        memcpy(uniform->value, value, size);
+        uniform->hasValue = GLFW_TRUE;
+    }
+
+    return uniform;
+}
+
+void setUniformBool(Shader *shader, UniformHandle handle, bool value) {
+    setUniformInt(shader, handle, (int)value);
+}
+void setUniformInt(Shader *shader, UniformHandle handle, int value) {
+    ShaderUniform *uniform = PrepareUpload(shader, handle, &value, sizeof(value));
+    if (uniform) glUniform1i(uniform->location, value);
+}
+void setUniformUInt(Shader *shader, UniformHandle handle, GLuint value) {
+    ShaderUniform *uniform = PrepareUpload(shader, handle, &value, sizeof(value));
+    if (uniform) glUniform1ui(uniform->location, value);
+}
+void setUniformFloat(Shader *shader, UniformHandle handle, float value) {
+    ShaderUniform *uniform = PrepareUpload(shader, handle, &value, sizeof(value));
+    if (uniform) glUniform1f(uniform->location, value);
+}
+void setUniformVec2(Shader *shader, UniformHandle handle, const vec2s *value) {
+    ShaderUniform *uniform = PrepareUpload(shader, handle, value, sizeof(vec2s));
+    if (uniform) glUniform2fv(uniform->location, 1, &value->raw[0]);
+}
+void setUniformVec3(Shader *shader, UniformHandle handle, const vec3s *value) {
+    ShaderUniform *uniform = PrepareUpload(shader, handle, value, sizeof(vec3s));
+    if (uniform) glUniform3fv(uniform->location, 1, &value->raw[0]);
+}
+void setUniformVec4(Shader *shader, UniformHandle handle, const vec4s *value) {
+    ShaderUniform *uniform = PrepareUpload(shader, handle, value, sizeof(vec4s));
+    if (uniform) glUniform4fv(uniform->location, 1, &value->raw[0]);
+}
+void setUniformMat2(Shader *shader, UniformHandle handle, const mat2s *mat) {
+    ShaderUniform *uniform = PrepareUpload(shader, handle, mat, sizeof(mat2s));
+    if (uniform) glUniformMatrix2fv(uniform->location, 1, GL_FALSE, &mat->raw[0][0]);
+}
+void setUniformMat3(Shader *shader, UniformHandle handle, const mat3s *mat) {
+    ShaderUniform *uniform = PrepareUpload(shader, handle, mat, sizeof(mat3s));
+    if (uniform) glUniformMatrix3fv(uniform->location, 1, GL_FALSE, &mat->raw[0][0]);
+}
+void setUniformMat4(Shader *shader, UniformHandle handle, const mat4s *mat) {
+    ShaderUniform *uniform = PrepareUpload(shader, handle, mat, sizeof(mat4s));
+    if (uniform) glUniformMatrix4fv(uniform->location, 1, GL_FALSE, &mat->raw[0][0]);
+}
@@ -0,0 +1,33 @@
+#include "simd.h"
+
+static int detectedLevel = -1;
+
+SimdLevel GetSimdLevel(void) {
+    if (detectedLevel >= 0) return (SimdLevel)detectedLevel;
+
+    detectedLevel = SIMD_SCALAR;
+
+#if ENGINE_SIMD_X86
+    // libgcc's CPUID probe, also checks XGETBV so AVX is only reported when the OS saves the YMM registers
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        detectedLevel = SIMD_AVX2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        detectedLevel = SIMD_SSE;
+    }
+#endif
+
+    return (SimdLevel)detectedLevel;
+}
+
+const char *SimdLevelName(SimdLevel level) {
+    switch (level) {
+        case SIMD_SSE:
+            return "SSE";
+        case SIMD_AVX2:
+            return "AVX2";
+        default:
+            return "Scalar";
+    }
+}
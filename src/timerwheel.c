@@ -0,0 +1,477 @@
+#include "timerwheel.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "engine.h"
+#include "profiler.h"
+
+#define WHEEL_LEVELS 4
+#define WHEEL_BITS 8
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_NEVER UINT64_MAX
+
+typedef struct WheelLevel {
+    WheelTimer *slots[WHEEL_SLOTS];
+    uint64_t occupied[WHEEL_SLOTS / 64];  // bit per non empty slot, finds the next deadline without walking empty slots
+} WheelLevel;
+
+static WheelLevel levels[WHEEL_LEVELS];
+static WheelTimer *overflow;  // deadlines past the top level's reach (~49 days at 1 ms), sorted again when it wraps
+
+static uint64_t currentTick;  // next tick to expire, every earlier one is done
+static uint64_t sleepUntil;   // tick the scheduler sleeps until, 0 while it's awake or already woken
+static struct timespec epoch;
+
+static pthread_t scheduler;
+static pthread_mutex_t wheelLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wheelWake;
+static bool running, stopping;
+
+static double schedulerSeconds;  // CPU time of the scheduler thread
+static int wakeups;
+
+static uint64_t NowNanoseconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)(now.tv_sec - epoch.tv_sec) * 1000000000ull + (uint64_t)now.tv_nsec - (uint64_t)epoch.tv_nsec;
+}
+
+static struct timespec TickTime(uint64_t tick) {
+    uint64_t nanoseconds = (uint64_t)epoch.tv_nsec + tick * ENGINE_TIMER_WHEEL_TICK_NS;
+
+    struct timespec time;
+    time.tv_sec = epoch.tv_sec + (time_t)(nanoseconds / 1000000000ull);
+    time.tv_nsec = (long)(nanoseconds % 1000000000ull);
+    return time;
+}
+
+static double ThreadSeconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+static WheelTimer **SlotHead(int level, int slot) {
+    return (level < WHEEL_LEVELS) ? &levels[level].slots[slot] : &overflow;
+}
+
+static void LinkTimer(WheelTimer *timer, int level, int slot) {
+    WheelTimer **head = SlotHead(level, slot);
+
+    timer->prev = NULL;
+    timer->next = *head;
+    if (*head != NULL) (*head)->prev = timer;
+    *head = timer;
+
+    timer->level = level;
+    timer->slot = slot;
+    timer->linked = true;
+
+    if (level < WHEEL_LEVELS) levels[level].occupied[slot >> 6] |= 1ull << (slot & 63);
+}
+
+static void UnlinkTimer(WheelTimer *timer) {
+    WheelTimer **head = SlotHead(timer->level, timer->slot);
+
+    if (timer->prev != NULL) {
+        timer->prev->next = timer->next;
+    } else {
+        *head = timer->next;
+    }
+
+    if (timer->next != NULL) timer->next->prev = timer->prev;
+
+    if (*head == NULL && timer->level < WHEEL_LEVELS) {
+        levels[timer->level].occupied[timer->slot >> 6] &= ~(1ull << (timer->slot & 63));
+    }
+
+    timer->next = timer->prev = NULL;
+    timer->linked = false;
+}
+
+/*
+ -> The level is the highest byte where the deadline differs from the current tick, the slot is that byte.
+    Every tick between now & the deadline shares the bytes above it, so the slot is reached before the deadline.
+*/
+static void InsertTimer(WheelTimer *timer) {
+    uint64_t deadline = (timer->deadline > currentTick) ? timer->deadline : currentTick;
+    uint64_t differ = deadline ^ currentTick;
+
+    if ((differ >> (WHEEL_BITS * WHEEL_LEVELS)) != 0) {
+        LinkTimer(timer, WHEEL_LEVELS, 0);
+        return;
+    }
+
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && (differ >> (WHEEL_BITS * (level + 1))) != 0) level++;
+
+    LinkTimer(timer, level, (int)((deadline >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1)));
+}
+
+static int FindOccupied(const WheelLevel *level, int from) {
+    for (int word = from >> 6; word < WHEEL_SLOTS / 64; word++) {
+        uint64_t bits = level->occupied[word];
+        if (word == from >> 6) bits &= ~0ull << (from & 63);
+
+        if (bits != 0) return word * 64 + __builtin_ctzll(bits);
+    }
+
+    return -1;
+}
+
+/* Earliest tick with anything to do, an expiry in level 0 or a slot of a higher level to cascade down */
+static uint64_t NextEventTick(void) {
+    uint64_t next = WHEEL_NEVER;
+
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        int shift = WHEEL_BITS * level;
+        int slot = FindOccupied(&levels[level], (int)((currentTick >> shift) & (WHEEL_SLOTS - 1)));
+        if (slot < 0) continue;
+
+        uint64_t span = 1ull << (shift + WHEEL_BITS);
+        uint64_t tick = (currentTick & ~(span - 1)) | ((uint64_t)slot << shift);
+
+        if (tick < currentTick) tick = currentTick;
+        if (tick < next) next = tick;
+    }
+
+    if (overflow != NULL) {
+        uint64_t wrap = ((currentTick >> (WHEEL_BITS * WHEEL_LEVELS)) + 1) << (WHEEL_BITS * WHEEL_LEVELS);
+        if (wrap < next) next = wrap;
+    }
+
+    return next;
+}
+
+static void FireWheelTimer(void *argument) {
+    WheelTimer *timer = (WheelTimer *)argument;
+
+    if (!__atomic_load_n(&timer->canceled, __ATOMIC_ACQUIRE)) {
+        timer->callback(timer);
+    }
+}
+
+static void ReinsertSlot(int level, int slot) {
+    WheelTimer *timer = *SlotHead(level, slot);
+
+    while (timer != NULL) {
+        WheelTimer *next = timer->next;
+
+        UnlinkTimer(timer);
+        InsertTimer(timer);
+
+        timer = next;
+    }
+}
+
+/* Cascade the slots that start at 'tick' (top level first so they fall all the way), then expire level 0 */
+static void ProcessTick(uint64_t tick) {
+    currentTick = tick;
+
+    if ((tick & ((1ull << (WHEEL_BITS * WHEEL_LEVELS)) - 1)) == 0) ReinsertSlot(WHEEL_LEVELS, 0);
+
+    for (int level = WHEEL_LEVELS - 1; level > 0; level--) {
+        int shift = WHEEL_BITS * level;
+        if ((tick & ((1ull << shift) - 1)) != 0) continue;
+
+        ReinsertSlot(level, (int)((tick >> shift) & (WHEEL_SLOTS - 1)));
+    }
+
+    WheelTimer *timer = levels[0].slots[tick & (WHEEL_SLOTS - 1)];
+
+    while (timer != NULL) {
+        WheelTimer *next = timer->next;
+        UnlinkTimer(timer);
+
+        // A callback that's still running isn't queued a second time, repeats never overlap. The scheduler never
+        // runs jobs itself, its job nodes come back through the job system's shared pool
+        if (JobCounterDone(&timer->counter)) {
+            timer->fired++;
+            RunJob(FireWheelTimer, timer, &timer->counter);
+        } else {
+            timer->overruns++;
+        }
+
+        if (timer->interval > 0) {
+            // Fixed rate, periods missed while the process was stalled are skipped rather than fired in a burst
+            timer->deadline += timer->interval;
+            if (timer->deadline <= tick) timer->deadline += ((tick - timer->deadline) / timer->interval + 1) * timer->interval;
+
+            InsertTimer(timer);
+        }
+
+        timer = next;
+    }
+
+    currentTick = tick + 1;
+}
+
+static void *WheelScheduler(void *argument) {
+    (void)argument;
+    ProfilerSetThreadName("Timer wheel");
+
+    pthread_mutex_lock(&wheelLock);
+
+    while (!stopping) {
+        uint64_t now = NowNanoseconds() / ENGINE_TIMER_WHEEL_TICK_NS;
+        uint64_t next;
+
+        while ((next = NextEventTick()) <= now) ProcessTick(next);
+        if (currentTick <= now) currentTick = now + 1;
+
+        schedulerSeconds = ThreadSeconds();
+        sleepUntil = next;
+
+        if (next == WHEEL_NEVER) {
+            pthread_cond_wait(&wheelWake, &wheelLock);
+        } else {
+            struct timespec wake = TickTime(next);
+            pthread_cond_timedwait(&wheelWake, &wheelLock, &wake);
+        }
+
+        sleepUntil = 0;
+        wakeups++;
+    }
+
+    pthread_mutex_unlock(&wheelLock);
+    return NULL;
+}
+
+void InitTimerWheel(void) {
+    if (running) return;
+
+    // Deadlines are on the monotonic clock, the sleep has to be too or a clock change would stretch it
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&wheelWake, &attributes);
+    pthread_condattr_destroy(&attributes);
+
+    clock_gettime(CLOCK_MONOTONIC, &epoch);
+    currentTick = 0;
+    sleepUntil = 0;
+    stopping = false;
+
+    if (pthread_create(&scheduler, NULL, WheelScheduler, NULL) != 0) {
+        fprintf(stderr, "[TIMER ERROR] Failed starting the timer wheel scheduler\n");
+        pthread_cond_destroy(&wheelWake);
+        return;
+    }
+
+    running = true;
+}
+
+void ShutdownTimerWheel(void) {
+    if (!running) return;
+
+    pthread_mutex_lock(&wheelLock);
+    stopping = true;
+    pthread_cond_signal(&wheelWake);
+    pthread_mutex_unlock(&wheelLock);
+
+    pthread_join(scheduler, NULL);
+
+    for (int level = 0; level <= WHEEL_LEVELS; level++) {
+        for (int slot = 0; slot < ((level < WHEEL_LEVELS) ? WHEEL_SLOTS : 1); slot++) {
+            while (*SlotHead(level, slot) != NULL) UnlinkTimer(*SlotHead(level, slot));
+        }
+    }
+
+    pthread_cond_destroy(&wheelWake);
+    running = false;
+}
+
+void StartWheelTimer(WheelTimer *timer, double delay, double interval, WheelTimerFunction callback, void *data) {
+    const uint64_t tick = ENGINE_TIMER_WHEEL_TICK_NS;
+
+    if (!running) {
+        fprintf(stderr, "[TIMER ERROR] Timer wheel isn't running, timer dropped\n");
+        return;
+    }
+
+    // Rounded up, a timer may fire up to a tick late but never early
+    uint64_t delayNs = (delay > 0.0) ? (uint64_t)(delay * 1e9) : 0;
+    uint64_t intervalNs = (interval > 0.0) ? (uint64_t)(interval * 1e9) : 0;
+
+    uint64_t deadline = (NowNanoseconds() + delayNs + tick - 1) / tick;
+
+    pthread_mutex_lock(&wheelLock);
+
+    // Still armed from an earlier start, relinking it as is would leave it in two slot lists
+    if (timer->linked) UnlinkTimer(timer);
+
+    // Field by field, 'counter' may still be counted down by a callback dispatched before the restart
+    timer->callback = callback;
+    timer->data = data;
+    timer->deadline = deadline;
+    timer->interval = (intervalNs > 0) ? (intervalNs + tick - 1) / tick : 0;
+    timer->fired = 0;
+    timer->overruns = 0;
+    __atomic_store_n(&timer->canceled, false, __ATOMIC_RELEASE);
+
+    InsertTimer(timer);
+
+    // Only an earlier deadline than the one the scheduler sleeps for is worth waking it up
+    if (timer->deadline < sleepUntil) {
+        sleepUntil = 0;
+        pthread_cond_signal(&wheelWake);
+    }
+
+    pthread_mutex_unlock(&wheelLock);
+}
+
+void CancelWheelTimer(WheelTimer *timer) {
+    __atomic_store_n(&timer->canceled, true, __ATOMIC_RELEASE);
+
+    pthread_mutex_lock(&wheelLock);
+    if (timer->linked) UnlinkTimer(timer);
+    pthread_mutex_unlock(&wheelLock);
+}
+
+void WaitForWheelTimer(WheelTimer *timer) {
+    WaitForCounter(&timer->counter);
+}
+
+#ifdef ENGINE_SELF_TESTS
+
+typedef struct WheelTestRecord {
+    double due;   // monotonic seconds the timer was asked for
+    double late;  // seconds past 'due' it fired
+    int fires;    // atomic
+} WheelTestRecord;
+
+static double NowSeconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+static void SleepSeconds(double seconds) {
+    struct timespec duration = {.tv_sec = (time_t)seconds, .tv_nsec = (long)((seconds - (double)(time_t)seconds) * 1e9)};
+    while (nanosleep(&duration, &duration) != 0) {
+    }
+}
+
+static void RecordWheelTest(WheelTimer *timer) {
+    WheelTestRecord *record = (WheelTestRecord *)timer->data;
+
+    record->late = NowSeconds() - record->due;
+    __atomic_add_fetch(&record->fires, 1, __ATOMIC_RELAXED);
+}
+
+static double SchedulerStats(int *wakeupCount) {
+    pthread_mutex_lock(&wheelLock);
+    double seconds = schedulerSeconds;
+    *wakeupCount = wakeups;
+    pthread_mutex_unlock(&wheelLock);
+
+    return seconds;
+}
+
+bool TimerWheelSelfTest(int timers) {
+    const double maxDelay = 0.1, period = 0.01, periodRun = 0.1, idleRun = 0.1;
+    const int periodic = 64;
+
+    if (!running) {
+        fprintf(stderr, "[TIMER WHEEL TEST] Timer wheel isn't running\n");
+        return false;
+    }
+
+    WheelTimer *wheelTimers = (WheelTimer *)calloc((size_t)(timers + periodic), sizeof(WheelTimer));
+    WheelTestRecord *records = (WheelTestRecord *)calloc((size_t)(timers + periodic), sizeof(WheelTestRecord));
+
+    if (wheelTimers == NULL || records == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed allocating the timer wheel test, ERROR ALLOCATING MEMORY\n");
+        free(wheelTimers);
+        free(records);
+        return false;
+    }
+
+    int startWakeups, wakeupCount;
+    double startCPU = SchedulerStats(&startWakeups);
+
+    // One-shots at random delays, every 4th canceled right away & must never fire, some restarted while armed
+    unsigned int seed = 12345u;
+
+    for (int i = 0; i < timers; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        double delay = maxDelay * (double)(seed >> 8) / (double)(1u << 24);
+        if ((i & 3) == 3) delay += 0.02;
+
+        records[i].due = NowSeconds() + delay;
+        StartWheelTimer(&wheelTimers[i], delay, 0.0, RecordWheelTest, &records[i]);
+        if ((i & 7) == 5) StartWheelTimer(&wheelTimers[i], delay, 0.0, RecordWheelTest, &records[i]);
+
+        if ((i & 3) == 3) CancelWheelTimer(&wheelTimers[i]);
+    }
+
+    for (int i = timers; i < timers + periodic; i++) {
+        records[i].due = NowSeconds() + period;
+        StartWheelTimer(&wheelTimers[i], period, period, RecordWheelTest, &records[i]);
+    }
+
+    SleepSeconds(periodRun + 0.02);
+
+    for (int i = timers; i < timers + periodic; i++) CancelWheelTimer(&wheelTimers[i]);
+    for (int i = 0; i < timers + periodic; i++) WaitForWheelTimer(&wheelTimers[i]);
+
+    double busyCPU = SchedulerStats(&wakeupCount) - startCPU;
+    int busyWakeups = wakeupCount - startWakeups;
+
+    bool ok = true;
+    double maxLate = 0.0, totalLate = 0.0;
+    int periodicFires = 0;
+
+    for (int i = 0; i < timers; i++) {
+        int expected = ((i & 3) == 3) ? 0 : 1;
+
+        if (records[i].fires != expected || (expected && records[i].late < 0.0)) {
+            if (ok) fprintf(stderr, "[TIMER WHEEL TEST] Timer %d fired %d times, %.3f ms late\n", i, records[i].fires, records[i].late * 1e3);
+            ok = false;
+        }
+
+        if (expected) {
+            totalLate += records[i].late;
+            if (records[i].late > maxLate) maxLate = records[i].late;
+        }
+    }
+
+    // The periodic timers ran 'periodRun' plus some slack, allow a couple of ticks either way
+    for (int i = timers; i < timers + periodic; i++) {
+        periodicFires += records[i].fires;
+
+        if (records[i].fires < (int)(periodRun / period) - 2 || records[i].fires > (int)((periodRun + 0.02) / period) + 1) {
+            if (ok) fprintf(stderr, "[TIMER WHEEL TEST] Periodic timer %d fired %d times\n", i - timers, records[i].fires);
+            ok = false;
+        }
+    }
+
+    // Idle cost, all timers far out: the scheduler should sleep through the whole wait
+    for (int i = 0; i < timers; i++) {
+        StartWheelTimer(&wheelTimers[i], 60.0 + (double)i * 1e-3, 0.0, RecordWheelTest, &records[i]);
+    }
+
+    startCPU = SchedulerStats(&startWakeups);
+    SleepSeconds(idleRun);
+    double idleCPU = SchedulerStats(&wakeupCount) - startCPU;
+    int idleWakeups = wakeupCount - startWakeups;
+
+    double cancelStart = NowSeconds();
+    for (int i = 0; i < timers; i++) CancelWheelTimer(&wheelTimers[i]);
+    double cancelSeconds = NowSeconds() - cancelStart;
+
+    printf("[TIMER WHEEL TEST] %d timers, %.3f ms mean & %.3f ms max late, %d periodic fires, scheduler %.3f ms CPU in %d wakeups\n",
+           timers, (timers > 0) ? totalLate * 1e3 / (timers - timers / 4) : 0.0, maxLate * 1e3, periodicFires, busyCPU * 1e3, busyWakeups);
+    printf("[TIMER WHEEL TEST] %d idle timers: %.3f ms CPU & %d wakeups over %.0f ms, %.1f ns per cancel: %s\n",
+           timers, idleCPU * 1e3, idleWakeups, idleRun * 1e3, cancelSeconds * 1e9 / (timers > 0 ? timers : 1), ok ? "OK" : "FAILED");
+
+    free(wheelTimers);
+    free(records);
+    return ok;
+}
+
+#endif  // ENGINE_SELF_TESTS
@@ -1,7 +1,80 @@
 #include "timings.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define TIMINGS_HAS_TSC true
+#else
+#define TIMINGS_HAS_TSC false
+#endif
+
 TimerManager *timerManager;
 
+#ifdef CLOCK_MONOTONIC_RAW
+#define TIMINGS_CLOCK CLOCK_MONOTONIC_RAW  // not slewed by NTP, steadier deltas
+#else
+#define TIMINGS_CLOCK CLOCK_MONOTONIC
+#endif
+
+// Written once by #CalibrateTSC() before other threads read the clock
+static bool tscCalibrated = false;
+static uint64_t tscBase, clockBase;
+static double nanosecondsPerCycle;
+
+static uint64_t clock_nanoseconds(void) {
+  struct timespec now;
+  clock_gettime(TIMINGS_CLOCK, &now);
+  return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+bool CalibrateTSC(double seconds) {
+#if TIMINGS_HAS_TSC == true
+  unsigned int eax, ebx, ecx, edx;
+
+  // Invariant TSC (CPUID 0x80000007, EDX bit 8) ticks at a constant rate across
+  // power states & cores
+  if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 8))) {
+    return false;
+  }
+
+  tscCalibrated = false;
+
+  uint64_t startClock = clock_nanoseconds();
+  uint64_t startCycles = __rdtsc();
+  uint64_t endClock;
+
+  do {
+    endClock = clock_nanoseconds();
+  } while ((double)(endClock - startClock) < seconds * 1e9);
+
+  uint64_t endCycles = __rdtsc();
+  if (endCycles <= startCycles) return false;
+
+  nanosecondsPerCycle =
+      (double)(endClock - startClock) / (double)(endCycles - startCycles);
+  tscBase = endCycles;
+  clockBase = endClock;
+  tscCalibrated = true;
+
+  printf("[TIMINGS] TSC calibrated at %.3f GHz\n", 1.0 / nanosecondsPerCycle);
+  return true;
+#else
+  (void)seconds;
+  return false;
+#endif  // TIMINGS_HAS_TSC
+}
+
+uint64_t GetTimeNanoseconds(void) {
+#if TIMINGS_HAS_TSC == true
+  if (tscCalibrated) {
+    return clockBase +
+           (uint64_t)((double)(__rdtsc() - tscBase) * nanosecondsPerCycle);
+  }
+#endif  // TIMINGS_HAS_TSC
+
+  return clock_nanoseconds();
+}
+
 Timer *NewTimer(double lifeTime) {
   Timer *timer = malloc(sizeof(Timer));
   if (timer == NULL) {
@@ -21,17 +94,74 @@ Timer *NewTimer(double lifeTime) {
                 timerManager->totalTimerCapacity * sizeof(Timer *));
   }
 
+  timer->index = timerManager->totalTimers;
   timerManager->timers[timerManager->totalTimers] = timer;
   timerManager->totalTimers += 1;
   return timer;
 }
 
-double current_time(void) {
-    timerManager->seconds = glfwGetTime();
+void FreeTimer(Timer *timer) {
+  if (timer == NULL) return;
+
+  // The last timer takes the freed slot so the array stays packed
+  Timer *last = timerManager->timers[timerManager->totalTimers - 1];
+  timerManager->timers[timer->index] = last;
+  last->index = timer->index;
+  timerManager->totalTimers -= 1;
+
+  free(timer);
 }
 
+double current_time(void) { return GetTimeSeconds(); }
+
 void StartTimer(Timer *timer) { timer->startTime = current_time(); }
 
 bool TimerDone(Timer timer) { return GetElasped(timer) >= timer.lifeTime; }
 
-double GetElasped(Timer timer) { return current_time() - timer.startTime; }
\ No newline at end of file
+double GetElasped(Timer timer) { return current_time() - timer.startTime; }
+
+double FrameTimerTick(FrameTimer *frameTimer) {
+  uint64_t now = GetTimeNanoseconds();
+
+  if (frameTimer->lastFrame == 0) {
+    frameTimer->lastFrame = now;
+    return 0.0;
+  }
+
+  double delta = (double)(now - frameTimer->lastFrame) * 1e-9;
+  frameTimer->lastFrame = now;
+  frameTimer->delta = delta;
+
+  frameTimer->smoothed =
+      (frameTimer->count == 0)
+          ? delta
+          : frameTimer->smoothed +
+                (delta - frameTimer->smoothed) * TIMINGS_FRAME_SMOOTHING;
+
+  frameTimer->window[frameTimer->head] = delta;
+  frameTimer->head = (frameTimer->head + 1) % TIMINGS_FRAME_WINDOW;
+  if (frameTimer->count < TIMINGS_FRAME_WINDOW) frameTimer->count++;
+
+  return delta;
+}
+
+static int compare_seconds(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+FrameTimeStats GetFrameTimeStats(const FrameTimer *frameTimer) {
+  FrameTimeStats stats = {0};
+  int count = frameTimer->count;
+  if (count == 0) return stats;
+
+  double sorted[TIMINGS_FRAME_WINDOW];
+  for (int i = 0; i < count; i++) sorted[i] = frameTimer->window[i];
+  qsort(sorted, (size_t)count, sizeof(double), compare_seconds);
+
+  // Nearest rank, the p99 of a short window is its slowest frame
+  stats.p50 = sorted[(count * 50 + 99) / 100 - 1];
+  stats.p95 = sorted[(count * 95 + 99) / 100 - 1];
+  stats.p99 = sorted[(count * 99 + 99) / 100 - 1];
+  return stats;
+}
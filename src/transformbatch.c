@@ -0,0 +1,563 @@
+#include "transformbatch.h"
+
+#include <float.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "arena.h"
+#include "jobs.h"
+#include "render.h"
+#include "utils.h"
+
+#if ENGINE_SIMD_X86
+#include <immintrin.h>
+#endif
+
+/* pi/2 split in three so 'k * part' stays exact during the range reduction (Cody & Waite) */
+#define SINCOS_PIO2_1 1.5703125f
+#define SINCOS_PIO2_2 4.837512969970703125e-4f
+#define SINCOS_PIO2_3 7.54978995489188216e-8f
+#define SINCOS_TWO_OVER_PI 0.636619772367581343f
+
+/* Minimax polynomials on [-pi/4, pi/4], same coefficients as Cephes' sinf & cosf */
+#define SIN_P0 -1.9515295891e-4f
+#define SIN_P1 8.3321608736e-3f
+#define SIN_P2 -1.6666654611e-1f
+#define COS_P0 2.443315711809948e-5f
+#define COS_P1 -1.388731625493765e-3f
+#define COS_P2 4.166664568298827e-2f
+
+/*
+ -> translate -> rotate -> scale collapses into a closed form, with (x, y, z) the normalized axis & t = 1 - cos:
+        column 0 = sx * (x*x*t + c,   y*x*t + z*s, z*x*t - y*s, 0)
+        column 1 = sy * (x*y*t - z*s, y*y*t + c,   z*y*t + x*s, 0)
+        column 2 = sz * (x*z*t + y*s, y*z*t - x*s, z*z*t + c,   0)
+        column 3 =      (px,          py,          pz,          1)
+ -> That is glm_rotate_make's Rodrigues matrix term for term, translate & scale only touch column 3 & the column lengths.
+*/
+static inline void ComposeLane(const TransformSoA *soa, int i, mat4s *matrix) {
+    float angle = glm_rad(soa->degrees[i]);
+    float c = cosf(angle), s = sinf(angle), t = 1.0f - c;
+
+    float ax = soa->axisX[i], ay = soa->axisY[i], az = soa->axisZ[i];
+    float norm = sqrtf(ax * ax + ay * ay + az * az);
+    float x = 0.0f, y = 0.0f, z = 0.0f;
+
+    // glm_vec3_normalize_to gives a zero axis here, which leaves c on the diagonal
+    if (norm >= FLT_EPSILON) {
+        float inverse = 1.0f / norm;
+        x = ax * inverse;
+        y = ay * inverse;
+        z = az * inverse;
+    }
+
+    float xt = x * t, yt = y * t, zt = z * t;
+    float xs = x * s, ys = y * s, zs = z * s;
+    float sx = soa->scaleX[i], sy = soa->scaleY[i], sz = soa->scaleZ[i];
+
+    matrix->raw[0][0] = (x * xt + c) * sx;
+    matrix->raw[0][1] = (y * xt + zs) * sx;
+    matrix->raw[0][2] = (z * xt - ys) * sx;
+    matrix->raw[0][3] = 0.0f;
+
+    matrix->raw[1][0] = (x * yt - zs) * sy;
+    matrix->raw[1][1] = (y * yt + c) * sy;
+    matrix->raw[1][2] = (z * yt + xs) * sy;
+    matrix->raw[1][3] = 0.0f;
+
+    matrix->raw[2][0] = (x * zt + ys) * sz;
+    matrix->raw[2][1] = (y * zt - xs) * sz;
+    matrix->raw[2][2] = (z * zt + c) * sz;
+    matrix->raw[2][3] = 0.0f;
+
+    matrix->raw[3][0] = soa->positionX[i];
+    matrix->raw[3][1] = soa->positionY[i];
+    matrix->raw[3][2] = soa->positionZ[i];
+    matrix->raw[3][3] = 1.0f;
+}
+
+static void ComposeScalar(const TransformSoA *soa, mat4s *matrices, int begin) {
+    for (int i = begin; i < soa->count; i++) {
+        ComposeLane(soa, i, &matrices[i]);
+    }
+}
+
+#if ENGINE_SIMD_X86
+
+/* Four lanes of one column (x, y, z, w) become one column of four consecutive matrices */
+__attribute__((target("sse2"))) static inline void StoreColumn4(mat4s *matrices, int column, __m128 x, __m128 y, __m128 z, __m128 w) {
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+
+    _mm_storeu_ps(matrices[0].raw[column], x);
+    _mm_storeu_ps(matrices[1].raw[column], y);
+    _mm_storeu_ps(matrices[2].raw[column], z);
+    _mm_storeu_ps(matrices[3].raw[column], w);
+}
+
+/* Quadrant 'k' of x = k * pi/2 + r picks which polynomial & sign each result takes */
+__attribute__((target("sse2"))) static inline void SinCos4(__m128 x, __m128 *sinOut, __m128 *cosOut) {
+    __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(SINCOS_TWO_OVER_PI)));
+    __m128 k = _mm_cvtepi32_ps(quadrant);
+
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(k, _mm_set1_ps(SINCOS_PIO2_1)));
+    r = _mm_sub_ps(r, _mm_mul_ps(k, _mm_set1_ps(SINCOS_PIO2_2)));
+    r = _mm_sub_ps(r, _mm_mul_ps(k, _mm_set1_ps(SINCOS_PIO2_3)));
+
+    __m128 z = _mm_mul_ps(r, r);
+
+    __m128 sinPoly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_P0), z), _mm_set1_ps(SIN_P1));
+    sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(SIN_P2));
+    sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, z), r), r);
+
+    __m128 cosPoly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(COS_P0), z), _mm_set1_ps(COS_P1));
+    cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(COS_P2));
+    cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, z), z);
+    cosPoly = _mm_add_ps(_mm_sub_ps(cosPoly, _mm_mul_ps(_mm_set1_ps(0.5f), z)), _mm_set1_ps(1.0f));
+
+    __m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2);
+
+    // Odd quadrants swap sin & cos, bit 1 of k (k + 1 for cos) flips the sign
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+    __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, two), 30));
+    __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, one), two), 30));
+
+    __m128 s = _mm_or_ps(_mm_and_ps(swap, cosPoly), _mm_andnot_ps(swap, sinPoly));
+    __m128 c = _mm_or_ps(_mm_and_ps(swap, sinPoly), _mm_andnot_ps(swap, cosPoly));
+
+    *sinOut = _mm_xor_ps(s, sinSign);
+    *cosOut = _mm_xor_ps(c, cosSign);
+}
+
+__attribute__((target("sse2"))) static int ComposeSSE(const TransformSoA *soa, mat4s *matrices) {
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    int i = 0;
+
+    for (; i + 4 <= soa->count; i += 4) {
+        __m128 angle = _mm_div_ps(_mm_mul_ps(_mm_loadu_ps(&soa->degrees[i]), _mm_set1_ps(GLM_PIf)), _mm_set1_ps(180.0f));
+        __m128 s, c;
+        SinCos4(angle, &s, &c);
+        __m128 t = _mm_sub_ps(one, c);
+
+        __m128 ax = _mm_loadu_ps(&soa->axisX[i]);
+        __m128 ay = _mm_loadu_ps(&soa->axisY[i]);
+        __m128 az = _mm_loadu_ps(&soa->axisZ[i]);
+
+        __m128 norm = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, ax), _mm_mul_ps(ay, ay)), _mm_mul_ps(az, az)));
+        __m128 valid = _mm_cmpge_ps(norm, _mm_set1_ps(FLT_EPSILON));
+        __m128 inverse = _mm_div_ps(one, norm);
+
+        __m128 x = _mm_and_ps(valid, _mm_mul_ps(ax, inverse));
+        __m128 y = _mm_and_ps(valid, _mm_mul_ps(ay, inverse));
+        __m128 z = _mm_and_ps(valid, _mm_mul_ps(az, inverse));
+
+        __m128 xt = _mm_mul_ps(x, t), yt = _mm_mul_ps(y, t), zt = _mm_mul_ps(z, t);
+        __m128 xs = _mm_mul_ps(x, s), ys = _mm_mul_ps(y, s), zs = _mm_mul_ps(z, s);
+
+        __m128 sx = _mm_loadu_ps(&soa->scaleX[i]);
+        __m128 sy = _mm_loadu_ps(&soa->scaleY[i]);
+        __m128 sz = _mm_loadu_ps(&soa->scaleZ[i]);
+
+        StoreColumn4(&matrices[i], 0,
+                     _mm_mul_ps(_mm_add_ps(_mm_mul_ps(x, xt), c), sx),
+                     _mm_mul_ps(_mm_add_ps(_mm_mul_ps(y, xt), zs), sx),
+                     _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(z, xt), ys), sx),
+                     zero);
+
+        StoreColumn4(&matrices[i], 1,
+                     _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(x, yt), zs), sy),
+                     _mm_mul_ps(_mm_add_ps(_mm_mul_ps(y, yt), c), sy),
+                     _mm_mul_ps(_mm_add_ps(_mm_mul_ps(z, yt), xs), sy),
+                     zero);
+
+        StoreColumn4(&matrices[i], 2,
+                     _mm_mul_ps(_mm_add_ps(_mm_mul_ps(x, zt), ys), sz),
+                     _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(y, zt), xs), sz),
+                     _mm_mul_ps(_mm_add_ps(_mm_mul_ps(z, zt), c), sz),
+                     zero);
+
+        StoreColumn4(&matrices[i], 3,
+                     _mm_loadu_ps(&soa->positionX[i]),
+                     _mm_loadu_ps(&soa->positionY[i]),
+                     _mm_loadu_ps(&soa->positionZ[i]),
+                     one);
+    }
+
+    return i;
+}
+
+__attribute__((target("avx2"))) static inline void StoreColumn8(mat4s *matrices, int column, __m256 x, __m256 y, __m256 z, __m256 w) {
+    StoreColumn4(&matrices[0], column,
+                 _mm256_castps256_ps128(x), _mm256_castps256_ps128(y),
+                 _mm256_castps256_ps128(z), _mm256_castps256_ps128(w));
+
+    StoreColumn4(&matrices[4], column,
+                 _mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1),
+                 _mm256_extractf128_ps(z, 1), _mm256_extractf128_ps(w, 1));
+}
+
+__attribute__((target("avx2"))) static inline void SinCos8(__m256 x, __m256 *sinOut, __m256 *cosOut) {
+    __m256i quadrant = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(SINCOS_TWO_OVER_PI)));
+    __m256 k = _mm256_cvtepi32_ps(quadrant);
+
+    __m256 r = _mm256_sub_ps(x, _mm256_mul_ps(k, _mm256_set1_ps(SINCOS_PIO2_1)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(k, _mm256_set1_ps(SINCOS_PIO2_2)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(k, _mm256_set1_ps(SINCOS_PIO2_3)));
+
+    __m256 z = _mm256_mul_ps(r, r);
+
+    __m256 sinPoly = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(SIN_P0), z), _mm256_set1_ps(SIN_P1));
+    sinPoly = _mm256_add_ps(_mm256_mul_ps(sinPoly, z), _mm256_set1_ps(SIN_P2));
+    sinPoly = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(sinPoly, z), r), r);
+
+    __m256 cosPoly = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(COS_P0), z), _mm256_set1_ps(COS_P1));
+    cosPoly = _mm256_add_ps(_mm256_mul_ps(cosPoly, z), _mm256_set1_ps(COS_P2));
+    cosPoly = _mm256_mul_ps(_mm256_mul_ps(cosPoly, z), z);
+    cosPoly = _mm256_add_ps(_mm256_sub_ps(cosPoly, _mm256_mul_ps(_mm256_set1_ps(0.5f), z)), _mm256_set1_ps(1.0f));
+
+    __m256i one = _mm256_set1_epi32(1), two = _mm256_set1_epi32(2);
+
+    __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(quadrant, one), one));
+    __m256 sinSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(quadrant, two), 30));
+    __m256 cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(quadrant, one), two), 30));
+
+    *sinOut = _mm256_xor_ps(_mm256_blendv_ps(sinPoly, cosPoly, swap), sinSign);
+    *cosOut = _mm256_xor_ps(_mm256_blendv_ps(cosPoly, sinPoly, swap), cosSign);
+}
+
+__attribute__((target("avx2"))) static int ComposeAVX2(const TransformSoA *soa, mat4s *matrices) {
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+    int i = 0;
+
+    for (; i + 8 <= soa->count; i += 8) {
+        __m256 angle = _mm256_div_ps(_mm256_mul_ps(_mm256_loadu_ps(&soa->degrees[i]), _mm256_set1_ps(GLM_PIf)), _mm256_set1_ps(180.0f));
+        __m256 s, c;
+        SinCos8(angle, &s, &c);
+        __m256 t = _mm256_sub_ps(one, c);
+
+        __m256 ax = _mm256_loadu_ps(&soa->axisX[i]);
+        __m256 ay = _mm256_loadu_ps(&soa->axisY[i]);
+        __m256 az = _mm256_loadu_ps(&soa->axisZ[i]);
+
+        __m256 norm = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, ax), _mm256_mul_ps(ay, ay)), _mm256_mul_ps(az, az)));
+        __m256 valid = _mm256_cmp_ps(norm, _mm256_set1_ps(FLT_EPSILON), _CMP_GE_OQ);
+        __m256 inverse = _mm256_div_ps(one, norm);
+
+        __m256 x = _mm256_and_ps(valid, _mm256_mul_ps(ax, inverse));
+        __m256 y = _mm256_and_ps(valid, _mm256_mul_ps(ay, inverse));
+        __m256 z = _mm256_and_ps(valid, _mm256_mul_ps(az, inverse));
+
+        __m256 xt = _mm256_mul_ps(x, t), yt = _mm256_mul_ps(y, t), zt = _mm256_mul_ps(z, t);
+        __m256 xs = _mm256_mul_ps(x, s), ys = _mm256_mul_ps(y, s), zs = _mm256_mul_ps(z, s);
+
+        __m256 sx = _mm256_loadu_ps(&soa->scaleX[i]);
+        __m256 sy = _mm256_loadu_ps(&soa->scaleY[i]);
+        __m256 sz = _mm256_loadu_ps(&soa->scaleZ[i]);
+
+        StoreColumn8(&matrices[i], 0,
+                     _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(x, xt), c), sx),
+                     _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(y, xt), zs), sx),
+                     _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(z, xt), ys), sx),
+                     zero);
+
+        StoreColumn8(&matrices[i], 1,
+                     _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(x, yt), zs), sy),
+                     _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(y, yt), c), sy),
+                     _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(z, yt), xs), sy),
+                     zero);
+
+        StoreColumn8(&matrices[i], 2,
+                     _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(x, zt), ys), sz),
+                     _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(y, zt), xs), sz),
+                     _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(z, zt), c), sz),
+                     zero);
+
+        StoreColumn8(&matrices[i], 3,
+                     _mm256_loadu_ps(&soa->positionX[i]),
+                     _mm256_loadu_ps(&soa->positionY[i]),
+                     _mm256_loadu_ps(&soa->positionZ[i]),
+                     one);
+    }
+
+    return i;
+}
+
+#endif  // ENGINE_SIMD_X86
+
+void ComposeTransformsBatchLevel(SimdLevel level, const TransformSoA *soa, mat4s *matrices) {
+    SimdLevel supported = GetSimdLevel();
+    if (level > supported) level = supported;
+
+    int done = 0;
+
+#if ENGINE_SIMD_X86
+    if (level == SIMD_AVX2) {
+        done = ComposeAVX2(soa, matrices);
+    } else if (level == SIMD_SSE) {
+        done = ComposeSSE(soa, matrices);
+    }
+#endif
+
+    // Whatever doesn't fill a whole vector
+    ComposeScalar(soa, matrices, done);
+}
+
+void ComposeTransformsBatch(const TransformSoA *soa, mat4s *matrices) {
+    ComposeTransformsBatchLevel(GetSimdLevel(), soa, matrices);
+}
+
+void ReserveTransformSoA(TransformSoA *soa, int capacity) {
+    if (capacity <= soa->capacity) return;
+
+    // One block, ten streams back to back
+    float *block = (float *)realloc(soa->positionX, (size_t)capacity * 10 * sizeof(float));
+    if (block == NULL) {
+        fprintf(stderr, "[MEMORY ERROR] Failed growing Transform SoA to %d lanes\n", capacity);
+        return;
+    }
+
+    float **streams[] = {&soa->positionX, &soa->positionY, &soa->positionZ,
+                         &soa->axisX, &soa->axisY, &soa->axisZ, &soa->degrees,
+                         &soa->scaleX, &soa->scaleY, &soa->scaleZ};
+
+    for (int i = 0; i < 10; i++) {
+        *streams[i] = block + (size_t)i * capacity;
+    }
+
+    soa->capacity = capacity;
+}
+
+void FreeTransformSoA(TransformSoA *soa) {
+    free(soa->positionX);
+    *soa = (TransformSoA){0};
+}
+
+void GatherTransforms(TransformSoA *soa, const Transform *transforms, const int *indices, int count) {
+    ReserveTransformSoA(soa, count);
+    if (soa->capacity < count) count = soa->capacity;
+
+    for (int i = 0; i < count; i++) {
+        const Transform *transform = &transforms[(indices != NULL) ? indices[i] : i];
+
+        soa->positionX[i] = transform->position.x;
+        soa->positionY[i] = transform->position.y;
+        soa->positionZ[i] = transform->position.z;
+
+        soa->axisX[i] = transform->rotation.x;
+        soa->axisY[i] = transform->rotation.y;
+        soa->axisZ[i] = transform->rotation.z;
+        soa->degrees[i] = transform->rotationDegrees;
+
+        soa->scaleX[i] = transform->scale.x;
+        soa->scaleY[i] = transform->scale.y;
+        soa->scaleZ[i] = transform->scale.z;
+    }
+
+    soa->count = count;
+}
+
+/* Lanes point into the arena, the SoA must not outlive the arena mark it was pushed after */
+static bool PushTransformSoA(Arena *arena, TransformSoA *soa, int capacity) {
+    float *block = ArenaPush(arena, float, (size_t)capacity * 10);
+    if (block == NULL) return GLFW_FALSE;
+
+    float **streams[] = {&soa->positionX, &soa->positionY, &soa->positionZ,
+                         &soa->axisX, &soa->axisY, &soa->axisZ, &soa->degrees,
+                         &soa->scaleX, &soa->scaleY, &soa->scaleZ};
+
+    for (int i = 0; i < 10; i++) {
+        *streams[i] = block + (size_t)i * capacity;
+    }
+
+    soa->count = 0;
+    soa->capacity = capacity;
+    return GLFW_TRUE;
+}
+
+typedef struct DirtyTransforms {
+    Transform *transforms;
+    const int *indices;
+} DirtyTransforms;
+
+/* Gather, compose & write back indices[start, end), scratch comes from the running thread's arena */
+static void ComposeDirtyRange(void *data, int start, int end) {
+    DirtyTransforms *dirty = (DirtyTransforms *)data;
+    int count = end - start;
+
+    // Left dirty, composed one by one when they're read
+    Arena *arena = GetThreadArena();
+    if (arena == NULL) return;
+
+    size_t mark = ArenaMark(arena);
+
+    TransformSoA soa = (TransformSoA){0};
+    mat4s *matrices = (mat4s *)ArenaAlloc(arena, (size_t)count * sizeof(mat4s), 32);
+
+    if (matrices != NULL && PushTransformSoA(arena, &soa, count)) {
+        GatherTransforms(&soa, dirty->transforms, &dirty->indices[start], count);
+        ComposeTransformsBatch(&soa, matrices);
+
+        for (int i = 0; i < count; i++) {
+            Transform *transform = &dirty->transforms[dirty->indices[start + i]];
+
+            transform->model = matrices[i];
+            transform->dirty = GLFW_FALSE;
+            transform->version++;
+        }
+    }
+
+    ArenaRewind(arena, mark);
+}
+
+void UpdateDirtyTransforms(Transform *transforms, int count) {
+    int dirtyCount = 0;
+    for (int i = 0; i < count; i++) {
+        dirtyCount += transforms[i].dirty;
+    }
+
+    if (dirtyCount < ENGINE_TRANSFORM_BATCH_THRESHOLD) return;
+
+    // Scratch only lives for this call, any thread may get here
+    Arena *arena = GetThreadArena();
+    if (arena == NULL) return;
+
+    size_t mark = ArenaMark(arena);
+
+    int *indices = ArenaPush(arena, int, dirtyCount);
+
+    if (indices != NULL) {
+        int n = 0;
+        for (int i = 0; i < count; i++) {
+            if (transforms[i].dirty) indices[n++] = i;
+        }
+
+        // Ranges touch disjoint transforms, below one batch this runs inline on the calling thread
+        DirtyTransforms dirty = (DirtyTransforms){.transforms = transforms, .indices = indices};
+        ParallelFor(dirtyCount, ENGINE_TRANSFORM_PARALLEL_BATCH, ComposeDirtyRange, &dirty);
+    }
+
+    ArenaRewind(arena, mark);
+}
+
+#ifdef ENGINE_SELF_TESTS
+
+static Transform *NewRandomTransforms(int count) {
+    Transform *transforms = (Transform *)malloc((size_t)count * sizeof(Transform));
+    if (transforms == NULL) return NULL;
+
+    unsigned int state = 0x7A5u;
+
+    for (int i = 0; i < count; i++) {
+        Transform transform = (Transform){0};
+
+        transform.position = (vec3s){{RandomRange(&state, -1000.0f, 1000.0f), RandomRange(&state, -1000.0f, 1000.0f), RandomRange(&state, -1000.0f, 1000.0f)}};
+        transform.rotation = (vec3s){{RandomRange(&state, -1.0f, 1.0f), RandomRange(&state, -1.0f, 1.0f), RandomRange(&state, -1.0f, 1.0f)}};
+        transform.rotationDegrees = RandomRange(&state, -1080.0f, 1080.0f);
+        transform.scale = (vec3s){{RandomRange(&state, 0.1f, 10.0f), RandomRange(&state, 0.1f, 10.0f), RandomRange(&state, 0.1f, 10.0f)}};
+
+        // The cases cglm special cases or that land exactly on quadrant boundaries
+        if (i % 17 == 0) transform.rotation = (vec3s){{0.0f, 0.0f, 0.0f}};
+        if (i % 13 == 0) transform.rotationDegrees = 0.0f;
+        if (i % 11 == 0) transform.rotationDegrees = 90.0f * (float)((i / 11) % 9 - 4);
+
+        transforms[i] = transform;
+    }
+
+    return transforms;
+}
+
+bool TransformBatchSelfTest(int count) {
+    Transform *transforms = NewRandomTransforms(count);
+    mat4s *reference = (mat4s *)malloc((size_t)count * sizeof(mat4s));
+    mat4s *result = (mat4s *)malloc((size_t)count * sizeof(mat4s));
+    TransformSoA soa = (TransformSoA){0};
+
+    if (transforms == NULL || reference == NULL || result == NULL) {
+        fprintf(stderr, "[SIMD TEST] Failed allocating %d test transforms\n", count);
+        free(transforms);
+        free(reference);
+        free(result);
+        return GLFW_FALSE;
+    }
+
+    for (int i = 0; i < count; i++) {
+        reference[i] = ComposeTransform(&transforms[i]);
+    }
+
+    GatherTransforms(&soa, transforms, NULL, count);
+
+    bool passed = GLFW_TRUE;
+
+    for (SimdLevel level = SIMD_SCALAR; level <= GetSimdLevel(); level++) {
+        memset(result, 0, (size_t)count * sizeof(mat4s));
+        ComposeTransformsBatchLevel(level, &soa, result);
+
+        float maxError = 0.0f;
+        int worst = 0;
+
+        for (int i = 0; i < count; i++) {
+            for (int j = 0; j < 16; j++) {
+                float expected = reference[i].raw[j / 4][j % 4];
+                float error = fabsf(result[i].raw[j / 4][j % 4] - expected) / fmaxf(1.0f, fabsf(expected));
+
+                if (!(error <= maxError)) {
+                    maxError = error;
+                    worst = i;
+                }
+            }
+        }
+
+        bool ok = maxError <= 1e-5f;
+        passed = passed && ok;
+
+        printf("[SIMD TEST] %-6s %d transforms, max relative error %.3g (instance %d) => %s\n",
+               SimdLevelName(level), count, maxError, worst, (ok) ? "OK" : "FAILED");
+    }
+
+    FreeTransformSoA(&soa);
+    free(transforms);
+    free(reference);
+    free(result);
+
+    return passed;
+}
+
+void BenchmarkTransformBatch(int count, int iterations) {
+    Transform *transforms = NewRandomTransforms(count);
+    mat4s *matrices = (mat4s *)malloc((size_t)count * sizeof(mat4s));
+    TransformSoA soa = (TransformSoA){0};
+
+    if (transforms == NULL || matrices == NULL || iterations < 1) {
+        free(transforms);
+        free(matrices);
+        return;
+    }
+
+    GatherTransforms(&soa, transforms, NULL, count);
+
+    double start = GetTimeSeconds();
+    for (int n = 0; n < iterations; n++) {
+        for (int i = 0; i < count; i++) {
+            matrices[i] = ComposeTransform(&transforms[i]);
+        }
+    }
+    double reference = (GetTimeSeconds() - start) / iterations;
+
+    printf("[SIMD BENCH] cglm   %d instances: %.3f ms (%.2f ns/instance)\n", count, reference * 1e3, reference * 1e9 / count);
+
+    for (SimdLevel level = SIMD_SCALAR; level <= GetSimdLevel(); level++) {
+        start = GetTimeSeconds();
+        for (int n = 0; n < iterations; n++) {
+            ComposeTransformsBatchLevel(level, &soa, matrices);
+        }
+        double elapsed = (GetTimeSeconds() - start) / iterations;
+
+        printf("[SIMD BENCH] %-6s %d instances: %.3f ms (%.2f ns/instance, %.2fx)\n",
+               SimdLevelName(level), count, elapsed * 1e3, elapsed * 1e9 / count, reference / elapsed);
+    }
+
+    FreeTransformSoA(&soa);
+    free(transforms);
+    free(matrices);
+}
+
+#endif  // ENGINE_SELF_TESTS
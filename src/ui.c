@@ -2,6 +2,8 @@
 
 #include <string.h>
 
+#include "glstate.h"
+#include "profiler.h"
 #include "utils.h"
 
 Menu *menu;
@@ -120,11 +122,27 @@ Element *NewUIElement(Element element) {
     return newElement;
 }
 
-void DrawElement(Element *element, void (*update)(void)) {
-    if (!menu->shown || !ElementExists(element)) return;
+/* NanoVG's GL3 backend binds its own program, VAO, textures & blend state on flush */
+static inline void EndUIFrame(void) {
+    nvgEndFrame(engine->vgContext);
+    InvalidateStateCache();
+}
+
+UIFrame GetUIFrame(void) {
+    return (UIFrame){
+        .shown = menu != NULL && menu->shown,
+        .windowWidth = engine->windowWidth,
+        .windowHeight = engine->windowHeight,
+        .pixelRatio = engine->aspectRatio};
+}
+
+void DrawElement(Element *element, const UIFrame *frame, void (*update)(void)) {
+    PROFILE_ZONE("DrawElement");
+
+    if (!frame->shown || !ElementExists(element)) return;
 
     if (update != NULL) update();
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    StatePolygonMode(GL_FILL);
 
     float posX = element->transform.position.x;
     float posY = element->transform.position.y;
@@ -132,7 +150,7 @@ void DrawElement(Element *element, void (*update)(void)) {
 
     switch (element->type) {
         case ELEMENT_TEXTBOX:
-            nvgBeginFrame(engine->vgContext, engine->windowWidth, engine->windowHeight, engine->aspectRatio);
+            nvgBeginFrame(engine->vgContext, frame->windowWidth, frame->windowHeight, frame->pixelRatio);
 
             nvgFontSize(engine->vgContext, element->textScale);
             nvgFontFaceId(engine->vgContext, engine->defaultFont);
@@ -163,11 +181,11 @@ void DrawElement(Element *element, void (*update)(void)) {
             // }
 
             if (element->alignment & NVG_ALIGN_RIGHT) {
-                textPosX = engine->windowWidth - padding;
+                textPosX = frame->windowWidth - padding;
             }
 
             if (element->alignment & NVG_ALIGN_CENTER) {
-                textPosX = engine->windowWidth / 2;
+                textPosX = frame->windowWidth / 2;
             } else {
                 // printf("ELSE CENTER TOP\n");
                 // textPosX = engine->windowWidth - padding;
@@ -182,18 +200,18 @@ void DrawElement(Element *element, void (*update)(void)) {
 
             if (element->alignment & NVG_ALIGN_MIDDLE) {
                 // printf("MIDDLE TOP\n");
-                textPosY = engine->windowHeight / 2;
+                textPosY = frame->windowHeight / 2;
             }
 
             nvgText(engine->vgContext, textPosX, textPosY, element->text, NULL);
-            nvgEndFrame(engine->vgContext);
+            EndUIFrame();
             break;
         case ELEMENT_RECT:
         case ELEMENT_BUTTON:
             const float textPadding = 40.0f;
 
             // actual rectangle
-            nvgBeginFrame(engine->vgContext, engine->windowWidth, engine->windowHeight, engine->aspectRatio);
+            nvgBeginFrame(engine->vgContext, frame->windowWidth, frame->windowHeight, frame->pixelRatio);
 
             if (element->type == ELEMENT_BUTTON) {
                 nvgFillColor(engine->vgContext, (element->clickable.isHovered) ? element->hoverColor : element->color);
@@ -204,23 +222,23 @@ void DrawElement(Element *element, void (*update)(void)) {
             float rectPosX = 0.0f, rectPosY = 0.0f;
 
             if (element->alignment & NVG_ALIGN_RIGHT) {
-                rectPosX = engine->windowWidth - (padding + element->width);
+                rectPosX = frame->windowWidth - (padding + element->width);
             } else {
                 rectPosX = padding;
             }
 
             if (element->alignment & NVG_ALIGN_CENTER) {
-                rectPosX = engine->windowWidth / 2 - (element->width / 2);
+                rectPosX = frame->windowWidth / 2 - (element->width / 2);
             }
 
             if (element->alignment & NVG_ALIGN_TOP) {
                 rectPosY = padding;
             } else {
-                rectPosY = engine->windowHeight - (padding + element->height);
+                rectPosY = frame->windowHeight - (padding + element->height);
             }
 
             if (element->alignment & NVG_ALIGN_MIDDLE) {
-                rectPosY = engine->windowHeight / 2 - (element->height / 2);
+                rectPosY = frame->windowHeight / 2 - (element->height / 2);
             }
 
             element->transform.position = (vec3s){rectPosX, rectPosY, 0.0f};
@@ -230,11 +248,11 @@ void DrawElement(Element *element, void (*update)(void)) {
             nvgFill(engine->vgContext);
             nvgClosePath(engine->vgContext);
 
-            nvgEndFrame(engine->vgContext);
+            EndUIFrame();
 
             // draw text inside the rectangle
             if (element->text != NULL) {
-                nvgBeginFrame(engine->vgContext, engine->windowWidth, engine->windowHeight, engine->aspectRatio);
+                nvgBeginFrame(engine->vgContext, frame->windowWidth, frame->windowHeight, frame->pixelRatio);
 
                 float bounds[4];
                 nvgTextBounds(engine->vgContext, posX, posY, element->text, NULL, bounds);
@@ -252,7 +270,7 @@ void DrawElement(Element *element, void (*update)(void)) {
 
                 nvgText(engine->vgContext, posX + textPadding, posY + element->textScale, element->text, NULL);
 
-                nvgEndFrame(engine->vgContext);
+                EndUIFrame();
             }
             break;
         default:
@@ -0,0 +1,158 @@
+#include "upload.h"
+
+#include <pthread.h>
+#include <stdio.h>
+
+#include "glstate.h"
+#include "profiler.h"
+
+static pthread_mutex_t uploadLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Guarded by 'uploadLock', oldest first. Only the render thread removes from the front */
+static GpuUpload *head, *tail;
+static GpuUploadStats stats;
+
+void QueueGpuUpload(GpuUpload *upload) {
+    upload->next = NULL;
+
+    pthread_mutex_lock(&uploadLock);
+
+    if (tail != NULL) {
+        tail->next = upload;
+    } else {
+        head = upload;
+    }
+
+    tail = upload;
+    stats.queued++;
+
+    pthread_mutex_unlock(&uploadLock);
+}
+
+void ProcessGpuUploads(size_t budget) {
+    size_t start = budget;
+
+    pthread_mutex_lock(&uploadLock);
+    GpuUpload *upload = head;
+    pthread_mutex_unlock(&uploadLock);
+
+    if (upload == NULL) return;
+
+    PROFILE_GPU_ZONE("Uploads");
+
+    while (upload != NULL && budget > 0) {
+        // Stepped outside the lock, producers only ever touch the back of the queue
+        if (!upload->step(upload, &budget)) break;
+
+        pthread_mutex_lock(&uploadLock);
+
+        head = upload->next;
+        if (head == NULL) tail = NULL;
+        stats.completed++;
+
+        GpuUpload *next = head;
+        pthread_mutex_unlock(&uploadLock);
+
+        if (upload->done != NULL) upload->done(upload);
+        upload = next;
+    }
+
+    size_t moved = start - budget;
+
+    pthread_mutex_lock(&uploadLock);
+
+    stats.bytes += moved;
+    if (moved > stats.maxFrameBytes) stats.maxFrameBytes = moved;
+    if (moved > 0) stats.frames++;
+
+    pthread_mutex_unlock(&uploadLock);
+}
+
+void DiscardGpuUploads(void) {
+    pthread_mutex_lock(&uploadLock);
+    head = tail = NULL;
+    pthread_mutex_unlock(&uploadLock);
+}
+
+GpuUploadStats GetGpuUploadStats(void) {
+    pthread_mutex_lock(&uploadLock);
+    GpuUploadStats copy = stats;
+    pthread_mutex_unlock(&uploadLock);
+
+    return copy;
+}
+
+static size_t TakeBudget(size_t *budget, size_t bytes) {
+    *budget = (bytes < *budget) ? *budget - bytes : 0;
+    return bytes;
+}
+
+bool UploadBufferSlices(BufferSlices *slices, size_t *budget) {
+    // GL_COPY_WRITE_BUFFER isn't part of any VAO, filling an element buffer through it can't disturb a bound one
+    glBindBuffer(GL_COPY_WRITE_BUFFER, slices->buffer);
+
+    if (!slices->allocated) {
+        glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)slices->size, NULL, GL_STATIC_DRAW);
+        slices->allocated = GLFW_TRUE;
+    }
+
+    size_t remaining = slices->size - slices->offset;
+    size_t slice = (remaining < *budget) ? remaining : *budget;
+
+    if (slice > 0) {
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)slices->offset, (GLsizeiptr)slice, (const char *)slices->data + slices->offset);
+        slices->offset += TakeBudget(budget, slice);
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return slices->offset >= slices->size;
+}
+
+static GLenum TextureFormat(int channels) {
+    switch (channels) {
+        case 1:
+            return GL_RED;
+        case 2:
+            return GL_RG;
+        case 3:
+            return GL_RGB;
+        default:
+            return GL_RGBA;
+    }
+}
+
+bool UploadTextureSlices(TextureSlices *slices, size_t *budget) {
+    GLenum format = TextureFormat(slices->channels);
+    size_t rowBytes = (size_t)slices->width * (size_t)slices->channels;
+
+    StateBindTexture(0, GL_TEXTURE_2D, slices->texture);
+
+    if (!slices->allocated) {
+        glTexImage2D(GL_TEXTURE_2D, 0, format, slices->width, slices->height, 0, format, GL_UNSIGNED_BYTE, NULL);
+        slices->allocated = GLFW_TRUE;
+    }
+
+    // At least one row, a row wider than the whole budget still has to make progress
+    int rows = (rowBytes > 0) ? (int)(*budget / rowBytes) : slices->height;
+    if (rows < 1) rows = 1;
+    if (rows > slices->height - slices->row) rows = slices->height - slices->row;
+
+    if (rows > 0) {
+        // Rows of 1 & 3 channel images aren't 4 byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, slices->row, slices->width, rows, format, GL_UNSIGNED_BYTE,
+                        slices->pixels + (size_t)slices->row * rowBytes);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        slices->row += rows;
+        TakeBudget(budget, (size_t)rows * rowBytes);
+    }
+
+    if (slices->row < slices->height) return GLFW_FALSE;
+
+    // Counted as the third of the image the mip chain adds
+    glGenerateMipmap(GL_TEXTURE_2D);
+    TakeBudget(budget, rowBytes * (size_t)slices->height / 3);
+
+    return GLFW_TRUE;
+}
@@ -1,5 +1,6 @@
 #include "utils.h"
 #include "physics.h"
+#include "render.h"
 
 bool isPointInsideElement(Element *element, vec2s cursor) {
     if (element != NULL) {
@@ -58,6 +59,7 @@ bool isPointInsideElement(Element *element, vec2s cursor) {
 bool isPointInside3DObj(SceneObject *object, Model3D *model, vec2s cursor) {
     if (object != NULL) {
         BoundingBox *boundingBox = (object != NULL) ? object->transforms->boundingBox : model->transforms->boundingBox;
+        Transform *transforms = (object != NULL) ? object->transforms : model->transforms;
 
         // vec3s unprojectedPosition = glms_unproject(object->transforms->position, object->transforms->model, glms_mat4_mul(camera->projection, camera->view));
 
@@ -84,9 +86,10 @@ bool isPointInside3DObj(SceneObject *object, Model3D *model, vec2s cursor) {
                 };
             }
 
-            // Negate min for projection if required
-            vec2s minScreen = projectToScreenSpace(boundingBox->min);
-            vec2s maxScreen = projectToScreenSpace(boundingBox->max);
+            // Box corners are in model space, take them to world space with the cached box matrix first
+            mat4s *boxMatrix = GetBoundingBoxMatrix(boundingBox, transforms);
+            vec2s minScreen = projectToScreenSpace(glms_mat4_mulv3(*boxMatrix, boundingBox->min, 1.0f));
+            vec2s maxScreen = projectToScreenSpace(glms_mat4_mulv3(*boxMatrix, boundingBox->max, 1.0f));
 
             // Check if the cursor is inside the projected 2D bounding box
             return (cursor.x >= fmin(minScreen.x, maxScreen.x) && cursor.x <= fmax(minScreen.x, maxScreen.x)) &&
@@ -98,7 +101,7 @@ bool isPointInside3DObj(SceneObject *object, Model3D *model, vec2s cursor) {
 
     return GLFW_FALSE;
 }
-static inline void DetectSelectedAxis(SceneObject *object, Model3D *model, vec2s cursor) {
+static inline void DetectSelectedAxis(SceneObject *object, Model3D *model, Ray ray) {
     Transform *transforms = (object != NULL) ? object->transforms : model->transforms;
     TransformGizmo gizmo = (object != NULL) ? object->gizmo : model->gizmo;
     Axis *axes = (Axis *)gizmo.axes;
@@ -109,8 +112,6 @@ static inline void DetectSelectedAxis(SceneObject *object, Model3D *model, vec2s
     float closestDistance = INFINITY;
     float distance;
 
-    Ray ray = (Ray)GenerateRay(camera, cursor);
-
     // X-axis
     Axis x_axis = (Axis)axes[0];
     if (RayIntersectsAxis(ray, position.raw, x_axis.position.raw, closestDistance, &distance)) {
@@ -147,7 +148,7 @@ static inline void DetectSelectedAxis(SceneObject *object, Model3D *model, vec2s
     engine->selectedAxis = selectedAxis;
 }
 
-void TransformGizmoUpdateObject(SceneObject *object, Model3D *model, vec3s delta, vec2s cursor) {
+void TransformGizmoUpdateObject(SceneObject *object, Model3D *model, vec3s delta, Ray ray) {
     Transform *transforms = (object != NULL) ? object->transforms : model->transforms;
     TransformGizmo gizmo = (object != NULL) ? object->gizmo : model->gizmo;
     Axis *axes = (Axis *)gizmo.axes;
@@ -155,7 +156,7 @@ void TransformGizmoUpdateObject(SceneObject *object, Model3D *model, vec3s delta
     vec3s position = transforms->position;
     vec3s selectedAxis = engine->selectedAxis;
 
-    DetectSelectedAxis(object, model, cursor);
+    DetectSelectedAxis(object, model, ray);
 
     if (axes[0].type == AXIS_X) {
         printf("X_AXIS update true\n");
@@ -168,6 +169,8 @@ void TransformGizmoUpdateObject(SceneObject *object, Model3D *model, vec3s delta
         transforms->position.raw[2] += delta.raw[2];
     }
 
+    MarkTransformDirty(transforms);
+
     // if (selectedAxis.x == 1.0f) {
     //     printf("X_AXIS update true\n");
     //     transforms->position.raw[0] += delta.raw[0];
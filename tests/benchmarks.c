@@ -0,0 +1,35 @@
+#include <stdio.h>
+#include "engine.h"
+
+#include "arena.h"
+#include "assets.h"
+#include "bvh.h"
+#include "culling.h"
+#include "jobs.h"
+#include "meshbvh.h"
+#include "model3d.h"
+#include "profiler.h"
+#include "simd.h"
+#include "transformbatch.h"
+
+/* Every engine benchmark without a window or GL context, results are printed */
+int main(void) {
+    InitProfiler();
+    InitJobSystem(ENGINE_JOB_WORKERS);
+    InitAssetRegistry();
+
+    printf("[TAV ENGINE] => SIMD level: %s\n", SimdLevelName(GetSimdLevel()));
+
+    BenchmarkTransformBatch(100000, 20);
+    BenchmarkCulling(100000, 20);
+    BenchmarkBVH();
+    BenchmarkMeshBVH(100000, 2000);
+    BenchmarkModelImport(512, 3000);
+
+    ShutdownJobSystem();
+    FreeThreadArena();
+    ShutdownProfiler();
+    ShutdownAssetRegistry();
+
+    return EXIT_SUCCESS;
+}
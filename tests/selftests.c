@@ -0,0 +1,36 @@
+#include <stdio.h>
+#include "engine.h"
+
+#include "arena.h"
+#include "culling.h"
+#include "jobs.h"
+#include "meshbvh.h"
+#include "profiler.h"
+#include "simd.h"
+#include "timerwheel.h"
+#include "transformbatch.h"
+
+/* Every engine self test without a window or GL context, exits with failure when one of them fails */
+int main(void) {
+    InitProfiler();
+    InitJobSystem(ENGINE_JOB_WORKERS);
+    InitTimerWheel();
+
+    printf("[TAV ENGINE] => SIMD level: %s\n", SimdLevelName(GetSimdLevel()));
+
+    // Not short circuited, every test runs & prints its result
+    bool ok = ProfilerSelfTest(1 << 20);
+    ok &= JobSystemSelfTest();
+    ok &= TimerWheelSelfTest(4096);
+    ok &= TransformBatchSelfTest(4099);
+    ok &= CullingSelfTest(10007);
+    ok &= MeshBVHSelfTest(4099, 2000);
+
+    ShutdownTimerWheel();
+    ShutdownJobSystem();
+    FreeThreadArena();
+    ShutdownProfiler();
+
+    printf("[TAV ENGINE] Self tests: %s\n", ok ? "OK" : "FAILED");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}